@@ -19,6 +19,7 @@
  */
 
 #include <utility>
+#include <fstream>
 
 #include "kord_exception.hh"
 #include "approximation.hh"
@@ -67,6 +68,14 @@ Approximation::getFoldDecisionRule() const
   return *fdr;
 }
 
+void
+Approximation::setCompiledRule(std::shared_ptr<const CompiledRule> c)
+{
+  KORD_RAISE_IF(!fdr,
+                "Folded decision rule has not been created in Approximation::setCompiledRule");
+  fdr->setCompiled(std::move(c));
+}
+
 /* This just returns ‘udr’ with a check that it is created. */
 const UnfoldDecisionRule &
 Approximation::getUnfoldDecisionRule() const
@@ -84,21 +93,13 @@ void
 Approximation::approxAtSteady()
 {
   model.calcDerivativesAtSteady();
+
   FirstOrder fo(model.nstat(), model.npred(), model.nboth(), model.nforw(),
                 model.nexog(), model.getModelDerivatives().get(Symmetry{1}),
                 journal, qz_criterium);
 
   if (model.order() >= 2)
-    {
-      KOrder korder(model.nstat(), model.npred(), model.nboth(), model.nforw(),
-                    model.getModelDerivatives(), fo.getGy(), fo.getGu(),
-                    model.getVcov(), journal);
-      korder.switchToFolded();
-      for (int k = 2; k <= model.order(); k++)
-        korder.performStep<Storage::fold>(k);
-
-      saveRuleDerivs(korder.getFoldDers());
-    }
+    approxHigherOrders(fo.getGy(), fo.getGu());
   else
     {
       FirstOrderDerivs<Storage::fold> fo_ders(fo);
@@ -107,6 +108,41 @@ Approximation::approxAtSteady()
   check(0.0);
 }
 
+/* This calculates the derivatives of orders 2 and more from the first order
+   ones, and saves them. The orders already known, either from the previous
+   derivatives or from the checkpoint file, are not recalculated. */
+
+void
+Approximation::approxHigherOrders(const TwoDMatrix &gy, const TwoDMatrix &gu)
+{
+  SylvParams sylv_pars;
+  sylv_pars.mixed_precision = sylv_mixed_precision;
+  KOrder korder(model.nstat(), model.npred(), model.nboth(), model.nforw(),
+                model.getModelDerivatives(), gy, gu, model.getVcov(), journal, sylv_pars);
+  korder.switchToFolded();
+  int done = 1;
+  if (prev_ders)
+    done = korder.restoreDerivatives(*prev_ders);
+  else if (resume && !checkpoint.empty())
+    {
+      if (std::ifstream(checkpoint))
+        done = korder.loadCheckpoint(checkpoint);
+      else
+        {
+          JournalRecord rec(journal);
+          rec << "Checkpoint file " << checkpoint << " not found, starting from order 2" << endrec;
+        }
+    }
+  for (int k = done+1; k <= model.order(); k++)
+    {
+      korder.performStep<Storage::fold>(k);
+      if (!checkpoint.empty())
+        korder.saveCheckpoint(checkpoint);
+    }
+
+  saveRuleDerivs(korder.getFoldDers());
+}
+
 /* This is the core routine of Approximation class.
 
    First we solve for the approximation about the deterministic steady state.
@@ -70,6 +70,8 @@
 #include "journal.hh"
 
 #include <memory>
+#include <string>
+#include <utility>
 
 /* This class is used to calculate derivatives by Faà Di Bruno of
    f(g**(g*(y*,u,σ),u′,σ),g(y*,u,σ),y*,u) with respect to u′. In order to keep
@@ -115,7 +117,20 @@ public:
 
    ‘dr_centralize’ is a new option. Dynare++ was automatically expressing
    results around the fixed point instead of the deterministic steady state.
-   ‘dr_centralize’ controls this behavior. */
+   ‘dr_centralize’ controls this behavior.
+
+   If a checkpoint file is set by setCheckpoint(), approxAtSteady() writes
+   the derivatives to it after each order of the k-order step, and if
+   ‘resume’ is true, it first reads them back from it (if it exists) and
+   only computes the missing orders. Only the approximation about the
+   deterministic steady state is checkpointed: the steps toward the
+   stochastic steady state are recomputed from it.
+
+   Similarly, setPreviousDerivatives() gives the derivatives of a previous
+   approximation of the same model about the deterministic steady state
+   (typically of a lower order). Then approxAtSteady() checks that the first
+   order solution of the model is theirs, takes the derivatives of higher
+   orders from them, and only computes the orders they miss. */
 
 class Approximation
 {
@@ -133,6 +148,10 @@ class Approximation
   bool dr_centralize;
   double qz_criterium;
   TwoDMatrix ss;
+  std::string checkpoint;
+  bool resume{false};
+  bool sylv_mixed_precision{false};
+  std::unique_ptr<FGSContainer> prev_ders;
 public:
   Approximation(DynamicModel &m, Journal &j, int ns, bool dr_centr, double qz_crit);
 
@@ -149,7 +168,31 @@ public:
     return model;
   }
 
+  void
+  setCheckpoint(std::string fname, bool res)
+  {
+    checkpoint = std::move(fname);
+    resume = res;
+  }
+
+  /* Makes the k-order step solve its Sylvester equations in single
+     precision with iterative refinement (see GeneralSylvester.hh) */
+  void
+  setSylvMixedPrecision(bool mixed)
+  {
+    sylv_mixed_precision = mixed;
+  }
+
+  void
+  setPreviousDerivatives(const FGSContainer &ders)
+  {
+    prev_ders = std::make_unique<FGSContainer>(ders);
+  }
+
   void walkStochSteady();
+  /* Makes the folded decision rule evaluated by a compiled polynomial (see
+     CompiledRule). It must be called after walkStochSteady(). */
+  void setCompiledRule(std::shared_ptr<const CompiledRule> c);
   TwoDMatrix calcYCov() const;
   const FGSContainer &
   get_rule_ders() const
@@ -168,6 +211,7 @@ public:
   }
 protected:
   void approxAtSteady();
+  void approxHigherOrders(const TwoDMatrix &gy, const TwoDMatrix &gu);
   void calcStochShift(Vector &out, double at_sigma) const;
   void saveRuleDerivs(const FGSContainer &g);
   void check(double at_sigma) const;
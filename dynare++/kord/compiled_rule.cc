@@ -0,0 +1,308 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "compiled_rule.hh"
+#include "kord_exception.hh"
+#include "t_polynomial.hh"
+
+#if !defined(_WIN32) && !defined(__CYGWIN32__)
+# include <dlfcn.h> // unix/linux DLL (.so) handling routines
+#endif
+
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <vector>
+
+namespace
+{
+  // Returns the reason of the last failure of the dynamic loader
+  std::string
+  loadError()
+  {
+#if defined(_WIN32) || defined(__CYGWIN32__)
+    return "";
+#else
+    const char *err = dlerror();
+    return err ? std::string{": "} + err : "";
+#endif
+  }
+
+  /* This maintains the names of the monomials used by the generated code.
+     A monomial is given by its sorted coordinates. A monomial of degree 1 is
+     the variable itself, and a monomial of degree d>1 is defined (when it is
+     first used) as the product of the monomial of its first d−1 coordinates
+     and the variable of the last one. */
+  class MonomialNames
+  {
+    std::map<IntSequence, std::string> names;
+    std::ostream &defs;
+    int nmon{0};
+  public:
+    explicit MonomialNames(std::ostream &d)
+      : defs(d)
+    {
+    }
+    const std::string &
+    get(const IntSequence &coor)
+    {
+      auto it = names.find(coor);
+      if (it != names.end())
+        return it->second;
+      int d = coor.size();
+      std::string var = "x[" + std::to_string(coor[d-1]) + "]";
+      std::string name = var;
+      if (d > 1)
+        {
+          const std::string &prefix = get(IntSequence(coor, 0, d-1));
+          name = "m" + std::to_string(nmon++);
+          defs << "      const double " << name << " = " << prefix << '*' << var << ";\n";
+        }
+      return names.emplace(coor, name).first->second;
+    }
+  };
+
+  /* Returns the number of distinct permutations of sorted coordinates, this
+     is the number of the columns of the unfolded tensor represented by a
+     column of the folded one */
+  double
+  multiplicity(const IntSequence &coor)
+  {
+    double res = 1.0;
+    int run = 1;
+    for (int i = 1; i < coor.size(); i++)
+      {
+        run = coor[i] == coor[i-1] ? run+1 : 1;
+        res *= static_cast<double>(i+1)/run;
+      }
+    return res;
+  }
+
+  // Writes a column of a tensor multiplied by ‘mult’ as a C initializer
+  void
+  writeColumn(std::ostream &out, const FFSTensor &t, int col, double mult)
+  {
+    out << "  {";
+    for (int r = 0; r < t.nrows(); r++)
+      {
+        double c = mult*t.get(r, col);
+        KORD_RAISE_IF(!std::isfinite(c),
+                      "Cannot generate the code of a rule with non-finite coefficients");
+        out << (r > 0 ? ", " : " ") << c;
+      }
+    out << " }";
+  }
+}
+
+CompiledRule::CompiledRule(const std::string &libname)
+{
+  std::string fname = libname;
+#if defined(_WIN32) || defined(__CYGWIN32__)
+  handle = LoadLibrary(fname.c_str());
+#else
+  // Without a slash, dlopen() would not look in the current directory
+  if (fname.find('/') == std::string::npos)
+    fname = "./" + fname;
+  handle = dlopen(fname.c_str(), RTLD_NOW);
+#endif
+  KORD_RAISE_IF(!handle, "Error when loading compiled rule " + fname + loadError());
+
+  dims_fct dims;
+  checksum_fct checksum_ptr;
+#if defined(_WIN32) || defined(__CYGWIN32__)
+  dims = reinterpret_cast<dims_fct>(GetProcAddress(handle, "dynare_rule_dims"));
+  checksum_ptr = reinterpret_cast<checksum_fct>(GetProcAddress(handle, "dynare_rule_checksum"));
+  eval_ptr = reinterpret_cast<eval_fct>(GetProcAddress(handle, "dynare_rule_eval"));
+#else
+  dims = reinterpret_cast<dims_fct>(dlsym(handle, "dynare_rule_dims"));
+  checksum_ptr = reinterpret_cast<checksum_fct>(dlsym(handle, "dynare_rule_checksum"));
+  eval_ptr = reinterpret_cast<eval_fct>(dlsym(handle, "dynare_rule_eval"));
+#endif
+  if (!dims || !checksum_ptr || !eval_ptr)
+    {
+      std::string err = loadError();
+#if defined(_WIN32) || defined(__CYGWIN32__)
+      FreeLibrary(handle);
+#else
+      dlclose(handle);
+#endif
+      KORD_RAISE("Error when loading symbols from compiled rule " + fname + err);
+    }
+  dims(&ny, &nv, &order);
+  sum = checksum_ptr();
+}
+
+CompiledRule::~CompiledRule()
+{
+#if defined(_WIN32) || defined(__CYGWIN32__)
+  FreeLibrary(handle);
+#else
+  dlclose(handle);
+#endif
+}
+
+void
+CompiledRule::eval(Vector &out, const ConstVector &v) const
+{
+  KORD_RAISE_IF(out.length() != ny || v.length() != nv,
+                "Wrong dimensions of input or output in CompiledRule::eval");
+  Vector vc(v), outc(ny);
+  eval_ptr(1, vc.base(), nv, outc.base(), ny);
+  out = outc;
+}
+
+void
+CompiledRule::evalBatch(GeneralMatrix &out, const ConstGeneralMatrix &v) const
+{
+  KORD_RAISE_IF(out.nrows() != ny || v.nrows() != nv || out.ncols() != v.ncols(),
+                "Wrong dimensions of input or output in CompiledRule::evalBatch");
+  if (v.ncols() > 0)
+    eval_ptr(v.ncols(), v.base(), v.getLD(), out.base(), out.getLD());
+}
+
+/* This is the FNV-1a hash of the bytes of the dimensions and of the data of
+   the tensors, in the order of their dimensions. */
+
+std::uint64_t
+CompiledRule::checksum(const FTensorPolynomial &pol)
+{
+  std::uint64_t h = 14695981039346656037ULL;
+  auto add = [&h](const void *p, std::size_t n)
+             {
+               for (std::size_t i = 0; i < n; i++)
+                 {
+                   h ^= static_cast<const unsigned char *>(p)[i];
+                   h *= 1099511628211ULL;
+                 }
+             };
+  for (int i : { pol.nrows(), pol.nvars(), pol.getMaxDim() })
+    add(&i, sizeof i);
+  for (int d = 0; d <= pol.getMaxDim(); d++)
+    if (pol.check(Symmetry{d}))
+      {
+        ConstVector data = pol.get(Symmetry{d}).getData();
+        add(&d, sizeof d);
+        for (int i = 0; i < data.length(); i++)
+          add(&data[i], sizeof(double));
+      }
+  return h;
+}
+
+std::uint64_t
+CompiledRule::checksum(const UTensorPolynomial &pol)
+{
+  return checksum(FTensorPolynomial(pol));
+}
+
+/* The code is written in two parts: while we go through the columns of the
+   tensors of order 1 and more, we write the definitions of the monomials and
+   the non-zero columns to separate streams, and then we assemble the file.
+
+   A column of a folded tensor stands for all the permutations of its
+   coordinates, so its coefficients are multiplied by their number, since
+   they all give the same monomial. */
+
+void
+CompiledRule::writeC(const FTensorPolynomial &pol, const std::string &fname)
+{
+  int ny = pol.nrows(), nv = pol.nvars(), order = pol.getMaxDim();
+
+  std::ostringstream defs, cols, weights;
+  cols << std::setprecision(std::numeric_limits<double>::max_digits10);
+  MonomialNames monomials(defs);
+  int ncols = 0;
+  for (int d = 1; d <= order; d++)
+    {
+      if (!pol.check(Symmetry{d}))
+        continue;
+      const FFSTensor &t = pol.get(Symmetry{d});
+      for (Tensor::index run = t.begin(); run != t.end(); ++run)
+        {
+          bool nonzero = false;
+          for (int r = 0; r < ny && !nonzero; r++)
+            nonzero = t.get(r, *run) != 0.0;
+          if (!nonzero)
+            continue;
+          cols << (ncols > 0 ? ",\n" : "");
+          writeColumn(cols, t, *run, multiplicity(run.getCoor()));
+          weights << (ncols > 0 ? ", " : "") << monomials.get(run.getCoor());
+          ncols++;
+        }
+    }
+
+  std::ofstream out(fname);
+  KORD_RAISE_IF(!out, "Cannot open file " + fname);
+  out << std::setprecision(std::numeric_limits<double>::max_digits10)
+      << "/* Decision rule generated by Dynare++ (ny=" << ny << ", nv=" << nv
+      << ", order=" << order << ").\n"
+      << "   Compile it as a shared library, for instance with:\n"
+      << "    cc -O3 -march=native -shared -fPIC -o rule.so " << fname << " */\n\n"
+      << "#if defined(_WIN32) || defined(__CYGWIN32__)\n"
+      << "# define EXPORT __declspec(dllexport)\n"
+      << "#else\n"
+      << "# define EXPORT\n"
+      << "#endif\n\n"
+      << "#define NY " << ny << "\n\n";
+
+  out << "static const double g0[NY] =\n";
+  if (pol.check(Symmetry{0}))
+    writeColumn(out, pol.get(Symmetry{0}), 0, 1.0);
+  else
+    out << "  { 0 }";
+  out << ";\n\n";
+  if (ncols > 0)
+    out << "#define NCOLS " << ncols << "\n\n"
+        << "static const double g[NCOLS][NY] =\n{\n" << cols.str() << "\n};\n\n";
+
+  out << "EXPORT void\n"
+      << "dynare_rule_dims(int *ny, int *nv, int *order)\n"
+      << "{\n"
+      << "  *ny = NY;\n"
+      << "  *nv = " << nv << ";\n"
+      << "  *order = " << order << ";\n"
+      << "}\n\n"
+      << "EXPORT unsigned long long\n"
+      << "dynare_rule_checksum(void)\n"
+      << "{\n"
+      << "  return " << checksum(pol) << "ULL;\n"
+      << "}\n\n"
+      << "EXPORT void\n"
+      << "dynare_rule_eval(int npoints, const double *v, int ldv, double *out, int ldout)\n"
+      << "{\n"
+      << "  for (int p = 0; p < npoints; p++)\n"
+      << "    {\n"
+      << "      const double *x = v + (long) p*ldv;\n"
+      << "      double *y = out + (long) p*ldout;\n"
+      << "      for (int r = 0; r < NY; r++)\n"
+      << "        y[r] = g0[r];\n";
+  if (ncols > 0)
+    out << defs.str()
+        << "      const double w[NCOLS] = { " << weights.str() << " };\n"
+        << "      for (int k = 0; k < NCOLS; k++)\n"
+        << "        for (int r = 0; r < NY; r++)\n"
+        << "          y[r] += g[k][r]*w[k];\n";
+  out << "    }\n"
+      << "}\n";
+
+  out.close();
+  KORD_RAISE_IF(!out, "Cannot write file " + fname);
+}
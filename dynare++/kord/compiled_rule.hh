@@ -0,0 +1,126 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Decision rule compiled to native code
+
+/* A decision rule is evaluated by the generic code of TensorPolynomial, which
+   loops over the tensors and their symmetries at runtime. When a fixed rule is
+   evaluated a very large number of times (long simulations, particle filters),
+   it pays to specialize the code for the rule. So we provide here a generator
+   writing a folded polynomial as a C source file, and the class CompiledRule,
+   which loads the shared library compiled from this file and evaluates the
+   polynomial with it.
+
+   The generated code evaluates the monomials of the state by straight-line
+   code (each monomial of degree d is the product of a monomial of degree d−1
+   and a variable, and only the monomials having a non-zero coefficient, and
+   their factors, are computed). The coefficients of the monomials are stored
+   as columns of length ‘ny’, so that adding a monomial times its column to the
+   result is a loop over contiguous memory, which the C compiler vectorizes.
+
+   The generated library exports three functions:
+
+    void dynare_rule_dims(int *ny, int *nv, int *order);
+    unsigned long long dynare_rule_checksum(void);
+    void dynare_rule_eval(int npoints, const double *v, int ldv,
+                          double *out, int ldout);
+
+   The first one returns the dimensions of the polynomial, the second one
+   the checksum of its coefficients (see checksum()), so that a library can
+   be checked against the rule it is supposed to evaluate, and the third one
+   evaluates it at ‘npoints’ points given as columns of the matrix ‘v’ (with
+   leading dimension ‘ldv’), and stores the results in the columns of ‘out’.
+
+   The library is loaded by dlopen() (or LoadLibrary() under Windows), as the
+   dynamic model in the k_order_perturbation MEX. */
+
+#ifndef COMPILED_RULE_H
+#define COMPILED_RULE_H
+
+#if defined(_WIN32) || defined(__CYGWIN32__)
+# ifndef NOMINMAX
+#  define NOMINMAX // Do not define "min" and "max" macros
+# endif
+# include <windows.h>
+#endif
+
+#include "GeneralMatrix.hh"
+#include "Vector.hh"
+
+#include <cstdint>
+#include <string>
+
+class FTensorPolynomial;
+class UTensorPolynomial;
+
+class CompiledRule
+{
+  using dims_fct = void (*)(int *ny, int *nv, int *order);
+  using checksum_fct = unsigned long long (*)();
+  using eval_fct = void (*)(int npoints, const double *v, int ldv, double *out, int ldout);
+#if defined(_WIN32) || defined(__CYGWIN32__)
+  HINSTANCE handle;
+#else
+  void *handle;
+#endif
+  eval_fct eval_ptr;
+  int ny, nv, order;
+  std::uint64_t sum;
+public:
+  // Loads the shared library
+  explicit CompiledRule(const std::string &libname);
+  CompiledRule(const CompiledRule &) = delete;
+  CompiledRule &operator=(const CompiledRule &) = delete;
+  ~CompiledRule();
+
+  int
+  nrows() const
+  {
+    return ny;
+  }
+  int
+  nvars() const
+  {
+    return nv;
+  }
+  int
+  getOrder() const
+  {
+    return order;
+  }
+  std::uint64_t
+  getChecksum() const
+  {
+    return sum;
+  }
+
+  // Evaluates the polynomial at ‘v’
+  void eval(Vector &out, const ConstVector &v) const;
+  // Evaluates the polynomial at the columns of ‘v’
+  void evalBatch(GeneralMatrix &out, const ConstGeneralMatrix &v) const;
+
+  // Writes the C source of the polynomial to the given file
+  static void writeC(const FTensorPolynomial &pol, const std::string &fname);
+  /* Returns a hash of the dimensions and of the coefficients of the
+     polynomial, the unfolded one is folded first */
+  static std::uint64_t checksum(const FTensorPolynomial &pol);
+  static std::uint64_t checksum(const UTensorPolynomial &pol);
+};
+
+#endif
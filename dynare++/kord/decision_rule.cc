@@ -27,10 +27,31 @@
 
 #include <dynlapack.h>
 
+#include <algorithm>
 #include <limits>
 #include <utility>
 #include <memory>
 
+namespace
+{
+  /* Welford update of the means and of the sums of squared deviations of the
+     elements of a matrix, by the n-th observation ‘d’. With δ the difference
+     between ‘d’ and the old mean, the mean is updated by δ/n, and the sum of
+     squared deviations by δ times the difference between ‘d’ and the updated
+     mean. */
+  void
+  welford(TwoDMatrix &mean, TwoDMatrix &m2, const ConstTwoDMatrix &d, int n)
+  {
+    for (int j = 0; j < d.ncols(); j++)
+      for (int i = 0; i < d.nrows(); i++)
+        {
+          double delta = d.get(i, j) - mean.get(i, j);
+          mean.get(i, j) += delta/n;
+          m2.get(i, j) += delta*(d.get(i, j) - mean.get(i, j));
+        }
+  }
+}
+
 // FoldDecisionRule conversion from UnfoldDecisionRule
 FoldDecisionRule::FoldDecisionRule(const UnfoldDecisionRule &udr)
   : DecisionRuleImpl<Storage::fold>(ctraits<Storage::fold>::Tpol(udr.nrows(), udr.nvars()),
@@ -59,40 +80,82 @@ SimResults::simulate(int num_sim, const DecisionRule &dr, const Vector &start,
   JournalRecordPair paa(journal);
   paa << "Performing " << num_sim << " stochastic simulations for "
       << num_per << " periods burning " << num_burn << " initial periods"  << endrec;
+  int added = num_added;
   simulate(num_sim, dr, start, vcov);
-  int thrown = num_sim - data.size();
+  int thrown = num_sim - (num_added - added);
   if (thrown > 0)
     {
       JournalRecord rec(journal);
       rec << "I had to throw " << thrown << " simulations away due to Nan or Inf" << endrec;
     }
+  if (max_sets >= 0)
+    {
+      JournalRecord rec(journal);
+      rec << "Keeping " << getNumSets() << " simulations out of " << num_added << endrec;
+    }
 }
 
 /* This runs a given number of simulations by creating
    SimulationWorker for each simulation and inserting them to the
-   thread group. */
+   thread group. The groups are run by chunks, and the results of a chunk are
+   added before the next one is started. The reservoir sampling is seeded
+   from the same seed as the shocks. */
 
 void
 SimResults::simulate(int num_sim, const DecisionRule &dr, const Vector &start,
                      const TwoDMatrix &vcov)
 {
-  std::vector<RandomShockRealization> rsrs;
-  rsrs.reserve(num_sim);
+  auto seed = seed_generator::get_new_seed();
+  RandomShockRealization proto(vcov, seed);
+  reservoir.seed(seed);
+  int chunk = 4*std::max(sthread::detach_thread_group::max_parallel_threads, 1);
 
-  sthread::detach_thread_group gr;
-  for (int i = 0; i < num_sim; i++)
+  for (int i0 = 0; i0 < num_sim; i0 += chunk)
     {
-      RandomShockRealization sr(vcov, seed_generator::get_new_seed());
-      rsrs.push_back(sr);
-      gr.insert(std::make_unique<SimulationWorker>(*this, dr, DecisionRule::emethod::horner,
-                                                   num_per+num_burn, start, rsrs.back()));
+      int n = std::min(chunk, num_sim-i0);
+      std::vector<RandomShockRealization> rsrs;
+      rsrs.reserve(n);
+      std::vector<SimulationWorker *> workers;
+
+      sthread::detach_thread_group gr;
+      for (int i = i0; i < i0+n; i++)
+        {
+          rsrs.emplace_back(proto, i);
+          auto w = std::make_unique<SimulationWorker>(*this, dr, DecisionRule::emethod::horner,
+                                                      num_per+num_burn, start, rsrs.back());
+          workers.push_back(w.get());
+          gr.insert(std::move(w));
+        }
+      gr.run();
+      for (auto w : workers)
+        w->addResult();
     }
-  gr.run();
+}
+
+void
+SimResults::clear()
+{
+  data.clear();
+  shocks.clear();
+  start.clear();
+  num_added = 0;
+}
+
+void
+SimResults::setRetention(int n)
+{
+  KORD_RAISE_IF(n < 0,
+                "Wrong number of kept simulations in SimResults::setRetention");
+  max_sets = n;
 }
 
 /* This adds the data with the realized shocks. It takes only periods
    which are not to be burnt. If the data is not finite, the both data
-   and shocks are thrown away. */
+   and shocks are thrown away. Otherwise, the data is passed to accumulate(),
+   and stored. If the number of kept simulations is bounded and reached, the
+   k-th simulation replaces a random one of the kept ones with probability
+   ‘max_sets’/k, and is dropped otherwise, so that the kept simulations are a
+   uniform sample of all of them. */
 
 bool
 SimResults::addDataSet(const TwoDMatrix &d, const ExplicitShockRealization &sr, const ConstVector &st)
@@ -101,19 +164,31 @@ SimResults::addDataSet(const TwoDMatrix &d, const ExplicitShockRealization &sr,
                 "Incompatible number of rows for SimResults::addDataSets");
   KORD_RAISE_IF(d.ncols() != num_per+num_burn,
                 "Incompatible number of cols for SimResults::addDataSets");
-  bool ret = false;
-  if (d.isFinite())
+  if (!d.isFinite())
+    return false;
+
+  accumulate(ConstTwoDMatrix(d, num_burn, num_per));
+  num_added++;
+
+  ConstVector dstart{num_burn == 0 ? st : d.getCol(num_burn-1)};
+  if (max_sets < 0 || getNumSets() < max_sets)
     {
       data.emplace_back(d, num_burn, num_per);
       shocks.emplace_back(ConstTwoDMatrix(sr.getShocks(), num_burn, num_per));
-      if (num_burn == 0)
-        start.emplace_back(st);
-      else
-        start.emplace_back(d.getCol(num_burn-1));
-      ret = true;
+      start.emplace_back(dstart);
+    }
+  else
+    {
+      int i = std::uniform_int_distribution<int>{0, num_added-1}(reservoir);
+      if (i < max_sets)
+        {
+          data[i] = ConstTwoDMatrix(d, num_burn, num_per);
+          shocks[i] = ExplicitShockRealization(ConstTwoDMatrix(sr.getShocks(), num_burn, num_per));
+          start[i] = dstart;
+        }
     }
 
-  return ret;
+  return true;
 }
 
 void
@@ -148,65 +223,57 @@ SimResultsStats::simulate(int num_sim, const DecisionRule &dr,
                           const Vector &start,
                           const TwoDMatrix &vcov, Journal &journal)
 {
+  clear();
+  mean.zeros();
+  this->vcov.zeros();
   SimResults::simulate(num_sim, dr, start, vcov, journal);
-  {
-    JournalRecordPair paa(journal);
-    paa << "Calculating means from the simulations." << endrec;
-    calcMean();
-  }
-  {
-    JournalRecordPair paa(journal);
-    paa << "Calculating covariances from the simulations." << endrec;
-    calcVcov();
-  }
+  JournalRecordPair paa(journal);
+  paa << "Calculating covariances from the simulations." << endrec;
+  if (num_added*num_per > 1)
+    this->vcov.mult(1.0/(num_added*num_per - 1));
+  else
+    this->vcov.infs();
 }
 
-/* Here we do not save the data itself, we save only mean and vcov. */
+/* Here we save only mean and vcov, and the kept simulations if their number
+   is bounded. */
 void
 SimResultsStats::writeMat(mat_t *fd, const std::string &lname) const
 {
   ConstTwoDMatrix(num_y, 1, mean).writeMat(fd, lname + "_mean");;
   vcov.writeMat(fd, lname + "_vcov");
+  if (max_sets > 0)
+    SimResults::writeMat(fd, lname);
 }
 
-void
-SimResultsStats::calcMean()
-{
-  mean.zeros();
-  if (data.size()*num_per > 0)
-    {
-      double mult = 1.0/data.size()/num_per;
-      for (const auto &i : data)
-        {
-          for (int j = 0; j < num_per; j++)
-            {
-              ConstVector col{i.getCol(j)};
-              mean.add(mult, col);
-            }
-        }
-    }
-}
+/* The mean ‘dmean’ and the sum of cross-products of deviations of the new
+   simulation are computed first, the latter by a single matrix
+   multiplication. Then, if the previous simulations have ‘na’ observations
+   and the new one ‘nb’, and δ is the difference between the new mean and the
+   old one, the merged mean is the old one plus nb/(na+nb)·δ, and the merged
+   sum of cross-products is the sum of both plus na·nb/(na+nb)·δδᵀ. */
 
 void
-SimResultsStats::calcVcov()
+SimResultsStats::accumulate(const ConstTwoDMatrix &d)
 {
-  if (data.size()*num_per > 1)
+  Vector dmean(num_y);
+  dmean.zeros();
+  for (int j = 0; j < num_per; j++)
+    dmean.add(1.0/num_per, ConstVector{d.getCol(j)});
+  TwoDMatrix dev(d);
+  for (int j = 0; j < num_per; j++)
     {
-      vcov.zeros();
-      double mult = 1.0/(data.size()*num_per - 1);
-      for (const auto &d : data)
-        for (int j = 0; j < num_per; j++)
-          for (int m = 0; m < num_y; m++)
-            for (int n = m; n < num_y; n++)
-              {
-                double s = (d.get(m, j)-mean[m])*(d.get(n, j)-mean[n]);
-                vcov.get(m, n) += mult*s;
-                if (m != n)
-                  vcov.get(n, m) += mult*s;
-              }
+      Vector devj{dev.getCol(j)};
+      devj.add(-1.0, dmean);
     }
-  else
-    vcov.infs();
+
+  double na = static_cast<double>(num_added)*num_per, nb = num_per;
+  Vector delta(dmean);
+  delta.add(-1.0, mean);
+  vcov.multAndAdd(dev, dev, "T");
+  ConstTwoDMatrix deltam(num_y, 1, delta);
+  vcov.multAndAdd(deltam, deltam, "T", na*nb/(na+nb));
+  mean.add(nb/(na+nb), delta);
 }
 
 void
@@ -214,17 +281,16 @@ SimResultsDynamicStats::simulate(int num_sim, const DecisionRule &dr,
                                  const Vector &start,
                                  const TwoDMatrix &vcov, Journal &journal)
 {
+  clear();
+  mean.zeros();
+  variance.zeros();
   SimResults::simulate(num_sim, dr, start, vcov, journal);
-  {
-    JournalRecordPair paa(journal);
-    paa << "Calculating means of the conditional simulations." << endrec;
-    calcMean();
-  }
-  {
-    JournalRecordPair paa(journal);
-    paa << "Calculating variances of the conditional simulations." << endrec;
-    calcVariance();
-  }
+  JournalRecordPair paa(journal);
+  paa << "Calculating variances of the conditional simulations." << endrec;
+  if (num_added > 1)
+    variance.mult(1.0/(num_added-1));
+  else
+    variance.infs();
 }
 
 void
@@ -235,105 +301,29 @@ SimResultsDynamicStats::writeMat(mat_t *fd, const std::string &lname) const
 }
 
 void
-SimResultsDynamicStats::calcMean()
+SimResultsDynamicStats::accumulate(const ConstTwoDMatrix &d)
 {
-  mean.zeros();
-  if (data.size() > 0)
-    {
-      double mult = 1.0/data.size();
-      for (int j = 0; j < num_per; j++)
-        {
-          Vector meanj{mean.getCol(j)};
-          for (const auto &i : data)
-            {
-              ConstVector col{i.getCol(j)};
-              meanj.add(mult, col);
-            }
-        }
-    }
+  welford(mean, variance, d, num_added+1);
 }
 
 void
-SimResultsDynamicStats::calcVariance()
+SimResultsIRF::accumulate(const ConstTwoDMatrix &d)
 {
-  if (data.size() > 1)
-    {
-      variance.zeros();
-      double mult = 1.0/(data.size()-1);
-      for (int j = 0; j < num_per; j++)
-        {
-          ConstVector meanj{mean.getCol(j)};
-          Vector varj{variance.getCol(j)};
-          for (const auto &i : data)
-            {
-              Vector col{i.getCol(j)};
-              col.add(-1.0, meanj);
-              for (int k = 0; k < col.length(); k++)
-                col[k] = col[k]*col[k];
-              varj.add(mult, col);
-            }
-        }
-    }
-  else
-    variance.infs();
+  welford(means, variances, d, num_added+1);
 }
 
 void
-SimResultsIRF::simulate(const DecisionRule &dr, Journal &journal)
+SimResultsIRF::finish(Journal &journal)
 {
-  JournalRecordPair paa(journal);
-  paa << "Performing " << control.getNumSets() << " IRF simulations for "
-      << num_per << " periods; shock=" << ishock << ", impulse=" << imp << endrec;
-  simulate(dr);
-  int thrown = control.getNumSets() - data.size();
+  int thrown = control.getNumSets() - num_added;
   if (thrown > 0)
     {
       JournalRecord rec(journal);
       rec << "I had to throw " << thrown
           << " simulations away due to Nan or Inf" << endrec;
     }
-  calcMeans();
-  calcVariances();
-}
-
-void
-SimResultsIRF::simulate(const DecisionRule &dr)
-{
-  sthread::detach_thread_group gr;
-  for (int idata = 0; idata < control.getNumSets(); idata++)
-    gr.insert(std::make_unique<SimulationIRFWorker>(*this, dr, DecisionRule::emethod::horner,
-                                                    num_per, idata, ishock, imp));
-  gr.run();
-}
-
-void
-SimResultsIRF::calcMeans()
-{
-  means.zeros();
-  if (data.size() > 0)
-    {
-      for (const auto &i : data)
-        means.add(1.0, i);
-      means.mult(1.0/data.size());
-    }
-}
-
-void
-SimResultsIRF::calcVariances()
-{
-  if (data.size() > 1)
-    {
-      variances.zeros();
-      for (const auto &i : data)
-        {
-          TwoDMatrix d(i);
-          d.add(-1.0, means);
-          for (int j = 0; j < d.nrows(); j++)
-            for (int k = 0; k < d.ncols(); k++)
-              variances.get(j, k) += d.get(j, k)*d.get(j, k);
-          d.mult(1.0/(data.size()-1));
-        }
-    }
+  if (num_added > 1)
+    variances.mult(1.0/(num_added-1));
   else
     variances.infs();
 }
@@ -370,18 +360,29 @@ void
 RTSimResultsStats::simulate(int num_sim, const DecisionRule &dr, const Vector &start,
                             const TwoDMatrix &vcov)
 {
-  std::vector<RandomShockRealization> rsrs;
-  rsrs.reserve(num_sim);
+  RandomShockRealization proto(vcov, seed_generator::get_new_seed());
+  int chunk = 4*std::max(sthread::detach_thread_group::max_parallel_threads, 1);
 
-  sthread::detach_thread_group gr;
-  for (int i = 0; i < num_sim; i++)
+  for (int i0 = 0; i0 < num_sim; i0 += chunk)
     {
-      RandomShockRealization sr(vcov, seed_generator::get_new_seed());
-      rsrs.push_back(sr);
-      gr.insert(std::make_unique<RTSimulationWorker>(*this, dr, DecisionRule::emethod::horner,
-                                                     num_per, start, rsrs.back()));
+      int n = std::min(chunk, num_sim-i0);
+      std::vector<RandomShockRealization> rsrs;
+      rsrs.reserve(n);
+      std::vector<RTSimulationWorker *> workers;
+
+      sthread::detach_thread_group gr;
+      for (int i = i0; i < i0+n; i++)
+        {
+          rsrs.emplace_back(proto, i);
+          auto w = std::make_unique<RTSimulationWorker>(*this, dr, DecisionRule::emethod::horner,
+                                                        num_per, start, rsrs.back());
+          workers.push_back(w.get());
+          gr.insert(std::move(w));
+        }
+      gr.run();
+      for (auto w : workers)
+        w->addResult();
     }
-  gr.run();
 }
 
 void
@@ -410,11 +411,29 @@ IRFResults::IRFResults(const DynamicModel &mod, const DecisionRule &dr,
                            ishock, -stderror);
     }
 
-  for (unsigned int ii = 0; ii < irf_list_ind.size(); ii++)
+  simulate(dr, control);
+  for (auto &r : irf_res)
+    r.finish(journal);
+}
+
+void
+IRFResults::simulate(const DecisionRule &dr, const SimResults &control)
+{
+  if (irf_res.empty())
+    return;
+  int block = std::max(batch_cols/static_cast<int>(irf_res.size()), 1);
+  std::vector<SimulationIRFBatchWorker *> workers;
+  sthread::detach_thread_group gr;
+  for (int ic = 0; ic < control.getNumSets(); ic += block)
     {
-      irf_res[2*ii].simulate(dr, journal);
-      irf_res[2*ii+1].simulate(dr, journal);
+      auto w = std::make_unique<SimulationIRFBatchWorker>(*this, dr, control, ic,
+                                                          std::min(block, control.getNumSets()-ic));
+      workers.push_back(w.get());
+      gr.insert(std::move(w));
     }
+  gr.run();
+  for (auto w : workers)
+    w->addResult();
 }
 
 void
@@ -432,34 +451,100 @@ IRFResults::writeMat(mat_t *fd, const std::string &prefix) const
 void
 SimulationWorker::operator()(std::mutex &mut)
 {
-  ExplicitShockRealization esr(sr, np);
-  TwoDMatrix m{dr.simulate(em, np, st, esr)};
-  {
-    std::unique_lock<std::mutex> lk{mut};
-    res.addDataSet(m, esr, st);
-  }
+  esr = std::make_unique<ExplicitShockRealization>(sr, np);
+  m = std::make_unique<TwoDMatrix>(dr.simulate(em, np, st, *esr));
 }
 
-/* Here we create a new instance of ExplicitShockRealization of the
-   corresponding control, add the impulse, and simulate. */
+void
+SimulationWorker::addResult()
+{
+  res.addDataSet(*m, *esr, st);
+}
+
+/* All the columns are advanced together. At the first period, the
+   predetermined part of the state is the one of the start of the control,
+   and the impulse is added to the shocks of the control. At the other
+   periods, it is taken from the previous period of the column. If a column
+   becomes non-finite, it stays so, and the simulation is thrown away when
+   added; the other columns are not affected. */
 
 void
-SimulationIRFWorker::operator()(std::mutex &mut)
+SimulationIRFBatchWorker::operator()(std::mutex &mut)
 {
-  ExplicitShockRealization esr(res.control.getShocks(idata));
-  esr.addToShock(ishock, 0, imp);
-  TwoDMatrix m{dr.simulate(em, np, res.control.getStart(idata), esr)};
-  m.add(-1.0, res.control.getData(idata));
-  {
-    std::unique_lock<std::mutex> lk{mut};
-    res.addDataSet(m, esr, res.control.getStart(idata));
-  }
+  const PartitionY &ypart = dr.getYPart();
+  int nys = ypart.nys();
+  int nu = dr.nexog();
+  int np = control.getNumPer();
+  int npairs = static_cast<int>(res.irf_res.size());
+  int ncols = nc*npairs;
+  const Vector &ysteady = dr.getSteady();
+  ConstVector ysteady_pred(ysteady, ypart.nstat, nys);
+
+  paths.reserve(ncols);
+  for (int k = 0; k < ncols; k++)
+    paths.emplace_back(ypart.ny(), np);
+  TwoDMatrix v(nys+nu, ncols);
+  TwoDMatrix y(ypart.ny(), ncols);
+  PowerMatrices ws{dr.batchWorkspace(ncols)};
+
+  for (int t = 0; t < np; t++)
+    {
+      for (int c = 0; c < nc; c++)
+        {
+          ConstVector u{control.getShocks(ic+c).getShocks().getCol(t)};
+          for (int p = 0; p < npairs; p++)
+            {
+              int k = c*npairs+p;
+              Vector vk{v.getCol(k)};
+              Vector dy(vk, 0, nys);
+              if (t == 0)
+                {
+                  dy = ConstVector(control.getStart(ic+c), ypart.nstat, nys);
+                  dy.add(-1.0, ysteady_pred);
+                }
+              else
+                dy = ConstVector(paths[k].getCol(t-1), ypart.nstat, nys);
+              Vector vu(vk, nys, nu);
+              vu = u;
+              if (t == 0)
+                vu[res.irf_res[p].ishock] += res.irf_res[p].imp;
+            }
+        }
+      dr.evalBatch(y, v, ws);
+      for (int k = 0; k < ncols; k++)
+        paths[k].getCol(t) = y.getCol(k);
+    }
+}
+
+/* The IRF is the simulation (with the steady state added) minus the
+   control. It is added with the shocks of the control plus the impulse. */
+
+void
+SimulationIRFBatchWorker::addResult()
+{
+  const Vector &ysteady = dr.getSteady();
+  int npairs = static_cast<int>(res.irf_res.size());
+  for (int c = 0; c < nc; c++)
+    for (int p = 0; p < npairs; p++)
+      {
+        SimResultsIRF &r = res.irf_res[p];
+        TwoDMatrix &m = paths[c*npairs+p];
+        for (int t = 0; t < m.ncols(); t++)
+          {
+            Vector col{m.getCol(t)};
+            col.add(1.0, ysteady);
+          }
+        m.add(-1.0, control.getData(ic+c));
+        ExplicitShockRealization esr(control.getShocks(ic+c));
+        esr.addToShock(r.ishock, 0, r.imp);
+        r.addDataSet(m, esr, control.getStart(ic+c));
+      }
+  paths.clear();
 }
 
 void
 RTSimulationWorker::operator()(std::mutex &mut)
 {
-  NormalConj nc(res.nc.getDim());
   const PartitionY &ypart = dr.getYPart();
   int nu = dr.nexog();
   const Vector &ysteady = dr.getSteady();
@@ -474,7 +559,6 @@ RTSimulationWorker::operator()(std::mutex &mut)
   ConstVector ypred(y, ypart.nstat, ypart.nys());
 
   // simulate the first real-time period
-  int ip = 0;
   dy = ystart_pred;
   dy.add(-1.0, ysteady_pred);
   sr.get(ip, u);
@@ -492,15 +576,17 @@ RTSimulationWorker::operator()(std::mutex &mut)
       if (ip >= res.num_burn)
         nc.update(y);
     }
-  {
-    std::unique_lock<std::mutex> lk{mut};
-    res.nc.update(nc);
-    if (res.num_per-ip > 0)
-      {
-        res.incomplete_simulations++;
-        res.thrown_periods += res.num_per-ip;
-      }
-  }
+}
+
+void
+RTSimulationWorker::addResult()
+{
+  res.nc.update(nc);
+  if (res.num_per-ip > 0)
+    {
+      res.incomplete_simulations++;
+      res.thrown_periods += res.num_per-ip;
+    }
 }
 
 /* This calculates factorization FFᵀ=V in the Cholesky way. It does
@@ -530,27 +616,47 @@ RandomShockRealization::schurFactor(const ConstTwoDMatrix &v)
   SymSchurDecomp(v).getFactor(factor);
 }
 
+void
+ShockRealization::getBatch(int n, TwoDMatrix &out)
+{
+  for (int j = 0; j < out.ncols(); j++)
+    {
+      Vector jcol{out.getCol(j)};
+      get(n+j, jcol);
+    }
+}
+
 void
 RandomShockRealization::get(int n, Vector &out)
 {
   KORD_RAISE_IF(out.length() != numShocks(),
                 "Wrong length of out vector in RandomShockRealization::get");
   Vector d(out.length());
-  for (int i = 0; i < d.length(); i++)
-    d[i] = dis(mtwister);
+  stream.fill(n, d.base(), d.length());
   out.zeros();
   factor.multaVec(out, ConstVector(d));
 }
 
+/* Here all the standard normal draws are generated at once, and multiplied
+   by the factor in one matrix multiplication. */
+
+void
+RandomShockRealization::getBatch(int n, TwoDMatrix &out)
+{
+  KORD_RAISE_IF(out.nrows() != numShocks(),
+                "Wrong number of rows of out matrix in RandomShockRealization::getBatch");
+  if (out.ncols() == 0)
+    return;
+  TwoDMatrix d(out.nrows(), out.ncols());
+  stream.fill(n, d.base(), d.nrows(), d.getLD(), d.ncols());
+  out.mult(factor, d);
+}
+
 ExplicitShockRealization::ExplicitShockRealization(ShockRealization &sr,
                                                    int num_per)
   : shocks(sr.numShocks(), num_per)
 {
-  for (int j = 0; j < num_per; j++)
-    {
-      Vector jcol{shocks.getCol(j)};
-      sr.get(j, jcol);
-    }
+  sr.getBatch(0, shocks);
 }
 
 void
@@ -584,3 +690,17 @@ GenShockRealization::get(int n, Vector &out)
     if (!std::isfinite(out[j]))
       out[j] = r[j];
 }
+
+void
+GenShockRealization::getBatch(int n, TwoDMatrix &out)
+{
+  RandomShockRealization::getBatch(n, out);
+  for (int j = 0; j < out.ncols(); j++)
+    {
+      Vector e(numShocks());
+      ExplicitShockRealization::get(n+j, e);
+      for (int i = 0; i < numShocks(); i++)
+        if (std::isfinite(e[i]))
+          out.get(i, j) = e[i];
+    }
+}
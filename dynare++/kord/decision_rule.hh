@@ -40,19 +40,25 @@
 #include "kord_exception.hh"
 #include "korder.hh"
 #include "normal_conjugate.hh"
+#include "compiled_rule.hh"
+#include "random_stream.hh"
 
+#include <cstdint>
 #include <memory>
 #include <random>
 #include <string>
 
 /* This is a general interface to a shock realizations. The interface has only
    one method returning the shock realizations at the given time. This method
-   is not constant, since it may change a state of the object. */
+   is not constant, since it may change a state of the object. The method
+   getBatch() fills the columns of a matrix with the shocks of consecutive
+   periods; by default it calls get() for each of them. */
 class ShockRealization
 {
 public:
   virtual ~ShockRealization() = default;
   virtual void get(int n, Vector &out) = 0;
+  virtual void getBatch(int n, TwoDMatrix &out);
   virtual int numShocks() const = 0;
 };
 
@@ -74,6 +80,13 @@ public:
      output are in deviations from the rule's steady. */
   virtual void eval(emethod em, Vector &out, const ConstVector &v) const = 0;
 
+  /* batched primitive evaluation (the columns of ‘v’ are states as in eval(),
+     and the corresponding columns of ‘out’ are the next period variables).
+     The workspace is given by batchWorkspace(), and can be reused. */
+  virtual void evalBatch(GeneralMatrix &out, const ConstGeneralMatrix &v,
+                         PowerMatrices &ws) const = 0;
+  virtual PowerMatrices batchWorkspace(int npoints) const = 0;
+
   /* makes only one step of simulation (in terms of absolute values, not
      deviations) */
   virtual void evaluate(emethod em, Vector &out, const ConstVector &ys,
@@ -118,7 +131,12 @@ public:
 
    The class is templated, the template argument is either Storage::fold or
    Storage::unfold. So, there are two implementations of the DecisionRule
-   interface. */
+   interface.
+
+   The polynomial can also be given in a compiled form (see CompiledRule) by
+   setCompiled(). Then eval() and evalBatch(), and so the simulations, use
+   it instead of the tensors. It is not passed to a centralized clone, whose
+   polynomial is different. */
 
 template<Storage t>
 class DecisionRuleImpl : public ctraits<t>::Tpol, public DecisionRule
@@ -132,6 +150,7 @@ protected:
   const Vector ysteady;
   const PartitionY ypart;
   const int nu;
+  std::shared_ptr<const CompiledRule> compiled;
 public:
   DecisionRuleImpl(const _Tpol &pol, const PartitionY &yp, int nuu,
                    const ConstVector &ys)
@@ -184,12 +203,38 @@ public:
   {
     return ypart;
   }
+  /* Makes the rule evaluated by the compiled polynomial, which must have
+     been generated from this rule (this is checked by the checksum of the
+     coefficients) */
+  void
+  setCompiled(std::shared_ptr<const CompiledRule> c)
+  {
+    KORD_RAISE_IF(c->nrows() != _Tpol::nrows() || c->nvars() != _Tpol::nvars(),
+                  "Wrong dimensions of compiled rule in DecisionRuleImpl::setCompiled");
+    KORD_RAISE_IF(c->getChecksum() != CompiledRule::checksum(static_cast<const _Tpol &>(*this)),
+                  "Compiled rule was not generated from this rule in DecisionRuleImpl::setCompiled");
+    compiled = std::move(c);
+  }
 protected:
   void fillTensors(const _Tg &g, double sigma);
   void fillTensors(const _TW &W, int nys);
   void centralize(const DecisionRuleImpl &dr);
 public:
   void eval(emethod em, Vector &out, const ConstVector &v) const override;
+  void
+  evalBatch(GeneralMatrix &out, const ConstGeneralMatrix &v,
+            PowerMatrices &ws) const override
+  {
+    if (compiled)
+      compiled->evalBatch(out, v);
+    else
+      _Tpol::evalBatch(out, v, ws);
+  }
+  PowerMatrices
+  batchWorkspace(int npoints) const override
+  {
+    return _Tpol::batchWorkspace(npoints);
+  }
 };
 
 /* Here we have to fill the tensor polynomial. This involves two separated
@@ -467,7 +512,9 @@ template<Storage t>
 void
 DecisionRuleImpl<t>::eval(emethod em, Vector &out, const ConstVector &v) const
 {
-  if (em == emethod::horner)
+  if (compiled)
+    compiled->eval(out, v);
+  else if (em == emethod::horner)
     _Tpol::evalHorner(out, v);
   else
     _Tpol::evalTrad(out, v);
@@ -789,7 +836,16 @@ DRFixPoint<t>::calcFixPoint(emethod em, Vector &out)
 /* This is a basically a number of matrices of the same dimensions, which can
    be obtained as simulation results from a given decision rule and shock
    realizations. We also store the realizations of shocks and the starting
-   point of each simulation. */
+   point of each simulation.
+
+   Each finite simulation is passed to accumulate() when it is added, so that
+   the subclasses can fold it into their statistics as it comes, in the order
+   of the simulations. By default all the simulations are stored, but
+   setRetention() bounds their number: then only a uniform sample of them is
+   kept (by reservoir sampling), and the memory needed does not grow with the
+   number of simulations. The simulations are run in chunks of a few times the
+   number of threads, so that the paths are not all held by the workers
+   either. */
 
 class ExplicitShockRealization;
 class SimResults
@@ -800,12 +856,18 @@ protected:
   int num_burn;
   std::vector<TwoDMatrix> data;
   std::vector<ExplicitShockRealization> shocks;
-  std::vector<ConstVector> start;
+  std::vector<Vector> start;
+  int num_added{0}; // Number of finite simulations added, kept or not
+  int max_sets{-1}; // Maximum number of kept simulations, −1 for all
+  std::mt19937 reservoir;
 public:
   SimResults(int ny, int nper, int nburn = 0)
     : num_y(ny), num_per(nper), num_burn(nburn)
   {
   }
+  virtual ~SimResults() = default;
+  // Keeps at most ‘n’ simulations
+  void setRetention(int n);
   void simulate(int num_sim, const DecisionRule &dr, const Vector &start,
                 const TwoDMatrix &vcov, Journal &journal);
   void simulate(int num_sim, const DecisionRule &dr, const Vector &start,
@@ -825,6 +887,11 @@ public:
   {
     return static_cast<int>(data.size());
   }
+  int
+  getNumAdded() const
+  {
+    return num_added;
+  }
   const TwoDMatrix &
   getData(int i) const
   {
@@ -835,7 +902,7 @@ public:
   {
     return shocks[i];
   }
-  const ConstVector &
+  const Vector &
   getStart(int i) const
   {
     return start[i];
@@ -844,10 +911,25 @@ public:
   bool addDataSet(const TwoDMatrix &d, const ExplicitShockRealization &sr, const ConstVector &st);
   void writeMat(const std::string &base, const std::string &lname) const;
   void writeMat(mat_t *fd, const std::string &lname) const;
+protected:
+  // Drops the simulations added so far, kept or not
+  void clear();
+  // Folds a finite simulation (without the burnt periods) into statistics
+  virtual void
+  accumulate(const ConstTwoDMatrix &d)
+  {
+  }
 };
 
 /* This does the same as SimResults plus it calculates means and covariances of
-   the simulated data. */
+   the simulated data. They are updated with each simulation: the mean and the
+   sum of cross-products of deviations from the mean of the simulation are
+   merged with those of the previous simulations by the formulas of Chan,
+   Golub and LeVeque. While simulating, ‘vcov’ holds the sum of cross-products,
+   it is divided by the number of observations minus one at the end. Each
+   call of simulate() starts afresh, dropping the simulations of a previous
+   call. If some simulations are kept, they are written together with the
+   statistics. */
 
 class SimResultsStats : public SimResults
 {
@@ -861,15 +943,27 @@ public:
   }
   void simulate(int num_sim, const DecisionRule &dr, const Vector &start,
                 const TwoDMatrix &vcov, Journal &journal);
+  const Vector &
+  getMean() const
+  {
+    return mean;
+  }
+  const TwoDMatrix &
+  getVcov() const
+  {
+    return vcov;
+  }
   void writeMat(mat_t *fd, const std::string &lname) const;
 protected:
-  void calcMean();
-  void calcVcov();
+  void accumulate(const ConstTwoDMatrix &d) override;
 };
 
 /* This does the similar thing as SimResultsStats but the statistics are not
    calculated over all periods but only within each period. Then we do not
-   calculate covariances with periods but only variances. */
+   calculate covariances with periods but only variances. The simulations are
+   folded into the means and the sums of squared deviations by the Welford
+   update, the latter are turned into variances at the end. As for
+   SimResultsStats, each call of simulate() starts afresh. */
 
 class SimResultsDynamicStats : public SimResults
 {
@@ -883,23 +977,36 @@ public:
   }
   void simulate(int num_sim, const DecisionRule &dr, const Vector &start,
                 const TwoDMatrix &vcov, Journal &journal);
+  const TwoDMatrix &
+  getMean() const
+  {
+    return mean;
+  }
+  const TwoDMatrix &
+  getVariance() const
+  {
+    return variance;
+  }
   void writeMat(mat_t *fd, const std::string &lname) const;
 protected:
-  void calcMean();
-  void calcVariance();
+  void accumulate(const ConstTwoDMatrix &d) override;
 };
 
-/* This goes through control simulation results, and for each control it adds a
-   given impulse to a given shock and runs a simulation. The control simulation
-   is then cancelled and the result is stored. After that these results are
-   averaged with variances calculated.
+/* This holds the responses to a given impulse to a given shock: for each
+   control simulation, the simulation with the impulse added to the shocks of
+   the control, minus the control. They are simulated by IRFResults (see
+   SimulationIRFBatchWorker), and averaged with variances calculated. As in
+   SimResultsDynamicStats, the means and the sums of squared deviations are
+   updated with each simulation, so the simulations themselves are not kept.
 
    The means and the variances are then written to the MAT file. */
 
-class SimulationIRFWorker;
+class SimulationIRFBatchWorker;
+class IRFResults;
 class SimResultsIRF : public SimResults
 {
-  friend class SimulationIRFWorker;
+  friend class SimulationIRFBatchWorker;
+  friend class IRFResults;
 protected:
   const SimResults &control;
   int ishock;
@@ -912,13 +1019,25 @@ public:
       ishock(i), imp(impulse),
       means(ny, nper), variances(ny, nper)
   {
+    means.zeros();
+    variances.zeros();
+    setRetention(0);
+  }
+  const TwoDMatrix &
+  getMeans() const
+  {
+    return means;
+  }
+  const TwoDMatrix &
+  getVariances() const
+  {
+    return variances;
   }
-  void simulate(const DecisionRule &dr, Journal &journal);
-  void simulate(const DecisionRule &dr);
   void writeMat(mat_t *fd, const std::string &lname) const;
 protected:
-  void calcMeans();
-  void calcVariances();
+  void accumulate(const ConstTwoDMatrix &d) override;
+  // Turns the sums of squared deviations into variances
+  void finish(Journal &journal);
 };
 
 /* This simulates and gathers all statistics from the real time simulations. In
@@ -964,23 +1083,46 @@ public:
 
    The constructor also takes the vector of indices of exogenous variables
    (‘ili’) for which the IRFs are generated. The list is kept (as
-   ‘irf_list_ind’) for other methods. */
+   ‘irf_list_ind’) for other methods.
+
+   Rather than simulating each SimResultsIRF on its own, the constructor
+   simulates all of them at once: the IRF simulations of all the shocks and
+   signs for a given control simulation share its shocks, and they are run
+   side by side as the columns of a matrix, which is advanced by one batched
+   evaluation of the rule per period. The controls are split in blocks, each
+   simulated by a SimulationIRFBatchWorker; a block has about ‘batch_cols’
+   columns. */
 
 class DynamicModel;
 class IRFResults
 {
+  friend class SimulationIRFBatchWorker;
   std::vector<SimResultsIRF> irf_res;
   const DynamicModel &model;
   std::vector<int> irf_list_ind;
 public:
+  static constexpr int batch_cols = 256;
   IRFResults(const DynamicModel &mod, const DecisionRule &dr,
              const SimResults &control, std::vector<int> ili,
              Journal &journal);
+  /* Returns the results, the positive and the negative impulses to the i-th
+     shock of the list are at 2i and 2i+1 */
+  const std::vector<SimResultsIRF> &
+  getResults() const
+  {
+    return irf_res;
+  }
   void writeMat(mat_t *fd, const std::string &prefix) const;
+private:
+  void simulate(const DecisionRule &dr, const SimResults &control);
 };
 
-/* This worker simulates the given decision rule and inserts the result to
-   SimResults. */
+/* This worker simulates the given decision rule and keeps the result, which
+   is inserted to SimResults by addResult(). The latter is called for all the
+   workers once the group is finished, in the order of their creation, so that
+   the stored simulations (and the statistics computed from them) do not depend
+   on the number of threads nor on their scheduling. The same holds for the
+   two following workers. */
 
 class SimulationWorker : public sthread::detach_thread
 {
@@ -991,6 +1133,8 @@ protected:
   int np;
   const Vector &st;
   ShockRealization &sr;
+  std::unique_ptr<ExplicitShockRealization> esr;
+  std::unique_ptr<TwoDMatrix> m;
 public:
   SimulationWorker(SimResults &sim_res,
                    const DecisionRule &dec_rule,
@@ -1000,37 +1144,38 @@ public:
   {
   }
   void operator()(std::mutex &mut) override;
+  void addResult();
 };
 
-/* This worker simulates a given impulse ‘imp’ to a given shock ‘ishock’ based
-   on a given control simulation with index ‘idata’. The control simulations
-   are contained in SimResultsIRF which is passed to the constructor. */
+/* This worker simulates the IRFs of all the SimResultsIRF’s of an IRFResults
+   against the controls ‘ic’, …, ‘ic’+‘nc’−1. The column of the control c and of
+   the SimResultsIRF p is (c−‘ic’)·P+p, where P is the number of the latter.
+   The simulations are kept (in deviations from the steady state) until they
+   are added by addResult(). */
 
-class SimulationIRFWorker : public sthread::detach_thread
+class SimulationIRFBatchWorker : public sthread::detach_thread
 {
-  SimResultsIRF &res;
+  IRFResults &res;
   const DecisionRule &dr;
-  DecisionRule::emethod em;
-  int np;
-  int idata;
-  int ishock;
-  double imp;
+  const SimResults &control;
+  int ic;
+  int nc;
+  std::vector<TwoDMatrix> paths;
 public:
-  SimulationIRFWorker(SimResultsIRF &sim_res,
-                      const DecisionRule &dec_rule,
-                      DecisionRule::emethod emet, int num_per,
-                      int id, int ishck, double impulse)
-    : res(sim_res), dr(dec_rule), em(emet), np(num_per),
-      idata(id), ishock(ishck), imp(impulse)
+  SimulationIRFBatchWorker(IRFResults &irf_res, const DecisionRule &dec_rule,
+                           const SimResults &cntl, int first, int num)
+    : res(irf_res), dr(dec_rule), control(cntl), ic(first), nc(num)
   {
   }
   void operator()(std::mutex &mut) override;
+  void addResult();
 };
 
 /* This class does the real time simulation job for RTSimResultsStats. It
    simulates the model period by period. It accummulates the information in
-   ‘RTSimResultsStats::nc’. If NaN or Inf is observed, it ends the simulation
-   and adds to the ‘thrown_periods’ of RTSimResultsStats. */
+   its own NormalConj, which is added to ‘RTSimResultsStats::nc’ by
+   addResult(). If NaN or Inf is observed, it ends the simulation and adds to
+   the ‘thrown_periods’ of RTSimResultsStats. */
 
 class RTSimulationWorker : public sthread::detach_thread
 {
@@ -1041,34 +1186,48 @@ protected:
   int np;
   const Vector &ystart;
   ShockRealization &sr;
+  NormalConj nc;
+  int ip{0};
 public:
   RTSimulationWorker(RTSimResultsStats &sim_res,
                      const DecisionRule &dec_rule,
                      DecisionRule::emethod emet, int num_per,
                      const Vector &start, ShockRealization &shock_r)
-    : res(sim_res), dr(dec_rule), em(emet), np(num_per), ystart(start), sr(shock_r)
+    : res(sim_res), dr(dec_rule), em(emet), np(num_per), ystart(start), sr(shock_r),
+      nc(sim_res.nc.getDim())
   {
   }
   void operator()(std::mutex &mut) override;
+  void addResult();
 };
 
 /* This class generates draws from Gaussian distribution with zero mean and the
    given variance-covariance matrix. It stores the factor of vcov V matrix,
-   yielding FFᵀ = V. */
+   yielding FFᵀ = V.
+
+   The standard normal draws are taken from a NormalStream given by the seed
+   and the index of the stream, so that the shocks of the period n depend
+   only on them and on n. The second constructor gives the same distribution
+   with another stream, without recomputing the factor; it is used to create
+   the realizations of the simulations of a batch. */
 
 class RandomShockRealization : virtual public ShockRealization
 {
 protected:
-  std::mt19937 mtwister;
-  std::normal_distribution<> dis;
+  NormalStream stream;
   TwoDMatrix factor;
 public:
-  RandomShockRealization(const ConstTwoDMatrix &v, decltype(mtwister)::result_type iseed)
-    : mtwister(iseed), factor(v.nrows(), v.nrows())
+  RandomShockRealization(const ConstTwoDMatrix &v, std::uint64_t iseed, std::uint32_t istream = 0)
+    : stream(iseed, istream), factor(v.nrows(), v.nrows())
   {
     schurFactor(v);
   }
+  RandomShockRealization(const RandomShockRealization &sr, std::uint32_t istream)
+    : stream(sr.stream.other(istream)), factor(sr.factor)
+  {
+  }
   void get(int n, Vector &out) override;
+  void getBatch(int n, TwoDMatrix &out) override;
   int
   numShocks() const override
   {
@@ -1129,6 +1288,7 @@ public:
                   "Wrong dimension of input matrix in GenShockRealization constructor");
   }
   void get(int n, Vector &out) override;
+  void getBatch(int n, TwoDMatrix &out) override;
   int
   numShocks() const override
   {
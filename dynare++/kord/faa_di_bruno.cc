@@ -20,6 +20,8 @@
 
 #include "faa_di_bruno.hh"
 #include "fine_container.hh"
+#include "MappedStorage.hh"
+#include "MemoryArena.hh"
 
 #include <cmath>
 
@@ -34,12 +36,14 @@ FaaDiBruno::calculate(const StackContainer<FGSTensor> &cont,
   out.zeros();
   for (int l = 1; l <= out.dimen(); l++)
     {
-      auto [max, mem_mb, p_size_mb] = estimRefinement(out.getDims(), out.nrows(), l);
+      auto [max, mem_mb, p_size_mb] = estimRefinement(out.getDims(), out.nrows(), l,
+                                                       out.getData().length());
       FoldedFineContainer fine_cont(cont, max);
       fine_cont.multAndAdd(l, f, out);
       JournalRecord recc(journal);
       recc << "dim=" << l << " avmem=" << mem_mb << " tmpmem=" << p_size_mb << " max=" << max
-           << " stacks=" << cont.numStacks() << u8"→" << fine_cont.numStacks() << endrec;
+           << " stacks=" << cont.numStacks() << u8"→" << fine_cont.numStacks()
+           << " sums=" << sumsMode() << endrec;
     }
 }
 
@@ -57,7 +61,7 @@ FaaDiBruno::calculate(const FoldedStackContainer &cont, const FGSContainer &g,
       cont.multAndAdd(l, g, out);
       JournalRecord rec(journal);
       int mem_mb = mem/1024/1024;
-      rec << "dim=" << l << " avmem=" << mem_mb << endrec;
+      rec << "dim=" << l << " avmem=" << mem_mb << " sums=" << sumsMode() << endrec;
     }
 }
 
@@ -72,12 +76,14 @@ FaaDiBruno::calculate(const StackContainer<UGSTensor> &cont,
   out.zeros();
   for (int l = 1; l <= out.dimen(); l++)
     {
-      auto [max, mem_mb, p_size_mb] = estimRefinement(out.getDims(), out.nrows(), l);
+      auto [max, mem_mb, p_size_mb] = estimRefinement(out.getDims(), out.nrows(), l,
+                                                       out.getData().length());
       UnfoldedFineContainer fine_cont(cont, max);
       fine_cont.multAndAdd(l, f, out);
       JournalRecord recc(journal);
       recc << "dim=" << l << " avmem=" << mem_mb << " tmpmem=" << p_size_mb << " max=" << max
-           << " stacks=" << cont.numStacks() << u8"→" << fine_cont.numStacks() << endrec;
+           << " stacks=" << cont.numStacks() << u8"→" << fine_cont.numStacks()
+           << " sums=" << sumsMode() << endrec;
     }
 }
 
@@ -94,10 +100,19 @@ FaaDiBruno::calculate(const UnfoldedStackContainer &cont, const UGSContainer &g,
       cont.multAndAdd(l, g, out);
       JournalRecord rec(journal);
       int mem_mb = mem/1024/1024;
-      rec << "dim=" << l << " avmem=" << mem_mb << endrec;
+      rec << "dim=" << l << " avmem=" << mem_mb << " sums=" << sumsMode() << endrec;
     }
 }
 
+/* This returns how the workers sum up their contributions, see StackOutput
+   in stack_container.hh. It is recorded in the journal, so that the timings
+   of the two modes can be compared. */
+const char *
+FaaDiBruno::sumsMode()
+{
+  return StackOutputBase::thread_local_sums ? "local" : "shared";
+}
+
 /* This function returns a number of maximum rows used for refinement of the
    stacked container. We want to set the maximum so that the expected memory
    consumption for the number of paralel threads would be less than available
@@ -125,11 +140,26 @@ FaaDiBruno::calculate(const UnfoldedStackContainer &cont, const UGSContainer &g,
    where ‘mem’ is available memory in bytes, ‘nthreads’ is a number of threads,
    r is a number of rows, and 8 is ‘sizeof(double)’.
 
+   If large tensors are stored out of core (see MappedStorage.hh), the slices
+   and the temporary tensors above the threshold of the mapped storage are
+   placed in files, also within the arena scopes of the workers (see
+   MemoryArena::allocate()), so they do not need to fit in the physical
+   memory, and the free space in the directory of the mapped storage is
+   added to ‘mem’.
+
+   Besides the temporaries of its current task, the memory arena of each
+   thread (see MemoryArena.hh) may keep up to ‘max_retained’ doubles of
+   emptied chunks, so this is subtracted from ‘mem’ for every thread. When
+   several evaluations run concurrently (see KOrder::performStep()), each one
+   only takes its share of ‘mem’. If the threads sum to private copies of
+   the output tensor (see StackOutput), the ‘nthreads’ copies of ‘out_len’
+   doubles are subtracted from this share.
+
    If the right hand side is less than zero, we set ‘max’ to 10, just to let it
    do something. */
 
 std::tuple<int, int, int>
-FaaDiBruno::estimRefinement(const TensorDimens &tdims, int nr, int l)
+FaaDiBruno::estimRefinement(const TensorDimens &tdims, int nr, int l, long out_len)
 {
   int nthreads = sthread::detach_thread_group::max_parallel_threads;
   long per_size1 = tdims.calcUnfoldMaxOffset();
@@ -138,6 +168,13 @@ FaaDiBruno::estimRefinement(const TensorDimens &tdims, int nr, int l)
   long per_size = sizeof(double)*nr
     *static_cast<long>(lambda*per_size1+(1-lambda)*per_size2);
   long mem = SystemResources::availableMemory();
+  if (MappedStorage::active())
+    mem += MappedStorage::availableSpace();
+  if (MemoryArena::enabled)
+    mem -= nthreads*static_cast<long>(MemoryArena::max_retained*sizeof(double));
+  mem /= nshares;
+  if (StackOutputBase::thread_local_sums)
+    mem -= nthreads*out_len*static_cast<long>(sizeof(double));
   int max = 0;
   double num_cols = static_cast<double>(mem-magic_mult*nthreads*per_size)
     /nthreads/sizeof(double)/nr;
@@ -43,9 +43,10 @@
 class FaaDiBruno
 {
   Journal &journal;
+  int nshares; // number of evaluations sharing the available memory
 public:
-  FaaDiBruno(Journal &jr)
-    : journal(jr)
+  FaaDiBruno(Journal &jr, int shares = 1)
+    : journal(jr), nshares(shares)
   {
   }
   void calculate(const StackContainer<FGSTensor> &cont, const TensorContainer<FSSparseTensor> &f,
@@ -57,7 +58,9 @@ public:
   void calculate(const UnfoldedStackContainer &cont, const UGSContainer &g,
                  UGSTensor &out);
 protected:
-  std::tuple<int, int, int> estimRefinement(const TensorDimens &tdims, int nr, int l);
+  std::tuple<int, int, int> estimRefinement(const TensorDimens &tdims, int nr, int l,
+                                            long out_len);
+  static const char *sumsMode();
 
   // See FaaDiBruno::calculate() folded sparse code for why we have magic_mult
   constexpr static double magic_mult = 1.5;
@@ -180,23 +180,25 @@ JournalRecordPair::~JournalRecordPair()
 {
   journal.decrementDepth();
   writePrefixForEnd(flash);
-  journal << prefix_end;
-  journal << mes;
-  journal << std::endl;
-  journal.flush();
+  journal.writeLine(prefix_end, mes);
 }
 
 JournalRecord &
 endrec(JournalRecord &rec)
 {
-  rec.journal << rec.prefix;
-  rec.journal << rec.mes;
-  rec.journal << std::endl;
-  rec.journal.flush();
+  rec.journal.writeLine(rec.prefix, rec.mes);
   rec.journal.incrementOrd();
   return rec;
 }
 
+void
+Journal::writeLine(const std::string &prefix, const std::string &mes)
+{
+  std::lock_guard<std::mutex> lk{mut};
+  *this << prefix << mes << std::endl;
+  flush();
+}
+
 void
 Journal::printHeader()
 {
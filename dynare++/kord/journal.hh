@@ -30,6 +30,8 @@
 #include <fstream>
 #include <string>
 #include <chrono>
+#include <atomic>
+#include <mutex>
 
 /* Implement static methods for accessing some system resources. An instance of
    this class is a photograph of these resources at the time of instantiation. */
@@ -55,10 +57,15 @@ struct SystemResources
   void diff(const SystemResources &pre);
 };
 
+/* The records may be written concurrently by several threads (see
+   KOrder::performStep()). Each line is then written as a whole, but the lines
+   of the threads are interleaved, and so are their depths. */
+
 class Journal : public std::ofstream
 {
-  int ord{0};
-  int depth{0};
+  std::atomic<int> ord{0};
+  std::atomic<int> depth{0};
+  std::mutex mut;
 public:
   explicit Journal(const std::string &fname)
     : std::ofstream(fname)
@@ -68,7 +75,14 @@ public:
   /* Constructor that does not initialize the std::ofstream. To be used when an
      on-disk journal is not wanted. */
   Journal() = default;
-  Journal &operator=(Journal &&) = default;
+  Journal &
+  operator=(Journal &&j)
+  {
+    std::ofstream::operator=(std::move(j));
+    ord = j.ord.load();
+    depth = j.depth.load();
+    return *this;
+  }
   ~Journal() override
   {
     flush();
@@ -99,6 +113,8 @@ public:
   {
     return depth;
   }
+  // Writes a line made of the prefix and the message of a record
+  void writeLine(const std::string &prefix, const std::string &mes);
 };
 
 class JournalRecord;
@@ -21,6 +21,12 @@
 #include "kord_exception.hh"
 #include "korder.hh"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
 /* Here we set ‘ipiv’ and ‘inv’ members of the PLUMatrix depending on its
    content. It is assumed that subclasses will call this method at the end of
    their constructors. */
@@ -295,7 +301,7 @@ KOrder::m<Storage::fold>() const
 KOrder::KOrder(int num_stat, int num_pred, int num_both, int num_forw,
                const TensorContainer<FSSparseTensor> &fcont,
                const TwoDMatrix &gy, const TwoDMatrix &gu, const TwoDMatrix &v,
-               Journal &jr)
+               Journal &jr, const SylvParams &sylv_pars)
   : ypart(num_stat, num_pred, num_both, num_forw),
     ny(ypart.ny()), nu(gu.ncols()), maxk(fcont.getMaxDim()),
     nvs{ypart.nys(), nu, nu, 1},
@@ -305,7 +311,7 @@ KOrder::KOrder(int num_stat, int num_pred, int num_both, int num_forw,
     _fZstack(&_fG, ypart.nyss(), &_fg, ny, ypart.nys(), nu),
     _uGstack(&_ugs, ypart.nys(), nu),
     _fGstack(&_fgs, ypart.nys(), nu),
-    _um(maxk, v), _fm(_um), f(fcont),
+    _um(maxk, v), _fm(_um), vcov(v), f(fcont),
     matA(f.get(Symmetry{1}), _uZstack.getStackSizes(), gy, ypart),
     matS(f.get(Symmetry{1}), _uZstack.getStackSizes(), gy, ypart),
     matB(f.get(Symmetry{1}), _uZstack.getStackSizes()),
@@ -344,20 +350,32 @@ KOrder::KOrder(int num_stat, int num_pred, int num_both, int num_forw,
   G<Storage::unfold>().insert(std::move(tGu));
   auto tGup = faaDiBrunoG<Storage::unfold>(Symmetry{0, 0, 1, 0});
   G<Storage::unfold>().insert(std::move(tGup));
+
+  // Decompose the matrices of the Sylvester equation
+  /* Note that the g*_y is not continuous in memory as assumed by the
+     sylvester code, so we make a temporary copy and pass it as matrix C. */
+  if (ypart.nys() > 0 && ypart.nyss() > 0)
+    {
+      TwoDMatrix gs_y(gs<Storage::unfold>().get(Symmetry{1, 0, 0, 0}));
+      sylvDecomp = std::make_unique<GeneralSylvesterDecomp>(ny, ypart.nys(),
+                                                            ypart.nstat+ypart.npred,
+                                                            matA.getData(), matB.getData(),
+                                                            gs_y.getData(), sylv_pars);
+    }
 }
 
 // KOrder::sylvesterSolve() unfolded specialization
 /* Here we have an unfolded specialization of sylvesterSolve(). We simply
-   create the sylvester object and solve it. Note that the g*_y is not
-   continuous in memory as assumed by the sylvester code, so we make a
-   temporary copy and pass it as matrix C.
+   solve the equation with the decomposition computed in the constructor.
+   Since the decomposition is not modified by the solution, the symmetries of
+   a wave can be solved concurrently.
 
    If the B matrix is empty, in other words there are now forward looking
    variables, then the system becomes AX=D which is solved by simple
    matA.multInv().
 
    If one wants to display the diagnostic messages from the Sylvester module,
-   then after the sylv.solve() one needs to call sylv.getParams().print(""). */
+   then one needs to pass a SylvParams to sylvDecomp->solve() and print it. */
 
 template<>
 void
@@ -369,12 +387,7 @@ KOrder::sylvesterSolve<Storage::unfold>(ctraits<Storage::unfold>::Ttensor &der)
     {
       KORD_RAISE_IF(!der.isFinite(),
                     "RHS of Sylverster is not finite");
-      TwoDMatrix gs_y(gs<Storage::unfold>().get(Symmetry{1, 0, 0, 0}));
-      GeneralSylvester sylv(der.getSym()[0], ny, ypart.nys(),
-                            ypart.nstat+ypart.npred,
-                            matA.getData(), matB.getData(),
-                            gs_y.getData(), der.getData());
-      sylv.solve();
+      sylvDecomp->solve(der.getSym()[0], der.getData());
     }
   else if (ypart.nys() > 0 && ypart.nyss() == 0)
     matA.multInv(der);
@@ -395,6 +408,64 @@ KOrder::sylvesterSolve<Storage::fold>(ctraits<Storage::fold>::Ttensor &der) cons
   der.getData() = const_cast<const Vector &>(ftmp.getData());
 }
 
+/* Here we group the symmetries {i, j, 0, k} of g of the given order in
+   waves. The dependencies of a symmetry on the symmetries of the same order
+   are read from the ‘Requires’ paragraphs in korder.hh:
+   — g_yⁿ does not depend on any,
+   — g_yⁱuʲ with j>0 depends on g_yⁿ,
+   — g_yⁱuʲσᵏ with k>0 depends on g_yⁱ⁺ʲuᵐσᵏ⁻ᵐ for m=0,…,k (through G_yⁱuʲσᵏ
+     and G_yⁱuʲu′ᵐσᵏ⁻ᵐ), and on g_yⁱuʲ⁺ᵐσᵏ⁻ᵐ for m=1,…,k (through Dᵢⱼₖ and
+     Eᵢⱼₖ),
+   — g_σⁿ is recovered after all the others.
+   A symmetry is put to the wave following the last wave of its dependencies.
+   We go through the symmetries in the order of the sequential algorithm,
+   which visits the dependencies before the symmetry. */
+
+std::vector<std::vector<Symmetry>>
+KOrder::recoveryWaves(int order)
+{
+  std::vector<std::vector<Symmetry>> res;
+  // wave[i][j] is the wave of {i, j, 0, order−i−j}
+  std::vector<std::vector<int>> wave(order+1, std::vector<int>(order+1, -1));
+  auto put = [&](int i, int j, int w)
+             {
+               wave[i][j] = w;
+               if (w >= static_cast<int>(res.size()))
+                 res.resize(w+1);
+               res[w].push_back(Symmetry{i, j, 0, order-i-j});
+             };
+  auto put_dependent = [&](int i, int j)
+                       {
+                         int k = order-i-j;
+                         int w = 0;
+                         for (int m = 0; m <= k; m++)
+                           if (j > 0 || m > 0)
+                             w = std::max(w, wave[i+j][m]+1);
+                         for (int m = 1; m <= k; m++)
+                           w = std::max(w, wave[i][j+m]+1);
+                         put(i, j, w);
+                       };
+
+  put(order, 0, 0);
+
+  for (int i = 0; i < order; i++)
+    put(i, order-i, 1);
+
+  for (int j = 1; j < order; j++)
+    {
+      for (int i = j-1; i >= 1; i--)
+        put_dependent(order-j, i);
+      put_dependent(order-j, 0);
+    }
+
+  for (int i = order-1; i >= 1; i--)
+    put_dependent(0, i);
+
+  put(0, 0, res.size());
+
+  return res;
+}
+
 void
 KOrder::switchToFolded()
 {
@@ -425,3 +496,295 @@ KOrder::switchToFolded()
           }
       }
 }
+
+/* The checkpoint file holds the derivatives of g and G computed so far, in
+   the native binary format (it is meant to be read back on the same
+   machine). It is made of:
+   — the string ‘checkpoint_magic’, whose last character is a format version,
+   — nstat, npred, nboth, nforw, nu and the last completed order,
+   — the covariance matrix of the shocks (nu×nu doubles),
+   — the maximum order of the model derivatives, followed by a hash of the
+     derivatives of each order (as 64-bit integers, zero for a missing order),
+   — the number of tensors of g, followed by each tensor as its symmetry (4
+     integers), its number of items, and its items,
+   — the same for G.
+   All integers are written as int. The dimensions of a tensor are given by
+   its symmetry and ‘nvs’, and its number of rows is ny for g and nyss for G.
+
+   The derivatives of g and G of order k depend only on the covariance
+   matrix and on the model derivatives of orders up to k. So a resumed run
+   checks that these are the same as when the file was written, and the
+   model derivatives of higher orders are allowed to differ (the order of
+   approximation can be increased). The tensors of order 1 (the first order
+   solution) are also included and checked.
+
+   The file is written under a temporary name, and then renamed, so that a
+   crash while writing leaves the previous checkpoint intact. */
+
+namespace
+{
+  constexpr char checkpoint_magic[8] = { 'D', 'Y', 'N', 'K', 'O', 'R', 'D', '2' };
+
+  void
+  writeInt(std::ostream &out, int i)
+  {
+    out.write(reinterpret_cast<const char *>(&i), sizeof i);
+  }
+
+  int
+  readInt(std::istream &in)
+  {
+    int i;
+    in.read(reinterpret_cast<char *>(&i), sizeof i);
+    KORD_RAISE_IF(!in, "Checkpoint file is truncated");
+    return i;
+  }
+
+  void
+  writeHash(std::ostream &out, std::uint64_t h)
+  {
+    out.write(reinterpret_cast<const char *>(&h), sizeof h);
+  }
+
+  std::uint64_t
+  readHash(std::istream &in)
+  {
+    std::uint64_t h;
+    in.read(reinterpret_cast<char *>(&h), sizeof h);
+    KORD_RAISE_IF(!in, "Checkpoint file is truncated");
+    return h;
+  }
+
+  /* FNV-1a hash of the dimensions and of the items (coordinates, rows and
+     values) of a sparse tensor. The items are traversed in the order of
+     their keys, so the hash does not depend on the order of insertion. */
+  std::uint64_t
+  hashTensor(const FSSparseTensor &t)
+  {
+    std::uint64_t h = 14695981039346656037ULL;
+    auto add = [&h](const void *p, std::size_t n)
+               {
+                 for (std::size_t i = 0; i < n; i++)
+                   {
+                     h ^= static_cast<const unsigned char *>(p)[i];
+                     h *= 1099511628211ULL;
+                   }
+               };
+    for (int i : { t.dimen(), t.nrows(), t.nvar() })
+      add(&i, sizeof i);
+    for (const auto &it : t.getMap())
+      {
+        for (int i = 0; i < it.first.size(); i++)
+          {
+            int c = it.first[i];
+            add(&c, sizeof c);
+          }
+        add(&it.second.first, sizeof(int));
+        add(&it.second.second, sizeof(double));
+      }
+    return h;
+  }
+
+  /* Checks that a tensor of order 1 from a previous solution is the one we
+     have, up to a relative tolerance */
+  bool
+  sameFirstOrder(const FGSTensor &prev, const FGSTensor &ours)
+  {
+    Vector diff(prev.getData());
+    diff.add(-1.0, ours.getData());
+    return diff.getMax() <= 1e-8*std::max(ours.getData().getMax(), 1.0);
+  }
+
+  void
+  writeContainer(std::ostream &out, const FGSContainer &c)
+  {
+    writeInt(out, std::distance(c.begin(), c.end()));
+    for (const auto &it : c)
+      {
+        for (int i = 0; i < it.first.num(); i++)
+          writeInt(out, it.first[i]);
+        const Vector &data = it.second->getData();
+        writeInt(out, data.length());
+        out.write(reinterpret_cast<const char *>(data.base()), data.length()*sizeof(double));
+      }
+  }
+}
+
+void
+KOrder::saveCheckpoint(const std::string &fname) const
+{
+  KORD_RAISE_IF(!g<Storage::fold>().check(Symmetry{1, 0, 0, 0}),
+                "Checkpoints can only be made of folded derivatives in KOrder::saveCheckpoint");
+
+  JournalRecordPair pa(journal);
+  pa << "Writing checkpoint to " << fname << endrec;
+
+  std::string tmpname = fname + ".tmp";
+  std::ofstream out(tmpname, std::ios::binary | std::ios::trunc);
+  KORD_RAISE_IF(!out, "Cannot open checkpoint file " + tmpname);
+
+  out.write(checkpoint_magic, sizeof checkpoint_magic);
+  for (int i : { ypart.nstat, ypart.npred, ypart.nboth, ypart.nforw, nu,
+        g<Storage::fold>().getMaxDim() })
+    writeInt(out, i);
+  out.write(reinterpret_cast<const char *>(vcov.base()), nu*nu*sizeof(double));
+  writeInt(out, maxk);
+  for (int d = 1; d <= maxk; d++)
+    writeHash(out, f.check(Symmetry{d}) ? hashTensor(f.get(Symmetry{d})) : 0);
+  writeContainer(out, g<Storage::fold>());
+  writeContainer(out, G<Storage::fold>());
+
+  out.close();
+  KORD_RAISE_IF(!out, "Cannot write checkpoint file " + tmpname);
+  KORD_RAISE_IF(std::rename(tmpname.c_str(), fname.c_str()) != 0,
+                "Cannot rename checkpoint file " + tmpname + " to " + fname);
+}
+
+/* The covariance matrix and the hashes of the model derivatives up to the
+   last completed order must be those of our model. Then the tensors of order
+   1 read from the file are compared to those we have, and the others are
+   inserted. The tensors of orders greater than ‘maxk’ are skipped. The
+   symmetry of every tensor is checked against the order of the file before
+   anything is allocated, so that a corrupted file raises an error instead
+   of making us allocate a huge tensor. */
+
+int
+KOrder::loadCheckpoint(const std::string &fname)
+{
+  KORD_RAISE_IF(g<Storage::fold>().getMaxDim() != 1,
+                "KOrder::loadCheckpoint must be called just after switchToFolded");
+
+  JournalRecordPair pa(journal);
+  pa << "Reading checkpoint from " << fname << endrec;
+
+  std::ifstream in(fname, std::ios::binary);
+  KORD_RAISE_IF(!in, "Cannot open checkpoint file " + fname);
+
+  char magic[sizeof checkpoint_magic];
+  in.read(magic, sizeof magic);
+  KORD_RAISE_IF(!in || !std::equal(magic, magic + sizeof magic, checkpoint_magic),
+                fname + " is not a checkpoint file of this version");
+
+  IntSequence dims{ypart.nstat, ypart.npred, ypart.nboth, ypart.nforw, nu};
+  for (int i = 0; i < dims.size(); i++)
+    KORD_RAISE_IF(readInt(in) != dims[i],
+                  "Checkpoint file " + fname + " does not match the dimensions of the model");
+  int file_order = readInt(in);
+  KORD_RAISE_IF(file_order < 1, "Wrong order in checkpoint file " + fname);
+  int order = std::min(file_order, maxk);
+
+  TwoDMatrix prev_vcov(nu, nu);
+  in.read(reinterpret_cast<char *>(prev_vcov.base()), nu*nu*sizeof(double));
+  KORD_RAISE_IF(!in, "Checkpoint file " + fname + " is truncated");
+  KORD_RAISE_IF(vcov.getData() != prev_vcov.getData(),
+                "Checkpoint file " + fname + " does not match the covariance matrix of the model");
+  int nhash = readInt(in);
+  KORD_RAISE_IF(nhash < order, "Wrong number of hashes in checkpoint file " + fname);
+  for (int d = 1; d <= nhash; d++)
+    {
+      std::uint64_t h = readHash(in);
+      KORD_RAISE_IF(d <= order && h != (f.check(Symmetry{d}) ? hashTensor(f.get(Symmetry{d})) : 0),
+                    "Checkpoint file " + fname + " does not match the model derivatives of order "
+                    + std::to_string(d));
+    }
+
+  for (bool is_g : { true, false })
+    {
+      int n = readInt(in);
+      for (int k = 0; k < n; k++)
+        {
+          Symmetry sym{0, 0, 0, 0};
+          for (int i = 0; i < sym.num(); i++)
+            {
+              sym[i] = readInt(in);
+              KORD_RAISE_IF(sym[i] < 0 || sym[i] > file_order,
+                            "Wrong symmetry in checkpoint file " + fname);
+            }
+          KORD_RAISE_IF(sym.dimen() > file_order,
+                        "Wrong symmetry in checkpoint file " + fname);
+          if (sym.dimen() > maxk)
+            {
+              int len = readInt(in);
+              KORD_RAISE_IF(len < 0, "Wrong tensor size in checkpoint file " + fname);
+              in.seekg(static_cast<std::streamoff>(len)*sizeof(double), std::ios::cur);
+              KORD_RAISE_IF(!in, "Checkpoint file " + fname + " is truncated");
+              continue;
+            }
+          auto t = std::make_unique<FGSTensor>(is_g ? ny : ypart.nyss(), TensorDimens(sym, nvs));
+          Vector &data = t->getData();
+          KORD_RAISE_IF(readInt(in) != data.length(),
+                        "Wrong tensor size in checkpoint file " + fname);
+          in.read(reinterpret_cast<char *>(data.base()), data.length()*sizeof(double));
+          KORD_RAISE_IF(!in, "Checkpoint file " + fname + " is truncated");
+
+          auto &cont = is_g ? g<Storage::fold>() : G<Storage::fold>();
+          if (sym.dimen() == 1 && cont.check(sym))
+            {
+              KORD_RAISE_IF(!sameFirstOrder(*t, cont.get(sym)),
+                            "Checkpoint file " + fname + " does not match the first order solution");
+            }
+          else
+            {
+              if (is_g)
+                insertDerivative<Storage::fold>(std::move(t));
+              else
+                cont.insert(std::move(t));
+            }
+        }
+    }
+
+  JournalRecord rec(journal);
+  rec << "Checkpoint complete up to order " << order << endrec;
+  return order;
+}
+
+/* The first order derivatives of the previous solution must be those we
+   have, which the caller has obtained by solving the first order problem of
+   our model. The derivatives of g are inserted order by order, checking that
+   none of the non-zero ones (those with an even number of σ) is missing.
+   Then the derivatives of G are calculated by the first stage of the
+   recovery, run in parallel for all the symmetries of all the orders: this
+   stage only reads g** and the G stack, and since g** is complete, it
+   directly provides the final G tensors, which performStep() obtains by
+   updating them after the recovery of g. */
+
+int
+KOrder::restoreDerivatives(const FGSContainer &ders)
+{
+  KORD_RAISE_IF(g<Storage::fold>().getMaxDim() != 1,
+                "KOrder::restoreDerivatives must be called just after switchToFolded");
+
+  JournalRecordPair pa(journal);
+  pa << "Restoring derivatives of a previous solution" << endrec;
+
+  for (const auto &sym : { Symmetry{1, 0, 0, 0}, Symmetry{0, 1, 0, 0} })
+    KORD_RAISE_IF(!ders.check(sym) || !sameFirstOrder(ders.get(sym), g<Storage::fold>().get(sym)),
+                  "Previous derivatives do not match the first order solution");
+
+  int order = std::min(ders.getMaxDim(), maxk);
+  std::vector<Recovery<Storage::fold>> recs;
+  for (int dim = 2; dim <= order; dim++)
+    for (int k = 0; k <= dim; k++)
+      for (int j = 0; j <= dim-k; j++)
+        {
+          Symmetry sym{dim-j-k, j, 0, k};
+          if (is_even(k))
+            {
+              KORD_RAISE_IF(!ders.check(sym),
+                            "Missing derivative of order " + std::to_string(dim) + " in previous derivatives");
+              KORD_RAISE_IF(ders.get(sym).nrows() != ny || ders.get(sym).getDims() != TensorDimens(sym, nvs),
+                            "Wrong dimensions of a derivative in previous derivatives");
+              insertDerivative<Storage::fold>(std::make_unique<FGSTensor>(ders.get(sym)));
+            }
+          recs.emplace_back(sym);
+        }
+
+  runRecoveryStage<Storage::fold>(recs, RecoveryStage::G);
+  for (auto &r : recs)
+    for (auto &G_t : r.Gs)
+      G<Storage::fold>().insert(std::move(G_t));
+
+  JournalRecord rec(journal);
+  rec << "Derivatives restored up to order " << order << endrec;
+  return order;
+}
@@ -51,6 +51,7 @@
 #include "faa_di_bruno.hh"
 #include "journal.hh"
 #include "pascal_triangle.hh"
+#include "sthread.hh"
 
 #include "kord_exception.hh"
 #include "GeneralSylvester.hh"
@@ -59,6 +60,9 @@
 
 #include <cmath>
 #include <type_traits>
+#include <memory>
+#include <vector>
+#include <string>
 
 // The enum class passed as template parameter for many data structures
 enum class Storage { fold, unfold };
@@ -244,6 +248,10 @@ protected:
   UNormalMoments _um;
   FNormalMoments _fm;
 
+  /* Covariance matrix of the shocks, kept to check that a checkpoint file
+     was made with the same one */
+  const TwoDMatrix vcov;
+
   /* Dynamic model derivatives: just a reference to the container of sparse
      tensors of the system derivatives, lives outside the class */
   const TensorContainer<FSSparseTensor> &f;
@@ -254,6 +262,20 @@ protected:
   const MatrixS matS;
   const MatrixB matB;
 
+  /* Decomposition of the Sylvester equation solved for the g_y*ⁱσᵏ
+     derivatives. Its matrices (A, B and g*_y) are the same for all the
+     symmetries and all the orders, so it is computed once in the
+     constructor (if there are both y* and y** variables), and then shared by
+     the concurrent recoveries. It is made with the SylvParams given to the
+     constructor, which may for instance ask for the mixed precision solve
+     (see GeneralSylvester.hh). */
+  std::unique_ptr<GeneralSylvesterDecomp> sylvDecomp;
+
+  /* Number of symmetries being recovered concurrently (see performStep()),
+     the Faà Di Bruno evaluations of each of them size their temporaries
+     with this share of the available memory */
+  int concurrent_recoveries{1};
+
   /* These are the declarations of the template functions accessing the
      containers. We declare template methods for accessing containers depending
      on ‘fold’ and ‘unfold’ flag, we implement their specializations*/
@@ -297,7 +319,7 @@ public:
   KOrder(int num_stat, int num_pred, int num_both, int num_forw,
          const TensorContainer<FSSparseTensor> &fcont,
          const TwoDMatrix &gy, const TwoDMatrix &gu, const TwoDMatrix &v,
-         Journal &jr);
+         Journal &jr, const SylvParams &sylv_pars = SylvParams());
 
   /* Performs k-order step provided that k=2 or the k−1-th step has been
      run, this is the core method */
@@ -312,6 +334,20 @@ public:
   template<Storage t>
   Vector calcStochShift(int order, double sigma) const;
   void switchToFolded();
+
+  /* Writes the folded derivatives of g and G (up to the last completed
+     order) to a checkpoint file */
+  void saveCheckpoint(const std::string &fname) const;
+  /* Reads the derivatives of orders 2 and more from a checkpoint file into
+     the folded containers, and returns the last order they complete. It must
+     be called just after switchToFolded(). */
+  int loadCheckpoint(const std::string &fname);
+  /* Inserts the derivatives of g of orders 2 up to ‘maxk’ found in a folded
+     container of a previous solution of the same model, and calculates the
+     derivatives of G from them. It returns the last order they complete, so
+     that the next orders can be obtained by performStep(). It must be called
+     just after switchToFolded(). */
+  int restoreDerivatives(const FGSContainer &ders);
   const PartitionY &
   getPartY() const
   {
@@ -357,24 +393,71 @@ protected:
   template<Storage t>
   std::unique_ptr<typename ctraits<t>::Ttensor> faaDiBrunoG(const Symmetry &sym) const;
 
-  // Recovers g_y*ⁱ
+  /* Tensors passed between the stages of the recovery of g_y*ⁱuʲσᵏ, whose
+     symmetry is {i, j, 0, k}: the G tensors to be inserted, the conditional
+     G_y*ⁱuʲσᵏ among them (if recovered), and the derivative */
   template<Storage t>
-  void recover_y(int i);
-  // Recovers g_y*ⁱuʲ
+  struct Recovery
+  {
+    Symmetry sym;
+    std::vector<std::unique_ptr<typename ctraits<t>::Ttensor>> Gs;
+    typename ctraits<t>::Ttensor *G_sym{nullptr};
+    std::unique_ptr<typename ctraits<t>::Ttensor> der;
+    explicit Recovery(Symmetry s)
+      : sym(std::move(s))
+    {
+    }
+  };
+  enum class RecoveryStage { G, der, update };
+
+  // Runs a stage of the recovery of a symmetry
   template<Storage t>
-  void recover_yu(int i, int j);
-  // Recovers g_y*ⁱσʲ
+  class RecoveryWorker : public sthread::detach_thread
+  {
+    KOrder &korder;
+    Recovery<t> &rec;
+    const RecoveryStage stage;
+  public:
+    RecoveryWorker(KOrder &korder_arg, Recovery<t> &rec_arg, RecoveryStage stage_arg)
+      : korder(korder_arg), rec(rec_arg), stage(stage_arg)
+    {
+    }
+    void
+    operator()(std::mutex &mut) override
+    {
+      switch (stage)
+        {
+        case RecoveryStage::G:
+          korder.recoverG<t>(rec);
+          break;
+        case RecoveryStage::der:
+          korder.recoverDer<t>(rec);
+          break;
+        case RecoveryStage::update:
+          korder.recoverUpdate<t>(rec);
+          break;
+        }
+    }
+  };
+
+  /* Groups the symmetries {i, j, 0, k} of g of the given order in waves of
+     mutually independent symmetries */
+  static std::vector<std::vector<Symmetry>> recoveryWaves(int order);
+  // Calculates the G tensors needed for the recovery of a symmetry
   template<Storage t>
-  void recover_ys(int i, int j);
-  // Recovers g_y*ⁱuʲσᵏ
+  void recoverG(Recovery<t> &r) const;
+  // Calculates the right hand side and solves for the derivative
   template<Storage t>
-  void recover_yus(int i, int j, int k);
+  void recoverDer(Recovery<t> &r) const;
+  // Updates G_y*ⁱuʲσᵏ once the derivative is in the containers
   template<Storage t>
-  // Recovers g_σⁱ
-  void recover_s(int i);
-  // Calculates specified derivatives of G and inserts them to the container
+  void recoverUpdate(Recovery<t> &r);
+  // Runs a stage of the recovery for all the symmetries of a wave
   template<Storage t>
-  void fillG(int i, int j, int k);
+  void runRecoveryStage(std::vector<Recovery<t>> &recs, RecoveryStage stage);
+  // Calculates specified derivatives of G
+  template<Storage t>
+  void fillG(int i, int j, int k, std::vector<std::unique_ptr<typename ctraits<t>::Ttensor>> &Gs) const;
 
   // Calculates Dᵢⱼₖ
   template<Storage t>
@@ -422,7 +505,7 @@ KOrder::faaDiBrunoZ(const Symmetry &sym) const
   JournalRecordPair pa(journal);
   pa << u8"Faà Di Bruno Z container for " << sym << endrec;
   auto res = std::make_unique<typename ctraits<t>::Ttensor>(ny, TensorDimens(sym, nvs));
-  FaaDiBruno bruno(journal);
+  FaaDiBruno bruno(journal, concurrent_recoveries);
   bruno.calculate(Zstack<t>(), f, *res);
   return res;
 }
@@ -437,251 +520,183 @@ KOrder::faaDiBrunoG(const Symmetry &sym) const
   pa << u8"Faà Di Bruno G container for " << sym << endrec;
   TensorDimens tdims(sym, nvs);
   auto res = std::make_unique<typename ctraits<t>::Ttensor>(ypart.nyss(), tdims);
-  FaaDiBruno bruno(journal);
+  FaaDiBruno bruno(journal, concurrent_recoveries);
   bruno.calculate(Gstack<t>(), gss<t>(), *res);
   return res;
 }
 
-/* Here we solve [F_yⁱ]=0. First we calculate conditional G_yⁱ (it misses l=1
-   and l=i since g_yⁱ does not exist yet). Then calculate conditional F_yⁱ and
-   we have the right hand side of equation. Since we miss two orders, we solve
-   by Sylvester, and insert the solution as the derivative g_yⁱ. Then we need
-   to update G_yⁱ running multAndAdd() for both dimensions 1 and i.
+/* The recovery of a derivative g_yⁱuʲσᵏ of order n=i+j+k is done in three
+   stages. The first one, recoverG(), calculates the G tensors needed for the
+   recovery, the second one, recoverDer(), calculates and solves the right
+   hand side, and the last one, recoverUpdate(), updates G_yⁱuʲσᵏ after the
+   derivative has been inserted. The stages read the containers, but they do
+   not insert anything in them, this is left to performStep() between two
+   stages. Depending on the symmetry, the stages do the following:
 
-   Requires: everything at order ≤ i−1
+   — For g_yⁱ, we solve [F_yⁱ]=0. First we calculate conditional G_yⁱ (it
+     misses l=1 and l=i since g_yⁱ does not exist yet). Then calculate
+     conditional F_yⁱ and we have the right hand side of equation. Since we
+     miss two orders, we solve by Sylvester, and insert the solution as the
+     derivative g_yⁱ. Then we need to update G_yⁱ running multAndAdd() for
+     both dimensions 1 and i.
 
-   Provides: g_yⁱ and G_yⁱ
-*/
-template<Storage t>
-void
-KOrder::recover_y(int i)
-{
-  Symmetry sym{i, 0, 0, 0};
-  JournalRecordPair pa(journal);
-  pa << "Recovering symmetry " << sym << endrec;
+     Requires: everything at order ≤ i−1
 
-  auto G_yi = faaDiBrunoG<t>(sym);
-  auto G_yi_ptr = G_yi.get();
-  G<t>().insert(std::move(G_yi));
+     Provides: g_yⁱ and G_yⁱ
 
-  auto g_yi = faaDiBrunoZ<t>(sym);
-  g_yi->mult(-1.0);
+   — For g_yⁱuʲ with j>0, we solve [F_yⁱuʲ]=0. We calculate conditional
+     G_yⁱuʲ (this misses only l=1) and calculate conditional F_yⁱuʲ and we
+     have the right hand side. It is solved by multiplication of inversion of
+     A. Then we insert the result, and update G_yⁱuʲ by multAndAdd() for l=1.
 
-  sylvesterSolve<t>(*g_yi);
+     Requires: everything at order ≤ i+j−1, G_yⁱ⁺ʲ and g_yⁱ⁺ʲ.
 
-  insertDerivative<t>(std::move(g_yi));
+     Provides: g_yⁱuʲ and G_yⁱuʲ
 
-  auto &gss_y = gss<t>().get(Symmetry{1, 0, 0, 0});
-  gs<t>().multAndAdd(gss_y, *G_yi_ptr);
-  auto &gss_yi = gss<t>().get(sym);
-  gs<t>().multAndAdd(gss_yi, *G_yi_ptr);
-}
+   — For g_yⁱσᵏ, we solve [F_yⁱσᵏ]+[Dᵢₖ]+[Eᵢₖ]=0. We calculate conditional
+     G_yⁱσᵏ (missing dimensions 1 and i+k), calculate conditional F_yⁱσᵏ.
+     Before we can calculate Dᵢₖ and Eᵢₖ, we have to calculate G_yⁱu′ᵐσᵏ⁻ᵐ
+     for m=1,…,k. Then we add the Dᵢₖ and Eᵢₖ to obtain the right hand side.
+     Then we solve the sylvester to obtain g_yⁱσᵏ. Then we update G_yⁱσᵏ for
+     l=1 and l=i+k.
 
-/* Here we solve [F_yⁱuʲ]=0 to obtain g_yⁱuʲ for j>0. We calculate conditional
-   G_yⁱuʲ (this misses only l=1) and calculate conditional F_yⁱuʲ and we have
-   the right hand side. It is solved by multiplication of inversion of A. Then
-   we insert the result, and update G_yⁱuʲ by multAndAdd() for l=1.
+     Requires: everything at order ≤ i+k−1, g_yⁱ⁺ᵏ, G_yⁱu′ᵏ and g_yⁱuᵏ
+       through Dᵢₖ, g_yⁱuᵐσᵏ⁻ᵐ for m=1,…,k−1 through Eᵢₖ.
 
-   Requires: everything at order ≤ i+j−1, G_yⁱ⁺ʲ and g_yⁱ⁺ʲ.
+     Provides: g_yⁱσᵏ and G_yⁱσᵏ, and finally G_yⁱu′ᵐσᵏ⁻ᵐ for m=1,…,k.
 
-   Provides: g_yⁱuʲ and G_yⁱuʲ
-*/
-template<Storage t>
-void
-KOrder::recover_yu(int i, int j)
-{
-  Symmetry sym{i, j, 0, 0};
-  JournalRecordPair pa(journal);
-  pa << "Recovering symmetry " << sym << endrec;
-
-  auto G_yiuj = faaDiBrunoG<t>(sym);
-  auto G_yiuj_ptr = G_yiuj.get();
-  G<t>().insert(std::move(G_yiuj));
-
-  auto g_yiuj = faaDiBrunoZ<t>(sym);
-  g_yiuj->mult(-1.0);
-  matA.multInv(*g_yiuj);
-  insertDerivative<t>(std::move(g_yiuj));
-
-  gs<t>().multAndAdd(gss<t>().get(Symmetry{1, 0, 0, 0}), *G_yiuj_ptr);
-}
-
-/* Here we solve [F_yⁱσʲ]+[Dᵢⱼ]+[Eᵢⱼ]=0 to obtain g_yⁱσʲ. We calculate
-   conditional G_yⁱσʲ (missing dimensions 1 and i+j), calculate conditional
-   F_yⁱσʲ. Before we can calculate Dᵢⱼ and Eᵢⱼ, we have to calculate
-   G_yⁱu′ᵐσʲ⁻ᵐ for m=1,…,j. Then we add the Dᵢⱼ and Eᵢⱼ to obtain the right
-   hand side. Then we solve the sylvester to obtain g_yⁱσʲ. Then we update
-   G_yⁱσʲ for l=1 and l=i+j.
-
-   Requires: everything at order ≤ i+j−1, g_yⁱ⁺ʲ, G_yⁱu′ʲ and g_yⁱuʲ through
-     Dᵢⱼ, g_yⁱuᵐσʲ⁻ᵐ for m=1,…,j−1 through Eᵢⱼ.
-
-   Provides: g_yⁱσʲ and G_yⁱσʲ, and finally G_yⁱu′ᵐσʲ⁻ᵐ for m=1,…,j. The latter
-     is calculated by fillG() before the actual calculation.
-*/
-template<Storage t>
-void
-KOrder::recover_ys(int i, int j)
-{
-  Symmetry sym{i, 0, 0, j};
-  JournalRecordPair pa(journal);
-  pa << "Recovering symmetry " << sym << endrec;
-
-  fillG<t>(i, 0, j);
-
-  if (is_even(j))
-    {
-      auto G_yisj = faaDiBrunoG<t>(sym);
-      auto G_yisj_ptr = G_yisj.get();
-      G<t>().insert(std::move(G_yisj));
+   — For g_yⁱuʲσᵏ with j>0, we solve [F_yⁱuʲσᵏ]+[Dᵢⱼₖ]+[Eᵢⱼₖ]=0. We
+     calculate conditional G_yⁱuʲσᵏ (missing only for dimension l=1), then we
+     evaluate conditional F_yⁱuʲσᵏ. Before we can calculate Dᵢⱼₖ, and Eᵢⱼₖ,
+     we need G_yⁱuʲu′ᵐσᵏ⁻ᵐ for m=1,…,k. Then we have right hand side and we
+     multiply by A⁻¹ to obtain g_yⁱuʲσᵏ. Finally we have to update G_yⁱuʲσᵏ
+     by multAndAdd() for dimension l=1.
 
-      auto g_yisj = faaDiBrunoZ<t>(sym);
+     Requires: everything at order ≤ i+j+k, g_yⁱ⁺ʲσᵏ through G_yⁱuʲσᵏ
+       involved in right hand side, then g_yⁱuʲ⁺ᵏ through Dᵢⱼₖ, and
+       g_yⁱuʲ⁺ᵐσᵏ⁻ᵐ for m=1,…,k−1 through Eᵢⱼₖ.
 
-      {
-        auto D_ij = calcD_ik<t>(i, j);
-        g_yisj->add(1.0, D_ij);
-      }
+     Provides: g_yⁱuʲσᵏ, G_yⁱuʲσᵏ, and G_yⁱuʲu′ᵐσᵏ⁻ᵐ for m=1,…,k
 
-      if (j >= 3)
-        {
-          auto E_ij = calcE_ik<t>(i, j);
-          g_yisj->add(1.0, E_ij);
-        }
+   — For g_σᵏ, we solve [F_{σᵏ}]+[Dₖ]+[Eₖ]=0. We calculate conditional G_σᵏ
+     (missing dimension l=1 and l=k), then we calculate conditional F_σᵏ.
+     Before we can calculate Dₖ and Eₖ, we have to obtain G_u′ᵐσᵏ⁻ᵐ for
+     m=1,…,k. Then adding Dₖ and Eₖ we have the right hand side. We solve by
+     S⁻¹ multiplication and update G_σᵏ by calling multAndAdd() for
+     dimensions l=1 and l=k.
 
-      g_yisj->mult(-1.0);
+     Recall that the solved equation here is:
 
-      sylvesterSolve<t>(*g_yisj);
+      [f_y][g_σᵏ]+[f_y**₊][g**_y*][g*_σᵏ]+[f_y**₊][g**_σᵏ] = RHS
 
-      insertDerivative<t>(std::move(g_yisj));
+     This is a sort of deficient sylvester equation (sylvester equation for
+     dimension=0), we solve it by S⁻¹. See the constructor of MatrixS to see
+     how S looks like.
 
-      Gstack<t>().multAndAdd(1, gss<t>(), *G_yisj_ptr);
-      Gstack<t>().multAndAdd(i+j, gss<t>(), *G_yisj_ptr);
-    }
-}
+     Requires: everything at order ≤ k−1, g_yᵏ and g_yᵏ⁻ᵐσᵐ, then g_uᵏ
+       through F_u′ᵏ, and g_yᵐuʲσˡ for j=1,…,k−1 and m+j+l=k through
+       F_u′ʲσᵏ⁻ʲ.
 
-/* Here we solve [F_yⁱuʲσᵏ]+[Dᵢⱼₖ]+[Eᵢⱼₖ]=0 to obtain g_yⁱuʲσᵏ. First we
-   calculate conditional G_yⁱuʲσᵏ (missing only for dimension l=1), then we
-   evaluate conditional F_yⁱuʲσᵏ. Before we can calculate Dᵢⱼₖ, and Eᵢⱼₖ, we
-   need to insert G_yⁱuʲu′ᵐσᵏ⁻ᵐ for m=1,…,k. This is done by fillG(). Then we
-   have right hand side and we multiply by A⁻¹ to obtain g_yⁱuʲσᵏ. Finally we
-   have to update G_yⁱuʲσᵏ by multAndAdd() for dimension l=1.
+     Provides: g_σᵏ, G_σᵏ, and G_u′ᵐσᵏ⁻ᵐ for m=1,…,k
 
-   Requires: everything at order ≤ i+j+k, g_yⁱ⁺ʲσᵏ through G_yⁱuʲσᵏ involved in
-     right hand side, then g_yⁱuʲ⁺ᵏ through Dᵢⱼₖ, and g_yⁱuʲ⁺ᵐσᵏ⁻ᵐ for m=1,…,k−1
-     through Eᵢⱼₖ.
+   The derivatives with an odd k are zero, they are not recovered, but the G
+   tensors for m with an even k−m are calculated anyway. */
 
-   Provides: g_yⁱuʲσᵏ, G_yⁱuʲσᵏ, and G_yⁱuʲu′ᵐσᵏ⁻ᵐ for m=1,…,k
-*/
 template<Storage t>
 void
-KOrder::recover_yus(int i, int j, int k)
+KOrder::recoverG(Recovery<t> &r) const
 {
-  Symmetry sym{i, j, 0, k};
-  JournalRecordPair pa(journal);
-  pa << "Recovering symmetry " << sym << endrec;
+  int i = r.sym[0], j = r.sym[1], k = r.sym[3];
 
-  fillG<t>(i, j, k);
+  if (k > 0)
+    fillG<t>(i, j, k, r.Gs);
 
   if (is_even(k))
     {
-      auto G_yiujsk = faaDiBrunoG<t>(sym);
-      auto G_yiujsk_ptr = G_yiujsk.get();
-      G<t>().insert(std::move(G_yiujsk));
-
-      auto g_yiujsk = faaDiBrunoZ<t>(sym);
-
-      {
-        auto D_ijk = calcD_ijk<t>(i, j, k);
-        g_yiujsk->add(1.0, D_ijk);
-      }
+      r.Gs.push_back(faaDiBrunoG<t>(r.sym));
+      r.G_sym = r.Gs.back().get();
+    }
+}
 
-      if (k >= 3)
-        {
-          auto E_ijk = calcE_ijk<t>(i, j, k);
-          g_yiujsk->add(1.0, E_ijk);
-        }
+template<Storage t>
+void
+KOrder::recoverDer(Recovery<t> &r) const
+{
+  int i = r.sym[0], j = r.sym[1], k = r.sym[3];
 
-      g_yiujsk->mult(-1.0);
+  if (!is_even(k))
+    return;
 
-      matA.multInv(*g_yiujsk);
-      insertDerivative<t>(std::move(g_yiujsk));
+  r.der = faaDiBrunoZ<t>(r.sym);
 
-      Gstack<t>().multAndAdd(1, gss<t>(), *G_yiujsk_ptr);
+  if (k > 0)
+    {
+      auto D_ijk = calcD_ijk<t>(i, j, k);
+      r.der->add(1.0, D_ijk);
     }
-}
-
-/* Here we solve [F_{σⁱ}]+[Dᵢ]+[Eᵢ]=0 to recover g_σⁱ. First we calculate
-   conditional G_σⁱ (missing dimension l=1 and l=i), then we calculate
-   conditional F_σⁱ. Before we can calculate Dᵢ and Eᵢ, we have to obtain
-   G_u′ᵐσⁱ⁻ᵐ for m=1,…,i. Then adding Dᵢ and Eᵢ we have the right hand side. We
-   solve by S⁻¹ multiplication and update G_σⁱ by calling multAndAdd() for
-   dimension l=1.
-
-   Recall that the solved equation here is:
 
-    [f_y][g_σᵏ]+[f_y**₊][g**_y*][g*_σᵏ]+[f_y**₊][g**_σᵏ] = RHS
+  if (k >= 3)
+    {
+      auto E_ijk = calcE_ijk<t>(i, j, k);
+      r.der->add(1.0, E_ijk);
+    }
 
-   This is a sort of deficient sylvester equation (sylvester equation for
-   dimension=0), we solve it by S⁻¹. See the constructor of MatrixS to see how
-   S looks like.
+  r.der->mult(-1.0);
 
-   Requires: everything at order ≤ i−1, g_yⁱ and g_yⁱ⁻ʲσʲ, then g_uᵏ through
-     F_u′ᵏ, and g_yᵐuʲσᵏ for j=1,…,i−1 and m+j+k=i through F_u′ʲσⁱ⁻ʲ.
+  if (j > 0)
+    matA.multInv(*r.der);
+  else if (i > 0)
+    sylvesterSolve<t>(*r.der);
+  else
+    matS.multInv(*r.der);
+}
 
-   Provides: g_σⁱ, G_σⁱ, and G_u′ᵐσⁱ⁻ᵐ for m=1,…,i
-*/
 template<Storage t>
 void
-KOrder::recover_s(int i)
+KOrder::recoverUpdate(Recovery<t> &r)
 {
-  Symmetry sym{0, 0, 0, i};
-  JournalRecordPair pa(journal);
-  pa << "Recovering symmetry " << sym << endrec;
+  int i = r.sym[0], j = r.sym[1], k = r.sym[3];
 
-  fillG<t>(0, 0, i);
+  if (!r.G_sym)
+    return;
 
-  if (is_even(i))
+  if (k == 0)
     {
-      auto G_si = faaDiBrunoG<t>(sym);
-      auto G_si_ptr = G_si.get();
-      G<t>().insert(std::move(G_si));
-
-      auto g_si = faaDiBrunoZ<t>(sym);
-
-      {
-        auto D_i = calcD_k<t>(i);
-        g_si->add(1.0, D_i);
-      }
-
-      if (i >= 3)
-        {
-          auto E_i = calcE_k<t>(i);
-          g_si->add(1.0, E_i);
-        }
-
-      g_si->mult(-1.0);
+      gs<t>().multAndAdd(gss<t>().get(Symmetry{1, 0, 0, 0}), *r.G_sym);
+      if (j == 0)
+        gs<t>().multAndAdd(gss<t>().get(r.sym), *r.G_sym);
+    }
+  else
+    {
+      Gstack<t>().multAndAdd(1, gss<t>(), *r.G_sym);
+      if (j == 0)
+        Gstack<t>().multAndAdd(i+k, gss<t>(), *r.G_sym);
+    }
+}
 
-      matS.multInv(*g_si);
-      insertDerivative<t>(std::move(g_si));
+/* Here we run a stage of the recovery for all the symmetries of a wave, each
+   one in its own worker. */
 
-      Gstack<t>().multAndAdd(1, gss<t>(), *G_si_ptr);
-      Gstack<t>().multAndAdd(i, gss<t>(), *G_si_ptr);
-    }
+template<Storage t>
+void
+KOrder::runRecoveryStage(std::vector<Recovery<t>> &recs, RecoveryStage stage)
+{
+  sthread::detach_thread_group gr;
+  for (auto &r : recs)
+    gr.insert(std::make_unique<RecoveryWorker<t>>(*this, r, stage));
+  gr.run();
 }
 
-/* Here we calculate and insert G_yⁱuʲu′ᵐσᵏ⁻ᵐ for m=1,…,k. The derivatives are
-   inserted only for k−m being even. */
+/* Here we calculate G_yⁱuʲu′ᵐσᵏ⁻ᵐ for m=1,…,k. The derivatives are
+   calculated only for k−m being even. */
 
 template<Storage t>
 void
-KOrder::fillG(int i, int j, int k)
+KOrder::fillG(int i, int j, int k, std::vector<std::unique_ptr<typename ctraits<t>::Ttensor>> &Gs) const
 {
   for (int m = 1; m <= k; m++)
     if (is_even(k-m))
-      {
-        auto G_yiujupms = faaDiBrunoG<t>(Symmetry{i, j, m, k-m});
-        G<t>().insert(std::move(G_yiujupms));
-      }
+      Gs.push_back(faaDiBrunoG<t>(Symmetry{i, j, m, k-m}));
 }
 
 /* Here we calculate:
@@ -771,7 +786,17 @@ KOrder::calcE_k(int k) const
 
    From the code, it is clear, that all g are calculated. If one goes through
    all the recovering methods, he should find out that also all G are
-   provided. */
+   provided.
+
+   The symmetries are recovered wave by wave (see recoveryWaves()), and the
+   symmetries of a wave are recovered concurrently. Each stage of the recovery
+   is run in parallel for all the symmetries of the wave, and the tensors
+   calculated by the stage are inserted to the containers after all the
+   workers have finished, so that the containers are never modified while
+   they are read. Since the symmetries of a wave do not depend on each other,
+   the result is the same as if they were recovered one after the other.
+   The available memory is shared among the symmetries of a wave, so that
+   their Faà Di Bruno evaluations do not oversubscribe it. */
 
 template<Storage t>
 void
@@ -782,22 +807,33 @@ KOrder::performStep(int order)
   JournalRecordPair pa(journal);
   pa << "Performing step for order = " << order << endrec;
 
-  recover_y<t>(order);
-
-  for (int i = 0; i < order; i++)
-    recover_yu<t>(i, order-i);
-
-  for (int j = 1; j < order; j++)
+  for (const auto &wave : recoveryWaves(order))
     {
-      for (int i = j-1; i >= 1; i--)
-        recover_yus<t>(order-j, i, j-i);
-      recover_ys<t>(order-j, j);
-    }
+      JournalRecordPair pa1(journal);
+      pa1 << "Recovering symmetries";
+      std::vector<Recovery<t>> recs;
+      recs.reserve(wave.size());
+      for (const auto &sym : wave)
+        {
+          pa1 << ' ' << sym;
+          recs.emplace_back(sym);
+        }
+      pa1 << endrec;
+      concurrent_recoveries = recs.size();
+
+      runRecoveryStage<t>(recs, RecoveryStage::G);
+      for (auto &r : recs)
+        for (auto &G_t : r.Gs)
+          G<t>().insert(std::move(G_t));
 
-  for (int i = order-1; i >= 1; i--)
-    recover_yus<t>(0, i, order-i);
+      runRecoveryStage<t>(recs, RecoveryStage::der);
+      for (auto &r : recs)
+        if (r.der)
+          insertDerivative<t>(std::move(r.der));
 
-  recover_s<t>(order);
+      runRecoveryStage<t>(recs, RecoveryStage::update);
+    }
+  concurrent_recoveries = 1;
 }
 
 /* Here we check for residuals of all the solved equations at the given order.
@@ -0,0 +1,77 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "random_stream.hh"
+
+#include <cmath>
+#include <cstddef>
+
+/* These are the constants of the reference implementation (Random123): the
+   multipliers of the two rounds, and the Weyl sequence increments of the
+   key. */
+
+NormalStream::counter_type
+NormalStream::philox(counter_type ctr, key_type k)
+{
+  constexpr std::uint64_t m0 = 0xD2511F53, m1 = 0xCD9E8D57;
+  constexpr std::uint32_t w0 = 0x9E3779B9, w1 = 0xBB67AE85;
+  for (int r = 0; r < 10; r++)
+    {
+      if (r > 0)
+        {
+          k[0] += w0;
+          k[1] += w1;
+        }
+      std::uint64_t p0 = m0*ctr[0], p1 = m1*ctr[2];
+      ctr = { static_cast<std::uint32_t>(p1 >> 32) ^ ctr[1] ^ k[0],
+              static_cast<std::uint32_t>(p1),
+              static_cast<std::uint32_t>(p0 >> 32) ^ ctr[3] ^ k[1],
+              static_cast<std::uint32_t>(p0) };
+    }
+  return ctr;
+}
+
+/* The draws 2j and 2j+1 of the period ‘n’ come from the block of the counter
+   (n, stream, j, 0). The first uniform is taken in (0,1] so that its
+   logarithm is finite. */
+
+void
+NormalStream::fill(int n, double *out, int len) const
+{
+  constexpr double two_pi = 6.283185307179586476925286766559;
+  constexpr double eps = 1.0/9007199254740992.0; // 2⁻⁵³
+  for (int j = 0; 2*j < len; j++)
+    {
+      counter_type r = philox({static_cast<std::uint32_t>(n), stream, static_cast<std::uint32_t>(j), 0}, key);
+      std::uint64_t x1 = (static_cast<std::uint64_t>(r[1]) << 32 | r[0]) >> 11;
+      std::uint64_t x2 = (static_cast<std::uint64_t>(r[3]) << 32 | r[2]) >> 11;
+      double rad = std::sqrt(-2.0*std::log((x1+1)*eps));
+      double theta = two_pi*(x2*eps);
+      out[2*j] = rad*std::cos(theta);
+      if (2*j+1 < len)
+        out[2*j+1] = rad*std::sin(theta);
+    }
+}
+
+void
+NormalStream::fill(int n, double *out, int len, int ld, int ncols) const
+{
+  for (int j = 0; j < ncols; j++)
+    fill(n+j, out + static_cast<std::ptrdiff_t>(j)*ld, len);
+}
@@ -0,0 +1,83 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Counter-based streams of normal draws
+
+/* A sequential generator such as Mersenne-Twister has a state which must be
+   advanced draw after draw, so that the draws of a simulation depend on the
+   order in which they are requested. Here we use the counter-based generator
+   Philox4×32-10 of Salmon, Moraes, Dror and Shaw (“Parallel random numbers: as
+   easy as 1, 2, 3”, SC11): a draw is a pure function of a key and a counter,
+   so it can be computed independently of all the others.
+
+   The key is derived from a seed, and the counter is made of a stream index
+   (the simulation), a period and the position of the draw within the period.
+   So the draws of a simulation do not depend on which thread computes it, nor
+   on the number of threads, nor on the order in which the periods are
+   requested, and a whole matrix of draws can be generated in one go.
+
+   Each block of the generator gives two uniform numbers with 53 random bits,
+   which are turned into two independent standard normal draws by the
+   Box–Muller transform. */
+
+#ifndef RANDOM_STREAM_H
+#define RANDOM_STREAM_H
+
+#include <array>
+#include <cstdint>
+
+class NormalStream
+{
+public:
+  using counter_type = std::array<std::uint32_t, 4>;
+  using key_type = std::array<std::uint32_t, 2>;
+private:
+  key_type key;
+  std::uint32_t stream;
+public:
+  NormalStream(std::uint64_t seed, std::uint32_t s)
+    : key{static_cast<std::uint32_t>(seed), static_cast<std::uint32_t>(seed >> 32)},
+      stream{s}
+  {
+  }
+  // Returns the same stream with another index
+  NormalStream
+  other(std::uint32_t s) const
+  {
+    NormalStream res{*this};
+    res.stream = s;
+    return res;
+  }
+  std::uint32_t
+  getStream() const
+  {
+    return stream;
+  }
+
+  /* Fills ‘out’ with ‘len’ standard normal draws of the period ‘n’, and the
+     columns of the column-major matrix ‘out’ (with leading dimension ‘ld’)
+     with the draws of the periods n, n+1, … */
+  void fill(int n, double *out, int len) const;
+  void fill(int n, double *out, int len, int ld, int ncols) const;
+
+  // Philox4×32-10 block function
+  static counter_type philox(counter_type ctr, key_type k);
+};
+
+#endif
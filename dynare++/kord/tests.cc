@@ -18,7 +18,13 @@
  * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
 #include <random>
 #include <string>
 #include <utility>
@@ -28,7 +34,12 @@
 #include <memory>
 
 #include "korder.hh"
+#include "kord_exception.hh"
+#include "decision_rule.hh"
+#include "dynamic_model.hh"
+#include "seed_generator.hh"
 #include "SylvException.hh"
+#include "sthread.hh"
 
 struct Rand
 {
@@ -276,6 +287,22 @@ protected:
                                    int nstat, int npred, int nboth, int forw,
                                    const TwoDMatrix &gy, const TwoDMatrix &gu,
                                    const TwoDMatrix &v);
+  static double korder_restore(int maxdim, int restore_dim,
+                               int nstat, int npred, int nboth, int forw,
+                               const TwoDMatrix &gy, const TwoDMatrix &gu,
+                               const TwoDMatrix &v);
+  static double korder_mixed(int maxdim,
+                             int nstat, int npred, int nboth, int forw,
+                             const TwoDMatrix &gy, const TwoDMatrix &gu,
+                             const TwoDMatrix &v);
+  static double korder_checkpoint(int maxdim, int save_dim,
+                                  int nstat, int npred, int nboth, int forw,
+                                  const TwoDMatrix &gy, const TwoDMatrix &gu,
+                                  const TwoDMatrix &v);
+  static bool korder_checkpoint_mismatch(int maxdim,
+                                         int nstat, int npred, int nboth, int forw,
+                                         const TwoDMatrix &gy, const TwoDMatrix &gu,
+                                         const TwoDMatrix &v);
 };
 
 bool
@@ -363,6 +390,208 @@ TestRunnable::korder_unfold_fold(int maxdim, int unfold_dim,
   return maxerror;
 }
 
+/* Solves up to ‘maxdim’ twice: once from scratch, and once from the
+   derivatives of the first solution up to ‘restore_dim’. Returns the maximum
+   difference between the two solutions, relative to the largest derivative. */
+double
+TestRunnable::korder_restore(int maxdim, int restore_dim,
+                             int nstat, int npred, int nboth, int nforw,
+                             const TwoDMatrix &gy, const TwoDMatrix &gu,
+                             const TwoDMatrix &v)
+{
+  TensorContainer<FSSparseTensor> c(1);
+  int ny = nstat+npred+nboth+nforw;
+  int nu = v.nrows();
+  int nz = nboth+nforw+ny+nboth+npred+nu;
+  SparseGenerator::fillContainer(c, maxdim, nz, ny, 5.0);
+  Journal jr("out.txt");
+  KOrder kord(nstat, npred, nboth, nforw, c, gy, gu, v, jr);
+  kord.switchToFolded();
+  std::unique_ptr<FGSContainer> prev;
+  for (int d = 2; d <= maxdim; d++)
+    {
+      kord.performStep<Storage::fold>(d);
+      if (d == restore_dim)
+        prev = std::make_unique<FGSContainer>(kord.getFoldDers());
+    }
+
+  KOrder kord_restored(nstat, npred, nboth, nforw, c, gy, gu, v, jr);
+  kord_restored.switchToFolded();
+  int done = kord_restored.restoreDerivatives(*prev);
+  std::cout << "\trestored up to dim=" << done << std::endl;
+  for (int d = done+1; d <= maxdim; d++)
+    kord_restored.performStep<Storage::fold>(d);
+
+  double maxdiff = 0.0, maxder = 0.0;
+  for (const auto &it : kord.getFoldDers())
+    {
+      Vector diff(it.second->getData());
+      maxder = std::max(diff.getMax(), maxder);
+      diff.add(-1.0, kord_restored.getFoldDers().get(it.first).getData());
+      maxdiff = std::max(diff.getMax(), maxdiff);
+    }
+  std::cout << "\tmax relative difference:      " << std::setprecision(6) << maxdiff/maxder
+            << std::endl;
+  return maxdiff/maxder;
+}
+
+/* Solves up to ‘maxdim’ twice, with the Sylvester equations solved in double
+   precision and in mixed precision. Returns the maximum difference between
+   the two solutions, relative to the largest derivative. */
+double
+TestRunnable::korder_mixed(int maxdim,
+                           int nstat, int npred, int nboth, int nforw,
+                           const TwoDMatrix &gy, const TwoDMatrix &gu,
+                           const TwoDMatrix &v)
+{
+  TensorContainer<FSSparseTensor> c(1);
+  int ny = nstat+npred+nboth+nforw;
+  int nu = v.nrows();
+  int nz = nboth+nforw+ny+nboth+npred+nu;
+  SparseGenerator::fillContainer(c, maxdim, nz, ny, 5.0);
+  Journal jr("out.txt");
+  KOrder kord(nstat, npred, nboth, nforw, c, gy, gu, v, jr);
+  SylvParams pars;
+  pars.mixed_precision = true;
+  KOrder kord_mixed(nstat, npred, nboth, nforw, c, gy, gu, v, jr, pars);
+  kord.switchToFolded();
+  kord_mixed.switchToFolded();
+  for (int d = 2; d <= maxdim; d++)
+    {
+      kord.performStep<Storage::fold>(d);
+      kord_mixed.performStep<Storage::fold>(d);
+    }
+
+  double maxdiff = 0.0, maxder = 0.0;
+  for (const auto &it : kord.getFoldDers())
+    {
+      Vector diff(it.second->getData());
+      maxder = std::max(diff.getMax(), maxder);
+      diff.add(-1.0, kord_mixed.getFoldDers().get(it.first).getData());
+      maxdiff = std::max(diff.getMax(), maxdiff);
+    }
+  std::cout << "\tmax relative difference:      " << std::setprecision(6) << maxdiff/maxder
+            << std::endl;
+  return maxdiff/maxder;
+}
+
+/* Solves up to ‘maxdim’ twice: once from scratch, writing a checkpoint
+   after each order up to ‘save_dim’, and once resumed from that checkpoint.
+   Returns the maximum difference between the two solutions, relative to the
+   largest derivative. */
+double
+TestRunnable::korder_checkpoint(int maxdim, int save_dim,
+                                int nstat, int npred, int nboth, int nforw,
+                                const TwoDMatrix &gy, const TwoDMatrix &gu,
+                                const TwoDMatrix &v)
+{
+  const std::string fname = "kordtests.chk";
+  TensorContainer<FSSparseTensor> c(1);
+  int ny = nstat+npred+nboth+nforw;
+  int nu = v.nrows();
+  int nz = nboth+nforw+ny+nboth+npred+nu;
+  SparseGenerator::fillContainer(c, maxdim, nz, ny, 5.0);
+  Journal jr("out.txt");
+  KOrder kord(nstat, npred, nboth, nforw, c, gy, gu, v, jr);
+  kord.switchToFolded();
+  for (int d = 2; d <= maxdim; d++)
+    {
+      kord.performStep<Storage::fold>(d);
+      if (d <= save_dim)
+        kord.saveCheckpoint(fname);
+    }
+
+  KOrder kord_resumed(nstat, npred, nboth, nforw, c, gy, gu, v, jr);
+  kord_resumed.switchToFolded();
+  int done = kord_resumed.loadCheckpoint(fname);
+  std::remove(fname.c_str());
+  std::cout << "\tresumed from dim=" << done << std::endl;
+  for (int d = done+1; d <= maxdim; d++)
+    kord_resumed.performStep<Storage::fold>(d);
+
+  double maxdiff = 0.0, maxder = 0.0;
+  for (const auto &it : kord.getFoldDers())
+    {
+      Vector diff(it.second->getData());
+      maxder = std::max(diff.getMax(), maxder);
+      diff.add(-1.0, kord_resumed.getFoldDers().get(it.first).getData());
+      maxdiff = std::max(diff.getMax(), maxdiff);
+    }
+  std::cout << "\tmax relative difference:      " << std::setprecision(6) << maxdiff/maxder
+            << std::endl;
+  return maxdiff/maxder;
+}
+
+/* Writes a checkpoint up to order ‘maxdim’−1, and checks that it is rejected
+   by a model whose derivatives of order 2 differ, and by a model with
+   another covariance matrix, but that it is accepted by a model whose
+   derivatives differ only at order ‘maxdim’. */
+bool
+TestRunnable::korder_checkpoint_mismatch(int maxdim,
+                                         int nstat, int npred, int nboth, int nforw,
+                                         const TwoDMatrix &gy, const TwoDMatrix &gu,
+                                         const TwoDMatrix &v)
+{
+  const std::string fname = "kordtests.chk";
+  int ny = nstat+npred+nboth+nforw;
+  int nu = v.nrows();
+  int nz = nboth+nforw+ny+nboth+npred+nu;
+  TensorContainer<FSSparseTensor> c(1);
+  SparseGenerator::fillContainer(c, maxdim, nz, ny, 5.0);
+  Journal jr("out.txt");
+  KOrder kord(nstat, npred, nboth, nforw, c, gy, gu, v, jr);
+  kord.switchToFolded();
+  for (int d = 2; d < maxdim; d++)
+    kord.performStep<Storage::fold>(d);
+  kord.saveCheckpoint(fname);
+
+  // Tries to resume with the model derivatives ‘cc’ and the covariance ‘vv’
+  auto accepted = [&](const TensorContainer<FSSparseTensor> &cc, const TwoDMatrix &vv)
+                  {
+                    KOrder kord_resumed(nstat, npred, nboth, nforw, cc, gy, gu, vv, jr);
+                    kord_resumed.switchToFolded();
+                    try
+                      {
+                        kord_resumed.loadCheckpoint(fname);
+                      }
+                    catch (const KordException &e)
+                      {
+                        std::cout << "\trejected: " << e.get_message() << '\n';
+                        return false;
+                      }
+                    return true;
+                  };
+
+  bool ok = accepted(c, v);
+  TensorContainer<FSSparseTensor> c2(1);
+  SparseGenerator::fillContainer(c2, maxdim, nz, ny, 5.0);
+  c2.remove(Symmetry{2});
+  c2.insert(SparseGenerator::makeTensor(2, nz, ny, 0.15, 5.0));
+  ok = ok && !accepted(c2, v);
+  TwoDMatrix v2(v);
+  v2.mult(2.0);
+  ok = ok && !accepted(c, v2);
+  TensorContainer<FSSparseTensor> c3(1);
+  SparseGenerator::fillContainer(c3, maxdim, nz, ny, 5.0);
+  c3.remove(Symmetry{maxdim});
+  c3.insert(SparseGenerator::makeTensor(maxdim, nz, ny, 0.15, 5.0));
+  ok = ok && accepted(c3, v);
+
+  // Corrupts the symmetry of the first tensor of g, which must be rejected
+  std::streamoff sym_pos = 8 + 6*sizeof(int) + nu*nu*sizeof(double) + sizeof(int)
+    + maxdim*sizeof(std::uint64_t) + sizeof(int);
+  for (int bad : { -1, 1 << 30 })
+    {
+      std::fstream f(fname, std::ios::binary | std::ios::in | std::ios::out);
+      f.seekp(sym_pos);
+      f.write(reinterpret_cast<const char *>(&bad), sizeof bad);
+      f.close();
+      ok = ok && !accepted(c, v);
+    }
+  std::remove(fname.c_str());
+  return ok;
+}
+
 class UnfoldKOrderSmall : public TestRunnable
 {
 public:
@@ -434,12 +663,577 @@ public:
   }
 };
 
+class RestoreKOrderSmall : public TestRunnable
+{
+public:
+  RestoreKOrderSmall()
+    : TestRunnable("fold-3 restored fold-4 korder (stat=2,pred=3,both=1,forw=2,u=3,dim=4)",
+                   4, 18)
+  {
+  }
+
+  bool
+  run() const override
+  {
+    TwoDMatrix gy{make_matrix(8, 4, gy_data)};
+    TwoDMatrix gu{make_matrix(8, 3, gu_data)};
+    TwoDMatrix v{make_matrix(3, 3, vdata)};
+    double err = korder_restore(4, 3, 2, 3, 1, 2,
+                                gy, gu, v);
+
+    return err < 1e-12;
+  }
+};
+
+class MixedKOrderSmall : public TestRunnable
+{
+public:
+  MixedKOrderSmall()
+    : TestRunnable("mixed precision fold-4 korder (stat=2,pred=3,both=1,forw=2,u=3,dim=4)",
+                   4, 18)
+  {
+  }
+
+  bool
+  run() const override
+  {
+    TwoDMatrix gy{make_matrix(8, 4, gy_data)};
+    TwoDMatrix gu{make_matrix(8, 3, gu_data)};
+    TwoDMatrix v{make_matrix(3, 3, vdata)};
+    double err = korder_mixed(4, 2, 3, 1, 2,
+                              gy, gu, v);
+
+    return err < 1e-10;
+  }
+};
+
+class CheckpointKOrderSmall : public TestRunnable
+{
+public:
+  CheckpointKOrderSmall()
+    : TestRunnable("fold-3 checkpointed fold-4 korder (stat=2,pred=3,both=1,forw=2,u=3,dim=4)",
+                   4, 18)
+  {
+  }
+
+  bool
+  run() const override
+  {
+    TwoDMatrix gy{make_matrix(8, 4, gy_data)};
+    TwoDMatrix gu{make_matrix(8, 3, gu_data)};
+    TwoDMatrix v{make_matrix(3, 3, vdata)};
+    double err = korder_checkpoint(4, 3, 2, 3, 1, 2,
+                                   gy, gu, v);
+
+    return err < 1e-12;
+  }
+};
+
+class CheckpointMismatchSmall : public TestRunnable
+{
+public:
+  CheckpointMismatchSmall()
+    : TestRunnable("checkpoint of another model (stat=2,pred=3,both=1,forw=2,u=3,dim=4)",
+                   4, 18)
+  {
+  }
+
+  bool
+  run() const override
+  {
+    TwoDMatrix gy{make_matrix(8, 4, gy_data)};
+    TwoDMatrix gu{make_matrix(8, 3, gu_data)};
+    TwoDMatrix v{make_matrix(3, 3, vdata)};
+    return korder_checkpoint_mismatch(4, 2, 3, 1, 2, gy, gu, v);
+  }
+};
+
+/* Returns a first order rule of the small model, made stable by halving the
+   coefficients. If ‘quad’ is not zero, a random second order term with
+   coefficients within ±‘quad’ is added. */
+std::unique_ptr<UnfoldDecisionRule>
+make_small_rule(double quad = 0.0)
+{
+  TwoDMatrix gy{make_matrix(8, 4, gy_data)};
+  TwoDMatrix gu{make_matrix(8, 3, gu_data)};
+  UTensorPolynomial pol(8, 7);
+  auto g1 = std::make_unique<UFSTensor>(8, 7, 1);
+  g1->place(ConstTwoDMatrix(gy), 0, 0);
+  g1->place(ConstTwoDMatrix(gu), 0, 4);
+  g1->mult(0.5);
+  pol.insert(std::move(g1));
+  if (quad != 0.0)
+    {
+      Rand::init(8, 7, 2, 0, 0);
+      FFSTensor g2(8, 7, 2);
+      for (int i = 0; i < g2.getData().length(); i++)
+        g2.getData()[i] = Rand::get(quad);
+      pol.insert(std::make_unique<UFSTensor>(g2));
+    }
+  Vector ys(8);
+  ys.zeros();
+  // The rule copies a const polynomial, otherwise it would refer to its tensors
+  return std::make_unique<UnfoldDecisionRule>(std::as_const(pol), PartitionY(2, 3, 1, 2), 3, ys);
+}
+
+/* Simulates a first order rule of the small model with a given number of
+   threads, and checks that the results are bit-identical to those obtained
+   with one thread. It also checks the generator against the known answers of
+   the reference implementation of Philox4×32-10. */
+
+class SimulationThreads : public TestRunnable
+{
+public:
+  SimulationThreads()
+    : TestRunnable("simulations with 1 and 4 threads (stat=2,pred=3,both=1,forw=2,u=3)",
+                   1, 7)
+  {
+  }
+
+  static std::vector<TwoDMatrix>
+  simulate(const DecisionRule &dr, const Vector &start, const TwoDMatrix &v, int nthreads)
+  {
+    int old_threads = sthread::detach_thread_group::max_parallel_threads;
+    sthread::detach_thread_group::max_parallel_threads = nthreads;
+    seed_generator::set_meta_seed(1234);
+    SimResults res(start.length(), 100, 10);
+    res.simulate(20, dr, start, v);
+    sthread::detach_thread_group::max_parallel_threads = old_threads;
+    std::vector<TwoDMatrix> data;
+    for (int i = 0; i < res.getNumSets(); i++)
+      data.push_back(res.getData(i));
+    return data;
+  }
+
+  bool
+  run() const override
+  {
+    NormalStream::counter_type r
+      = NormalStream::philox({0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344},
+                             {0xa4093822, 0x299f31d0});
+    if (r != NormalStream::counter_type{0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1})
+      {
+        std::cout << "\tPhilox4x32-10 does not give the known answer\n";
+        return false;
+      }
+
+    TwoDMatrix v{make_matrix(3, 3, vdata)};
+    auto dr = make_small_rule();
+    Vector ys(8);
+    ys.zeros();
+
+    auto d1 = simulate(*dr, ys, v, 1);
+    auto d4 = simulate(*dr, ys, v, 4);
+    if (d1.empty() || d1.size() != d4.size())
+      return false;
+    double maxdiff = 0.0;
+    for (unsigned int i = 0; i < d1.size(); i++)
+      {
+        d4[i].add(-1.0, d1[i]);
+        maxdiff = std::max(maxdiff, d4[i].getData().getMax());
+      }
+    std::cout << "\tmax difference:               " << maxdiff << '\n';
+    return maxdiff == 0.0;
+  }
+};
+
+/* Simulates the first order rule of the small model, and checks the
+   statistics accumulated during the simulations against those computed from
+   all the simulated data at once: the mean and the covariance over all
+   periods, and the means and the variances of each period. It also checks
+   that simulating again gives the same statistics (and not those of both
+   runs), and that keeping only a sample of the simulations does not change
+   the statistics and keeps some of the simulations. */
+
+class SimulationStats : public TestRunnable
+{
+public:
+  SimulationStats()
+    : TestRunnable("simulation statistics (stat=2,pred=3,both=1,forw=2,u=3)",
+                   1, 7)
+  {
+  }
+
+  static double
+  relDiff(const ConstVector &a, const ConstVector &b)
+  {
+    Vector diff(a);
+    diff.add(-1.0, b);
+    return diff.getMax()/std::max(b.getMax(), 1e-300);
+  }
+
+  bool
+  run() const override
+  {
+    const int num_sim = 30, num_per = 40, num_burn = 10;
+    TwoDMatrix v{make_matrix(3, 3, vdata)};
+    auto dr = make_small_rule();
+    Vector ys(8);
+    ys.zeros();
+    Journal jr("out.txt");
+
+    seed_generator::set_meta_seed(1234);
+    SimResultsStats res(8, num_per, num_burn);
+    res.simulate(num_sim, *dr, ys, v, jr);
+    if (res.getNumSets() != num_sim)
+      return false;
+
+    // Statistics over all periods, computed in two passes
+    int nobs = num_sim*num_per;
+    Vector mean(8);
+    mean.zeros();
+    for (int i = 0; i < num_sim; i++)
+      for (int j = 0; j < num_per; j++)
+        mean.add(1.0/nobs, ConstVector{res.getData(i).getCol(j)});
+    TwoDMatrix vcov(8, 8);
+    vcov.zeros();
+    for (int i = 0; i < num_sim; i++)
+      {
+        TwoDMatrix dev(res.getData(i));
+        for (int j = 0; j < num_per; j++)
+          {
+            Vector devj{dev.getCol(j)};
+            devj.add(-1.0, mean);
+          }
+        vcov.multAndAdd(dev, dev, "T", 1.0/(nobs-1));
+      }
+    double err = std::max(relDiff(res.getMean(), mean),
+                          relDiff(res.getVcov().getData(), vcov.getData()));
+    std::cout << "\tmean and covariance:          " << err << '\n';
+
+    // Simulating again must restart the statistics
+    Vector mean1(res.getMean());
+    TwoDMatrix vcov1(res.getVcov());
+    seed_generator::set_meta_seed(1234);
+    res.simulate(num_sim, *dr, ys, v, jr);
+    bool same = res.getNumAdded() == num_sim && res.getNumSets() == num_sim
+      && res.getMean() == mean1 && res.getVcov().getData() == vcov1.getData();
+    std::cout << "\tsecond run gives the same:    " << same << '\n';
+
+    // A sample of the simulations
+    seed_generator::set_meta_seed(1234);
+    SimResultsStats sample(8, num_per, num_burn);
+    sample.setRetention(5);
+    sample.simulate(num_sim, *dr, ys, v, jr);
+    bool kept = sample.getNumSets() == 5 && sample.getNumAdded() == num_sim
+      && sample.getMean() == res.getMean() && sample.getVcov().getData() == res.getVcov().getData();
+    for (int k = 0; k < sample.getNumSets(); k++)
+      {
+        bool found = false;
+        for (int i = 0; i < num_sim && !found; i++)
+          found = sample.getData(k).getData() == res.getData(i).getData();
+        kept = kept && found;
+      }
+    std::cout << "\tsample of the simulations:    " << kept << '\n';
+
+    // Statistics of each period
+    seed_generator::set_meta_seed(1234);
+    SimResultsDynamicStats dyn(8, num_per, num_burn);
+    dyn.simulate(num_sim, *dr, ys, v, jr);
+    TwoDMatrix dmean(8, num_per), dvar(8, num_per);
+    dmean.zeros();
+    dvar.zeros();
+    for (int i = 0; i < num_sim; i++)
+      dmean.add(1.0/num_sim, res.getData(i));
+    for (int i = 0; i < num_sim; i++)
+      {
+        TwoDMatrix dev(res.getData(i));
+        dev.add(-1.0, dmean);
+        for (int k = 0; k < dev.getData().length(); k++)
+          dvar.getData()[k] += dev.getData()[k]*dev.getData()[k]/(num_sim-1);
+      }
+    double derr = std::max(relDiff(dyn.getMean().getData(), dmean.getData()),
+                           relDiff(dyn.getVariance().getData(), dvar.getData()));
+    std::cout << "\tmeans and variances by period: " << derr << '\n';
+
+    return err < 1e-12 && same && kept && derr < 1e-12;
+  }
+};
+
+/* The names of the variables of SmallModel */
+class SmallNames : public NameList
+{
+  std::vector<std::string> names;
+public:
+  SmallNames(const std::string &prefix, int n)
+  {
+    for (int i = 0; i < n; i++)
+      names.push_back(prefix + std::to_string(i+1));
+  }
+  int
+  getNum() const override
+  {
+    return static_cast<int>(names.size());
+  }
+  const std::string &
+  getName(int i) const override
+  {
+    return names[i];
+  }
+};
+
+/* A model with the dimensions and the covariance of the small model, which
+   provides only what the simulations need (there are no equations) */
+class SmallModel : public DynamicModel
+{
+  TwoDMatrix vcov;
+  Vector ys;
+  SmallNames endo_names, state_names, exog_names;
+public:
+  explicit SmallModel(const TwoDMatrix &v)
+    : vcov(v), ys(8), endo_names("y", 8), state_names("y", 4), exog_names("u", 3)
+  {
+    ys.zeros();
+  }
+  std::unique_ptr<DynamicModel>
+  clone() const override
+  {
+    return std::make_unique<SmallModel>(vcov);
+  }
+  int
+  nstat() const override
+  {
+    return 2;
+  }
+  int
+  nboth() const override
+  {
+    return 1;
+  }
+  int
+  npred() const override
+  {
+    return 3;
+  }
+  int
+  nforw() const override
+  {
+    return 2;
+  }
+  int
+  nexog() const override
+  {
+    return 3;
+  }
+  int
+  order() const override
+  {
+    return 1;
+  }
+  const NameList &
+  getAllEndoNames() const override
+  {
+    return endo_names;
+  }
+  const NameList &
+  getStateNames() const override
+  {
+    return state_names;
+  }
+  const NameList &
+  getExogNames() const override
+  {
+    return exog_names;
+  }
+  const TwoDMatrix &
+  getVcov() const override
+  {
+    return vcov;
+  }
+  const TensorContainer<FSSparseTensor> &
+  getModelDerivatives() const override
+  {
+    KORD_RAISE("The small model has no derivatives");
+  }
+  const Vector &
+  getSteady() const override
+  {
+    return ys;
+  }
+  Vector &
+  getSteady() override
+  {
+    return ys;
+  }
+  void
+  solveDeterministicSteady() override
+  {
+  }
+  void
+  evaluateSystem(Vector &out, const ConstVector &yy, const Vector &xx) override
+  {
+    KORD_RAISE("The small model has no equations");
+  }
+  void
+  evaluateSystem(Vector &out, const ConstVector &yym, const ConstVector &yy,
+                 const ConstVector &yyp, const Vector &xx) override
+  {
+    KORD_RAISE("The small model has no equations");
+  }
+  void
+  calcDerivativesAtSteady() override
+  {
+  }
+};
+
+/* Simulates the IRFs of a second order rule of the small model (so that they
+   depend on the controls) to two of its shocks, and checks the means and the variances of the batched
+   simulations of IRFResults against those of the simulations of each
+   control and impulse one by one. */
+
+class IRFBatch : public TestRunnable
+{
+public:
+  IRFBatch()
+    : TestRunnable("batched IRFs (stat=2,pred=3,both=1,forw=2,u=3)",
+                   1, 7)
+  {
+  }
+
+  bool
+  run() const override
+  {
+    const int num_sim = 30, num_per = 20, num_burn = 10;
+    TwoDMatrix v{make_matrix(3, 3, vdata)};
+    auto dr = make_small_rule(0.02);
+    Vector ys(8);
+    ys.zeros();
+    Journal jr("out.txt");
+
+    seed_generator::set_meta_seed(1234);
+    SimResults control(8, num_per, num_burn);
+    control.simulate(num_sim, *dr, ys, v);
+    SmallModel model(v);
+    std::vector<int> shocks{0, 2};
+    IRFResults irf(model, *dr, control, shocks, jr);
+    if (irf.getResults().size() != 2*shocks.size())
+      return false;
+
+    double err = 0.0;
+    for (unsigned int p = 0; p < irf.getResults().size(); p++)
+      {
+        int ishock = shocks[p/2];
+        double imp = (p % 2 == 0 ? 1.0 : -1.0)*std::sqrt(v.get(ishock, ishock));
+        std::vector<TwoDMatrix> resp;
+        TwoDMatrix mean(8, num_per), var(8, num_per);
+        mean.zeros();
+        var.zeros();
+        for (int i = 0; i < control.getNumSets(); i++)
+          {
+            ExplicitShockRealization esr(control.getShocks(i));
+            esr.addToShock(ishock, 0, imp);
+            resp.push_back(dr->simulate(DecisionRule::emethod::horner, num_per,
+                                        control.getStart(i), esr));
+            resp.back().add(-1.0, control.getData(i));
+            mean.add(1.0/num_sim, resp.back());
+          }
+        for (auto &m : resp)
+          {
+            m.add(-1.0, mean);
+            for (int k = 0; k < m.getData().length(); k++)
+              var.getData()[k] += m.getData()[k]*m.getData()[k]/(num_sim-1);
+          }
+        const SimResultsIRF &r = irf.getResults()[p];
+        err = std::max({ err, SimulationStats::relDiff(r.getMeans().getData(), mean.getData()),
+                         SimulationStats::relDiff(r.getVariances().getData(), var.getData()) });
+      }
+    std::cout << "\tmax relative difference:      " << err << '\n';
+    return err < 1e-12;
+  }
+};
+
+/* Writes the C code of a random folded polynomial of order 3 (with the
+   dimensions of a rule of the small model), compiles it with the system C
+   compiler and loads it. Checks that it gives the same values as the Horner
+   evaluation of the polynomial, and that a decision rule accepts it, but not
+   a decision rule with another polynomial. */
+
+class CompiledRuleSmall : public TestRunnable
+{
+public:
+  CompiledRuleSmall()
+    : TestRunnable("compiled rule (stat=2,pred=3,both=1,forw=2,u=3,dim=3)",
+                   3, 7)
+  {
+  }
+
+  static FTensorPolynomial
+  randomPolynomial(int ny, int nv, int maxdim)
+  {
+    FTensorPolynomial pol(ny, nv);
+    for (int d = 0; d <= maxdim; d++)
+      {
+        auto t = std::make_unique<FFSTensor>(ny, nv, d);
+        for (int i = 0; i < t->getData().length(); i++)
+          t->getData()[i] = Rand::discrete(0.7) ? Rand::get(1.0) : 0.0;
+        pol.insert(std::move(t));
+      }
+    return pol;
+  }
+
+  bool
+  run() const override
+  {
+    Rand::init(8, 7, 3, 0, 0);
+    FTensorPolynomial pol = randomPolynomial(8, 7, 3);
+    CompiledRule::writeC(pol, "kordtests_rule.c");
+    if (std::system("cc -O2 -shared -fPIC -o kordtests_rule.so kordtests_rule.c") != 0)
+      {
+        std::cout << "\tcannot compile the rule\n";
+        return false;
+      }
+    auto compiled = std::make_shared<CompiledRule>("kordtests_rule.so");
+    std::remove("kordtests_rule.c");
+    std::remove("kordtests_rule.so");
+
+    double maxdiff = 0.0;
+    for (int k = 0; k < 100; k++)
+      {
+        Vector x(7), y1(8), y2(8);
+        for (int i = 0; i < x.length(); i++)
+          x[i] = Rand::get(1.0);
+        pol.evalHorner(y1, x);
+        compiled->eval(y2, x);
+        y2.add(-1.0, y1);
+        maxdiff = std::max(maxdiff, y2.getMax()/std::max(y1.getMax(), 1.0));
+      }
+    std::cout << "\tmax relative difference:      " << maxdiff << '\n';
+
+    Vector ys(8);
+    ys.zeros();
+    FoldDecisionRule dr(pol, PartitionY(2, 3, 1, 2), 3, ys);
+    dr.setCompiled(compiled);
+    FTensorPolynomial pol2(pol);
+    pol2.get(Symmetry{2}).getData()[0] += 1e-10;
+    FoldDecisionRule dr2(pol2, PartitionY(2, 3, 1, 2), 3, ys);
+    try
+      {
+        dr2.setCompiled(compiled);
+        std::cout << "\tcompiled rule of another polynomial accepted\n";
+        return false;
+      }
+    catch (const KordException &e)
+      {
+      }
+    return maxdiff < 1e-13;
+  }
+};
+
 int
 main()
 {
+  sthread::pool_shutdown_guard pool_guard;
   std::vector<std::unique_ptr<TestRunnable>> all_tests;
   // Fill in vector of all tests
   all_tests.push_back(std::make_unique<UnfoldKOrderSmall>());
+  all_tests.push_back(std::make_unique<RestoreKOrderSmall>());
+  all_tests.push_back(std::make_unique<MixedKOrderSmall>());
+  all_tests.push_back(std::make_unique<CheckpointKOrderSmall>());
+  all_tests.push_back(std::make_unique<CheckpointMismatchSmall>());
+  all_tests.push_back(std::make_unique<SimulationThreads>());
+  all_tests.push_back(std::make_unique<SimulationStats>());
+  all_tests.push_back(std::make_unique<IRFBatch>());
+  all_tests.push_back(std::make_unique<CompiledRuleSmall>());
   all_tests.push_back(std::make_unique<UnfoldKOrderSW>());
   all_tests.push_back(std::make_unique<UnfoldFoldKOrderSW>());
 
@@ -29,8 +29,9 @@
 DynareParams::DynareParams(int argc, char **argv)
   : num_per(100), num_burn(0), num_sim(80),
     num_rtper(0), num_rtsim(0),
-    num_condper(0), num_condsim(0),
-    num_threads(sthread::default_threads_number()), num_steps(0),
+    num_condper(0), num_condsim(0), num_keep(-1),
+    num_threads(sthread::default_threads_number()), local_sums(false),
+    mmap_threshold(64), resume(false), sylv_mixed(false), num_steps(0),
     prefix("dyn"), seed(934098), order(-1), ss_tol(1.e-13),
     check_along_path(false), check_along_shocks(false),
     check_on_ellipse(false), check_evals(1000), check_num(10), check_scale(2.0),
@@ -66,8 +67,17 @@ DynareParams::DynareParams(int argc, char **argv)
      {"condper", required_argument, nullptr, static_cast<int>(opt::condper)},
      {"condsimulations", required_argument, nullptr, static_cast<int>(opt::condsim)},
      {"condsim", required_argument, nullptr, static_cast<int>(opt::condsim)},
+     {"keep", required_argument, nullptr, static_cast<int>(opt::keep)},
      {"prefix", required_argument, nullptr, static_cast<int>(opt::prefix)},
      {"threads", required_argument, nullptr, static_cast<int>(opt::threads)},
+     {"local-sums", no_argument, nullptr, static_cast<int>(opt::local_sums)},
+     {"mmap-dir", required_argument, nullptr, static_cast<int>(opt::mmap_dir)},
+     {"mmap-threshold", required_argument, nullptr, static_cast<int>(opt::mmap_threshold)},
+     {"checkpoint", required_argument, nullptr, static_cast<int>(opt::checkpoint)},
+     {"resume", no_argument, nullptr, static_cast<int>(opt::resume)},
+     {"sylv-mixed", no_argument, nullptr, static_cast<int>(opt::sylv_mixed)},
+     {"codegen", required_argument, nullptr, static_cast<int>(opt::codegen)},
+     {"rule-lib", required_argument, nullptr, static_cast<int>(opt::rule_lib)},
      {"steps", required_argument, nullptr, static_cast<int>(opt::steps)},
      {"seed", required_argument, nullptr, static_cast<int>(opt::seed)},
      {"order", required_argument, nullptr, static_cast<int>(opt::order)},
@@ -121,12 +131,39 @@ DynareParams::DynareParams(int argc, char **argv)
             case opt::condsim:
               num_condsim = std::stoi(optarg);
               break;
+            case opt::keep:
+              num_keep = std::stoi(optarg);
+              break;
             case opt::prefix:
               prefix = optarg;
               break;
             case opt::threads:
               num_threads = std::stoi(optarg);
               break;
+            case opt::local_sums:
+              local_sums = true;
+              break;
+            case opt::mmap_dir:
+              mmap_dir = optarg;
+              break;
+            case opt::mmap_threshold:
+              mmap_threshold = std::stoi(optarg);
+              break;
+            case opt::checkpoint:
+              checkpoint = optarg;
+              break;
+            case opt::resume:
+              resume = true;
+              break;
+            case opt::sylv_mixed:
+              sylv_mixed = true;
+              break;
+            case opt::codegen:
+              codegen = optarg;
+              break;
+            case opt::rule_lib:
+              rule_lib = optarg;
+              break;
             case opt::steps:
               num_steps = std::stoi(optarg);
               break;
@@ -189,6 +226,12 @@ DynareParams::DynareParams(int argc, char **argv)
         }
     }
 
+  if (resume && checkpoint.empty())
+    {
+      std::cerr << "Option --resume needs --checkpoint, ignored\n";
+      resume = false;
+    }
+
   // make basename (get rid of the directory and the extension)
   basename = modname;
   auto pos = basename.find_last_of(R"(/\)");
@@ -215,6 +258,7 @@ DynareParams::printHelp() const
     "    --rtsim <num>        number of RT simulations [0]\n"
     "    --condper <num>      number of periods in cond. simulations [0]\n"
     "    --condsim <num>      number of conditional simulations [0]\n"
+    "    --keep <num>         number of simulations kept in memory [all]\n"
     "    --steps <num>        steps towards stoch. SS [0=deter.]\n"
     "    --centralize         centralize the rule [do centralize]\n"
     "    --no-centralize      do not centralize the rule [do centralize]\n"
@@ -222,6 +266,14 @@ DynareParams::printHelp() const
     "    --seed <num>         random number generator seed [934098]\n"
     "    --order <num>        order of approximation [no default]\n"
     "    --threads <num>      number of max parallel threads [1/2 * nb. of logical CPUs]\n"
+    "    --local-sums         Faa Di Bruno threads sum to private copies [off]\n"
+    "    --mmap-dir <dir>     store large tensors in files mapped from dir [in memory]\n"
+    "    --mmap-threshold <n> size in MB from which tensors are mapped [64]\n"
+    "    --checkpoint <file>  save derivatives to file after each order [none]\n"
+    "    --resume             resume from the checkpoint file if it exists [off]\n"
+    "    --sylv-mixed         single precision Sylvester solves with refinement [off]\n"
+    "    --codegen <file>     write the decision rule as C code to file [none]\n"
+    "    --rule-lib <file>    simulate with the rule compiled from C code [none]\n"
     "    --ss-tol <num>       steady state calcs tolerance [1.e-13]\n"
     "    --check pesPES       check model residuals [no checks]\n"
     "                         lower/upper case switches off/on\n"
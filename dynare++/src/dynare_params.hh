@@ -40,7 +40,29 @@ struct DynareParams
   int num_rtsim;
   int num_condper;
   int num_condsim;
+  /* Number of simulations kept in memory (and used for IRFs), −1 if all
+     are kept. */
+  int num_keep;
   int num_threads;
+  /* Whether the threads of Faà Di Bruno accumulate to thread-local copies of
+     the output. */
+  bool local_sums;
+  /* Directory where large tensors are stored in memory mapped files (empty
+     if they stay in memory), and the size from which they are (in MB). */
+  std::string mmap_dir;
+  int mmap_threshold;
+  /* File where the derivatives are saved after each order (empty if none),
+     and whether they are first read back from it. */
+  std::string checkpoint;
+  bool resume;
+  /* Whether the Sylvester equations of the k-order step are solved in single
+     precision with iterative refinement. */
+  bool sylv_mixed;
+  /* File where the C code of the decision rule is written (empty if none),
+     and shared library compiled from such a code used in the simulations
+     (empty if none). */
+  std::string codegen;
+  std::string rule_lib;
   int num_steps;
   std::string prefix;
   int seed;
@@ -89,8 +111,9 @@ struct DynareParams
     return 10*check_num;
   }
 private:
-  enum class opt { per, burn, sim, rtper, rtsim, condper, condsim,
-                   prefix, threads,
+  enum class opt { per, burn, sim, rtper, rtsim, condper, condsim, keep,
+                   prefix, threads, local_sums, mmap_dir, mmap_threshold,
+                   checkpoint, resume, sylv_mixed, codegen, rule_lib,
                    steps, seed, order, ss_tol, check,
                    check_evals, check_scale, check_num, noirfs, irfs,
                    help, version, centralize, no_centralize, qz_criterium };
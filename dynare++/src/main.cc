@@ -25,9 +25,11 @@
 #include "utils/cc/exception.hh"
 #include "parser/cc/parser_exception.hh"
 #include "../sylv/cc/SylvException.hh"
+#include "../sylv/cc/MappedStorage.hh"
 #include "../kord/seed_generator.hh"
 #include "../kord/global_check.hh"
 #include "../kord/approximation.hh"
+#include "../kord/compiled_rule.hh"
 
 #include <fstream>
 #include <iostream>
@@ -53,6 +55,14 @@ main(int argc, char **argv)
       return EXIT_SUCCESS;
     }
   sthread::detach_thread_group::max_parallel_threads = params.num_threads;
+  sthread::pool_shutdown_guard pool_guard;
+  StackOutputBase::thread_local_sums = params.local_sums;
+  if (!params.mmap_dir.empty()
+      && !MappedStorage::setup(params.mmap_dir, static_cast<long>(params.mmap_threshold)*1024*1024))
+    {
+      std::cerr << "Cannot store tensors in directory " << params.mmap_dir << '\n';
+      return EXIT_FAILURE;
+    }
 
   try
     {
@@ -113,6 +123,8 @@ main(int argc, char **argv)
                      +2*dynare.nforw()+dynare.nexog());
 
       Approximation app(dynare, journal, params.num_steps, params.do_centralize, params.qz_criterium);
+      app.setCheckpoint(params.checkpoint, params.resume);
+      app.setSylvMixedPrecision(params.sylv_mixed);
       try
         {
           app.walkStochSteady();
@@ -154,10 +166,18 @@ main(int argc, char **argv)
       // write the folded decision rule to the Mat-4 file
       app.getFoldDecisionRule().writeMat(matfd, params.prefix);
 
+      // write the C code of the folded decision rule, and load a compiled one
+      if (!params.codegen.empty())
+        CompiledRule::writeC(app.getFoldDecisionRule(), params.codegen);
+      if (!params.rule_lib.empty())
+        app.setCompiledRule(std::make_shared<const CompiledRule>(params.rule_lib));
+
       // simulate conditional
       if (params.num_condper > 0 && params.num_condsim > 0)
         {
           SimResultsDynamicStats rescond(dynare.numeq(), params.num_condper, 0);
+          // only the statistics of the conditional simulations are used
+          rescond.setRetention(0);
           Vector det_ss{app.getSS().getCol(0)};
           rescond.simulate(params.num_condsim, app.getFoldDecisionRule(), det_ss, dynare.getVcov(), journal);
           rescond.writeMat(matfd, params.prefix);
@@ -169,6 +189,10 @@ main(int argc, char **argv)
       if (params.num_per > 0 && params.num_sim > 0)
         {
           SimResultsStats res(dynare.numeq(), params.num_per, params.num_burn);
+          if (params.num_keep >= 0)
+            res.setRetention(params.num_keep);
+          else if (irf_list_ind.empty())
+            res.setRetention(0);
           res.simulate(params.num_sim, dr, dynare.getSteady(), dynare.getVcov(), journal);
           res.writeMat(matfd, params.prefix);
 
@@ -22,76 +22,239 @@
 #include "SchurDecomp.hh"
 #include "SylvException.hh"
 #include "TriangularSylvester.hh"
+#include "SinglePrecisionSylvester.hh"
 #include "IterativeSylvester.hh"
 #include "int_power.hh"
+#include "sthread.hh"
+
+#include <dynlapack.h>
 
 #include <ctime>
 
+GeneralSylvesterDecomp::GeneralSylvesterDecomp(int n, int m, int zero_cols,
+                                               const ConstVector &da, const ConstVector &db,
+                                               const ConstVector &dc, const SylvParams &ps)
+  : pars(ps), a(Vector{da}, n), b(Vector{db}, n, n-zero_cols), c(Vector{dc}, m),
+    alu(a), ipiv(n)
+{
+  // PLU factorization of A
+  auto piv = std::make_unique<lapack_int[]>(n);
+  lapack_int rows = n, lda = alu.getLD(), info;
+  dgetrf(&rows, &rows, alu.base(), &lda, piv.get(), &info);
+  for (int i = 0; i < n; i++)
+    ipiv[i] = piv[i];
+
+  // condition numbers
+  auto work = std::make_unique<double[]>(4*n);
+  auto iwork = std::make_unique<lapack_int[]>(n);
+  double norm1 = a.getNorm1();
+  double rcond1;
+  dgecon("1", &rows, alu.base(), &lda, &norm1, &rcond1,
+         work.get(), iwork.get(), &info);
+  double norminf = a.getNormInf();
+  double rcondinf;
+  dgecon("I", &rows, alu.base(), &lda, &norminf, &rcondinf,
+         work.get(), iwork.get(), &info);
+  pars.rcondA1 = rcond1;
+  pars.rcondAI = rcondinf;
+
+  GeneralMatrix ainvb(b);
+  multInvA(ainvb);
+  bdecomp = std::make_unique<SchurDecompZero>(ainvb);
+  cdecomp = std::make_unique<SimilarityDecomp>(c.getData(), c.nrows(), *(pars.bs_norm));
+  cdecomp->check(pars, c);
+  cdecomp->infoToPars(pars);
+  if (mixedPrecision())
+    sylv = std::make_unique<SinglePrecisionSylvester>(*bdecomp, *cdecomp);
+  else if (*(pars.method) == SylvParams::solve_method::recurse)
+    sylv = std::make_unique<TriangularSylvester>(*bdecomp, *cdecomp);
+  else
+    sylv = std::make_unique<IterativeSylvester>(*bdecomp, *cdecomp);
+}
+
+// Computes x = A⁻¹·x from the PLU factorization of A
+void
+GeneralSylvesterDecomp::multInvA(GeneralMatrix &x) const
+{
+  auto piv = std::make_unique<lapack_int[]>(getN());
+  for (int i = 0; i < getN(); i++)
+    piv[i] = ipiv[i];
+  lapack_int rows = getN(), lda = alu.getLD(), cols = x.ncols(), ldx = x.getLD(), info;
+  if (cols > 0)
+    dgetrs("N", &rows, &cols, alu.base(), &lda, piv.get(), x.base(), &ldx, &info);
+}
+
+bool
+GeneralSylvesterDecomp::mixedPrecision() const
+{
+  return *(pars.mixed_precision) && *(pars.method) == SylvParams::solve_method::recurse;
+}
+
+void
+GeneralSylvesterDecomp::solveOnce(int order, Vector &dd, SylvParams &ps) const
+{
+  SylvMatrix d(dd, getN(), power(getM(), order));
+  multInvA(d);
+  // multiply d
+  d.multLeftITrans(bdecomp->getQ());
+  d.multRightKron(cdecomp->getQ(), order);
+  // convert to KronVector
+  KronVector dkron(d.getData(), getM(), getN(), order);
+  // solve
+  sylv->solve(ps, dkron);
+  // multiply d back
+  d.multLeftI(bdecomp->getQ());
+  d.multRightKron(cdecomp->getInvQ(), order);
+}
+
+void
+GeneralSylvesterDecomp::solve(int order, Vector &dd, SylvParams &ps) const
+{
+  if (dd.length() != getN()*power(getM(), order))
+    throw SYLV_MES_EXCEPTION("Wrong size of the right hand side in GeneralSylvesterDecomp::solve.");
+
+  clock_t start = clock();
+  if (!mixedPrecision())
+    solveOnce(order, dd, ps);
+  else
+    {
+      auto relErr = [](const Vector &r, const Vector &x)
+                    {
+                      double xmax = x.getMax();
+                      return xmax > 0 ? r.getMax()/xmax : r.getMax();
+                    };
+      Vector ds(const_cast<const Vector &>(dd));
+      solveOnce(order, dd, ps);
+      Vector r(dd.length());
+      residual(order, dd, ds, r);
+      double err = relErr(r, dd);
+      int iter = 0;
+      while (err > *(pars.refine_tol) && iter < *(pars.max_refine_iter))
+        {
+          // r becomes the correction of the solution
+          solveOnce(order, r, ps);
+          dd.add(-1.0, r);
+          Vector rnew(dd.length());
+          residual(order, dd, ds, rnew);
+          double err_new = relErr(rnew, dd);
+          if (err_new >= err)
+            {
+              dd.add(1.0, r);
+              break;
+            }
+          r = rnew;
+          err = err_new;
+          iter++;
+        }
+      ps.refine_iter = iter;
+      ps.refine_err = err;
+    }
+  clock_t end = clock();
+  ps.cpu_time = static_cast<double>(end-start)/CLOCKS_PER_SEC;
+}
+
+void
+GeneralSylvesterDecomp::solve(int order, Vector &d) const
+{
+  SylvParams ps(pars);
+  solve(order, d, ps);
+}
+
+namespace
+{
+  class GeneralSylvesterWorker : public sthread::detach_thread
+  {
+    const GeneralSylvesterDecomp &decomp;
+    int order;
+    Vector &d;
+  public:
+    GeneralSylvesterWorker(const GeneralSylvesterDecomp &dec, int ord, Vector &dd)
+      : decomp(dec), order(ord), d(dd)
+    {
+    }
+    void
+    operator()(std::mutex &mut) override
+    {
+      decomp.solve(order, d);
+    }
+  };
+}
+
+void
+GeneralSylvesterDecomp::solve(int order, const std::vector<Vector *> &ds) const
+{
+  sthread::detach_thread_group gr;
+  for (auto d : ds)
+    gr.insert(std::make_unique<GeneralSylvesterWorker>(*this, order, *d));
+  gr.run();
+}
+
+void
+GeneralSylvesterDecomp::residual(int order, const ConstVector &x, const ConstVector &ds,
+                                 Vector &r) const
+{
+  GeneralMatrix xm(ConstGeneralMatrix(x, getN(), power(getM(), order)));
+
+  // calculate r = A·X+B·X·⊗ⁱC−D
+  SylvMatrix dcheck(r, xm.nrows(), xm.ncols());
+  dcheck.multLeft(b.nrows()-b.ncols(), b, xm);
+  dcheck.multRightKron(c, order);
+  dcheck.multAndAdd(a, xm);
+  dcheck.getData().add(-1.0, ds);
+}
+
+void
+GeneralSylvesterDecomp::check(int order, const ConstVector &x, const ConstVector &ds,
+                              SylvParams &ps) const
+{
+  ConstGeneralMatrix xm(x, getN(), power(getM(), order));
+  Vector r(x.length());
+  residual(order, x, ds, r);
+  ConstGeneralMatrix dcheck(r, xm.nrows(), xm.ncols());
+  // calculate relative norms
+  ps.mat_err1 = dcheck.getNorm1()/xm.getNorm1();
+  ps.mat_errI = dcheck.getNormInf()/xm.getNormInf();
+  ps.mat_errF = dcheck.getData().getNorm()/xm.getData().getNorm();
+  ps.vec_err1 = dcheck.getData().getNorm1()/xm.getData().getNorm1();
+  ps.vec_errI = dcheck.getData().getMax()/xm.getData().getMax();
+}
+
 GeneralSylvester::GeneralSylvester(int ord, int n, int m, int zero_cols,
                                    const ConstVector &da, const ConstVector &db,
                                    const ConstVector &dc, const ConstVector &dd,
                                    const SylvParams &ps)
-  : pars(ps),
-    order(ord), a(Vector{da}, n),
-    b(Vector{db}, n, n-zero_cols), c(Vector{dc}, m), d(Vector{dd}, n, power(m, order)),
+  : decomp{std::make_unique<GeneralSylvesterDecomp>(n, m, zero_cols, da, db, dc, ps)},
+    pars(decomp->getParams()),
+    order(ord), d(Vector{dd}, n, power(m, order)),
     solved(false)
 {
-  init();
 }
 
 GeneralSylvester::GeneralSylvester(int ord, int n, int m, int zero_cols,
                                    const ConstVector &da, const ConstVector &db,
                                    const ConstVector &dc, Vector &dd,
                                    const SylvParams &ps)
-  : pars(ps),
-    order(ord), a(Vector{da}, n),
-    b(Vector{db}, n, n-zero_cols), c(Vector{dc}, m), d(dd, n, power(m, order)),
+  : decomp{std::make_unique<GeneralSylvesterDecomp>(n, m, zero_cols, da, db, dc, ps)},
+    pars(decomp->getParams()),
+    order(ord), d(dd, n, power(m, order)),
     solved(false)
 {
-  init();
 }
 
 GeneralSylvester::GeneralSylvester(int ord, int n, int m, int zero_cols,
                                    const ConstVector &da, const ConstVector &db,
                                    const ConstVector &dc, const ConstVector &dd,
                                    bool alloc_for_check)
-  : pars(alloc_for_check),
-    order(ord), a(Vector{da}, n),
-    b(Vector{db}, n, n-zero_cols), c(Vector{dc}, m), d(Vector{dd}, n, power(m, order)),
-    solved(false)
+  : GeneralSylvester(ord, n, m, zero_cols, da, db, dc, dd, SylvParams(alloc_for_check))
 {
-  init();
 }
 
 GeneralSylvester::GeneralSylvester(int ord, int n, int m, int zero_cols,
                                    const ConstVector &da, const ConstVector &db,
                                    const ConstVector &dc, Vector &dd,
                                    bool alloc_for_check)
-  : pars(alloc_for_check),
-    order(ord), a(Vector{da}, n),
-    b(Vector{db}, n, n-zero_cols), c(Vector{dc}, m), d(dd, n, power(m, order)),
-    solved(false)
-{
-  init();
-}
-
-void
-GeneralSylvester::init()
+  : GeneralSylvester(ord, n, m, zero_cols, da, db, dc, dd, SylvParams(alloc_for_check))
 {
-  GeneralMatrix ainvb(b);
-  double rcond1;
-  double rcondinf;
-  a.multInvLeft2(ainvb, d, rcond1, rcondinf);
-  pars.rcondA1 = rcond1;
-  pars.rcondAI = rcondinf;
-  bdecomp = std::make_unique<SchurDecompZero>(ainvb);
-  cdecomp = std::make_unique<SimilarityDecomp>(c.getData(), c.nrows(), *(pars.bs_norm));
-  cdecomp->check(pars, c);
-  cdecomp->infoToPars(pars);
-  if (*(pars.method) == SylvParams::solve_method::recurse)
-    sylv = std::make_unique<TriangularSylvester>(*bdecomp, *cdecomp);
-  else
-    sylv = std::make_unique<IterativeSylvester>(*bdecomp, *cdecomp);
 }
 
 void
@@ -100,19 +263,7 @@ GeneralSylvester::solve()
   if (solved)
     throw SYLV_MES_EXCEPTION("Attempt to run solve() more than once.");
 
-  clock_t start = clock();
-  // multiply d
-  d.multLeftITrans(bdecomp->getQ());
-  d.multRightKron(cdecomp->getQ(), order);
-  // convert to KronVector
-  KronVector dkron(d.getData(), getM(), getN(), order);
-  // solve
-  sylv->solve(pars, dkron);
-  // multiply d back
-  d.multLeftI(bdecomp->getQ());
-  d.multRightKron(cdecomp->getInvQ(), order);
-  clock_t end = clock();
-  pars.cpu_time = static_cast<double>(end-start)/CLOCKS_PER_SEC;
+  decomp->solve(order, d.getData(), pars);
 
   solved = true;
 }
@@ -123,16 +274,5 @@ GeneralSylvester::check(const ConstVector &ds)
   if (!solved)
     throw SYLV_MES_EXCEPTION("Cannot run check on system, which is not solved yet.");
 
-  // calculate xcheck = A·X+B·X·⊗ⁱC−D
-  SylvMatrix dcheck(d.nrows(), d.ncols());
-  dcheck.multLeft(b.nrows()-b.ncols(), b, d);
-  dcheck.multRightKron(c, order);
-  dcheck.multAndAdd(a, d);
-  dcheck.getData().add(-1.0, ds);
-  // calculate relative norms
-  pars.mat_err1 = dcheck.getNorm1()/d.getNorm1();
-  pars.mat_errI = dcheck.getNormInf()/d.getNormInf();
-  pars.mat_errF = dcheck.getData().getNorm()/d.getData().getNorm();
-  pars.vec_err1 = dcheck.getData().getNorm1()/d.getData().getNorm1();
-  pars.vec_errI = dcheck.getData().getMax()/d.getData().getMax();
+  decomp->check(order, d.getData(), ds, pars);
 }
@@ -26,19 +26,91 @@
 #include "SylvesterSolver.hh"
 
 #include <memory>
+#include <vector>
 
-class GeneralSylvester
+/* Decomposition of the matrices of the general Sylvester equation
+
+    A·X + B·X·(C⊗…⊗C) = D
+
+   where A is n×n, B is n×(n−zero_cols) (completed by zero columns on the
+   left), C is m×m, and the number of Kronecker factors is the order of the
+   equation. It holds the LU factorization of A, the Schur decomposition of
+   A⁻¹·B and the block diagonalization of C, which do not depend on the order
+   nor on D. So it is computed once, and then used to solve the equation for
+   any number of right hand sides D of any order. The solve() methods do not
+   modify the object, so that they can be called concurrently.
+
+   If the ‘mixed_precision’ parameter is set (with the recursive method), the
+   triangular system is solved in single precision by
+   SinglePrecisionSylvester, and the solution is improved by iterative
+   refinement: the residual A·X+B·X·(C⊗…⊗C)−D is computed in double precision
+   (as in check()), the equation is solved again for it, and the result is
+   subtracted from X. This stops when the relative ∞ norm of the residual is
+   below ‘refine_tol’, when it no longer decreases (the last step is then
+   undone), or after ‘max_refine_iter’ steps. The number of steps and the
+   achieved residual are stored in ‘refine_iter’ and ‘refine_err’. */
+
+class GeneralSylvesterDecomp
 {
   SylvParams pars;
-  int order;
   const SqSylvMatrix a;
   const SylvMatrix b;
   const SqSylvMatrix c;
-  SylvMatrix d;
-  bool solved;
+  SqSylvMatrix alu; // LU factorization of A
+  std::vector<int> ipiv; // its pivots
   std::unique_ptr<SchurDecompZero> bdecomp;
   std::unique_ptr<SimilarityDecomp> cdecomp;
   std::unique_ptr<SylvesterSolver> sylv;
+public:
+  GeneralSylvesterDecomp(int n, int m, int zero_cols,
+                         const ConstVector &da, const ConstVector &db,
+                         const ConstVector &dc, const SylvParams &ps);
+  GeneralSylvesterDecomp(const GeneralSylvesterDecomp &) = delete;
+  GeneralSylvesterDecomp &operator=(const GeneralSylvesterDecomp &) = delete;
+  int
+  getM() const
+  {
+    return c.nrows();
+  }
+  int
+  getN() const
+  {
+    return a.nrows();
+  }
+  // Parameters, and diagnostics of the decompositions
+  const SylvParams &
+  getParams() const
+  {
+    return pars;
+  }
+  /* Overwrites ‘d’ (an n×mᵒʳᵈᵉʳ matrix) with the solution, the
+     diagnostics are stored in ‘ps’ */
+  void solve(int order, Vector &d, SylvParams &ps) const;
+  // Same as above, without the diagnostics
+  void solve(int order, Vector &d) const;
+  /* Solves the equation of the given order for several right hand sides,
+     concurrently on the thread pool */
+  void solve(int order, const std::vector<Vector *> &ds) const;
+  /* Stores in ‘ps’ the errors of the solution ‘x’ of the equation with the
+     right hand side ‘ds’ */
+  void check(int order, const ConstVector &x, const ConstVector &ds, SylvParams &ps) const;
+private:
+  void multInvA(GeneralMatrix &x) const;
+  // Solves the equation once with the triangular solver
+  void solveOnce(int order, Vector &d, SylvParams &ps) const;
+  // Stores in ‘r’ the residual A·X+B·X·⊗ⁱC−D of the solution ‘x’
+  void residual(int order, const ConstVector &x, const ConstVector &ds, Vector &r) const;
+  // Returns true if the solution is computed in single precision and refined
+  bool mixedPrecision() const;
+};
+
+class GeneralSylvester
+{
+  std::unique_ptr<GeneralSylvesterDecomp> decomp;
+  SylvParams pars;
+  int order;
+  SylvMatrix d;
+  bool solved;
 public:
   // Construct with my copy of d
   GeneralSylvester(int ord, int n, int m, int zero_cols,
@@ -62,12 +134,12 @@ public:
   int
   getM() const
   {
-    return c.nrows();
+    return decomp->getM();
   }
   int
   getN() const
   {
-    return a.nrows();
+    return decomp->getN();
   }
   const double *
   getResult() const
@@ -86,8 +158,6 @@ public:
   }
   void solve();
   void check(const ConstVector &ds);
-private:
-  void init();
 };
 
 #endif /* GENERAL_SYLVESTER_H */
@@ -21,6 +21,8 @@
 #include "KronUtils.hh"
 #include "int_power.hh"
 
+#include <utility>
+
 void
 KronUtils::multAtLevel(int level, const QuasiTriangular &t,
                        KronVector &x)
@@ -73,8 +75,27 @@ void
 KronUtils::multKron(const QuasiTriangular &f, const QuasiTriangular &k,
                     KronVector &x)
 {
-  multAtLevel(0, k, x);
-  if (x.getDepth() > 0)
-    for (int level = 1; level <= x.getDepth(); level++)
-      multAtLevelTrans(level, f, x);
+  int depth = x.getDepth();
+  if (depth == 0)
+    {
+      multAtLevel(0, k, x);
+      return;
+    }
+
+  int m = x.getM();
+  int n = x.getN();
+  int len = x.length();
+  Vector work(len);
+  Vector *src = &x;
+  Vector *dst = &work;
+  for (int level = depth; level > 0; level--)
+    {
+      GeneralMatrix b(*dst, m, len/m);
+      f.multTransOtherTransposed(b, ConstGeneralMatrix(*src, len/m, m));
+      std::swap(src, dst);
+    }
+  GeneralMatrix b(*dst, n, len/n);
+  k.multOtherTransposed(b, ConstGeneralMatrix(*src, len/n, n));
+  if (dst != &x)
+    x = *dst;
 }
@@ -36,7 +36,17 @@ public:
   static void multAtLevelTrans(int level, const QuasiTriangular &t,
                                KronVector &x);
 
-  // Computes x=(Fᵀ⊗Fᵀ⊗…⊗K)·x
+  /* Computes x=(Fᵀ⊗Fᵀ⊗…⊗K)·x.
+
+     Applying the factors level by level with multAtLevel() would split x into
+     many small blocks for the inner levels. Instead, x is seen as a matrix
+     whose columns are indexed by the slowest index, and each factor is
+     applied by one matrix multiplication (a single GEMM) which also
+     transposes the result, so that the index just multiplied becomes the
+     fastest one, and the next factor again acts on the slowest index. After
+     d+1 such products (the last one for K), the indices are back in their
+     original order. No explicit transposition is needed, the transpositions
+     are done by BLAS as part of the products. */
   static void multKron(const QuasiTriangular &f, const QuasiTriangular &k,
                        KronVector &x);
 };
@@ -0,0 +1,136 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "MappedStorage.hh"
+
+#ifndef _WIN32
+# include <fcntl.h>
+# include <sys/mman.h>
+# include <sys/statvfs.h>
+# include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <vector>
+
+std::string MappedStorage::directory;
+std::size_t MappedStorage::threshold = 0;
+std::map<const double *, std::size_t> MappedStorage::mappings;
+std::mutex MappedStorage::mut;
+std::atomic<int> MappedStorage::num_mappings{0};
+
+bool
+MappedStorage::setup(const std::string &dir, long threshold_bytes)
+{
+  std::lock_guard<std::mutex> lk{mut};
+  if (dir.empty())
+    {
+      directory.clear();
+      threshold = 0;
+      return true;
+    }
+#ifndef _WIN32
+  if (access(dir.c_str(), W_OK | X_OK) != 0)
+    return false;
+  directory = dir;
+  threshold = std::max(threshold_bytes/static_cast<long>(sizeof(double)), 1L);
+  return true;
+#else
+  return false;
+#endif
+}
+
+long
+MappedStorage::availableSpace()
+{
+#ifndef _WIN32
+  if (!active())
+    return 0;
+  struct statvfs st;
+  if (statvfs(directory.c_str(), &st) != 0)
+    return 0;
+  return static_cast<long>(st.f_bavail)*st.f_frsize;
+#else
+  return 0;
+#endif
+}
+
+/* The file is created with mkstemp(), unlinked immediately, and its blocks
+   are reserved before mapping it. Otherwise a full disk would only be
+   noticed when the kernel writes a page back, and the program would be
+   killed by SIGBUS. */
+
+double *
+MappedStorage::allocate(int len)
+{
+#ifndef _WIN32
+  if (!active() || len <= 0 || static_cast<std::size_t>(len) < threshold)
+    return nullptr;
+  std::size_t bytes = static_cast<std::size_t>(len)*sizeof(double);
+
+  std::string templ = directory + "/dynare-tensor-XXXXXX";
+  std::vector<char> name(templ.begin(), templ.end());
+  name.push_back('\0');
+  int fd = mkstemp(name.data());
+  if (fd < 0)
+    return nullptr;
+  unlink(name.data());
+# ifdef __linux__
+  bool ok = posix_fallocate(fd, 0, bytes) == 0;
+# else
+  bool ok = ftruncate(fd, bytes) == 0;
+# endif
+  void *p = ok ? mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+  close(fd);
+  if (p == MAP_FAILED)
+    return nullptr;
+  madvise(p, bytes, MADV_SEQUENTIAL);
+
+  auto data = static_cast<double *>(p);
+  std::lock_guard<std::mutex> lk{mut};
+  mappings.emplace(data, bytes);
+  num_mappings.fetch_add(1, std::memory_order_relaxed);
+  return data;
+#else
+  return nullptr;
+#endif
+}
+
+bool
+MappedStorage::deallocate(double *p)
+{
+#ifndef _WIN32
+  if (num_mappings.load(std::memory_order_relaxed) == 0)
+    return false;
+  std::size_t bytes;
+  {
+    std::lock_guard<std::mutex> lk{mut};
+    auto it = mappings.find(p);
+    if (it == mappings.end())
+      return false;
+    bytes = it->second;
+    mappings.erase(it);
+    num_mappings.fetch_sub(1, std::memory_order_relaxed);
+  }
+  munmap(p, bytes);
+  return true;
+#else
+  return false;
+#endif
+}
@@ -0,0 +1,82 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Out-of-core storage for large vectors and matrices.
+
+   Once set up with a directory and a size threshold, the storage of every
+   Vector (and thus of every GeneralMatrix, TwoDMatrix and tensor) larger
+   than the threshold is placed in a memory mapped file created in the
+   directory. The kernel can then write the pages of large tensors back to
+   the file and drop them, so that the resident memory stays bounded by the
+   working set instead of the total size of the tensors.
+
+   The files are unlinked as soon as they are created, hence they disappear
+   with the mappings, also if the program is killed. Since the tensors are
+   mostly traversed column by column, the mappings are advised for
+   sequential access.
+
+   If a mapping cannot be created (e.g. because the disk is full), the
+   storage silently falls back to the system allocator. On Windows, the
+   out-of-core storage is not available and setup() fails. */
+
+#ifndef MAPPED_STORAGE_H
+#define MAPPED_STORAGE_H
+
+#include <atomic>
+#include <cstddef>
+#include <map>
+#include <mutex>
+#include <string>
+
+class MappedStorage
+{
+  static std::string directory;
+  static std::size_t threshold; // in doubles, 0 if not set up
+  static std::map<const double *, std::size_t> mappings;
+  static std::mutex mut;
+  static std::atomic<int> num_mappings;
+public:
+  /* Places the vectors of at least ‘threshold_bytes’ bytes in files of the
+     given directory. An empty directory switches the out-of-core storage
+     off. Returns false if the directory is not usable. This must be called
+     before any vector is allocated in the mapped storage. */
+  static bool setup(const std::string &dir, long threshold_bytes);
+  static bool
+  active()
+  {
+    return threshold > 0;
+  }
+  // Returns the free space (in bytes) in the directory, or 0 if not active
+  static long availableSpace();
+  // Returns the number of vectors currently placed in the mapped storage
+  static int
+  numMappings()
+  {
+    return num_mappings.load(std::memory_order_relaxed);
+  }
+
+  /* Returns mapped storage for ‘len’ doubles, or nullptr if the storage is
+     not active, if ‘len’ is below the threshold or if the mapping fails. */
+  static double *allocate(int len);
+  /* Unmaps the storage if it has been returned by allocate(), in which case
+     it returns true; otherwise does nothing and returns false. */
+  static bool deallocate(double *p);
+};
+
+#endif
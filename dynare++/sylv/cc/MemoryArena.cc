@@ -0,0 +1,226 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "MemoryArena.hh"
+#include "MappedStorage.hh"
+
+#include <algorithm>
+#include <tuple>
+
+bool MemoryArena::enabled = true;
+
+MemoryArena &
+MemoryArena::local()
+{
+  thread_local MemoryArena arena;
+  return arena;
+}
+
+/* Blocks are rounded up to whole cache lines, so that each of them starts
+   at the same alignment as the chunk. */
+
+std::size_t
+MemoryArena::rounded(int len)
+{
+  constexpr std::size_t line = 64/sizeof(double);
+  return (static_cast<std::size_t>(std::max(len, 1))+line-1)/line*line;
+}
+
+double *
+MemoryArena::allocate(int len, Chunk *&chunk)
+{
+  chunk = nullptr;
+  if (double *p = MappedStorage::allocate(len))
+    return p;
+  if (enabled && static_cast<std::size_t>(len) <= max_block)
+    {
+      MemoryArena &a = local();
+      if (a.use)
+        return a.bump(rounded(len), chunk);
+    }
+  return new double[len];
+}
+
+/* Take ‘n’ doubles from the current chunk. If they do not fit, we go to the
+   next chunk, which is empty, and create it if there is none or if it is too
+   small. */
+
+double *
+MemoryArena::bump(std::size_t n, Chunk *&chunk)
+{
+  while (current < chunks.size() && chunks[current]->top + n > chunks[current]->size)
+    current++;
+  if (current == chunks.size())
+    chunks.push_back(std::make_unique<Chunk>(std::max(chunk_size, n), current, this));
+  Chunk &c = *chunks[current];
+  double *p = c.mem.get() + c.top;
+  c.top += n;
+  c.state.fetch_add(1, std::memory_order_relaxed);
+  marks.back().live++;
+  chunk = &c;
+  return p;
+}
+
+/* If the chunk belongs to the arena of the current thread, we account the
+   block to the scope in which it was allocated, and give the memory back to
+   the chunk if the block is the last one allocated. Then we decrease the
+   number of live blocks of the chunk; if the chunk has been abandoned and
+   this is its last block, we delete it.
+
+   Blocks freed by another thread are not accounted to their scope, which
+   then simply does not go back to its mark when closed. */
+
+void
+MemoryArena::deallocate(double *p, int len, Chunk *chunk)
+{
+  if (!chunk)
+    {
+      if (!MappedStorage::deallocate(p))
+        delete[] p;
+      return;
+    }
+  MemoryArena &a = local();
+  if (chunk->owner.load(std::memory_order_relaxed) == &a)
+    a.release(p, rounded(len), *chunk);
+  if (chunk->state.fetch_sub(1, std::memory_order_acq_rel) == Chunk::abandoned_flag+1)
+    delete chunk;
+}
+
+/* The block was allocated in the innermost scope whose mark is below the
+   block. The memory is given back only if this is the innermost scope, so
+   that the top never goes below the mark of the innermost scope. */
+
+void
+MemoryArena::release(double *p, std::size_t n, Chunk &c)
+{
+  std::size_t off = p - c.mem.get();
+  for (auto m = marks.rbegin(); m != marks.rend(); ++m)
+    if (std::tie(c.index, off) >= std::tie(m->chunk, m->top))
+      {
+        m->live--;
+        if (m == marks.rbegin() && off + n == c.top)
+          c.top = off;
+        return;
+      }
+}
+
+void
+MemoryArena::open()
+{
+  marks.push_back({ current, current < chunks.size() ? chunks[current]->top : 0, 0 });
+}
+
+/* When a nested scope is closed and all its blocks have been freed, we go
+   back to its mark. Otherwise its live blocks are accounted to the enclosing
+   scope, since they are above the mark of the enclosing scope too. The
+   outermost scope resets the arena. */
+
+void
+MemoryArena::close()
+{
+  Mark m = marks.back();
+  marks.pop_back();
+  if (marks.empty())
+    reset();
+  else if (m.live == 0)
+    {
+      for (std::size_t i = m.chunk; i < chunks.size(); i++)
+        chunks[i]->top = (i == m.chunk) ? m.top : 0;
+      current = m.chunk;
+    }
+  else
+    marks.back().live += m.live;
+}
+
+/* Chunks without live blocks are emptied, the others are abandoned: they are
+   given up by the arena, and deleted by the deallocation of their last
+   block. Since only the owning thread can add blocks to a chunk, if there
+   are no live blocks, there is no race with the deallocation.
+
+   The arenas live as long as the threads of the pool, that is as long as
+   the process, so the emptied chunks kept for the next task are capped to
+   ‘max_retained’ doubles in total: the memory taken by a large task is given
+   back at the end of the task, instead of being held by an idle thread. The
+   largest chunks are kept first, and the kept chunks are reused as they
+   are, so that tasks regularly needing up to ‘max_retained’ doubles do not
+   allocate (and fault in) new chunks. */
+
+void
+MemoryArena::reset()
+{
+  std::vector<std::unique_ptr<Chunk>> idle;
+  for (auto &c : chunks)
+    if (c->state.load(std::memory_order_acquire) == 0)
+      idle.push_back(std::move(c));
+    else
+      abandon(std::move(c));
+  std::stable_sort(idle.begin(), idle.end(),
+                   [](const auto &a, const auto &b) { return a->size > b->size; });
+  std::size_t total = 0;
+  std::vector<std::unique_ptr<Chunk>> kept;
+  for (auto &c : idle)
+    if (total + c->size <= max_retained)
+      {
+        total += c->size;
+        kept.push_back(std::move(c));
+      }
+  for (std::size_t i = 0; i < kept.size(); i++)
+    {
+      kept[i]->top = 0;
+      kept[i]->index = i;
+    }
+  chunks = std::move(kept);
+  current = 0;
+}
+
+/* The chunk is deleted by whoever decreases the number of live blocks to
+   zero after the flag is set. If the flag is set when there are no more
+   live blocks, this is us. */
+
+void
+MemoryArena::abandon(std::unique_ptr<Chunk> c)
+{
+  c->owner.store(nullptr, std::memory_order_relaxed);
+  if (c->state.fetch_add(Chunk::abandoned_flag, std::memory_order_acq_rel) != 0)
+    c.release();
+}
+
+/* At the exit of the thread, the chunks are deleted, or abandoned if they
+   still hold live blocks. */
+
+MemoryArena::~MemoryArena()
+{
+  for (auto &c : chunks)
+    abandon(std::move(c));
+}
+
+MemoryArenaScope::MemoryArenaScope(bool use_arena)
+{
+  MemoryArena &a = MemoryArena::local();
+  prev_use = a.use;
+  a.use = use_arena;
+  a.open();
+}
+
+MemoryArenaScope::~MemoryArenaScope()
+{
+  MemoryArena &a = MemoryArena::local();
+  a.use = prev_use;
+  a.close();
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* A per-thread arena for the storage of temporary vectors and matrices.
+
+   Code creating many short-lived Vector objects (and thus GeneralMatrix,
+   TwoDMatrix and tensors) can open a MemoryArenaScope. While the scope is
+   open, the storage of the vectors allocated by the thread is carved out of
+   large chunks owned by the thread, instead of going through the system
+   allocator. When the outermost scope of the thread is closed, the arena is
+   reset and its chunks are reused by the next scope, up to ‘max_retained’
+   doubles, the rest being given back to the system.
+
+   Allocation is a bump of a pointer. Freeing the most recently allocated
+   block moves the pointer back, so that temporaries created and destroyed
+   in a loop reuse the same memory. Moreover, when a nested scope is closed
+   and all the blocks allocated within it have been freed, the pointer goes
+   back to where it was when the scope was opened. Other blocks are
+   reclaimed only by the reset.
+
+   A vector may safely outlive the scope in which it was allocated, or be
+   destroyed by another thread: each chunk counts its live blocks, and a
+   chunk still holding live blocks at the reset is abandoned by the arena
+   and deleted when its last block is freed.
+
+   Blocks larger than ‘max_block’ always come from the system allocator, so
+   that the memory retained by the arenas stays moderate. Blocks above the
+   threshold of the out-of-core storage (see MappedStorage.hh) go to the
+   mapped storage, also within a scope, so that lowering the threshold moves
+   them out of the physical memory. The arenas can be switched off globally
+   by setting ‘MemoryArena::enabled’ to false. */
+
+#ifndef MEMORY_ARENA_H
+#define MEMORY_ARENA_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+class MemoryArena
+{
+  friend class MemoryArenaScope;
+public:
+  class Chunk
+  {
+    friend class MemoryArena;
+    std::unique_ptr<double[]> mem;
+    std::size_t size;
+    std::size_t top{0};
+    std::size_t index; // position in the arena
+    std::atomic<const MemoryArena *> owner; // null if abandoned
+    /* Number of live blocks, plus ‘abandoned_flag’ if the chunk has been
+       abandoned by its arena. */
+    std::atomic<int> state{0};
+    static constexpr int abandoned_flag = 1 << 30;
+  public:
+    Chunk(std::size_t s, std::size_t i, const MemoryArena *o)
+      : mem{new double[s]}, size{s}, index{i}, owner{o}
+    {
+    }
+  };
+
+  static bool enabled;
+  // Size of a chunk (in doubles)
+  static constexpr std::size_t chunk_size = 1 << 20;
+  // Maximum size of a block allocated in the arena (in doubles)
+  static constexpr std::size_t max_block = 1 << 22;
+  // Maximum size of the storage kept by an arena between scopes (in doubles)
+  static constexpr std::size_t max_retained = 2*chunk_size;
+
+  /* Allocates storage for ‘len’ doubles. If the storage is taken from the
+     arena of the current thread, ‘chunk’ is set to the chunk containing it,
+     otherwise the storage comes from the mapped storage or from operator
+     new[] and ‘chunk’ is set to nullptr. */
+  static double *allocate(int len, Chunk *&chunk);
+  // Frees storage returned by allocate()
+  static void deallocate(double *p, int len, Chunk *chunk);
+private:
+  /* Position of the top of the arena when a scope was opened, and the
+     number of live blocks allocated since then */
+  struct Mark
+  {
+    std::size_t chunk;
+    std::size_t top;
+    int live;
+  };
+  std::vector<std::unique_ptr<Chunk>> chunks;
+  std::size_t current{0};
+  std::vector<Mark> marks;
+  bool use{false};
+
+  MemoryArena() = default;
+  ~MemoryArena();
+  static MemoryArena &local();
+  static std::size_t rounded(int len);
+  double *bump(std::size_t n, Chunk *&chunk);
+  void release(double *p, std::size_t n, Chunk &c);
+  void open();
+  void close();
+  void reset();
+  static void abandon(std::unique_ptr<Chunk> c);
+};
+
+/* This opens the arena of the current thread for allocations, until the
+   destruction of the object. Scopes can be nested; the arena is reset when
+   the outermost one is closed. A scope constructed with ‘use_arena’ set to
+   false makes the thread allocate from the system within an open scope
+   (this is for objects known to outlive the scope). */
+
+class MemoryArenaScope
+{
+  bool prev_use;
+public:
+  explicit MemoryArenaScope(bool use_arena = true);
+  MemoryArenaScope(const MemoryArenaScope &) = delete;
+  MemoryArenaScope &operator=(const MemoryArenaScope &) = delete;
+  ~MemoryArenaScope();
+};
+
+#endif
@@ -0,0 +1,268 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Quasi-triangular matrix in packed storage
+
+/* QuasiTriangular keeps the matrix in a full square array, and its diagonal
+   blocks in a list of DiagonalBlock. Its solvers first add the identity to
+   the matrix in place and eliminate the subdiagonal elements of the complex
+   blocks by row operations, so that the bottom of the Sylvester recursion,
+   which solves (I+r·K)·x=d or (I+c₁·K+c₂·K²)·x=d many times, must build a
+   new matrix (and a new list of blocks) for each right hand side.
+
+   Here the matrix is stored once, as a vector of descriptors of its diagonal
+   blocks (with the elements of the blocks), and a panel with the strictly
+   upper part of the columns above their diagonal blocks, column after column
+   in contiguous memory. The systems are then solved by back substitution
+   from the last block to the first one: a real block is a division, a
+   complex block a 2×2 system solved directly, and the solved block is
+   eliminated from the preceding rows by a loop over the contiguous columns
+   of the panel, fusing the two columns of a complex block, which the
+   compiler vectorizes. The matrices are not modified, so they can be shared
+   by the threads of the recursion, and the combinations of K and K² are
+   applied on the fly.
+
+   The class is a template so that TriangularSylvester uses it in double
+   precision and SinglePrecisionSylvester in single precision. The methods
+   of QuasiTriangular and QuasiTriangularZero are kept as the reference
+   implementation (tests compare both). */
+
+#ifndef PACKED_QUASI_TRIANGULAR_H
+#define PACKED_QUASI_TRIANGULAR_H
+
+#include "QuasiTriangular.hh"
+#include "GeneralMatrix.hh"
+
+#include <vector>
+#include <algorithm>
+#include <cstddef>
+
+template<typename T>
+class PackedQuasiTriangular
+{
+public:
+  // A diagonal block, a₁₂ is above and a₂₁ below the diagonal
+  struct Block
+  {
+    int index;
+    bool real;
+    T a11, a12, a21, a22;
+  };
+private:
+  int n;
+  std::vector<Block> blocks;
+  std::vector<T> panel;
+  std::vector<std::ptrdiff_t> offsets; // start of the columns in ‘panel’
+  std::vector<int> tops; // lengths of the columns in ‘panel’
+public:
+  /* Packs the matrix t, including the zero columns of a
+     QuasiTriangularZero, with the diagonal blocks of t */
+  explicit PackedQuasiTriangular(const QuasiTriangular &t);
+  int
+  getDim() const
+  {
+    return n;
+  }
+  const std::vector<Block> &
+  getBlocks() const
+  {
+    return blocks;
+  }
+
+  // Calculates x = T·b
+  void
+  multVec(T *x, const T *b) const
+  {
+    std::fill_n(x, n, T{0});
+    multaVec(x, b);
+  }
+  // Calculates x = x + T·b
+  void multaVec(T *x, const T *b) const;
+  // Solves (I+c·T)·x = d, x→d
+  void
+  solvePre(double c, T *d, double &eig_min) const
+  {
+    solvePre(c, 0.0, nullptr, d, eig_min);
+  }
+  /* Solves (I+c₁·T+c₂·T₂)·x = d, x→d, where T₂ has the diagonal blocks of T
+     (for instance T₂=T²) */
+  void
+  solvePre(double c1, double c2, const PackedQuasiTriangular &t2, T *d, double &eig_min) const
+  {
+    solvePre(c1, c2, &t2, d, eig_min);
+  }
+private:
+  void solvePre(double c1, double c2, const PackedQuasiTriangular *t2, T *d, double &eig_min) const;
+  const T *
+  column(int j) const
+  {
+    return panel.data() + offsets[j];
+  }
+  /* Calculates y = y + a·x. The vectors do not overlap, and the loop is
+     unrolled by four, so that it is vectorized at -O2 (whose cost model
+     rejects the runtime alias checks and the epilogue of the plain loop) */
+  static void
+  axpy(int len, T a, const T *__restrict x, T *__restrict y)
+  {
+    int i = 0;
+    for (; i+4 <= len; i += 4)
+      {
+        y[i] += a*x[i];
+        y[i+1] += a*x[i+1];
+        y[i+2] += a*x[i+2];
+        y[i+3] += a*x[i+3];
+      }
+    for (; i < len; i++)
+      y[i] += a*x[i];
+  }
+  // Calculates y = y + a₁·x₁ + a₂·x₂, in the same way
+  static void
+  axpy2(int len, T a1, const T *__restrict x1, T a2, const T *__restrict x2, T *__restrict y)
+  {
+    int i = 0;
+    for (; i+4 <= len; i += 4)
+      {
+        y[i] += a1*x1[i] + a2*x2[i];
+        y[i+1] += a1*x1[i+1] + a2*x2[i+1];
+        y[i+2] += a1*x1[i+2] + a2*x2[i+2];
+        y[i+3] += a1*x1[i+3] + a2*x2[i+3];
+      }
+    for (; i < len; i++)
+      y[i] += a1*x1[i] + a2*x2[i];
+  }
+};
+
+/* The elements are read from the full matrix, which for a
+   QuasiTriangularZero is obtained by multiplying the identity, and the
+   blocks are taken from the Diagonal of t rather than from the non-zero
+   subdiagonal elements, so that T and T² have the same blocks even if a
+   block of T² happens to be diagonal. */
+
+template<typename T>
+PackedQuasiTriangular<T>::PackedQuasiTriangular(const QuasiTriangular &t)
+  : n(t.getDim()), offsets(n), tops(n)
+{
+  GeneralMatrix id(n, n);
+  id.unit();
+  GeneralMatrix full(n, n);
+  t.multOtherTransposed(full, id);
+
+  // The zero columns of a QuasiTriangularZero are real blocks
+  int nz = n - t.nrows();
+  for (int j = 0; j < nz; j++)
+    blocks.push_back({ j, true, T{0}, T{0}, T{0}, T{0} });
+  for (auto di = t.diag_begin(); di != t.diag_end(); ++di)
+    {
+      int j = nz + di->getIndex();
+      if (di->isReal())
+        blocks.push_back({ j, true, static_cast<T>(full.get(j, j)), T{0}, T{0}, T{0} });
+      else
+        blocks.push_back({ j, false, static_cast<T>(full.get(j, j)), static_cast<T>(full.get(j, j+1)),
+                           static_cast<T>(full.get(j+1, j)), static_cast<T>(full.get(j+1, j+1)) });
+    }
+  std::sort(blocks.begin(), blocks.end(),
+            [](const Block &b1, const Block &b2) { return b1.index < b2.index; });
+
+  std::ptrdiff_t size = 0;
+  for (const auto &b : blocks)
+    for (int j = b.index; j < b.index + (b.real ? 1 : 2); j++)
+      {
+        offsets[j] = size;
+        tops[j] = b.index;
+        size += b.index;
+      }
+  panel.resize(size);
+  for (int j = 0; j < n; j++)
+    for (int i = 0; i < tops[j]; i++)
+      panel[offsets[j]+i] = static_cast<T>(full.get(i, j));
+}
+
+template<typename T>
+void
+PackedQuasiTriangular<T>::multaVec(T *x, const T *b) const
+{
+  for (const auto &bl : blocks)
+    {
+      int j = bl.index;
+      if (bl.real)
+        {
+          axpy(j, b[j], column(j), x);
+          x[j] += bl.a11*b[j];
+        }
+      else
+        {
+          axpy2(j, b[j], column(j), b[j+1], column(j+1), x);
+          T x1 = bl.a11*b[j] + bl.a12*b[j+1];
+          T x2 = bl.a21*b[j] + bl.a22*b[j+1];
+          x[j] += x1;
+          x[j+1] += x2;
+        }
+    }
+}
+
+/* The diagonal blocks are solved in double precision. The eigenvalue sizes
+   are computed as in QuasiTriangular::solvePre(): the square of the diagonal
+   element of a real block, and the determinant of a complex block, of
+   I+c₁·T+c₂·T₂. */
+
+template<typename T>
+void
+PackedQuasiTriangular<T>::solvePre(double c1, double c2, const PackedQuasiTriangular *t2,
+                                   T *d, double &eig_min) const
+{
+  for (int ib = static_cast<int>(blocks.size())-1; ib >= 0; ib--)
+    {
+      const Block &b = blocks[ib];
+      int j = b.index;
+      double a11 = 1.0 + c1*b.a11, a12 = c1*b.a12, a21 = c1*b.a21, a22 = 1.0 + c1*b.a22;
+      if (t2)
+        {
+          const Block &b2 = t2->blocks[ib];
+          a11 += c2*b2.a11;
+          a12 += c2*b2.a12;
+          a21 += c2*b2.a21;
+          a22 += c2*b2.a22;
+        }
+      double eig_size;
+      if (b.real)
+        {
+          eig_size = a11*a11;
+          double x = d[j]/a11;
+          d[j] = static_cast<T>(x);
+          axpy(j, static_cast<T>(-c1*x), column(j), d);
+          if (t2)
+            axpy(j, static_cast<T>(-c2*x), t2->column(j), d);
+        }
+      else
+        {
+          double det = a11*a22 - a12*a21;
+          eig_size = det;
+          double x1 = (a22*d[j] - a12*d[j+1])/det;
+          double x2 = (a11*d[j+1] - a21*d[j])/det;
+          d[j] = static_cast<T>(x1);
+          d[j+1] = static_cast<T>(x2);
+          axpy2(j, static_cast<T>(-c1*x1), column(j), static_cast<T>(-c1*x2), column(j+1), d);
+          if (t2)
+            axpy2(j, static_cast<T>(-c2*x1), t2->column(j), static_cast<T>(-c2*x2), t2->column(j+1), d);
+        }
+      eig_min = std::min(eig_min, eig_size);
+    }
+}
+
+#endif /* PACKED_QUASI_TRIANGULAR_H */
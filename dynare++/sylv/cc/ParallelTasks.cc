@@ -0,0 +1,73 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "ParallelTasks.hh"
+#include "sthread.hh"
+
+#include <algorithm>
+#include <memory>
+#include <utility>
+
+namespace
+{
+  // Worker running a closure on the thread pool
+  class TaskWorker : public sthread::detach_thread
+  {
+    std::function<void()> task;
+  public:
+    explicit TaskWorker(std::function<void()> t)
+      : task(std::move(t))
+    {
+    }
+    void
+    operator()(std::mutex &mut) override
+    {
+      task();
+    }
+  };
+}
+
+void
+ParallelTasks::run(std::vector<std::function<void()>> tasks, bool par)
+{
+  if (!par)
+    {
+      for (auto &t : tasks)
+        t();
+      return;
+    }
+  sthread::detach_thread_group gr;
+  for (auto &t : tasks)
+    gr.insert(std::make_unique<TaskWorker>(std::move(t)));
+  gr.run();
+}
+
+void
+ParallelTasks::forRange(int n, bool par, const std::function<void(int)> &f)
+{
+  int nchunks = par ? std::min(n, sthread::detach_thread_group::max_parallel_threads) : 1;
+  std::vector<std::function<void()>> tasks;
+  for (int c = 0; c < nchunks; c++)
+    tasks.emplace_back([&f, c, n, nchunks]
+                       {
+                         for (int i = c*n/nchunks; i < (c+1)*n/nchunks; i++)
+                           f(i);
+                       });
+  run(std::move(tasks), nchunks > 1);
+}
@@ -0,0 +1,44 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Running independent pieces of work of the solvers on the thread pool
+
+/* The Sylvester solvers have several places where independent pieces of work
+   (eliminations of a solved block from the remaining sub-vectors, Kronecker
+   products of independent sub-vectors) can be run in parallel. These are
+   given here as closures and pushed to the persistent thread pool of
+   sthread::detach_thread_group. */
+
+#ifndef PARALLEL_TASKS_H
+#define PARALLEL_TASKS_H
+
+#include <functional>
+#include <vector>
+
+class ParallelTasks
+{
+public:
+  // Runs the tasks on the thread pool if ‘par’ is true, in sequence otherwise
+  static void run(std::vector<std::function<void()>> tasks, bool par);
+  /* Calls f(i) for i=0,…,n−1; if ‘par’ is true, the range is split into
+     contiguous chunks (one per thread) run on the thread pool */
+  static void forRange(int n, bool par, const std::function<void(int)> &f);
+};
+
+#endif /* PARALLEL_TASKS_H */
@@ -643,6 +643,20 @@ QuasiTriangular::multLeftOtherTrans(GeneralMatrix &a) const
   a.multLeftTrans(*this);
 }
 
+void
+QuasiTriangular::multOtherTransposed(GeneralMatrix &b, const ConstGeneralMatrix &a) const
+{
+  b.zeros();
+  b.multAndAdd(*this, a, "trans");
+}
+
+void
+QuasiTriangular::multTransOtherTransposed(GeneralMatrix &b, const ConstGeneralMatrix &a) const
+{
+  b.zeros();
+  b.multAndAdd(*this, "trans", a, "trans");
+}
+
 void
 QuasiTriangular::swapDiagLogically(diag_iter it)
 {
@@ -365,6 +365,12 @@ public:
   {
     return diagonal;
   }
+  // Returns the dimension of the represented matrix
+  virtual int
+  getDim() const
+  {
+    return nrows();
+  }
   int getNumOffdiagonal() const;
   void swapDiagLogically(diag_iter it);
   void checkDiagConsistency(diag_iter it);
@@ -396,6 +402,10 @@ public:
   virtual void multLeftOther(GeneralMatrix &a) const;
   /* A = thisᵀ·A */
   virtual void multLeftOtherTrans(GeneralMatrix &a) const;
+  /* B = this·Aᵀ */
+  virtual void multOtherTransposed(GeneralMatrix &b, const ConstGeneralMatrix &a) const;
+  /* B = thisᵀ·Aᵀ */
+  virtual void multTransOtherTransposed(GeneralMatrix &b, const ConstGeneralMatrix &a) const;
 
   const_diag_iter
   diag_begin() const
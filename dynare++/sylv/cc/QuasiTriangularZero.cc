@@ -146,6 +146,33 @@ QuasiTriangularZero::multLeftOther(GeneralMatrix &a) const
   QuasiTriangular::multLeftOther(a2);
 }
 
+/* Here the first ‘nz’ columns of A are multiplied by the zero columns, so
+   only the last ones are used */
+void
+QuasiTriangularZero::multOtherTransposed(GeneralMatrix &b, const ConstGeneralMatrix &a) const
+{
+  ConstGeneralMatrix a2(a, 0, nz, a.nrows(), a.ncols()-nz);
+  GeneralMatrix b1(b, 0, 0, nz, b.ncols());
+  GeneralMatrix b2(b, nz, 0, b.nrows()-nz, b.ncols());
+  b1.zeros();
+  b1.multAndAdd(ru, a2, "trans");
+  QuasiTriangular::multOtherTransposed(b2, a2);
+}
+
+/* The transpose has zero first rows, and the right upper part goes to the
+   left lower part */
+void
+QuasiTriangularZero::multTransOtherTransposed(GeneralMatrix &b, const ConstGeneralMatrix &a) const
+{
+  ConstGeneralMatrix a1(a, 0, 0, a.nrows(), nz);
+  ConstGeneralMatrix a2(a, 0, nz, a.nrows(), a.ncols()-nz);
+  GeneralMatrix b1(b, 0, 0, nz, b.ncols());
+  GeneralMatrix b2(b, nz, 0, b.nrows()-nz, b.ncols());
+  b1.zeros();
+  QuasiTriangular::multTransOtherTransposed(b2, a2);
+  b2.multAndAdd(ru, "trans", a1, "trans");
+}
+
 void
 QuasiTriangularZero::print() const
 {
@@ -50,6 +50,11 @@ public:
   explicit QuasiTriangularZero(const QuasiTriangular &t);
   explicit QuasiTriangularZero(const SchurDecompZero &decomp);
   ~QuasiTriangularZero() override = default;
+  int
+  getDim() const override
+  {
+    return nz+nrows();
+  }
   void solvePre(Vector &x, double &eig_min) override;
   void solvePreTrans(Vector &x, double &eig_min) override;
   void multVec(Vector &x, const ConstVector &b) const override;
@@ -59,6 +64,8 @@ public:
   void multKron(KronVector &x) const override;
   void multKronTrans(KronVector &x) const override;
   void multLeftOther(GeneralMatrix &a) const override;
+  void multOtherTransposed(GeneralMatrix &b, const ConstGeneralMatrix &a) const override;
+  void multTransOtherTransposed(GeneralMatrix &b, const ConstGeneralMatrix &a) const override;
 
   std::unique_ptr<QuasiTriangular>
   clone() const override
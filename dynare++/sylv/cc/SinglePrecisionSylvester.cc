@@ -0,0 +1,381 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "SinglePrecisionSylvester.hh"
+#include "ParallelTasks.hh"
+#include "SylvException.hh"
+#include "int_power.hh"
+#include "sthread.hh"
+
+#include <dynblas.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace
+{
+  // Returns the elements of the matrix t in a full n×n matrix
+  GeneralMatrix
+  fullMatrix(const QuasiTriangular &t)
+  {
+    int n = t.getDim();
+    GeneralMatrix id(n, n);
+    id.unit();
+    GeneralMatrix res(n, n);
+    t.multOtherTransposed(res, id);
+    return res;
+  }
+
+  std::vector<float>
+  toFloat(const GeneralMatrix &a)
+  {
+    std::vector<float> res(a.nrows()*a.ncols());
+    for (int j = 0; j < a.ncols(); j++)
+      for (int i = 0; i < a.nrows(); i++)
+        res[i+j*a.nrows()] = static_cast<float>(a.get(i, j));
+    return res;
+  }
+
+  // Computes y = y + a·x
+  void
+  axpy(int len, double a, const float *x, float *y)
+  {
+    blas_int n = len, inc = 1;
+    float af = static_cast<float>(a);
+    saxpy(&n, &af, x, &inc, y, &inc);
+  }
+
+  void
+  scale(int len, double a, float *x)
+  {
+    float af = static_cast<float>(a);
+    for (int i = 0; i < len; i++)
+      x[i] *= af;
+  }
+}
+
+SinglePrecisionSylvester::SinglePrecisionSylvester(const QuasiTriangular &kmat,
+                                                   const QuasiTriangular &fmat)
+  : SylvesterSolver(kmat, fmat), n(kmat.getDim()), m(fmat.getDim()),
+    packedK{*matrixK}, packedKK{*matrixK->square()}
+{
+  init();
+}
+
+SinglePrecisionSylvester::SinglePrecisionSylvester(const SchurDecompZero &kdecomp,
+                                                   const SimilarityDecomp &fdecomp)
+  : SylvesterSolver(kdecomp, fdecomp), n(matrixK->getDim()), m(matrixF->getDim()),
+    packedK{*matrixK}, packedKK{*matrixK->square()}
+{
+  init();
+}
+
+/* The matrices are copied to full matrices before being rounded, since
+   QuasiTriangularZero does not store its zero columns. The diagonal blocks
+   of F are found as in Diagonal, from the non-zero elements below the
+   diagonal. */
+
+void
+SinglePrecisionSylvester::init()
+{
+  GeneralMatrix kd = fullMatrix(*matrixK);
+  GeneralMatrix fd = fullMatrix(*matrixF);
+  k = toFloat(kd);
+  kk = toFloat(fullMatrix(*matrixK->square()));
+  f = toFloat(fd);
+  ff = toFloat(fullMatrix(*matrixF->square()));
+
+  int j = 0;
+  while (j < m)
+    if (j < m-1 && fd.get(j+1, j) != 0.0)
+      {
+        fblocks.push_back({ j, false, fd.get(j, j), fd.get(j, j+1), fd.get(j+1, j) });
+        j += 2;
+      }
+    else
+      {
+        fblocks.push_back({ j, true, fd.get(j, j), 0.0, 0.0 });
+        j++;
+      }
+}
+
+int
+SinglePrecisionSylvester::length(int depth) const
+{
+  return n*power(m, depth);
+}
+
+bool
+SinglePrecisionSylvester::parallel(int len)
+{
+  return sthread::detach_thread_group::max_parallel_threads > 1
+    && len >= par_min_length;
+}
+
+void
+SinglePrecisionSylvester::solve(SylvParams &pars, KronVector &d) const
+{
+  if (d.getN() != n || d.getM() != m)
+    throw SYLV_MES_EXCEPTION("Wrong dimensions of the vector in SinglePrecisionSylvester::solve.");
+
+  std::vector<float> x(d.length());
+  for (int i = 0; i < d.length(); i++)
+    x[i] = static_cast<float>(d[i]);
+  double eig_min = 1e30;
+  solvi(1., x.data(), d.getDepth(), eig_min);
+  for (int i = 0; i < d.length(); i++)
+    d[i] = x[i];
+  pars.eig_min = std::sqrt(eig_min);
+}
+
+/* This is the same algorithm as in KronUtils::multKron(): each factor is
+   applied to the slowest index by one SGEMM, which also transposes the
+   result. */
+
+void
+SinglePrecisionSylvester::multKron(bool square, float *x, int depth) const
+{
+  const float *fm = square ? ff.data() : f.data();
+  const float *km = square ? kk.data() : k.data();
+  blas_int len = length(depth);
+  std::vector<float> work(len);
+  float *src = x;
+  float *dst = work.data();
+  const float one = 1.0f, zero = 0.0f;
+  blas_int bm = m, bn = n, cols = len/m, ldsrc = len/m;
+  for (int level = depth; level > 0; level--)
+    {
+      sgemm("T", "T", &bm, &cols, &bm, &one, fm, &bm, src, &ldsrc, &zero, dst, &bm);
+      std::swap(src, dst);
+    }
+  cols = len/n;
+  ldsrc = len/n;
+  sgemm("N", "T", &bn, &cols, &bn, &one, km, &bn, src, &ldsrc, &zero, dst, &bn);
+  if (dst != x)
+    std::copy_n(dst, len, x);
+}
+
+void
+SinglePrecisionSylvester::solvi(double r, float *d, int depth, double &eig_min) const
+{
+  if (depth == 0)
+    packedK.solvePre(r, d, eig_min);
+  else
+    for (const auto &b : fblocks)
+      if (b.real)
+        solviRealAndEliminate(r, b, d, depth, eig_min);
+      else
+        solviComplexAndEliminate(r, b, d, depth, eig_min);
+}
+
+void
+SinglePrecisionSylvester::solvii(double alpha, double beta1, double beta2,
+                                 float *d1, float *d2, int depth,
+                                 double &eig_min) const
+{
+  int len = length(depth);
+  std::vector<float> y1(d1, d1+len), y2(d2, d2+len);
+  ParallelTasks::run({ [&] { multKron(false, y1.data(), depth); },
+                       [&] { multKron(false, y2.data(), depth); } },
+                     parallel(len));
+  axpy(len, alpha, y1.data(), d1);
+  axpy(len, -beta1, y2.data(), d1);
+  axpy(len, alpha, y2.data(), d2);
+  axpy(len, beta2, y1.data(), d2);
+  double eig_min1 = eig_min, eig_min2 = eig_min;
+  ParallelTasks::run({ [&] { solviip(alpha, beta1*beta2, d1, depth, eig_min1); },
+                       [&] { solviip(alpha, beta1*beta2, d2, depth, eig_min2); } },
+                     parallel(len));
+  eig_min = std::min(eig_min1, eig_min2);
+}
+
+void
+SinglePrecisionSylvester::solviip(double alpha, double betas,
+                                  float *d, int depth, double &eig_min) const
+{
+  // quick exit to solvi if betas is small
+  if (betas < diag_zero_sq)
+    {
+      solvi(alpha, d, depth, eig_min);
+      solvi(alpha, d, depth, eig_min);
+      return;
+    }
+
+  if (depth == 0)
+    packedK.solvePre(2*alpha, alpha*alpha+betas, packedKK, d, eig_min);
+  else
+    for (const auto &b : fblocks)
+      if (b.real)
+        solviipRealAndEliminate(alpha, betas, b, d, depth, eig_min);
+      else
+        solviipComplexAndEliminate(alpha, betas, b, d, depth, eig_min);
+}
+
+void
+SinglePrecisionSylvester::solviRealAndEliminate(double r, const Block &b,
+                                                float *d, int depth,
+                                                double &eig_min) const
+{
+  int len = length(depth-1);
+  float *dj = d + b.index*len;
+  if (std::abs(r*b.alpha) > diag_zero)
+    solvi(r*b.alpha, dj, depth-1, eig_min);
+  std::vector<float> y(dj, dj+len);
+  multKron(false, y.data(), depth-1);
+  scale(len, r, y.data());
+  eliminate(b, d, depth, { { y.data(), f, b.index } });
+}
+
+void
+SinglePrecisionSylvester::solviComplexAndEliminate(double r, const Block &b,
+                                                   float *d, int depth,
+                                                   double &eig_min) const
+{
+  int len = length(depth-1);
+  float *dj = d + b.index*len;
+  float *djj = dj + len;
+  // swap because of transpose
+  double beta1 = b.beta2;
+  double beta2 = -b.beta1;
+  double aspbs = b.alpha*b.alpha - b.beta1*b.beta2;
+  if (r*r*aspbs > diag_zero_sq)
+    solvii(r*b.alpha, r*beta1, r*beta2, dj, djj, depth-1, eig_min);
+  std::vector<float> y1(dj, dj+len), y2(djj, djj+len);
+  ParallelTasks::run({ [&] { multKron(false, y1.data(), depth-1); },
+                       [&] { multKron(false, y2.data(), depth-1); } },
+                     parallel(len));
+  scale(len, r, y1.data());
+  scale(len, r, y2.data());
+  eliminate(b, d, depth, { { y1.data(), f, b.index }, { y2.data(), f, b.index+1 } });
+}
+
+void
+SinglePrecisionSylvester::solviipRealAndEliminate(double alpha, double betas,
+                                                  const Block &b, float *d, int depth,
+                                                  double &eig_min) const
+{
+  int len = length(depth-1);
+  float *dj = d + b.index*len;
+  double aspbs = alpha*alpha+betas;
+  double fs = b.alpha*b.alpha;
+  if (fs*aspbs > diag_zero_sq)
+    solviip(b.alpha*alpha, fs*betas, dj, depth-1, eig_min);
+  std::vector<float> y1(dj, dj+len), y2(dj, dj+len);
+  ParallelTasks::run({ [&] { multKron(false, y1.data(), depth-1); },
+                       [&] { multKron(true, y2.data(), depth-1); } },
+                     parallel(len));
+  scale(len, 2*alpha, y1.data());
+  scale(len, aspbs, y2.data());
+  eliminate(b, d, depth, { { y1.data(), f, b.index }, { y2.data(), ff, b.index } });
+}
+
+void
+SinglePrecisionSylvester::solviipComplexAndEliminate(double alpha, double betas,
+                                                     const Block &b, float *d, int depth,
+                                                     double &eig_min) const
+{
+  int len = length(depth-1);
+  float *dj = d + b.index*len;
+  float *djj = dj + len;
+  double aspbs = alpha*alpha+betas;
+  double gamma = b.alpha;
+  double delta1 = b.beta2; // swap because of transpose
+  double delta2 = -b.beta1;
+  double gspds = gamma*gamma - b.beta1*b.beta2;
+  if (gspds*aspbs > diag_zero_sq)
+    solviipComplex(alpha, betas, gamma, delta1, delta2, dj, djj, depth-1, eig_min);
+  std::vector<float> y1(dj, dj+len), y11(djj, djj+len), y2(dj, dj+len), y22(djj, djj+len);
+  ParallelTasks::run({ [&] { multKron(false, y1.data(), depth-1); },
+                       [&] { multKron(false, y11.data(), depth-1); },
+                       [&] { multKron(true, y2.data(), depth-1); },
+                       [&] { multKron(true, y22.data(), depth-1); } },
+                     parallel(len));
+  scale(len, 2*alpha, y1.data());
+  scale(len, 2*alpha, y11.data());
+  scale(len, aspbs, y2.data());
+  scale(len, aspbs, y22.data());
+  eliminate(b, d, depth, { { y1.data(), f, b.index }, { y11.data(), f, b.index+1 },
+                           { y2.data(), ff, b.index }, { y22.data(), ff, b.index+1 } });
+}
+
+void
+SinglePrecisionSylvester::solviipComplex(double alpha, double betas, double gamma,
+                                         double delta1, double delta2,
+                                         float *d1, float *d2, int depth,
+                                         double &eig_min) const
+{
+  int len = length(depth);
+  std::vector<float> o1(d1, d1+len), o2(d2, d2+len);
+  std::vector<float> y1(o1), y2(o2);
+  ParallelTasks::run({ [&] { multKron(false, y1.data(), depth); },
+                       [&] { multKron(false, y2.data(), depth); } },
+                     parallel(len));
+  axpy(len, 2*alpha*gamma, y1.data(), d1);
+  axpy(len, -2*alpha*delta1, y2.data(), d1);
+  axpy(len, 2*alpha*gamma, y2.data(), d2);
+  axpy(len, 2*alpha*delta2, y1.data(), d2);
+  ParallelTasks::run({ [&] { multKron(true, o1.data(), depth); },
+                       [&] { multKron(true, o2.data(), depth); } },
+                     parallel(len));
+  double aspbs = alpha*alpha + betas;
+  double gspds = gamma*gamma - delta1*delta2;
+  axpy(len, aspbs*gspds, o1.data(), d1);
+  axpy(len, -2*aspbs*gamma*delta1, o2.data(), d1);
+  axpy(len, aspbs*gspds, o2.data(), d2);
+  axpy(len, 2*aspbs*gamma*delta2, o1.data(), d2);
+
+  double delta = std::sqrt(delta1*delta2);
+  double beta = std::sqrt(betas);
+  double a1 = alpha*gamma - beta*delta;
+  double b1 = alpha*delta + gamma*beta;
+  double a2 = alpha*gamma + beta*delta;
+  double b2 = alpha*delta - gamma*beta;
+  double eig_min1 = eig_min, eig_min2 = eig_min;
+  ParallelTasks::run({ [&]
+                       {
+                         solviip(a2, b2*b2, d1, depth, eig_min1);
+                         solviip(a1, b1*b1, d1, depth, eig_min1);
+                       },
+                       [&]
+                       {
+                         solviip(a2, b2*b2, d2, depth, eig_min2);
+                         solviip(a1, b1*b1, d2, depth, eig_min2);
+                       } },
+                     parallel(len));
+  eig_min = std::min(eig_min1, eig_min2);
+}
+
+void
+SinglePrecisionSylvester::eliminate(const Block &b, float *d, int depth,
+                                    const std::vector<ElimTerm> &terms) const
+{
+  int len = length(depth-1);
+  std::vector<int> cols;
+  for (int col = b.index + (b.real ? 1 : 2); col < m; col++)
+    if (std::any_of(terms.begin(), terms.end(),
+                    [&](const ElimTerm &t) { return t.mat[t.row+col*m] != 0.0f; }))
+      cols.push_back(col);
+  ParallelTasks::forRange(cols.size(), parallel(len), [&](int i)
+                          {
+                            float *dk = d + cols[i]*len;
+                            for (const auto &t : terms)
+                              axpy(len, -t.mat[t.row+cols[i]*m], t.y, dk);
+                          });
+}
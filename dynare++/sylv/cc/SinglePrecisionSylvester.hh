@@ -0,0 +1,115 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Triangular Sylvester solver in single precision
+
+/* This solves the same triangular system as TriangularSylvester, by the same
+   recursion over the diagonal blocks of F, but with the vector and the
+   matrices K, F and their squares stored in single precision. The hot parts
+   of the recursion (the Kronecker products and the eliminations of the solved
+   blocks) stream long vectors through memory, so that halving the size of
+   the elements roughly halves their cost. The Kronecker products are done by
+   SGEMM as in KronUtils::multKron(), the eliminations by SAXPY, and the
+   quasi-triangular systems of size n at the bottom of the recursion by
+   PackedQuasiTriangular in single precision.
+
+   The result is only accurate to single precision. It is meant to be used by
+   GeneralSylvesterDecomp within a loop of iterative refinement, which brings
+   the solution back to double precision by solving for the correction of the
+   residual computed in double precision. The scalar coefficients of the
+   recursion are still computed in double precision. */
+
+#ifndef SINGLE_PRECISION_SYLVESTER_H
+#define SINGLE_PRECISION_SYLVESTER_H
+
+#include "SylvesterSolver.hh"
+#include "KronVector.hh"
+#include "QuasiTriangular.hh"
+#include "SimilarityDecomp.hh"
+#include "PackedQuasiTriangular.hh"
+
+#include <vector>
+
+class SinglePrecisionSylvester : public SylvesterSolver
+{
+  // A diagonal block of F, β₁ is above and β₂ below the diagonal
+  struct Block
+  {
+    int index;
+    bool real;
+    double alpha, beta1, beta2;
+  };
+  const int n; // dimension of K
+  const int m; // dimension of F
+  std::vector<float> k, kk, f, ff; // K, K², F and F², column-major
+  std::vector<Block> fblocks;
+  // K and K² packed for the systems at the bottom of the recursion
+  const PackedQuasiTriangular<float> packedK, packedKK;
+public:
+  SinglePrecisionSylvester(const QuasiTriangular &kmat, const QuasiTriangular &fmat);
+  SinglePrecisionSylvester(const SchurDecompZero &kdecomp, const SimilarityDecomp &fdecomp);
+  ~SinglePrecisionSylvester() override = default;
+  void solve(SylvParams &pars, KronVector &d) const override;
+private:
+  void init();
+  // Length of a vector of the given depth
+  int length(int depth) const;
+  /* Computes x=(Fᵀ⊗Fᵀ⊗…⊗K)·x, or x=(Fᵀ²⊗Fᵀ²⊗…⊗K²)·x if ‘square’ is true */
+  void multKron(bool square, float *x, int depth) const;
+
+  // These are the methods of TriangularSylvester on vectors of floats
+  void solvi(double r, float *d, int depth, double &eig_min) const;
+  void solvii(double alpha, double beta1, double beta2,
+              float *d1, float *d2, int depth, double &eig_min) const;
+  void solviip(double alpha, double betas,
+               float *d, int depth, double &eig_min) const;
+  void solviRealAndEliminate(double r, const Block &b,
+                             float *d, int depth, double &eig_min) const;
+  void solviComplexAndEliminate(double r, const Block &b,
+                                float *d, int depth, double &eig_min) const;
+  void solviipRealAndEliminate(double alpha, double betas, const Block &b,
+                               float *d, int depth, double &eig_min) const;
+  void solviipComplexAndEliminate(double alpha, double betas, const Block &b,
+                                  float *d, int depth, double &eig_min) const;
+  void solviipComplex(double alpha, double betas, double gamma,
+                      double delta1, double delta2,
+                      float *d1, float *d2, int depth, double &eig_min) const;
+  /* A term of the elimination: the vector ‘y’ multiplied by the elements
+     of the row ‘row’ of the matrix ‘mat’ (F or F²) */
+  struct ElimTerm
+  {
+    const float *y;
+    const std::vector<float> &mat;
+    int row;
+  };
+  /* Subtracts from the sub-vectors of ‘d’ following the block ‘b’ the sum of
+     the given terms */
+  void eliminate(const Block &b, float *d, int depth,
+                 const std::vector<ElimTerm> &terms) const;
+
+  // Norms for what we consider zero on diagonal of F
+  static constexpr double diag_zero = 1.e-15;
+  static constexpr double diag_zero_sq = diag_zero*diag_zero;
+  /* Minimal length of the independent sub-vectors for which the work is
+     distributed to the thread pool */
+  static constexpr int par_min_length = 1024;
+  static bool parallel(int len);
+};
+
+#endif /* SINGLE_PRECISION_SYLVESTER_H */
@@ -54,7 +54,17 @@ SylvParams::print(std::ostream &fdesc, const std::string &prefix) const
       num_iter.print(fdesc, prefix,        "num iter           ");
     }
   else
-    eig_min.print(fdesc, prefix,         "minimum eigenvalue ");
+    {
+      eig_min.print(fdesc, prefix,         "minimum eigenvalue ");
+      mixed_precision.print(fdesc, prefix, "mixed precision    ");
+      if (*mixed_precision)
+        {
+          refine_tol.print(fdesc, prefix,      "refinement tol.    ");
+          max_refine_iter.print(fdesc, prefix, "max refine iter    ");
+          refine_iter.print(fdesc, prefix,     "num refine iter    ");
+          refine_err.print(fdesc, prefix,    u8"refined res. norm∞ ");
+        }
+    }
 
   mat_err1.print(fdesc, prefix,   "rel. matrix norm1  ");
   mat_errI.print(fdesc, prefix, u8"rel. matrix norm∞  ");
@@ -82,6 +92,16 @@ SylvParams::setArrayNames(int &num, const char **names) const
     names[num++] = "iter_last_norm";
   if (num_iter.getStatus() != status::undef)
     names[num++] = "num_iter";
+  if (mixed_precision.getStatus() != status::undef)
+    names[num++] = "mixed_precision";
+  if (max_refine_iter.getStatus() != status::undef)
+    names[num++] = "max_refine_iter";
+  if (refine_tol.getStatus() != status::undef)
+    names[num++] = "refine_tol";
+  if (refine_iter.getStatus() != status::undef)
+    names[num++] = "refine_iter";
+  if (refine_err.getStatus() != status::undef)
+    names[num++] = "refine_err";
   if (f_err1.getStatus() != status::undef)
     names[num++] = "f_err1";
   if (f_errI.getStatus() != status::undef)
@@ -183,6 +203,16 @@ SylvParams::createStructArray() const
     mxSetFieldByNumber(res, 0, i++, iter_last_norm.createMatlabArray());
   if (num_iter.getStatus() != status::undef)
     mxSetFieldByNumber(res, 0, i++, num_iter.createMatlabArray());
+  if (mixed_precision.getStatus() != status::undef)
+    mxSetFieldByNumber(res, 0, i++, mixed_precision.createMatlabArray());
+  if (max_refine_iter.getStatus() != status::undef)
+    mxSetFieldByNumber(res, 0, i++, max_refine_iter.createMatlabArray());
+  if (refine_tol.getStatus() != status::undef)
+    mxSetFieldByNumber(res, 0, i++, refine_tol.createMatlabArray());
+  if (refine_iter.getStatus() != status::undef)
+    mxSetFieldByNumber(res, 0, i++, refine_iter.createMatlabArray());
+  if (refine_err.getStatus() != status::undef)
+    mxSetFieldByNumber(res, 0, i++, refine_err.createMatlabArray());
   if (f_err1.getStatus() != status::undef)
     mxSetFieldByNumber(res, 0, i++, f_err1.createMatlabArray());
   if (f_errI.getStatus() != status::undef)
@@ -171,10 +171,15 @@ public:
   IntParamItem max_num_iter; // max number of iterations
   DoubleParamItem bs_norm; // Bavely Stewart log₁₀ of norm for diagonalization
   BoolParamItem want_check; // true => allocate extra space for checks
+  BoolParamItem mixed_precision; // true => single precision solve with refinement
+  IntParamItem max_refine_iter; // max number of refinement steps
+  DoubleParamItem refine_tol; // residual for what we consider refined
   // output parameters
   BoolParamItem converged; // true if converged
   DoubleParamItem iter_last_norm; // norm of the last iteration
   IntParamItem num_iter; // number of iterations
+  IntParamItem refine_iter; // number of refinement steps
+  DoubleParamItem refine_err; // rel. vector ∞ norm of the refined residual
   DoubleParamItem f_err1; // norm 1 of diagonalization abs. error C−V·F·V⁻¹
   DoubleParamItem f_errI; // norm ∞ of diagonalization abs. error C−V·F·V⁻¹
   DoubleParamItem viv_err1; // norm 1 of error I−V·V⁻¹
@@ -197,7 +202,8 @@ public:
 
   SylvParams(bool wc = false)
     : method(solve_method::recurse), convergence_tol(1.e-30), max_num_iter(15),
-      bs_norm(1.3), want_check(wc)
+      bs_norm(1.3), want_check(wc), mixed_precision(false), max_refine_iter(10),
+      refine_tol(1.e-14)
   {
   }
   SylvParams(const SylvParams &p) = default;
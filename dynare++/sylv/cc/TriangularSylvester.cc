@@ -22,15 +22,22 @@
 #include "QuasiTriangularZero.hh"
 #include "KronUtils.hh"
 #include "BlockDiagonal.hh"
+#include "ParallelTasks.hh"
+#include "sthread.hh"
 
 #include <iostream>
 #include <cmath>
+#include <vector>
+#include <algorithm>
+#include <utility>
 
 TriangularSylvester::TriangularSylvester(const QuasiTriangular &k,
                                          const QuasiTriangular &f)
   : SylvesterSolver(k, f),
     matrixKK{matrixK->square()},
-    matrixFF{matrixF->square()}
+    matrixFF{matrixF->square()},
+    packedK{*matrixK},
+    packedKK{*matrixKK}
 {
 }
 
@@ -38,7 +45,9 @@ TriangularSylvester::TriangularSylvester(const SchurDecompZero &kdecomp,
                                          const SchurDecomp &fdecomp)
   : SylvesterSolver(kdecomp, fdecomp),
     matrixKK{matrixK->square()},
-    matrixFF{matrixF->square()}
+    matrixFF{matrixF->square()},
+    packedK{*matrixK},
+    packedKK{*matrixKK}
 {
 }
 
@@ -46,7 +55,9 @@ TriangularSylvester::TriangularSylvester(const SchurDecompZero &kdecomp,
                                          const SimilarityDecomp &fdecomp)
   : SylvesterSolver(kdecomp, fdecomp),
     matrixKK{matrixK->square()},
-    matrixFF{matrixF->square()}
+    matrixFF{matrixF->square()},
+    packedK{*matrixK},
+    packedKK{*matrixKK}
 {
 }
 
@@ -67,14 +78,18 @@ TriangularSylvester::solve(SylvParams &pars, KronVector &d) const
   pars.eig_min = std::sqrt(eig_min);
 }
 
+bool
+TriangularSylvester::parallel(const ConstVector &v)
+{
+  return sthread::detach_thread_group::max_parallel_threads > 1
+    && v.length() >= par_min_length;
+}
+
 void
 TriangularSylvester::solvi(double r, KronVector &d, double &eig_min) const
 {
   if (d.getDepth() == 0)
-    {
-      auto t = matrixK->scale(r);
-      t->solvePre(d, eig_min);
-    }
+    packedK.solvePre(r, d.base(), eig_min);
   else
     {
       for (const_diag_iter di = matrixF->diag_begin();
@@ -95,8 +110,11 @@ TriangularSylvester::solvii(double alpha, double beta1, double beta2,
   KronVector d1tmp(d1);
   KronVector d2tmp(d2);
   linEval(alpha, beta1, beta2, d1, d2, d1tmp, d2tmp);
-  solviip(alpha, beta1*beta2, d1, eig_min);
-  solviip(alpha, beta1*beta2, d2, eig_min);
+  double eig_min1 = eig_min, eig_min2 = eig_min;
+  ParallelTasks::run({ [&] { solviip(alpha, beta1*beta2, d1, eig_min1); },
+                       [&] { solviip(alpha, beta1*beta2, d2, eig_min2); } },
+                     parallel(d1));
+  eig_min = std::min(eig_min1, eig_min2);
 }
 
 void
@@ -112,11 +130,7 @@ TriangularSylvester::solviip(double alpha, double betas,
     }
 
   if (d.getDepth() == 0)
-    {
-      double aspbs = alpha*alpha+betas;
-      auto t = matrixK->linearlyCombine(2*alpha, aspbs, *matrixKK);
-      t->solvePre(d, eig_min);
-    }
+    packedK.solvePre(2*alpha, alpha*alpha+betas, packedKK, d.base(), eig_min);
   else
     {
       const_diag_iter di = matrixF->diag_begin();
@@ -152,12 +166,15 @@ void
 TriangularSylvester::solviEliminateReal(const_diag_iter di, KronVector &d,
                                         const KronVector &y, double divisor) const
 {
+  std::vector<const_row_iter> row;
   for (const_row_iter ri = matrixF->row_begin(*di);
        ri != matrixF->row_end(*di); ++ri)
-    {
-      KronVector dk(d, ri.getCol());
-      dk.add(-(*ri)/divisor, y);
-    }
+    row.push_back(ri);
+  ParallelTasks::forRange(row.size(), parallel(y), [&](int i)
+                          {
+                            KronVector dk(d, row[i].getCol());
+                            dk.add(-(*row[i])/divisor, y);
+                          });
 }
 
 void
@@ -178,8 +195,9 @@ TriangularSylvester::solviComplexAndEliminate(double r, const_diag_iter di,
     solvii(r*alpha, r*beta1, r*beta2, dj, djj, eig_min);
   KronVector y1(dj);
   KronVector y2(djj);
-  KronUtils::multKron(*matrixF, *matrixK, y1);
-  KronUtils::multKron(*matrixF, *matrixK, y2);
+  ParallelTasks::run({ [&] { KronUtils::multKron(*matrixF, *matrixK, y1); },
+                       [&] { KronUtils::multKron(*matrixF, *matrixK, y2); } },
+                     parallel(y1));
   y1.mult(r);
   y2.mult(r);
   double divisor = 1.0;
@@ -191,13 +209,16 @@ TriangularSylvester::solviEliminateComplex(const_diag_iter di, KronVector &d,
                                            const KronVector &y1, const KronVector &y2,
                                            double divisor) const
 {
+  std::vector<const_row_iter> row;
   for (const_row_iter ri = matrixF->row_begin(*di);
        ri != matrixF->row_end(*di); ++ri)
-    {
-      KronVector dk(d, ri.getCol());
-      dk.add(-ri.a()/divisor, y1);
-      dk.add(-ri.b()/divisor, y2);
-    }
+    row.push_back(ri);
+  ParallelTasks::forRange(row.size(), parallel(y1), [&](int i)
+                          {
+                            KronVector dk(d, row[i].getCol());
+                            dk.add(-row[i].a()/divisor, y1);
+                            dk.add(-row[i].b()/divisor, y2);
+                          });
 }
 
 void
@@ -217,9 +238,10 @@ TriangularSylvester::solviipRealAndEliminate(double alpha, double betas,
     solviip(f*alpha, fs*betas, dj, eig_min);
   KronVector y1(const_cast<const KronVector &>(dj));
   KronVector y2(const_cast<const KronVector &>(dj));
-  KronUtils::multKron(*matrixF, *matrixK, y1);
+  ParallelTasks::run({ [&] { KronUtils::multKron(*matrixF, *matrixK, y1); },
+                       [&] { KronUtils::multKron(*matrixFF, *matrixKK, y2); } },
+                     parallel(y1));
   y1.mult(2*alpha);
-  KronUtils::multKron(*matrixFF, *matrixKK, y2);
   y2.mult(aspbs);
   double divisor = 1.0;
   double divisor2 = 1.0;
@@ -232,14 +254,17 @@ TriangularSylvester::solviipEliminateReal(const_diag_iter di, const_diag_iter ds
                                           const KronVector &y1, const KronVector &y2,
                                           double divisor, double divisor2) const
 {
+  std::vector<std::pair<const_row_iter, const_row_iter>> row;
   const_row_iter ri = matrixF->row_begin(*di);
   const_row_iter rsi = matrixFF->row_begin(*dsi);
   for (; ri != matrixF->row_end(*di); ++ri, ++rsi)
-    {
-      KronVector dk(d, ri.getCol());
-      dk.add(-(*ri)/divisor, y1);
-      dk.add(-(*rsi)/divisor2, y2);
-    }
+    row.emplace_back(ri, rsi);
+  ParallelTasks::forRange(row.size(), parallel(y1), [&](int i)
+                          {
+                            KronVector dk(d, row[i].first.getCol());
+                            dk.add(-(*row[i].first)/divisor, y1);
+                            dk.add(-(*row[i].second)/divisor2, y2);
+                          });
 }
 
 void
@@ -260,21 +285,18 @@ TriangularSylvester::solviipComplexAndEliminate(double alpha, double betas,
   if (gspds*aspbs > diag_zero_sq)
     solviipComplex(alpha, betas, gamma, delta1, delta2, dj, djj, eig_min);
   // here dj, djj is solution, set y1, y2, y11, y22
-  // y1
   KronVector y1(const_cast<const KronVector &>(dj));
-  KronUtils::multKron(*matrixF, *matrixK, y1);
-  y1.mult(2*alpha);
-  // y11
   KronVector y11(const_cast<const KronVector &>(djj));
-  KronUtils::multKron(*matrixF, *matrixK, y11);
-  y11.mult(2*alpha);
-  // y2
   KronVector y2(const_cast<const KronVector &>(dj));
-  KronUtils::multKron(*matrixFF, *matrixKK, y2);
-  y2.mult(aspbs);
-  // y22
   KronVector y22(const_cast<const KronVector &>(djj));
-  KronUtils::multKron(*matrixFF, *matrixKK, y22);
+  ParallelTasks::run({ [&] { KronUtils::multKron(*matrixF, *matrixK, y1); },
+                       [&] { KronUtils::multKron(*matrixF, *matrixK, y11); },
+                       [&] { KronUtils::multKron(*matrixFF, *matrixKK, y2); },
+                       [&] { KronUtils::multKron(*matrixFF, *matrixKK, y22); } },
+                     parallel(y1));
+  y1.mult(2*alpha);
+  y11.mult(2*alpha);
+  y2.mult(aspbs);
   y22.mult(aspbs);
 
   double divisor = 1.0;
@@ -297,10 +319,19 @@ TriangularSylvester::solviipComplex(double alpha, double betas, double gamma,
   double b1 = alpha*delta + gamma*beta;
   double a2 = alpha*gamma + beta*delta;
   double b2 = alpha*delta - gamma*beta;
-  solviip(a2, b2*b2, d1, eig_min);
-  solviip(a1, b1*b1, d1, eig_min);
-  solviip(a2, b2*b2, d2, eig_min);
-  solviip(a1, b1*b1, d2, eig_min);
+  double eig_min1 = eig_min, eig_min2 = eig_min;
+  ParallelTasks::run({ [&]
+                       {
+                         solviip(a2, b2*b2, d1, eig_min1);
+                         solviip(a1, b1*b1, d1, eig_min1);
+                       },
+                       [&]
+                       {
+                         solviip(a2, b2*b2, d2, eig_min2);
+                         solviip(a1, b1*b1, d2, eig_min2);
+                       } },
+                     parallel(d1));
+  eig_min = std::min(eig_min1, eig_min2);
 }
 
 void
@@ -310,16 +341,19 @@ TriangularSylvester::solviipEliminateComplex(const_diag_iter di, const_diag_iter
                                              const KronVector &y2, const KronVector &y22,
                                              double divisor) const
 {
+  std::vector<std::pair<const_row_iter, const_row_iter>> row;
   const_row_iter ri = matrixF->row_begin(*di);
   const_row_iter rsi = matrixFF->row_begin(*dsi);
   for (; ri != matrixF->row_end(*di); ++ri, ++rsi)
-    {
-      KronVector dk(d, ri.getCol());
-      dk.add(-ri.a()/divisor, y1);
-      dk.add(-ri.b()/divisor, y11);
-      dk.add(-rsi.a()/divisor, y2);
-      dk.add(-rsi.b()/divisor, y22);
-    }
+    row.emplace_back(ri, rsi);
+  ParallelTasks::forRange(row.size(), parallel(y1), [&](int i)
+                          {
+                            KronVector dk(d, row[i].first.getCol());
+                            dk.add(-row[i].first.a()/divisor, y1);
+                            dk.add(-row[i].first.b()/divisor, y11);
+                            dk.add(-row[i].second.a()/divisor, y2);
+                            dk.add(-row[i].second.b()/divisor, y22);
+                          });
 }
 
 void
@@ -329,8 +363,9 @@ TriangularSylvester::linEval(double alpha, double beta1, double beta2,
 {
   KronVector d1tmp(d1); // make copy
   KronVector d2tmp(d2); // make copy
-  KronUtils::multKron(*matrixF, *matrixK, d1tmp);
-  KronUtils::multKron(*matrixF, *matrixK, d2tmp);
+  ParallelTasks::run({ [&] { KronUtils::multKron(*matrixF, *matrixK, d1tmp); },
+                       [&] { KronUtils::multKron(*matrixF, *matrixK, d2tmp); } },
+                     parallel(d1tmp));
   x1 = d1;
   x2 = d2;
   Vector::mult2a(alpha, beta1, -beta2, x1, x2, d1tmp, d2tmp);
@@ -344,16 +379,18 @@ TriangularSylvester::quaEval(double alpha, double betas,
 {
   KronVector d1tmp(d1); // make copy
   KronVector d2tmp(d2); // make copy
-  KronUtils::multKron(*matrixF, *matrixK, d1tmp);
-  KronUtils::multKron(*matrixF, *matrixK, d2tmp);
+  ParallelTasks::run({ [&] { KronUtils::multKron(*matrixF, *matrixK, d1tmp); },
+                       [&] { KronUtils::multKron(*matrixF, *matrixK, d2tmp); } },
+                     parallel(d1tmp));
   x1 = d1;
   x2 = d2;
   Vector::mult2a(2*alpha*gamma, 2*alpha*delta1, -2*alpha*delta2,
                  x1, x2, d1tmp, d2tmp);
   d1tmp = d1; // restore to d1
   d2tmp = d2; // restore to d2
-  KronUtils::multKron(*matrixFF, *matrixKK, d1tmp);
-  KronUtils::multKron(*matrixFF, *matrixKK, d2tmp);
+  ParallelTasks::run({ [&] { KronUtils::multKron(*matrixFF, *matrixKK, d1tmp); },
+                       [&] { KronUtils::multKron(*matrixFF, *matrixKK, d2tmp); } },
+                     parallel(d1tmp));
   double aspbs = alpha*alpha + betas;
   double gspds = gamma*gamma - delta1*delta2;
   Vector::mult2a(aspbs*gspds, 2*aspbs*gamma*delta1, -2*aspbs*gamma*delta2,
@@ -26,13 +26,25 @@
 #include "QuasiTriangular.hh"
 #include "QuasiTriangularZero.hh"
 #include "SimilarityDecomp.hh"
+#include "PackedQuasiTriangular.hh"
 
 #include <memory>
 
+/* The solver recurses over the diagonal blocks of F. At a given level, the
+   diagonal blocks must be solved in sequence, but the elimination of a solved
+   block from the remaining sub-vectors, the Kronecker products needed for it,
+   and the two independent systems of a complex block are run in parallel on
+   the thread pool when the sub-vectors are long enough. Every sub-vector
+   undergoes the same operations in the same order as in the sequential
+   solver, so that the results do not depend on the number of threads. */
+
 class TriangularSylvester : public SylvesterSolver
 {
   const std::unique_ptr<const QuasiTriangular> matrixKK;
   const std::unique_ptr<const QuasiTriangular> matrixFF;
+  // K and K² packed for the systems at the bottom of the recursion
+  const PackedQuasiTriangular<double> packedK;
+  const PackedQuasiTriangular<double> packedKK;
 public:
   TriangularSylvester(const QuasiTriangular &k, const QuasiTriangular &f);
   TriangularSylvester(const SchurDecompZero &kdecomp, const SchurDecomp &fdecomp);
@@ -128,6 +140,10 @@ private:
   // Norms for what we consider zero on diagonal of F
   static constexpr double diag_zero = 1.e-15;
   static constexpr double diag_zero_sq = diag_zero*diag_zero;
+  /* Minimal length of the independent sub-vectors for which the work is
+     distributed to the thread pool */
+  static constexpr int par_min_length = 1024;
+  static bool parallel(const ConstVector &v);
 };
 
 #endif /* TRIANGULAR_SYLVESTER_H */
@@ -31,13 +31,13 @@
 #include <iomanip>
 
 Vector::Vector(const Vector &v)
-  : len(v.len), data{new double[len]}
+  : len(v.len), data{MemoryArena::allocate(len, chunk)}
 {
   copy(v.data, v.s);
 }
 
 Vector::Vector(const ConstVector &v)
-  : len(v.len), data{new double[len]}
+  : len(v.len), data{MemoryArena::allocate(len, chunk)}
 {
   copy(v.data, v.s);
 }
@@ -102,7 +102,7 @@ Vector::Vector(Vector &v, int off_arg, int l)
 }
 
 Vector::Vector(const Vector &v, int off_arg, int l)
-  : len(l), data{new double[len]}
+  : len(l), data{MemoryArena::allocate(len, chunk)}
 {
   if (off_arg < 0 || off_arg + len > v.len)
     throw SYLV_MES_EXCEPTION("Subvector not contained in supvector.");
@@ -115,7 +115,7 @@ Vector::Vector(Vector &v, int off_arg, int skip, int l)
 }
 
 Vector::Vector(const Vector &v, int off_arg, int skip, int l)
-  : len(l), data{new double[len]}
+  : len(l), data{MemoryArena::allocate(len, chunk)}
 {
   copy(v.data+off_arg*v.s, v.s*skip);
 }
@@ -25,6 +25,8 @@
    to avoid running virtual method invokation mechanism. Some
    members, and methods are thus duplicated */
 
+#include "MemoryArena.hh"
+
 #include <complex>
 #include <utility>
 
@@ -41,13 +43,14 @@ class Vector
 protected:
   int len{0};
   int s{1}; // stride (also called “skip” in some places)
+  MemoryArena::Chunk *chunk{nullptr}; // arena chunk holding the data, if any
   double *data;
   bool destroy{true};
 public:
   Vector() : data{nullptr}, destroy{false}
   {
   }
-  Vector(int l) : len{l}, data{new double[l]}
+  Vector(int l) : len{l}, data{MemoryArena::allocate(l, chunk)}
   {
   }
   Vector(Vector &v) : len{v.len}, s{v.s}, data{v.data}, destroy{false}
@@ -55,6 +58,7 @@ public:
   }
   Vector(const Vector &v);
   Vector(Vector &&v) : len{std::exchange(v.len, 0)}, s{v.s},
+                       chunk{std::exchange(v.chunk, nullptr)},
                        data{std::exchange(v.data, nullptr)},
                        destroy{std::exchange(v.destroy, false)}
   {
@@ -118,7 +122,7 @@ public:
   virtual ~Vector()
   {
     if (destroy)
-      delete[] data;
+      MemoryArena::deallocate(data, len, chunk);
   }
   void zeros();
   void nans();
@@ -0,0 +1,182 @@
+%%MatrixMarket matrix array real general
+20 9
+ 4.06
+ 1.86
+ 2.67
+ 4.05
+-2.40
+ 1.36
+ 4.05
+ 3.72
+ 0.73
+-3.31
+-0.88
+ 4.94
+-3.97
+-1.81
+ 4.50
+-0.51
+-2.91
+-1.83
+ 4.09
+-1.64
+-0.73
+ 1.28
+ 3.06
+-0.08
+-4.19
+ 0.73
+-4.65
+-4.05
+-3.10
+ 1.93
+-2.17
+ 1.90
+-3.37
+-3.82
+-4.77
+ 2.06
+ 3.59
+-2.80
+-2.62
+-4.87
+ 1.45
+-1.99
+-3.63
+ 1.47
+ 1.00
+-0.53
+-3.47
+ 1.39
+ 0.56
+-0.67
+-3.35
+ 4.29
+ 3.63
+ 1.90
+ 4.96
+ 0.80
+-1.55
+-3.84
+ 1.08
+ 0.19
+-0.64
+ 4.93
+ 3.39
+-3.85
+ 3.84
+-4.98
+ 1.51
+-1.85
+ 2.30
+ 4.53
+ 0.30
+ 2.63
+-4.46
+ 1.67
+-3.82
+-0.45
+-1.66
+-4.27
+ 2.47
+-4.07
+-2.43
+-4.14
+ 1.62
+-1.99
+-4.56
+-4.73
+-2.80
+ 0.07
+-4.88
+-4.76
+ 1.67
+ 0.27
+-3.65
+-1.88
+-3.74
+-2.25
+-1.12
+-2.82
+-3.02
+-2.74
+-1.99
+ 0.55
+ 3.86
+ 1.48
+-0.51
+-4.97
+-3.11
+ 1.34
+-0.95
+ 3.47
+ 4.09
+-2.04
+-1.36
+-2.02
+ 1.76
+-4.01
+-2.24
+ 3.79
+-1.27
+ 4.70
+-1.04
+ 3.37
+-0.37
+-4.01
+ 0.78
+-2.89
+ 4.18
+ 2.01
+ 0.29
+ 4.23
+ 0.47
+ 4.67
+ 2.15
+-3.21
+-2.06
+ 3.46
+-4.00
+ 4.82
+-4.59
+ 2.50
+ 1.18
+-0.94
+ 1.01
+ 0.82
+-1.40
+-2.17
+-4.50
+ 1.55
+ 3.81
+-1.24
+ 3.58
+-1.03
+-2.46
+ 3.01
+ 4.26
+-4.08
+ 3.71
+-1.81
+ 2.74
+-2.07
+ 4.90
+-1.63
+-2.93
+-4.48
+-3.65
+-4.09
+ 3.20
+-4.80
+-3.82
+-2.60
+-3.58
+ 2.76
+-4.93
+ 1.81
+-1.50
+-3.53
+-2.70
+ 0.26
+-2.53
+-1.09
@@ -25,12 +25,15 @@
 #include "KronVector.hh"
 #include "KronUtils.hh"
 #include "TriangularSylvester.hh"
+#include "PackedQuasiTriangular.hh"
 #include "GeneralSylvester.hh"
 #include "SchurDecompEig.hh"
 #include "SimilarityDecomp.hh"
 #include "IterativeSylvester.hh"
 #include "SylvMatrix.hh"
+#include "MappedStorage.hh"
 #include "int_power.hh"
+#include "sthread.hh"
 
 #include "MMMatrix.hh"
 
@@ -41,6 +44,7 @@
 #include <iostream>
 #include <iomanip>
 #include <memory>
+#include <vector>
 
 class TestRunnable
 {
@@ -56,12 +60,15 @@ public:
 protected:
   // declaration of auxiliary static methods
   static bool quasi_solve(bool trans, const std::string &mname, const std::string &vname);
+  static bool packed_solve(const std::string &mname, const std::string &vname);
   static bool mult_kron(bool trans, const std::string &mname, const std::string &vname,
                         const std::string &cname, int m, int n, int depth);
   static bool level_kron(bool trans, const std::string &mname, const std::string &vname,
                          const std::string &cname, int level, int m, int n, int depth);
   static bool kron_power(const std::string &m1name, const std::string &m2name, const std::string &vname,
                          const std::string &cname, int m, int n, int depth);
+  static bool kron_bench(const std::string &m1name, const std::string &m2name, const std::string &vname,
+                         int m, int n, int depth, int nrep);
   static bool lin_eval(const std::string &m1name, const std::string &m2name, const std::string &vname,
                        const std::string &cname, int m, int n, int depth,
                        double alpha, double beta1, double beta2);
@@ -71,12 +78,19 @@ protected:
                        double delta1, double delta2);
   static bool tri_sylv(const std::string &m1name, const std::string &m2name, const std::string &vname,
                        int m, int n, int depth);
+  static bool tri_sylv_par(const std::string &m1name, const std::string &m2name, const std::string &vname,
+                           int m, int n, int depth, int nthreads);
   static bool gen_sylv(const std::string &aname, const std::string &bname, const std::string &cname,
                        const std::string &dname, int m, int n, int order);
+  static bool gen_sylv_batch(const std::string &aname, const std::string &bname, const std::string &cname,
+                             const std::string &dname, int m, int n, int order, int nrhs);
+  static bool gen_sylv_mixed(const std::string &aname, const std::string &bname, const std::string &cname,
+                             const std::string &dname, int m, int n, int order);
   static bool eig_bubble(const std::string &aname, int from, int to);
   static bool block_diag(const std::string &aname, double log10norm = 3.0);
   static bool iter_sylv(const std::string &m1name, const std::string &m2name, const std::string &vname,
                         int m, int n, int depth);
+  static bool mapped_storage(int rows, int cols);
 };
 
 bool
@@ -142,6 +156,60 @@ TestRunnable::quasi_solve(bool trans, const std::string &mname, const std::strin
   return (norm < eps_norm);
 }
 
+/* Compares the multiplication and the solution of (I+c₁·T+c₂·T²)·x=v by
+   PackedQuasiTriangular with those of QuasiTriangular, in double and single
+   precision */
+
+bool
+TestRunnable::packed_solve(const std::string &mname, const std::string &vname)
+{
+  MMMatrixIn mmt(mname);
+  MMMatrixIn mmv(vname);
+
+  std::unique_ptr<QuasiTriangular> t;
+  if (mmt.row() == mmt.col())
+    t = std::make_unique<QuasiTriangular>(mmt.getData(), mmt.row());
+  else if (mmt.row() > mmt.col())
+    t = std::make_unique<QuasiTriangularZero>(mmt.row()-mmt.col(), mmt.getData(), mmt.col());
+  else
+    {
+      std::cout << "  Wrong quasi triangular dimensions, rows must be >= cols.\n";
+      return false;
+    }
+  auto tsq = t->square();
+  PackedQuasiTriangular<double> pt(*t), ptsq(*tsq);
+  PackedQuasiTriangular<float> pf(*t), pfsq(*tsq);
+  ConstVector v{mmv.getData()};
+  int n = v.length();
+
+  Vector x(n), xp(n);
+  t->multVec(x, v);
+  pt.multVec(xp.base(), v.base());
+  xp.add(-1.0, x);
+  double mult_norm = xp.getNorm();
+  std::cout << "\tmult error norm = " << mult_norm << std::endl;
+
+  const double c1 = 0.7, c2 = 0.3;
+  double eig_min = 1.0e20, eig_minp = 1.0e20, eig_minf = 1.0e20;
+  t->linearlyCombine(c1, c2, *tsq)->solve(x, v, eig_min);
+  xp = v;
+  pt.solvePre(c1, c2, ptsq, xp.base(), eig_minp);
+  std::vector<float> xf(v.base(), v.base()+n);
+  pf.solvePre(c1, c2, pfsq, xf.data(), eig_minf);
+  Vector xfd(n);
+  for (int i = 0; i < n; i++)
+    xfd[i] = xf[i];
+  xp.add(-1.0, x);
+  xfd.add(-1.0, x);
+  double solve_err = xp.getNorm()/x.getNorm();
+  double solve_errf = xfd.getNorm()/x.getNorm();
+  std::cout << "eig_min = " << eig_min << ", packed eig_min = " << eig_minp << std::endl
+            << "\trel. solve error norm = " << solve_err << std::endl
+            << "\trel. solve error norm in single precision = " << solve_errf << std::endl;
+  return (mult_norm < eps_norm && solve_err < eps_norm && solve_errf < 1.0e-4
+          && std::abs(eig_min-eig_minp) < eps_norm*eig_min);
+}
+
 bool
 TestRunnable::mult_kron(bool trans, const std::string &mname, const std::string &vname,
                         const std::string &cname, int m, int n, int depth)
@@ -251,6 +319,72 @@ TestRunnable::kron_power(const std::string &m1name, const std::string &m2name, c
   return (norm < eps_norm);
 }
 
+/* Compares KronUtils::multKron() with the product computed level by level
+   with multAtLevel() and multAtLevelTrans(), and reports the timings of both
+   over ‘nrep’ repetitions. Only the upper triangles of the matrices are used,
+   so that any square matrix can be given. */
+bool
+TestRunnable::kron_bench(const std::string &m1name, const std::string &m2name, const std::string &vname,
+                         int m, int n, int depth, int nrep)
+{
+  MMMatrixIn mmt1(m1name);
+  MMMatrixIn mmt2(m2name);
+  MMMatrixIn mmv(vname);
+
+  int length = power(m, depth)*n;
+  if (mmt1.row() != m
+      || mmt2.row() != n
+      || mmv.size() != length)
+    {
+      std::cout << "  Incompatible sizes for kron power benchmark, len=" << length
+                << ", row1=" << mmt1.row() << ", row2=" << mmt2.row()
+                << ", m=" << m << ", n=" << n
+                << ", vsize=" << mmv.size()
+                << std::endl;
+      return false;
+    }
+
+  auto upper = [](MMMatrixIn &mm)
+                {
+                  Vector d{mm.getData()};
+                  for (int j = 0; j < mm.row(); j++)
+                    for (int i = j+1; i < mm.row(); i++)
+                      d[i+j*mm.row()] = 0.0;
+                  return QuasiTriangular(d, mm.row());
+                };
+  QuasiTriangular t1 = upper(mmt1);
+  QuasiTriangular t2 = upper(mmt2);
+  Vector vraw{mmv.getData()};
+  ConstKronVector v(vraw, m, n, depth);
+
+  KronVector xlev(v);
+  clock_t start = clock();
+  for (int i = 0; i < nrep; i++)
+    {
+      xlev = v;
+      KronUtils::multAtLevel(0, t2, xlev);
+      for (int level = 1; level <= depth; level++)
+        KronUtils::multAtLevelTrans(level, t1, xlev);
+    }
+  double tlev = static_cast<double>(clock()-start)/CLOCKS_PER_SEC;
+
+  KronVector x(v);
+  start = clock();
+  for (int i = 0; i < nrep; i++)
+    {
+      x = v;
+      KronUtils::multKron(t1, t2, x);
+    }
+  double tblock = static_cast<double>(clock()-start)/CLOCKS_PER_SEC;
+
+  std::cout << "\tlevel by level: " << tlev << " s, blocked: " << tblock
+            << " s (" << nrep << " repetitions)" << std::endl;
+  x.add(-1, xlev);
+  double norm = x.getNorm();
+  std::cout << "\terror norm = " << norm << std::endl;
+  return (norm < eps_norm*xlev.getNorm());
+}
+
 bool
 TestRunnable::lin_eval(const std::string &m1name, const std::string &m2name, const std::string &vname,
                        const std::string &cname, int m, int n, int depth,
@@ -387,6 +521,43 @@ TestRunnable::tri_sylv(const std::string &m1name, const std::string &m2name, con
   return (norm < xnorm*eps_norm);
 }
 
+/* Solves the system sequentially and with ‘nthreads’ threads, and checks that
+   the results are identical */
+bool
+TestRunnable::tri_sylv_par(const std::string &m1name, const std::string &m2name, const std::string &vname,
+                           int m, int n, int depth, int nthreads)
+{
+  MMMatrixIn mmt1(m1name);
+  MMMatrixIn mmt2(m2name);
+  MMMatrixIn mmv(vname);
+
+  QuasiTriangular t1(mmt1.getData(), mmt1.row());
+  QuasiTriangular t2(mmt2.getData(), mmt2.row());
+  TriangularSylvester ts(t2, t1);
+  Vector vraw{mmv.getData()};
+  ConstKronVector v(vraw, m, n, depth);
+
+  int old_threads = sthread::detach_thread_group::max_parallel_threads;
+  KronVector dseq(v);
+  SylvParams pseq;
+  sthread::detach_thread_group::max_parallel_threads = 1;
+  ts.solve(pseq, dseq);
+  KronVector dpar(v);
+  SylvParams ppar;
+  sthread::detach_thread_group::max_parallel_threads = nthreads;
+  ts.solve(ppar, dpar);
+  sthread::detach_thread_group::max_parallel_threads = old_threads;
+
+  int ndiff = 0;
+  for (int i = 0; i < dseq.length(); i++)
+    if (dseq[i] != dpar[i])
+      ndiff++;
+  std::cout << "\tnumber of differing elements = " << ndiff << std::endl;
+  std::cout << "\teig_min sequential = " << *(pseq.eig_min)
+            << ", parallel = " << *(ppar.eig_min) << std::endl;
+  return ndiff == 0 && *(pseq.eig_min) == *(ppar.eig_min);
+}
+
 bool
 TestRunnable::gen_sylv(const std::string &aname, const std::string &bname, const std::string &cname,
                        const std::string &dname, int m, int n, int order)
@@ -419,6 +590,115 @@ TestRunnable::gen_sylv(const std::string &aname, const std::string &bname, const
           && *(pars.vec_errI) < eps_norm);
 }
 
+/* Solves the equation for ‘nrhs’ multiples of D with one decomposition and
+   concurrently, and checks that the solutions are identical to those of
+   separate GeneralSylvester objects */
+bool
+TestRunnable::gen_sylv_batch(const std::string &aname, const std::string &bname, const std::string &cname,
+                             const std::string &dname, int m, int n, int order, int nrhs)
+{
+  MMMatrixIn mma(aname);
+  MMMatrixIn mmb(bname);
+  MMMatrixIn mmc(cname);
+  MMMatrixIn mmd(dname);
+
+  if (m != mmc.row() || m != mmc.col()
+      || n != mma.row() || n != mma.col()
+      || n != mmb.row() || n < mmb.col()
+      || n != mmd.row() || power(m, order) != mmd.col())
+    {
+      std::cout << "  Incompatible sizes for gen_sylv_batch.\n";
+      return false;
+    }
+
+  GeneralSylvesterDecomp decomp(n, m, n-mmb.col(),
+                                mma.getData(), mmb.getData(),
+                                mmc.getData(), SylvParams(true));
+  std::vector<Vector> ds;
+  for (int k = 0; k < nrhs; k++)
+    {
+      ds.emplace_back(ConstVector{mmd.getData()});
+      ds.back().mult(k+1.0);
+    }
+  std::vector<Vector> xs(ds);
+  std::vector<Vector *> xptrs;
+  for (auto &x : xs)
+    xptrs.push_back(&x);
+
+  int old_threads = sthread::detach_thread_group::max_parallel_threads;
+  sthread::detach_thread_group::max_parallel_threads = 4;
+  decomp.solve(order, xptrs);
+  sthread::detach_thread_group::max_parallel_threads = old_threads;
+
+  int ndiff = 0;
+  for (int k = 0; k < nrhs; k++)
+    {
+      GeneralSylvester gs(order, n, m, n-mmb.col(),
+                          mma.getData(), mmb.getData(),
+                          mmc.getData(), ConstVector{ds[k]});
+      gs.solve();
+      for (int i = 0; i < xs[k].length(); i++)
+        if (xs[k][i] != gs.getResult()[i])
+          ndiff++;
+    }
+  std::cout << "\tnumber of differing elements = " << ndiff << std::endl;
+
+  SylvParams pars(decomp.getParams());
+  decomp.check(order, xs[nrhs-1], ds[nrhs-1], pars);
+  pars.print("\t");
+  return (ndiff == 0 && *(pars.mat_err1) < eps_norm && *(pars.mat_errI) < eps_norm
+          && *(pars.mat_errF) < eps_norm && *(pars.vec_err1) < eps_norm
+          && *(pars.vec_errI) < eps_norm);
+}
+
+/* Solves the equation in single precision with iterative refinement, and
+   compares the solution with the one computed in double precision */
+bool
+TestRunnable::gen_sylv_mixed(const std::string &aname, const std::string &bname, const std::string &cname,
+                             const std::string &dname, int m, int n, int order)
+{
+  MMMatrixIn mma(aname);
+  MMMatrixIn mmb(bname);
+  MMMatrixIn mmc(cname);
+  MMMatrixIn mmd(dname);
+
+  if (m != mmc.row() || m != mmc.col()
+      || n != mma.row() || n != mma.col()
+      || n != mmb.row() || n < mmb.col()
+      || n != mmd.row() || power(m, order) != mmd.col())
+    {
+      std::cout << "  Incompatible sizes for gen_sylv_mixed.\n";
+      return false;
+    }
+
+  SylvParams ps(true);
+  ps.mixed_precision = true;
+  GeneralSylvester gs(order, n, m, n-mmb.col(),
+                      mma.getData(), mmb.getData(),
+                      mmc.getData(), mmd.getData(),
+                      ps);
+  gs.solve();
+  gs.check(mmd.getData());
+  const SylvParams &pars = gs.getParams();
+  pars.print("\t");
+
+  GeneralSylvester gsd(order, n, m, n-mmb.col(),
+                       mma.getData(), mmb.getData(),
+                       mmc.getData(), mmd.getData());
+  gsd.solve();
+  ConstVector x(gs.getResult(), mmd.row()*mmd.col());
+  Vector diff(ConstVector(gsd.getResult(), mmd.row()*mmd.col()));
+  double xmax = diff.getMax();
+  diff.add(-1.0, x);
+  double rel_diff = diff.getMax()/xmax;
+  std::cout << u8"\trel. ∞ difference to double precision = " << rel_diff << std::endl;
+
+  return (*(pars.refine_err) < eps_norm && rel_diff < eps_norm
+          && *(pars.mat_err1) < eps_norm && *(pars.mat_errI) < eps_norm
+          && *(pars.mat_errF) < eps_norm && *(pars.vec_err1) < eps_norm
+          && *(pars.vec_errI) < eps_norm);
+}
+
 bool
 TestRunnable::eig_bubble(const std::string &aname, int from, int to)
 {
@@ -537,6 +817,50 @@ TestRunnable::iter_sylv(const std::string &m1name, const std::string &m2name, co
   return (cnorm < xnorm*eps_norm);
 }
 
+bool
+TestRunnable::mapped_storage(int rows, int cols)
+{
+  if (!MappedStorage::setup(".", sizeof(double)*rows*cols))
+    {
+      std::cout << "\tcannot set up mapped storage in current directory\n";
+      return false;
+    }
+  int fails = 0;
+  {
+    GeneralMatrix small(rows, cols-1);
+    if (MappedStorage::numMappings() != 0)
+      fails++;
+    GeneralMatrix big(rows, cols);
+    if (MappedStorage::numMappings() != 1)
+      fails++;
+    for (int j = 0; j < cols; j++)
+      for (int i = 0; i < rows; i++)
+        big.get(i, j) = i-2.0*j;
+    GeneralMatrix copy(big);
+    if (MappedStorage::numMappings() != 2)
+      fails++;
+    copy.add(-1.0, big);
+    if (copy.getData().getMax() != 0.0 || big.get(rows-1, cols-1) != rows-1-2.0*(cols-1))
+      fails++;
+  }
+  if (MappedStorage::numMappings() != 0)
+    fails++;
+  {
+    // Within an arena scope, the large matrix must not be taken from the arena
+    MemoryArenaScope scope;
+    GeneralMatrix small(rows, cols-1);
+    GeneralMatrix big(rows, cols);
+    if (MappedStorage::numMappings() != 1)
+      fails++;
+  }
+  if (MappedStorage::numMappings() != 0)
+    fails++;
+  MappedStorage::setup("", 0);
+
+  std::cout << "\tnumber of failures = " << fails << '\n';
+  return fails == 0;
+}
+
 /**********************************************************/
 /*   sub classes declarations                             */
 /**********************************************************/
@@ -613,6 +937,24 @@ public:
   bool run() const override;
 };
 
+class PackedQuasiTrLargeTest : public TestRunnable
+{
+public:
+  PackedQuasiTrLargeTest() : TestRunnable("packed quasi triangular solve large (250)")
+  {
+  }
+  bool run() const override;
+};
+
+class PackedQuasiZeroSmallTest : public TestRunnable
+{
+public:
+  PackedQuasiZeroSmallTest() : TestRunnable(u8"packed quasi tr. zero small test (2×1)")
+  {
+  }
+  bool run() const override;
+};
+
 class QuasiZeroSmallTest : public TestRunnable
 {
 public:
@@ -703,6 +1045,24 @@ public:
   bool run() const override;
 };
 
+class KronBenchTest : public TestRunnable
+{
+public:
+  KronBenchTest() : TestRunnable(u8"kronecker power mult benchmark (48000=40×40×30)")
+  {
+  }
+  bool run() const override;
+};
+
+class KronBenchGenTest : public TestRunnable
+{
+public:
+  KronBenchGenTest() : TestRunnable(u8"kronecker power mult benchmark (12000=20×20×30)")
+  {
+  }
+  bool run() const override;
+};
+
 class SmallLinEvalTest : public TestRunnable
 {
 public:
@@ -784,6 +1144,15 @@ public:
   bool run() const override;
 };
 
+class TriSylvParallelTest : public TestRunnable
+{
+public:
+  TriSylvParallelTest() : TestRunnable(u8"triangular sylvester parallel solve (48000=40×40×30)")
+  {
+  }
+  bool run() const override;
+};
+
 class IterSylvTest : public TestRunnable
 {
 public:
@@ -811,6 +1180,33 @@ public:
   bool run() const override;
 };
 
+class GenSylvBatchTest : public TestRunnable
+{
+public:
+  GenSylvBatchTest() : TestRunnable(u8"general sylvester batched solve (4×12000=20×20×30)")
+  {
+  }
+  bool run() const override;
+};
+
+class GenSylvMixedTest : public TestRunnable
+{
+public:
+  GenSylvMixedTest() : TestRunnable(u8"general sylvester mixed precision solve (12000=20×20×30)")
+  {
+  }
+  bool run() const override;
+};
+
+class GenSylvMixedZeroTest : public TestRunnable
+{
+public:
+  GenSylvMixedZeroTest() : TestRunnable(u8"general sylvester mixed precision solve with zero columns (180=20×3×3)")
+  {
+  }
+  bool run() const override;
+};
+
 class GenSylvTest : public TestRunnable
 {
 public:
@@ -903,6 +1299,15 @@ public:
   bool run() const override;
 };
 
+class MappedStorageTest : public TestRunnable
+{
+public:
+  MappedStorageTest() : TestRunnable(u8"mapped storage test (300×700)")
+  {
+  }
+  bool run() const override;
+};
+
 /**********************************************************/
 /*   run methods of sub classes                           */
 /**********************************************************/
@@ -961,6 +1366,18 @@ QuasiZeroSmallTest::run() const
   return quasi_solve(false, "b2x1.mm", "v2.mm");
 }
 
+bool
+PackedQuasiTrLargeTest::run() const
+{
+  return packed_solve("qt250x250.mm", "v250.mm");
+}
+
+bool
+PackedQuasiZeroSmallTest::run() const
+{
+  return packed_solve("b2x1.mm", "v2.mm");
+}
+
 bool
 MultKronSmallTest::run() const
 {
@@ -1015,6 +1432,18 @@ KronPowerTest::run() const
   return kron_power("qt7x7.mm", "tr5x5.mm", "v1715.mm", "vcheck1715d.mm", 7, 5, 3);
 }
 
+bool
+KronBenchTest::run() const
+{
+  return kron_bench("qt40x40.mm", "qt30x30.mm", "v48000.mm", 40, 30, 2, 100);
+}
+
+bool
+KronBenchGenTest::run() const
+{
+  return kron_bench("c20x20.mm", "a30x30.mm", "d30x400.mm", 20, 30, 2, 400);
+}
+
 bool
 SmallLinEvalTest::run() const
 {
@@ -1073,6 +1502,12 @@ TriSylvLargeTest::run() const
   return tri_sylv("qt40x40.mm", "qt30x30eig011-095.mm", "v1920000.mm", 40, 30, 3);
 }
 
+bool
+TriSylvParallelTest::run() const
+{
+  return tri_sylv_par("qt40x40.mm", "qt30x30eig011-095.mm", "v48000.mm", 40, 30, 2, 4);
+}
+
 bool
 IterSylvTest::run() const
 {
@@ -1091,12 +1526,30 @@ GenSylvSmallTest::run() const
   return gen_sylv("a2x2.mm", "b2x1.mm", "c3x3.mm", "d2x9.mm", 3, 2, 2);
 }
 
+bool
+GenSylvBatchTest::run() const
+{
+  return gen_sylv_batch("a30x30.mm", "b30x25.mm", "c20x20.mm", "d30x400.mm", 20, 30, 2, 4);
+}
+
 bool
 GenSylvTest::run() const
 {
   return gen_sylv("a30x30.mm", "b30x25.mm", "c20x20.mm", "d30x400.mm", 20, 30, 2);
 }
 
+bool
+GenSylvMixedTest::run() const
+{
+  return gen_sylv_mixed("a30x30.mm", "b30x25.mm", "c20x20.mm", "d30x400.mm", 20, 30, 2);
+}
+
+bool
+GenSylvMixedZeroTest::run() const
+{
+  return gen_sylv_mixed("a20x20.mm", "b20x4.mm", "c3x3.mm", "d20x9.mm", 3, 20, 2);
+}
+
 bool
 GenSylvSingTest::run() const
 {
@@ -1151,6 +1604,12 @@ BlockDiagBigTest::run() const
   return block_diag("c50x50.mm", 1.3);
 }
 
+bool
+MappedStorageTest::run() const
+{
+  return mapped_storage(300, 700);
+}
+
 /**********************************************************/
 /*   main                                                 */
 /**********************************************************/
@@ -1169,6 +1628,8 @@ main()
   all_tests.push_back(std::make_unique<QuasiTrLargeTest>());
   all_tests.push_back(std::make_unique<QuasiTrLargeTransTest>());
   all_tests.push_back(std::make_unique<QuasiZeroSmallTest>());
+  all_tests.push_back(std::make_unique<PackedQuasiTrLargeTest>());
+  all_tests.push_back(std::make_unique<PackedQuasiZeroSmallTest>());
   all_tests.push_back(std::make_unique<MultKronSmallTest>());
   all_tests.push_back(std::make_unique<MultKronTest>());
   all_tests.push_back(std::make_unique<MultKronSmallTransTest>());
@@ -1178,6 +1639,8 @@ main()
   all_tests.push_back(std::make_unique<LevelZeroKronTest>());
   all_tests.push_back(std::make_unique<LevelZeroKronTransTest>());
   all_tests.push_back(std::make_unique<KronPowerTest>());
+  all_tests.push_back(std::make_unique<KronBenchTest>());
+  all_tests.push_back(std::make_unique<KronBenchGenTest>());
   all_tests.push_back(std::make_unique<SmallLinEvalTest>());
   all_tests.push_back(std::make_unique<LinEvalTest>());
   all_tests.push_back(std::make_unique<SmallQuaEvalTest>());
@@ -1194,12 +1657,17 @@ main()
   all_tests.push_back(std::make_unique<TriSylvTest>());
   all_tests.push_back(std::make_unique<TriSylvBigTest>());
   all_tests.push_back(std::make_unique<TriSylvLargeTest>());
+  all_tests.push_back(std::make_unique<TriSylvParallelTest>());
   all_tests.push_back(std::make_unique<IterSylvTest>());
   all_tests.push_back(std::make_unique<IterSylvLargeTest>());
   all_tests.push_back(std::make_unique<GenSylvSmallTest>());
   all_tests.push_back(std::make_unique<GenSylvTest>());
+  all_tests.push_back(std::make_unique<GenSylvBatchTest>());
+  all_tests.push_back(std::make_unique<GenSylvMixedTest>());
+  all_tests.push_back(std::make_unique<GenSylvMixedZeroTest>());
   all_tests.push_back(std::make_unique<GenSylvSingTest>());
   all_tests.push_back(std::make_unique<GenSylvLargeTest>());
+  all_tests.push_back(std::make_unique<MappedStorageTest>());
 
   // launch the tests
   std::cout << std::setprecision(4);
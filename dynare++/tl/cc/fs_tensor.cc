@@ -24,6 +24,7 @@
 #include "rfs_tensor.hh"
 #include "tl_exception.hh"
 #include "pascal_triangle.hh"
+#include "tl_static.hh"
 
 /* This constructs a fully symmetric tensor as given by the contraction:
 
@@ -88,19 +89,17 @@ FFSTensor::FFSTensor(const FSSparseTensor &t)
 
 /* The conversion from unfolded copies only columns of respective
    coordinates. So we go through all the columns in the folded tensor
-   (this), make an index of the unfolded vector from coordinates, and
-   copy the column. */
+   (this), look up the unfolded column in the index table of the full
+   symmetry dimensions, and copy the column. */
 
 FFSTensor::FFSTensor(const UFSTensor &ut)
   : FTensor(indor::along_col, IntSequence(ut.dimen(), ut.nvar()),
             ut.nrows(), calcMaxOffset(ut.nvar(), ut.dimen()), ut.dimen()),
     nv(ut.nvar())
 {
-  for (index in = begin(); in != end(); ++in)
-    {
-      index src(ut, in.getCoor());
-      copyColumn(ut, *src, *in);
-    }
+  auto itab = TLStatic::getIndexTable(TensorDimens(nv, dimen()));
+  for (int f = 0; f < ncols(); f++)
+    copyColumn(ut, itab->unfoldOf(f), f);
 }
 
 /* Here just make a new instance and return the reference. */
@@ -205,20 +204,18 @@ UFSTensor::UFSTensor(const UFSTensor &t, const ConstVector &x)
     }
 }
 
-/* Here we convert folded full symmetry tensor to unfolded. We copy all
-   columns of folded tensor, and then call unfoldData(). */
+/* Here we convert folded full symmetry tensor to unfolded. For each
+   column of the unfolded tensor we look up the folded column in the index
+   table and copy it, which also unfolds the data. */
 
 UFSTensor::UFSTensor(const FFSTensor &ft)
   : UTensor(indor::along_col, IntSequence(ft.dimen(), ft.nvar()),
             ft.nrows(), calcMaxOffset(ft.nvar(), ft.dimen()), ft.dimen()),
     nv(ft.nvar())
 {
-  for (index src = ft.begin(); src != ft.end(); ++src)
-    {
-      index in(*this, src.getCoor());
-      copyColumn(ft, *src, *in);
-    }
-  unfoldData();
+  auto itab = TLStatic::getIndexTable(TensorDimens(nv, dimen()));
+  for (int u = 0; u < ncols(); u++)
+    copyColumn(ft, itab->foldOf(u), u);
 }
 
 std::unique_ptr<FTensor>
@@ -291,16 +288,17 @@ UFSTensor::addSubTensor(const UGSTensor &t)
 }
 
 /* Here we go through all columns, find a column of folded index, and
-   then copy the column data. Finding the index is done by sorting the
-   integer sequence. */
+   then copy the column data. The column of the folded index (the one with
+   sorted coordinates) is taken from the index table. */
 
 void
 UFSTensor::unfoldData()
 {
-  for (index in = begin(); in != end(); ++in)
+  auto itab = TLStatic::getIndexTable(TensorDimens(nv, dimen()));
+  for (int u = 0; u < ncols(); u++)
     {
-      IntSequence v(in.getCoor());
-      v.sort();
-      copyColumn(*index(*this, v), *in);
+      int first = itab->firstOf(u);
+      if (first != u)
+        copyColumn(first, u);
     }
 }
@@ -23,6 +23,7 @@
 #include "tl_exception.hh"
 #include "kron_prod.hh"
 #include "pascal_triangle.hh"
+#include "tl_static.hh"
 
 /* Constructor used for slicing fully symmetric tensor. It constructs the
    dimensions from the partitioning of variables of fully symmetric tensor. Let
@@ -165,18 +166,16 @@ TensorDimens::decrement(IntSequence &v) const
 }
 
 // FGSTensor conversion from UGSTensor
-/* Here we go through columns of folded, calculate column of unfolded,
-   and copy data. */
+/* Here we go through columns of folded, look up the column of unfolded in
+   the index table of the dimensions, and copy data. */
 FGSTensor::FGSTensor(const UGSTensor &ut)
   : FTensor(indor::along_col, ut.tdims.getNVX(), ut.nrows(),
             ut.tdims.calcFoldMaxOffset(), ut.dimen()),
     tdims(ut.tdims)
 {
-  for (index ti = begin(); ti != end(); ++ti)
-    {
-      index ui(ut, ti.getCoor());
-      copyColumn(ut, *ui, *ti);
-    }
+  auto itab = TLStatic::getIndexTable(tdims);
+  for (int f = 0; f < ncols(); f++)
+    copyColumn(ut, itab->unfoldOf(f), f);
 }
 
 // FGSTensor slicing constructor from FSSparseTensor
@@ -362,21 +361,17 @@ FGSTensor::contractAndAdd(int i, FGSTensor &out,
   out.add(1.0, tmp);
 }
 
-/* Here we go through folded tensor, and each index we convert to index
-   of the unfolded tensor and copy the data to the unfolded. Then we
-   unfold data within the unfolded tensor. */
+/* Here we go through the unfolded tensor, and for each column we look up
+   the folded column in the index table of the dimensions and copy the
+   data. This fills all the columns equivalent in the symmetry at once, so
+   there is no need to unfold the data afterwards. */
 
 UGSTensor::UGSTensor(const FGSTensor &ft)
   : UTensor(indor::along_col, ft.tdims.getNVX(), ft.nrows(),
             ft.tdims.calcUnfoldMaxOffset(), ft.dimen()),
     tdims(ft.tdims)
 {
-  for (index fi = ft.begin(); fi != ft.end(); ++fi)
-    {
-      index ui(*this, fi.getCoor());
-      copyColumn(ft, *fi, *ui);
-    }
-  unfoldData();
+  copyFolded(ft);
 }
 
 // UGSTensor slicing from FSSparseTensor
@@ -391,12 +386,7 @@ UGSTensor::UGSTensor(const FSSparseTensor &t, const IntSequence &ss,
     return;
 
   FGSTensor ft(t, ss, coor, td);
-  for (index fi = ft.begin(); fi != ft.end(); ++fi)
-    {
-      index ui(*this, fi.getCoor());
-      copyColumn(ft, *fi, *ui);
-    }
-  unfoldData();
+  copyFolded(ft);
 }
 
 // UGSTensor slicing from UFSTensor
@@ -409,12 +399,7 @@ UGSTensor::UGSTensor(const UFSTensor &t, const IntSequence &ss,
 {
   FFSTensor folded(t);
   FGSTensor ft(folded, ss, coor, td);
-  for (index fi = ft.begin(); fi != ft.end(); ++fi)
-    {
-      index ui(*this, fi.getCoor());
-      copyColumn(ft, *fi, *ui);
-    }
-  unfoldData();
+  copyFolded(ft);
 }
 
 // UGSTensor increment and decrement codes
@@ -455,31 +440,46 @@ UGSTensor::getOffset(const IntSequence &v) const
 }
 
 /* Unfold all data. We go through all the columns and for each we
-   obtain an index of the first equivalent, and copy the data. */
+   obtain the column of the first equivalent from the index table, and copy
+   the data. */
 
 void
 UGSTensor::unfoldData()
 {
-  for (index in = begin(); in != end(); ++in)
-    copyColumn(*getFirstIndexOf(in), *in);
+  auto itab = TLStatic::getIndexTable(tdims);
+  for (int u = 0; u < ncols(); u++)
+    {
+      int first = itab->firstOf(u);
+      if (first != u)
+        copyColumn(first, u);
+    }
+}
+
+/* Fill all columns from the folded tensor of the same dimensions. */
+
+void
+UGSTensor::copyFolded(const FGSTensor &ft)
+{
+  auto itab = TLStatic::getIndexTable(tdims);
+  for (int u = 0; u < ncols(); u++)
+    copyColumn(ft, itab->foldOf(u), u);
 }
 
 /* Here we return the first index which is equivalent in the symmetry
-   to the given index. It is a matter of sorting all the symmetry
-   partitions of the index. */
+   to the given index. This amounts to sorting all the symmetry partitions
+   of the index, and the sorted coordinates are precisely the coordinates
+   of the folded offset, so we take both from the index table. */
 
 Tensor::index
 UGSTensor::getFirstIndexOf(const index &in) const
 {
-  IntSequence v(in.getCoor());
-  int last = 0;
-  for (int i = 0; i < tdims.getSym().num(); i++)
-    {
-      IntSequence vtmp(v, last, last+tdims.getSym()[i]);
-      vtmp.sort();
-      last += tdims.getSym()[i];
-    }
-  return index(*this, v);
+  auto itab = TLStatic::getIndexTable(tdims);
+  int f = itab->foldOf(*in);
+  IntSequence v(dimen());
+  const int *c = itab->foldCoor(f);
+  for (int i = 0; i < dimen(); i++)
+    v[i] = c[i];
+  return index(*this, v, itab->unfoldOf(f));
 }
 
 /* Here is perfectly same code with the same semantics as in
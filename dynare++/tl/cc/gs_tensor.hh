@@ -255,6 +255,7 @@ public:
   int getOffset(const IntSequence &v) const override;
 private:
   void unfoldData();
+  void copyFolded(const FGSTensor &ft);
 public:
   index getFirstIndexOf(const index &in) const;
 };
@@ -0,0 +1,87 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "index_table.hh"
+#include "gs_tensor.hh"
+#include "tl_exception.hh"
+
+/* We go through the folded offsets in the same way as FGSTensor::increment()
+   does, that is, we increment the coordinates as if they were unfolded and
+   then make them monotone within each partition of the symmetry. For each
+   folded offset we store the coordinates and the unfolded offset of the
+   coordinates. These unfolded offsets are exactly the first indices of the
+   equivalence classes, so at this point we can mark them in
+   ‘unfold_to_fold’.
+
+   Then we go through all unfolded offsets, sort the coordinates within the
+   partitions, and look up the folded offset of the sorted coordinates,
+   which is already known since the sorted coordinates form a first index. */
+
+IndexTable::IndexTable(const TensorDimens &td)
+  : dim(td.dimen()),
+    fold_to_unfold(td.calcFoldMaxOffset()),
+    unfold_to_fold(td.calcUnfoldMaxOffset(), -1)
+{
+  const IntSequence &nvx = td.getNVX();
+  const Symmetry &sym = td.getSym();
+  int nf = foldSize();
+  int nu = unfoldSize();
+
+  fold_coor.resize(static_cast<std::size_t>(nf)*dim);
+  IntSequence v(dim, 0);
+  for (int f = 0; f < nf; f++)
+    {
+      if (f > 0)
+        {
+          UTensor::increment(v, nvx);
+          v.pmonotone(sym);
+        }
+      for (int i = 0; i < dim; i++)
+        fold_coor[static_cast<std::size_t>(f)*dim+i] = v[i];
+      int u = UTensor::getOffset(v, nvx);
+      fold_to_unfold[f] = u;
+      unfold_to_fold[u] = f;
+    }
+
+  if (nf == 0)
+    return;
+
+  IntSequence vu(dim, 0);
+  IntSequence w(dim, 0);
+  for (int u = 0; u < nu; u++)
+    {
+      if (u > 0)
+        UTensor::increment(vu, nvx);
+      if (unfold_to_fold[u] < 0)
+        {
+          w = vu;
+          int last = 0;
+          for (int i = 0; i < sym.num(); i++)
+            {
+              IntSequence wtmp(w, last, last+sym[i]);
+              wtmp.sort();
+              last += sym[i];
+            }
+          int f = unfold_to_fold[UTensor::getOffset(w, nvx)];
+          TL_RAISE_IF(f < 0,
+                      "First index not found in IndexTable constructor");
+          unfold_to_fold[u] = f;
+        }
+    }
+}
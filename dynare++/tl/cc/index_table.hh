@@ -0,0 +1,107 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Index tables for tensor dimensions.
+
+/* Converting between folded and unfolded storage of a tensor (and unfolding
+   the data within an unfolded tensor) needs, for each column, the
+   correspondence between a folded offset and an unfolded offset. Obtaining
+   it through Tensor::index means calling the virtual increment() for each
+   column, sorting each symmetry partition of the coordinates and
+   recalculating offsets from the coordinates.
+
+   All of this depends only on the TensorDimens, and the same dimensions are
+   converted over and over again (for each stack, each symmetry, and each
+   order of the approximation). So we precompute, for given dimensions:
+   — the coordinates of each folded offset (these are the coordinates sorted
+     within each partition of the symmetry),
+   — the unfolded offset of each folded offset,
+   — the folded offset of each unfolded offset.
+
+   The tables are shared among all tensors with the same dimensions, they
+   are obtained through TLStatic::getIndexTable(), which keeps the most
+   recently used ones up to a memory budget. */
+
+#ifndef INDEX_TABLE_H
+#define INDEX_TABLE_H
+
+#include <vector>
+#include <cstddef>
+
+class TensorDimens;
+
+class IndexTable
+{
+  int dim;
+  std::vector<int> fold_coor;
+  std::vector<int> fold_to_unfold;
+  std::vector<int> unfold_to_fold;
+public:
+  explicit IndexTable(const TensorDimens &td);
+  IndexTable(const IndexTable &) = delete;
+  IndexTable &operator=(const IndexTable &) = delete;
+
+  int
+  dimen() const
+  {
+    return dim;
+  }
+  int
+  foldSize() const
+  {
+    return static_cast<int>(fold_to_unfold.size());
+  }
+  int
+  unfoldSize() const
+  {
+    return static_cast<int>(unfold_to_fold.size());
+  }
+  // Unfolded offset of the given folded offset
+  int
+  unfoldOf(int f) const
+  {
+    return fold_to_unfold[f];
+  }
+  // Folded offset of the given unfolded offset
+  int
+  foldOf(int u) const
+  {
+    return unfold_to_fold[u];
+  }
+  // Unfolded offset of the first index equivalent to the given unfolded offset
+  int
+  firstOf(int u) const
+  {
+    return fold_to_unfold[unfold_to_fold[u]];
+  }
+  // Memory taken by the table in bytes
+  std::size_t
+  memory() const
+  {
+    return sizeof(int)*(fold_coor.size() + fold_to_unfold.size() + unfold_to_fold.size());
+  }
+  // Coordinates of the given folded offset (dimen() integers)
+  const int *
+  foldCoor(int f) const
+  {
+    return fold_coor.data() + static_cast<std::size_t>(f)*dim;
+  }
+};
+
+#endif
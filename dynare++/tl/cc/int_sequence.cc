@@ -284,12 +284,19 @@ IntSequence::print() const
    we want to compute the number of permutations of the word ‘yyyyuuvvv’.
                                                 ⎛  9  ⎞
    This is equal to the multinomial coefficient ⎝4,2,3⎠.
+
+   The identity is applied iteratively rather than recursively on a
+   subsequence, since the subsequence would share the data of ‘this’ and so
+   move it out of its inline buffer.
 */
 int
 IntSequence::noverseq()
 {
-  if (size() == 0 || size() == 1)
-    return 1;
-  data[1] += data[0];
-  return PascalTriangle::noverk(data[1], data[0]) * IntSequence(*this, 1, size()).noverseq();
+  int res = 1;
+  for (int i = 1; i < size(); i++)
+    {
+      data[i] += data[i-1];
+      res *= PascalTriangle::noverk(data[i], data[i-1]);
+    }
+  return res;
 }
@@ -51,6 +51,16 @@
    ‘data’, an ‘offset’ integer indicating the beginning of the data relatively
    to the pointer and a ‘length’ of the sequence.
 
+   Most of the sequences are short (coordinates of a tensor index, symmetries,
+   keys of sparse tensors), and they are created in huge numbers. So a
+   sequence of at most ‘small_size’ items owning its data keeps it in the
+   inline buffer ‘buf’ instead of the heap. Since an inline buffer cannot be
+   stolen, moving such a sequence copies its items. Subsequences sharing the
+   data pointer (with ‘destroy’ set to false) must stay valid when their
+   parent is moved (for instance when it is held in a reallocated vector),
+   so a parent whose data is inline moves it to the heap before handing out
+   the first such subsequence (see shared()).
+
    WARNING: IntSequence(n) and IntSequence{n} are not the same (parentheses
    versus braces). The former initializes a sequence of length n, while the
    latter constructs a sequence of a single element equal to n. This is similar
@@ -59,49 +69,82 @@
 class Symmetry;
 class IntSequence
 {
+public:
+  static constexpr int small_size = 8;
+private:
   int *data;
   int length;
   bool destroy{true};
+  int buf[small_size];
+  int *
+  allocate(int l)
+  {
+    return l <= small_size ? buf : new int[l];
+  }
+  // Moves the data out of the inline buffer and returns the data pointer
+  int *
+  shared()
+  {
+    if (data == buf)
+      {
+        data = new int[length];
+        std::copy_n(buf, length, data);
+      }
+    return data;
+  }
 public:
   // Constructor allocating a given length of (uninitialized) data
   explicit IntSequence(int l)
-    : data{new int[l]}, length{l}
+    : data{allocate(l)}, length{l}
   {
   }
   // Constructor allocating and then initializing all members to a given number
   IntSequence(int l, int n)
-    : data{new int[l]}, length{l}
+    : data{allocate(l)}, length{l}
   {
     std::fill_n(data, length, n);
   }
   /* Constructor using an initializer list (gives the contents of the
      IntSequence, similarly to std::vector) */
   IntSequence(std::initializer_list<int> init)
-    : data{new int[init.size()]},
+    : data{allocate(init.size())},
       length{static_cast<int>(init.size())}
   {
     std::copy(init.begin(), init.end(), data);
   }
   // Copy constructor
   IntSequence(const IntSequence &s)
-    : data{new int[s.length]}, length{s.length}
+    : data{allocate(s.length)}, length{s.length}
   {
     std::copy_n(s.data, length, data);
   }
-  // Move constructor
-  IntSequence(IntSequence &&s)
-    : data{std::exchange(s.data, nullptr)}, length{std::exchange(s.length, 0)},
-      destroy{std::exchange(s.destroy, false)}
+  /* Move constructor (steals the data, unless it is in the inline buffer).
+     It is noexcept so that std::vector moves its sequences when it
+     reallocates, instead of copying them. */
+  IntSequence(IntSequence &&s) noexcept
+    : data{s.data}, length{s.length}, destroy{s.destroy}
   {
+    if (s.data == s.buf)
+      {
+        data = buf;
+        std::copy_n(s.buf, length, buf);
+      }
+    else
+      {
+        s.data = nullptr;
+        s.destroy = false;
+      }
+    s.length = 0;
   }
-  // Subsequence constructor (which shares the data pointer)
+  /* Subsequence constructor (which shares the data pointer, after having
+     moved the data of ‘s’ to the heap if it was inline) */
   IntSequence(IntSequence &s, int i1, int i2)
-    : data{s.data+i1}, length{i2-i1}, destroy{false}
+    : data{s.shared()+i1}, length{i2-i1}, destroy{false}
   {
   }
   // Subsequence constructor (without pointer sharing)
   IntSequence(const IntSequence &s, int i1, int i2)
-    : data{new int[i2-i1]}, length{i2-i1}
+    : data{allocate(i2-i1)}, length{i2-i1}
   {
     std::copy_n(s.data+i1, length, data);
   }
@@ -119,7 +162,7 @@ public:
   IntSequence &operator=(IntSequence &&s);
   virtual ~IntSequence()
   {
-    if (destroy)
+    if (destroy && data != buf)
       delete[] data;
   }
   bool operator==(const IntSequence &s) const;
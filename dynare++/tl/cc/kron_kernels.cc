@@ -0,0 +1,231 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "kron_kernels.hh"
+
+#include <algorithm>
+#include <utility>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+# define KRON_KERNELS_X86
+# include <immintrin.h>
+#endif
+
+/* All the implementations process the rows in blocks of ‘block_rows’, so
+   that the m input columns of the block stay in cache while all the n output
+   columns of the block are calculated.
+
+   The vectorized implementations calculate four vectors of an output column
+   at once: the accumulators stay in registers while going through all the
+   input columns, so each output element is stored only once. The rows which
+   do not fill four vectors, are done one vector at a time, the last one
+   being masked.
+
+   The scalar implementation calculates each output element with four
+   partial sums, so that it is not bound by the latency of the additions
+   when there are only a few rows. */
+
+namespace KronKernels
+{
+  constexpr int block_rows = 512;
+
+  using Kernel = void (*)(int, int, int, const double *, std::ptrdiff_t,
+                          const double *, std::ptrdiff_t, double *, std::ptrdiff_t);
+
+  void
+  multColumnsScalar(int nr, int m, int n,
+                    const double *in, std::ptrdiff_t in_stride,
+                    const double *a, std::ptrdiff_t lda,
+                    double *out, std::ptrdiff_t out_stride)
+  {
+    for (int r0 = 0; r0 < nr; r0 += block_rows)
+      {
+        int r1 = std::min(r0+block_rows, nr);
+        for (int k = 0; k < n; k++)
+          {
+            const double *ak = a+k*lda;
+            double *o = out+k*out_stride;
+            for (int r = r0; r < r1; r++)
+              {
+                double s0 = 0.0, s1 = 0.0, s2 = 0.0, s3 = 0.0;
+                const double *p = in+r;
+                int j = 0;
+                for (; j+4 <= m; j += 4)
+                  {
+                    s0 += ak[j]*p[j*in_stride];
+                    s1 += ak[j+1]*p[(j+1)*in_stride];
+                    s2 += ak[j+2]*p[(j+2)*in_stride];
+                    s3 += ak[j+3]*p[(j+3)*in_stride];
+                  }
+                for (; j < m; j++)
+                  s0 += ak[j]*p[j*in_stride];
+                o[r] = (s0+s1)+(s2+s3);
+              }
+          }
+      }
+  }
+
+#ifdef KRON_KERNELS_X86
+  __attribute__((target("avx2,fma"))) void
+  multColumnsAVX2(int nr, int m, int n,
+                  const double *in, std::ptrdiff_t in_stride,
+                  const double *a, std::ptrdiff_t lda,
+                  double *out, std::ptrdiff_t out_stride)
+  {
+    constexpr int w = 4;
+    for (int r0 = 0; r0 < nr; r0 += block_rows)
+      {
+        int r1 = std::min(r0+block_rows, nr);
+        for (int k = 0; k < n; k++)
+          {
+            const double *ak = a+k*lda;
+            double *o = out+k*out_stride;
+            int r = r0;
+            for (; r+4*w <= r1; r += 4*w)
+              {
+                __m256d acc0 = _mm256_setzero_pd(), acc1 = _mm256_setzero_pd(),
+                  acc2 = _mm256_setzero_pd(), acc3 = _mm256_setzero_pd();
+                for (int j = 0; j < m; j++)
+                  {
+                    __m256d aj = _mm256_broadcast_sd(ak+j);
+                    const double *p = in+j*in_stride+r;
+                    acc0 = _mm256_fmadd_pd(aj, _mm256_loadu_pd(p), acc0);
+                    acc1 = _mm256_fmadd_pd(aj, _mm256_loadu_pd(p+w), acc1);
+                    acc2 = _mm256_fmadd_pd(aj, _mm256_loadu_pd(p+2*w), acc2);
+                    acc3 = _mm256_fmadd_pd(aj, _mm256_loadu_pd(p+3*w), acc3);
+                  }
+                _mm256_storeu_pd(o+r, acc0);
+                _mm256_storeu_pd(o+r+w, acc1);
+                _mm256_storeu_pd(o+r+2*w, acc2);
+                _mm256_storeu_pd(o+r+3*w, acc3);
+              }
+            for (; r+w <= r1; r += w)
+              {
+                __m256d acc = _mm256_setzero_pd();
+                for (int j = 0; j < m; j++)
+                  acc = _mm256_fmadd_pd(_mm256_broadcast_sd(ak+j),
+                                        _mm256_loadu_pd(in+j*in_stride+r), acc);
+                _mm256_storeu_pd(o+r, acc);
+              }
+            if (r < r1)
+              {
+                __m256i mask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(r1-r),
+                                                  _mm256_setr_epi64x(0, 1, 2, 3));
+                __m256d acc = _mm256_setzero_pd();
+                for (int j = 0; j < m; j++)
+                  acc = _mm256_fmadd_pd(_mm256_broadcast_sd(ak+j),
+                                        _mm256_maskload_pd(in+j*in_stride+r, mask), acc);
+                _mm256_maskstore_pd(o+r, mask, acc);
+              }
+          }
+      }
+  }
+
+  __attribute__((target("avx512f"))) void
+  multColumnsAVX512(int nr, int m, int n,
+                    const double *in, std::ptrdiff_t in_stride,
+                    const double *a, std::ptrdiff_t lda,
+                    double *out, std::ptrdiff_t out_stride)
+  {
+    constexpr int w = 8;
+    for (int r0 = 0; r0 < nr; r0 += block_rows)
+      {
+        int r1 = std::min(r0+block_rows, nr);
+        for (int k = 0; k < n; k++)
+          {
+            const double *ak = a+k*lda;
+            double *o = out+k*out_stride;
+            int r = r0;
+            for (; r+4*w <= r1; r += 4*w)
+              {
+                __m512d acc0 = _mm512_setzero_pd(), acc1 = _mm512_setzero_pd(),
+                  acc2 = _mm512_setzero_pd(), acc3 = _mm512_setzero_pd();
+                for (int j = 0; j < m; j++)
+                  {
+                    __m512d aj = _mm512_set1_pd(ak[j]);
+                    const double *p = in+j*in_stride+r;
+                    acc0 = _mm512_fmadd_pd(aj, _mm512_loadu_pd(p), acc0);
+                    acc1 = _mm512_fmadd_pd(aj, _mm512_loadu_pd(p+w), acc1);
+                    acc2 = _mm512_fmadd_pd(aj, _mm512_loadu_pd(p+2*w), acc2);
+                    acc3 = _mm512_fmadd_pd(aj, _mm512_loadu_pd(p+3*w), acc3);
+                  }
+                _mm512_storeu_pd(o+r, acc0);
+                _mm512_storeu_pd(o+r+w, acc1);
+                _mm512_storeu_pd(o+r+2*w, acc2);
+                _mm512_storeu_pd(o+r+3*w, acc3);
+              }
+            for (; r+w <= r1; r += w)
+              {
+                __m512d acc = _mm512_setzero_pd();
+                for (int j = 0; j < m; j++)
+                  acc = _mm512_fmadd_pd(_mm512_set1_pd(ak[j]),
+                                        _mm512_loadu_pd(in+j*in_stride+r), acc);
+                _mm512_storeu_pd(o+r, acc);
+              }
+            if (r < r1)
+              {
+                auto mask = static_cast<__mmask8>((1u << (r1-r))-1);
+                __m512d acc = _mm512_setzero_pd();
+                for (int j = 0; j < m; j++)
+                  acc = _mm512_fmadd_pd(_mm512_set1_pd(ak[j]),
+                                        _mm512_maskz_loadu_pd(mask, in+j*in_stride+r), acc);
+                _mm512_mask_storeu_pd(o+r, mask, acc);
+              }
+          }
+      }
+  }
+#endif
+
+  /* Choose the implementation according to the running processor. This is
+     done only once. */
+  std::pair<Kernel, const char *>
+  select()
+  {
+#ifdef KRON_KERNELS_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+      return { multColumnsAVX512, "AVX-512" };
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+      return { multColumnsAVX2, "AVX2" };
+#endif
+    return { multColumnsScalar, "scalar" };
+  }
+
+  const std::pair<Kernel, const char *> &
+  selected()
+  {
+    static const std::pair<Kernel, const char *> sel = select();
+    return sel;
+  }
+
+  void
+  multColumns(int nr, int m, int n,
+              const double *in, std::ptrdiff_t in_stride,
+              const double *a, std::ptrdiff_t lda,
+              double *out, std::ptrdiff_t out_stride)
+  {
+    selected().first(nr, m, n, in, in_stride, a, lda, out, out_stride);
+  }
+
+  const char *
+  isa()
+  {
+    return selected().second;
+  }
+}
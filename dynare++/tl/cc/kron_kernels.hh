@@ -0,0 +1,53 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Kernels for Kronecker products with small matrices.
+
+/* The products B·(I⊗A), B·(A⊗I) and B·(I⊗A⊗I) computed in kron_prod.cc
+   consist of calculating columns of the result as linear combinations of
+   columns of B, the coefficients being the elements of a column of A. When A
+   is small, this is faster done directly than by many calls to BLAS, each
+   doing very little work.
+
+   KronKernels::multColumns() calculates
+     outₖ = ∑ⱼ aⱼₖ·inⱼ,  for k=0,…,n−1, j=0,…,m−1
+   where inⱼ is a column of ‘nr’ contiguous doubles starting at
+   in+j·in_stride, outₖ is a column starting at out+k·out_stride, and aⱼₖ is
+   a[j+k·lda].
+
+   There are several implementations: a portable scalar one, and on x86
+   processors, ones using AVX2 and AVX-512 instructions. The best one
+   supported by the running processor is chosen at the first call. */
+
+#ifndef KRON_KERNELS_H
+#define KRON_KERNELS_H
+
+#include <cstddef>
+
+namespace KronKernels
+{
+  void multColumns(int nr, int m, int n,
+                   const double *in, std::ptrdiff_t in_stride,
+                   const double *a, std::ptrdiff_t lda,
+                   double *out, std::ptrdiff_t out_stride);
+  // Name of the instruction set used by multColumns()
+  const char *isa();
+};
+
+#endif
@@ -19,9 +19,12 @@
  */
 
 #include "kron_prod.hh"
+#include "kron_kernels.hh"
 #include "tl_exception.hh"
+#include "MemoryArena.hh"
 
 #include <tuple>
+#include <cstddef>
 
 /* Here we construct Kronecker product dimensions from Kronecker product
    dimensions by picking a given matrix and all other set to identity. The
@@ -108,6 +111,29 @@ KronProd::kronMult(const ConstVector &v1, const ConstVector &v2,
     }
 }
 
+/* The default threshold was chosen by timing the products with the narrow
+   matrices typical of small state blocks against the BLAS slice path (see
+   the “kron prod kernels” test in tl/testing). */
+
+int KronProd::blocked_max_size = 400;
+
+/* Here we compute the columns obase+k·ostride of ‘out’, for k=0,…,n−1, as
+   ∑ⱼ aⱼₖ·bⱼ where bⱼ is the column ibase+j·istride of ‘in’, and A is m×n.
+   The work is done by the kernel in kron_kernels.hh. */
+
+void
+KronProd::multColumns(const ConstTwoDMatrix &in, int ibase, int istride,
+                      const TwoDMatrix &a,
+                      TwoDMatrix &out, int obase, int ostride)
+{
+  std::ptrdiff_t ild = in.getLD();
+  std::ptrdiff_t old = out.getLD();
+  KronKernels::multColumns(in.nrows(), a.nrows(), a.ncols(),
+                           in.getData().base() + ibase*ild, istride*ild,
+                           a.getData().base(), a.getLD(),
+                           out.getData().base() + obase*old, ostride*old);
+}
+
 void
 KronProdAll::setMat(int i, const TwoDMatrix &m)
 {
@@ -135,7 +161,8 @@ KronProdAll::isUnit() const
    is partitioned accordingly, then the result is (B₁·A B₂·A … Bₘ·A).
 
    In the implementation, ‘outi’ are partitions of ‘out’, ‘ini’ are const
-   partitions of ‘in’, and ‘id_cols’ is m. We employ level-2 BLAS. */
+   partitions of ‘in’, and ‘id_cols’ is m. We employ level-2 BLAS, unless A is
+   small, in which case each Bᵢ·A is done by multColumns(). */
 
 void
 KronProdIA::mult(const ConstTwoDMatrix &in, TwoDMatrix &out) const
@@ -143,6 +170,14 @@ KronProdIA::mult(const ConstTwoDMatrix &in, TwoDMatrix &out) const
   checkDimForMult(in, out);
 
   int id_cols = kpd.cols[0];
+
+  if (useBlocked(mat))
+    {
+      for (int i = 0; i < id_cols; i++)
+        multColumns(in, i * mat.nrows(), 1, mat, out, i * mat.ncols(), 1);
+      return;
+    }
+
   ConstTwoDMatrix a(mat);
 
   for (int i = 0; i < id_cols; i++)
@@ -181,7 +216,9 @@ KronProdAI::KronProdAI(const KronProdIAI &kpiai)
    columns as the identity matrix. Then we have Rᵢ=∑aⱼᵢBⱼ.
 
    In the implementation, ‘outi’ is Rᵢ, ‘ini’ is Bⱼ, and ‘id_cols’ is the
-   dimension of the identity matrix. */
+   dimension of the identity matrix. If A is small, we rather calculate the
+   columns of R by multColumns(), the c-th column of Rᵢ being a combination of
+   the c-th columns of all Bⱼ. */
 
 void
 KronProdAI::mult(const ConstTwoDMatrix &in, TwoDMatrix &out) const
@@ -197,6 +234,9 @@ KronProdAI::mult(const ConstTwoDMatrix &in, TwoDMatrix &out) const
       TwoDMatrix out_resh(in.nrows()*id_cols, a.ncols(), out.getData());
       out_resh.mult(in_resh, a);
     }
+  else if (useBlocked(mat))
+    for (int c = 0; c < id_cols; c++)
+      multColumns(in, c, id_cols, mat, out, c, id_cols);
   else
     {
       out.zeros();
@@ -220,7 +260,13 @@ KronProdAI::mult(const ConstTwoDMatrix &in, TwoDMatrix &out) const
    of partitions of R is the number of columns of A⊗I.
 
    In the implementation, ‘id_cols’ is n, ‘akronid’ is A⊗I, and ‘in_bl_width’
-   and ‘out_bl_width’ are the rows and cols of A⊗I. */
+   and ‘out_bl_width’ are the rows and cols of A⊗I.
+
+   If A is small, the columns of all the partitions are calculated directly by
+   multColumns(). Moreover, if both ‘in’ and ‘out’ are stored contiguously, the
+   p columns of B multiplied by one element of A (p being the dimension of the
+   last identity) form a contiguous block of memory, so we reshape ‘in’ and
+   ‘out’ to have p times more rows, and the product becomes B·(I⊗A). */
 
 void
 KronProdIAI::mult(const ConstTwoDMatrix &in, TwoDMatrix &out) const
@@ -232,6 +278,24 @@ KronProdIAI::mult(const ConstTwoDMatrix &in, TwoDMatrix &out) const
   KronProdAI akronid(*this);
   auto [in_bl_width, out_bl_width] = akronid.kpd.getRC();
 
+  if (useBlocked(mat))
+    {
+      int id_last = kpd.cols[2];
+      if (in.getLD() == in.nrows() && out.getLD() == out.nrows())
+        {
+          ConstTwoDMatrix in_resh(in.nrows()*id_last, in.ncols()/id_last, in.getData());
+          TwoDMatrix out_resh(out.nrows()*id_last, out.ncols()/id_last, out.getData());
+          for (int i = 0; i < id_cols; i++)
+            multColumns(in_resh, i*mat.nrows(), 1, mat, out_resh, i*mat.ncols(), 1);
+        }
+      else
+        for (int i = 0; i < id_cols; i++)
+          for (int c = 0; c < id_last; c++)
+            multColumns(in, i*in_bl_width + c, id_last, mat,
+                        out, i*out_bl_width + c, id_last);
+      return;
+    }
+
   for (int i = 0; i < id_cols; i++)
     {
       TwoDMatrix outi(out, i *out_bl_width, out_bl_width);
@@ -251,7 +315,10 @@ KronProdIAI::mult(const ConstTwoDMatrix &in, TwoDMatrix &out) const
 
    We have to be careful in cases when last or first matrix is unit and
    no calculations are performed in corresponding codes. The codes should
-   handle ‘last’ safely also if no calcs are done. */
+   handle ‘last’ safely also if no calcs are done.
+
+   The intermediate results live in the memory arena of the thread, so that
+   they do not go through the system allocator (see MemoryArena.hh). */
 
 void
 KronProdAll::mult(const ConstTwoDMatrix &in, TwoDMatrix &out) const
@@ -284,6 +351,7 @@ KronProdAll::mult(const ConstTwoDMatrix &in, TwoDMatrix &out) const
       return;
     }
 
+  MemoryArenaScope arena;
   int c;
   std::unique_ptr<TwoDMatrix> last;
 
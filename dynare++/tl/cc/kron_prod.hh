@@ -142,7 +142,15 @@ public:
 
    The class also contains a static method kronMult(), which calculates a
    Kronecker product of two vectors and stores it in the provided vector. It is
-   useful at a few points of the library. */
+   useful at a few points of the library.
+
+   The products with I⊗A, A⊗I and I⊗A⊗I all boil down to computing columns of
+   the result as linear combinations of columns of B with coefficients taken
+   from A. If A is small, this is better done by the cache-blocked kernel
+   multColumns() than by calling BLAS for each slice of B, since each BLAS call
+   would do very little work. The static member ‘blocked_max_size’ is the
+   maximum number of elements of A for which the kernel is used; setting it to
+   zero always uses BLAS. */
 
 class KronProd
 {
@@ -184,6 +192,8 @@ public:
   static void kronMult(const ConstVector &v1, const ConstVector &v2,
                        Vector &res);
 
+  static int blocked_max_size;
+
   int
   nrows() const
   {
@@ -204,6 +214,15 @@ public:
   {
     return kpd.ncols(i);
   }
+protected:
+  static bool
+  useBlocked(const TwoDMatrix &a)
+  {
+    return a.nrows()*a.ncols() <= blocked_max_size;
+  }
+  static void multColumns(const ConstTwoDMatrix &in, int ibase, int istride,
+                          const TwoDMatrix &a,
+                          TwoDMatrix &out, int obase, int ostride);
 };
 
 /* KronProdAll is the main class of this file. It represents the Kronecker
@@ -19,71 +19,184 @@
  */
 
 #include <memory>
+#include <algorithm>
+#include <vector>
 
 #include "normal_moments.hh"
 #include "permutation.hh"
 #include "kron_prod.hh"
 #include "tl_static.hh"
+#include "sthread.hh"
 
-UNormalMoments::UNormalMoments(int maxdim, const TwoDMatrix &v)
-  : TensorContainer<URSingleTensor>(1)
+std::list<UNormalMoments> UNormalMoments::cache;
+std::mutex UNormalMoments::cache_mut;
+
+/* We first look for moments of the same variance-covariance matrix up to at
+   least the requested dimension in the cache. If found, the entry is moved
+   to the front of the cache and its tensors are copied. Otherwise, we
+   generate the moments and put a copy of them in the cache, replacing the
+   entries of the same matrix (which have a lower dimension) and dropping the
+   least recently used entry if the cache is full. */
+
+UNormalMoments::UNormalMoments(int maxdim_arg, const TwoDMatrix &v)
+  : TensorContainer<URSingleTensor>(1), maxdim(maxdim_arg), vcov(v)
+{
+  TL_RAISE_IF(v.nrows() != v.ncols(),
+              "Variance-covariance matrix is not square in UNormalMoments constructor");
+
+  if (maxdim < 2)
+    return;
+
+  auto same_vcov = [&v](const UNormalMoments &m)
+                   {
+                     return m.vcov.nrows() == v.nrows()
+                       && ConstVector(m.vcov.getData()) == ConstVector(v.getData());
+                   };
+
+  {
+    std::lock_guard<std::mutex> lk{cache_mut};
+    for (auto it = cache.begin(); it != cache.end(); ++it)
+      if (it->maxdim >= maxdim && same_vcov(*it))
+        {
+          cache.splice(cache.begin(), cache, it);
+          for (int d = 2; d <= maxdim; d += 2)
+            insert(std::make_unique<URSingleTensor>(it->get(Symmetry{d})));
+          return;
+        }
+  }
+
+  generateMoments(maxdim, v);
+
+  std::lock_guard<std::mutex> lk{cache_mut};
+  cache.remove_if(same_vcov);
+  cache.push_front(*this);
+  if (static_cast<int>(cache.size()) > max_cached)
+    cache.pop_back();
+}
+
+void
+UNormalMoments::clearCache()
 {
-  if (maxdim >= 2)
-    generateMoments(maxdim, v);
+  std::lock_guard<std::mutex> lk{cache_mut};
+  cache.clear();
+}
+
+/* This worker fills the items of the moment tensor ‘mom’ at the offsets from
+   ‘first’ (included) to ‘last’ (excluded) by applying Fₙ to ‘kronv’. The
+   permutations of Fₙ are packed in ‘perms’.
+
+   Instead of adding each item of ‘kronv’ to the permuted location of ‘mom’,
+   we go through the items of ‘mom’ and add the items of ‘kronv’ from the
+   permuted locations, so that the workers write to disjoint parts of ‘mom’.
+   The permutation must be taken as the permutation implied by the
+   equivalence (not its inverse, as it would be for the former), and the
+   items are summed in the same order. */
+
+namespace
+{
+  class MomentsWorker : public sthread::detach_thread
+  {
+    URSingleTensor &mom;
+    const URSingleTensor &kronv;
+    const std::vector<int> &perms;
+    const int first, last;
+  public:
+    MomentsWorker(URSingleTensor &mom_arg, const URSingleTensor &kronv_arg,
+                  const std::vector<int> &perms_arg, int first_arg, int last_arg)
+      : mom(mom_arg), kronv(kronv_arg), perms(perms_arg), first(first_arg), last(last_arg)
+    {
+    }
+    void
+    operator()(std::mutex &mut) override
+    {
+      int d = mom.dimen();
+      int nv = mom.nvar();
+      int nperms = perms.size()/d;
+
+      IntSequence pw(d);
+      pw[d-1] = 1;
+      for (int j = d-2; j >= 0; j--)
+        pw[j] = pw[j+1]*nv;
+
+      IntSequence ind(d);
+      for (int j = 0, off = first; j < d; j++)
+        {
+          ind[j] = off/pw[j];
+          off %= pw[j];
+        }
+
+      for (int o = first; o < last; o++)
+        {
+          double s = 0.0;
+          for (int p = 0; p < nperms; p++)
+            {
+              const int *per = perms.data() + p*d;
+              int src = 0;
+              for (int j = 0; j < d; j++)
+                src += ind[per[j]]*pw[j];
+              s += kronv.get(src, 0);
+            }
+          mom.get(o, 0) = s;
+          UTensor::increment(ind, nv);
+        }
+    }
+  };
 }
 
 /* Here we fill up the container with the tensors for d=2,4,6,… up to the given
    dimension. Each tensor of moments is equal to Fₙ(⊗ⁿv). This has a dimension
    equal to 2n. See the header file for proof and details.
 
-   Here we sequentially construct the Kronecker power ⊗ⁿv and apply Fₙ.
-*/
+   Here we sequentially construct the Kronecker powers ⊗ⁿv, and tabulate
+   the permutations of Fₙ, i.e. of the equivalences over 2n elements having
+   n classes of 2 elements each. Then Fₙ is applied to all the powers in
+   parallel, each tensor being split into several ranges of items. */
+
 void
 UNormalMoments::generateMoments(int maxdim, const TwoDMatrix &v)
 {
-  TL_RAISE_IF(v.nrows() != v.ncols(),
-              "Variance-covariance matrix is not square in UNormalMoments constructor");
-
   int nv = v.nrows();
   auto mom2 = std::make_unique<URSingleTensor>(nv, 2);
   mom2->getData() = v.getData();
   insert(std::move(mom2));
-  auto kronv = std::make_unique<URSingleTensor>(nv, 2);
-  kronv->getData() = v.getData();
+
+  std::vector<std::unique_ptr<URSingleTensor>> kronv, moms;
+  std::vector<std::vector<int>> perms;
+  kronv.push_back(std::make_unique<URSingleTensor>(nv, 2));
+  kronv.back()->getData() = v.getData();
   for (int d = 4; d <= maxdim; d += 2)
     {
       auto newkronv = std::make_unique<URSingleTensor>(nv, d);
       KronProd::kronMult(ConstVector(v.getData()),
-                         ConstVector(kronv->getData()),
+                         ConstVector(kronv.back()->getData()),
                          newkronv->getData());
-      kronv = std::move(newkronv);
-      auto mom = std::make_unique<URSingleTensor>(nv, d);
-      // apply Fₙ to ‘kronv’
-      /* Here we go through all equivalences, select only those having 2
-         elements in each class, then go through all elements in ‘kronv’ and
-         add to permuted location of ‘mom’.
-
-         The permutation must be taken as inverse of the permutation implied by
-         the equivalence, since we need a permutation which after application
-         to identity of indices yileds indices in the equivalence classes. Note
-         how the Equivalence::apply() method works. */
-      mom->zeros();
-      const EquivalenceSet eset = TLStatic::getEquiv(d);
-      for (const auto &cit : eset)
-        if (selectEquiv(cit))
+      kronv.push_back(std::move(newkronv));
+      moms.push_back(std::make_unique<URSingleTensor>(nv, d));
+
+      perms.emplace_back();
+      for (const auto *e : TLStatic::getEquiv(d, d/2))
+        if (selectEquiv(*e))
           {
-            Permutation per(cit);
-            per.inverse();
-            for (Tensor::index it = kronv->begin(); it != kronv->end(); ++it)
-              {
-                IntSequence ind(kronv->dimen());
-                per.apply(it.getCoor(), ind);
-                Tensor::index it2(*mom, ind);
-                mom->get(*it2, 0) += kronv->get(*it, 0);
-              }
+            Permutation per(*e);
+            for (int j = 0; j < d; j++)
+              perms.back().push_back(per.getMap()[j]);
           }
-      insert(std::move(mom));
     }
+
+  sthread::detach_thread_group gr;
+  int nchunks = 4*sthread::detach_thread_group::max_parallel_threads;
+  for (unsigned int i = 0; i < moms.size(); i++)
+    {
+      int ncols = moms[i]->nrows();
+      int chunk = std::max(ncols/nchunks, 1024);
+      for (int first = 0; first < ncols; first += chunk)
+        gr.insert(std::make_unique<MomentsWorker>(*moms[i], *kronv[i+1], perms[i], first,
+                                                  std::min(first+chunk, ncols)));
+    }
+  gr.run();
+
+  for (auto &mom : moms)
+    insert(std::move(mom));
 }
 
 /* We return true for an equivalence whose each class has 2 elements. */
@@ -111,6 +111,13 @@
    and apply Fₙ to ⊗ⁿv. Fₙ is, in fact, a set of all equivalences in sense of
    class Equivalence over 2n elements, having n classes each of them having
    exactly 2 elements.
+
+   The moments depend only on the maximum dimension and on V, and they are
+   needed several times for the same model (by KOrder, by Approximation, and
+   again for each new solution with the same covariance). So the generated
+   moments are kept in a small process-wide cache keyed by V, and a
+   container of moments up to a dimension not greater than the cached one is
+   just copied from the cache.
 */
 
 #ifndef NORMAL_MOMENTS_H
@@ -118,10 +125,24 @@
 
 #include "t_container.hh"
 
+#include <list>
+#include <mutex>
+
 class UNormalMoments : public TensorContainer<URSingleTensor>
 {
+  // Maximum number of covariance matrices whose moments are cached
+  static constexpr int max_cached = 4;
+  // Most recently used first
+  static std::list<UNormalMoments> cache;
+  static std::mutex cache_mut;
+  int maxdim;
+  TwoDMatrix vcov;
 public:
   UNormalMoments(int maxdim, const TwoDMatrix &v);
+  UNormalMoments(const UNormalMoments &) = default;
+  UNormalMoments(UNormalMoments &&) = default;
+  // Empties the cache of moments
+  static void clearCache();
 private:
   void generateMoments(int maxdim, const TwoDMatrix &v);
   static bool selectEquiv(const Equivalence &e);
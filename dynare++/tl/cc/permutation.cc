@@ -21,6 +21,8 @@
 #include "permutation.hh"
 #include "tl_exception.hh"
 
+#include <set>
+
 /* This is easy, we simply apply the map in the fashion s∘m */
 
 void
@@ -121,6 +123,23 @@ PermutationSet::getPreserving(const IntSequence &s) const
   return res;
 }
 
+std::vector<IntSequence>
+PermutationSet::getArrangements(const IntSequence &s) const
+{
+  TL_RAISE_IF(s.size() != order,
+              "Wrong sequence length in PermutationSet::getArrangements");
+
+  std::set<IntSequence> arr;
+  IntSequence tmp(s.size());
+  for (int i = 0; i < size; i++)
+    {
+      pers[i].apply(s, tmp);
+      arr.insert(tmp);
+    }
+
+  return std::vector<IntSequence>(arr.begin(), arr.end());
+}
+
 PermutationBundle::PermutationBundle(int nmax)
 {
   nmax = std::max(nmax, 1);
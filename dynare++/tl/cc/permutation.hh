@@ -141,7 +141,10 @@ protected:
 
    The method getPreserving() returns a factor subgroup of permutations, which
    are invariants with respect to the given sequence. This are all permutations
-   p yielding p∘s = s, where s is the given sequence. */
+   p yielding p∘s = s, where s is the given sequence.
+
+   The method getArrangements() returns the distinct sequences p∘s over all
+   permutations p, in lexicographic order. */
 
 class PermutationSet
 {
@@ -162,6 +165,7 @@ public:
     return pers[i];
   }
   std::vector<Permutation> getPreserving(const IntSequence &s) const;
+  std::vector<IntSequence> getArrangements(const IntSequence &s) const;
 };
 
 /* The permutation bundle encapsulates all permutations sets up to some
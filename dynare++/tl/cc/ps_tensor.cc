@@ -229,8 +229,7 @@ UPSTensor::fillFromSparseTwo(const FSSparseTensor &t, const IntSequence &ss,
       ub_srt[i] = cum[coor_srt[i]] + ss[coor_srt[i]] - 1;
     }
 
-  const PermutationSet &pset = TLStatic::getPerm(coor.size());
-  std::vector<Permutation> pp = pset.getPreserving(coor);
+  const std::vector<Permutation> &pp = TLStatic::getPreserving(coor);
 
   Permutation unsort(coor);
   zeros();
@@ -282,13 +281,12 @@ PerTensorDimens2::calcOffset(const IntSequence &coor) const
 {
   TL_RAISE_IF(coor.size() != dimen(),
               "Wrong length of coordinates in PerTensorDimens2::calcOffset");
-  IntSequence cc(coor);
   int ret = 0;
   int off = 0;
   for (int i = 0; i < numSyms(); i++)
     {
       TensorDimens td(syms[i], getNVS());
-      IntSequence c(cc, off, off+syms[i].dimen());
+      IntSequence c(coor, off, off+syms[i].dimen());
       int a = td.calcFoldOffset(c);
       ret = ret*ds[i] + a;
       off += syms[i].dimen();
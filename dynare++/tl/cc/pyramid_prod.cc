@@ -41,21 +41,17 @@ USubTensor::USubTensor(const TensorDimens &bdims,
 {
   TL_RAISE_IF(!hdims.getNVX().isConstant(),
               "Tensor has not full symmetry in USubTensor()");
-  const EquivalenceSet &eset = TLStatic::getEquiv(bdims.dimen());
   zeros();
-  for (const auto &it : eset)
+  for (auto it : TLStatic::getEquiv(bdims.dimen(), hdims.dimen()))
     {
-      if (it.numClasses() == hdims.dimen())
+      Permutation per(*it);
+      std::vector<const FGSTensor *> ts
+        = cont.fetchTensors(bdims.getSym(), *it);
+      for (int i = 0; i < static_cast<int>(lst.size()); i++)
         {
-          Permutation per(it);
-          std::vector<const FGSTensor *> ts
-            = cont.fetchTensors(bdims.getSym(), it);
-          for (int i = 0; i < static_cast<int>(lst.size()); i++)
-            {
-              IntSequence perindex(lst[i].size());
-              per.apply(lst[i], perindex);
-              addKronColumn(i, ts, perindex);
-            }
+          IntSequence perindex(lst[i].size());
+          per.apply(lst[i], perindex);
+          addKronColumn(i, ts, perindex);
         }
     }
 }
@@ -0,0 +1,104 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+// Index arithmetic specialized for small dimensions.
+
+/* The index arithmetic of the tensors (offsets, increments, sorting of
+   coordinates) works on IntSequence·s of any length, which are allocated on
+   the heap and traversed by loops whose length is known only at runtime.
+   Since most of the tensors have a dimension between 1 and 6, we provide
+   here versions of these operations taking the dimension as a template
+   parameter ‘D’ and working on plain arrays of ‘D’ integers (which can live
+   on the stack), so that the compiler fully unrolls them.
+
+   The function dispatch() selects at runtime the instance for a given
+   dimension: dispatch<F>(d, args…) calls F::template run<d>(args…) and returns
+   true if 1≤d≤‘max_dim’, otherwise it does nothing and returns false, so that
+   the caller can fall back to the generic code. */
+
+#ifndef SMALL_DIM_H
+#define SMALL_DIM_H
+
+#include "pascal_triangle.hh"
+
+#include <utility>
+
+namespace SmallDim
+{
+  constexpr int max_dim = 6;
+
+  /* Offset of sorted coordinates ‘v’ (an array or an IntSequence) in a
+     folded tensor of ‘nv’ variables. This is the iterative form of the
+     formula given in tensor.cc: the coordinate vᵢ contributes the number of
+     sorted sequences of length D−i over nv−vᵢ₋₁ variables which begin with a
+     value lower than vᵢ−vᵢ₋₁. */
+  template<int D, class V>
+  inline int
+  foldedOffset(const V &v, int nv)
+  {
+    int res = 0;
+    int prev = 0;
+    for (int i = 0; i < D; i++)
+      {
+        int m = v[i]-prev;
+        if (m > 0)
+          {
+            int k = D-i;
+            res += PascalTriangle::noverk(nv+k-1, k) - PascalTriangle::noverk(nv-m+k-1, k);
+            nv -= m;
+            prev = v[i];
+          }
+      }
+    return res;
+  }
+
+  // Sorts the coordinates in increasing order (insertion sort)
+  template<int D>
+  inline void
+  sort(int *v)
+  {
+    for (int i = 1; i < D; i++)
+      for (int j = i; j > 0 && v[j-1] > v[j]; j--)
+        std::swap(v[j-1], v[j]);
+  }
+
+  template<class F, int D, class... Args>
+  inline bool
+  dispatchFrom(int d, Args &&... args)
+  {
+    if constexpr (D > max_dim)
+      return false;
+    else if (d == D)
+      {
+        F::template run<D>(std::forward<Args>(args)...);
+        return true;
+      }
+    else
+      return dispatchFrom<F, D+1>(d, std::forward<Args>(args)...);
+  }
+
+  template<class F, class... Args>
+  inline bool
+  dispatch(int d, Args &&... args)
+  {
+    return dispatchFrom<F, 1>(d, std::forward<Args>(args)...);
+  }
+};
+
+#endif
@@ -21,13 +21,197 @@
 #include "sparse_tensor.hh"
 #include "fs_tensor.hh"
 #include "tl_exception.hh"
+#include "small_dim.hh"
 
 #include <iostream>
 #include <iomanip>
 #include <cmath>
+#include <algorithm>
+
+SparseTensorMap::SparseTensorMap(const SparseTensorMap &m)
+  : dim{m.dim}
+{
+  m.compress();
+  keys = std::make_unique<IntSequence>(*m.keys);
+  colptr = m.colptr;
+  rows = m.rows;
+  vals = m.vals;
+}
+
+void
+SparseTensorMap::insert(const IntSequence &key, int r, double c)
+{
+  for (int i = 0; i < dim; i++)
+    pend_keys.push_back(key[i]);
+  pend_rows.push_back(r);
+  pend_vals.push_back(c);
+  dirty = true;
+}
+
+bool
+SparseTensorMap::keyLess(const int *k1, const int *k2) const
+{
+  return std::lexicographical_compare(k1, k1+dim, k2, k2+dim);
+}
+
+/* Here we merge the pending items to the compressed ones. We sort the
+   pending items by their keys and rows (through a permutation of their
+   positions), and then we merge the two sorted sequences into new arrays,
+   starting a new key whenever it differs from the previous one. A duplicate
+   pair of key and row is an error. */
+
+void
+SparseTensorMap::compress() const
+{
+  if (!dirty)
+    return;
+  std::lock_guard<std::mutex> lk{mut};
+  if (!dirty)
+    return;
+
+  int npend = pend_rows.size();
+  std::vector<int> order(npend);
+  for (int i = 0; i < npend; i++)
+    order[i] = i;
+  std::sort(order.begin(), order.end(),
+            [this](int i, int j)
+            {
+              const int *ki = pend_keys.data() + i*dim;
+              const int *kj = pend_keys.data() + j*dim;
+              if (keyLess(ki, kj))
+                return true;
+              if (keyLess(kj, ki))
+                return false;
+              return pend_rows[i] < pend_rows[j];
+            });
+
+  int nold = rows.size();
+  std::vector<int> new_keys;
+  std::vector<int> new_colptr;
+  std::vector<int> new_rows;
+  std::vector<double> new_vals;
+  new_keys.reserve(keys->size() + pend_keys.size());
+  new_rows.reserve(nold + npend);
+  new_vals.reserve(nold + npend);
+
+  int kold = 0; // Key of the compressed item ‘iold’
+  int iold = 0;
+  int ipend = 0;
+  const int *last_key = nullptr;
+  while (iold < nold || ipend < npend)
+    {
+      const int *k_old = iold < nold ? &(*keys)[kold*dim] : nullptr;
+      const int *k_pend = ipend < npend ? pend_keys.data() + order[ipend]*dim : nullptr;
+      bool take_old;
+      if (!k_pend)
+        take_old = true;
+      else if (!k_old)
+        take_old = false;
+      else if (keyLess(k_old, k_pend))
+        take_old = true;
+      else if (keyLess(k_pend, k_old))
+        take_old = false;
+      else
+        {
+          TL_RAISE_IF(rows[iold] == pend_rows[order[ipend]],
+                      "Duplicate <key, r> insertion in SparseTensor::insert");
+          take_old = rows[iold] < pend_rows[order[ipend]];
+        }
+
+      const int *k = take_old ? k_old : k_pend;
+      if (!last_key || keyLess(last_key, k))
+        {
+          new_colptr.push_back(new_rows.size());
+          new_keys.insert(new_keys.end(), k, k+dim);
+        }
+      else
+        TL_RAISE_IF(!take_old && new_rows.back() == pend_rows[order[ipend]],
+                    "Duplicate <key, r> insertion in SparseTensor::insert");
+      if (take_old)
+        {
+          new_rows.push_back(rows[iold]);
+          new_vals.push_back(vals[iold]);
+          iold++;
+          if (iold == colptr[kold+1])
+            kold++;
+        }
+      else
+        {
+          new_rows.push_back(pend_rows[order[ipend]]);
+          new_vals.push_back(pend_vals[order[ipend]]);
+          ipend++;
+        }
+      last_key = new_keys.data() + new_keys.size() - dim;
+    }
+  new_colptr.push_back(new_rows.size());
+
+  keys = std::make_unique<IntSequence>(new_keys.size());
+  std::copy(new_keys.begin(), new_keys.end(), &(*keys)[0]);
+  colptr = std::move(new_colptr);
+  rows = std::move(new_rows);
+  vals = std::move(new_vals);
+  pend_keys.clear();
+  pend_rows.clear();
+  pend_vals.clear();
+  dirty = false;
+}
+
+SparseTensorMap::const_iterator
+SparseTensorMap::lower_bound(const IntSequence &key) const
+{
+  compress();
+  int lo = 0, hi = numKeys();
+  while (lo < hi)
+    {
+      int mid = (lo + hi)/2;
+      if (getKey(mid) < key)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return { this, colptr[lo], lo };
+}
+
+SparseTensorMap::const_iterator
+SparseTensorMap::upper_bound(const IntSequence &key) const
+{
+  compress();
+  int lo = 0, hi = numKeys();
+  while (lo < hi)
+    {
+      int mid = (lo + hi)/2;
+      if (!(key < getKey(mid)))
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  return { this, colptr[lo], lo };
+}
+
+int
+SparseTensorMap::find(const int *key, const int *&r, const double *&c) const
+{
+  compress();
+  int lo = 0, hi = numKeys();
+  while (lo < hi)
+    {
+      int mid = (lo + hi)/2;
+      if (keyLess(&(*keys)[mid*dim], key))
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+  if (lo == numKeys() || keyLess(key, &(*keys)[lo*dim]))
+    return 0;
+  r = rows.data() + colptr[lo];
+  c = vals.data() + colptr[lo];
+  return colptr[lo+1] - colptr[lo];
+}
 
 /* This is straightforward. Before we insert anything, we do a few
-   checks. Then we reset ‘first_nz_row’ and ‘last_nz_row’ if necessary. */
+   checks. Then we reset ‘first_nz_row’ and ‘last_nz_row’ if necessary. The
+   uniqueness of the pair ‘key’ and ‘r’ is checked when the item is merged
+   to the compressed storage. */
 
 void
 SparseTensor::insert(IntSequence key, int r, double c)
@@ -39,14 +223,7 @@ SparseTensor::insert(IntSequence key, int r, double c)
   TL_RAISE_IF(!std::isfinite(c),
               "Insertion of non-finite value in SparseTensor::insert");
 
-  auto first_pos = m.lower_bound(key);
-
-  // check that pair ‘key’ and ‘r’ is unique
-  auto last_pos = m.upper_bound(key);
-  for (auto it = first_pos; it != last_pos; ++it)
-    TL_RAISE_IF(it->second.first == r, "Duplicate <key, r> insertion in SparseTensor::insert");
-
-  m.emplace_hint(first_pos, std::move(key), std::make_pair(r, c));
+  m.insert(key, r, c);
   if (first_nz_row > r)
     first_nz_row = r;
   if (last_nz_row < r)
@@ -80,7 +257,8 @@ SparseTensor::getFoldIndexFillFactor() const
   while (start_col != m.end())
     {
       cnt++;
-      const IntSequence &key = start_col->first;
+      auto item = *start_col;
+      const IntSequence &key = item.first;
       start_col = m.upper_bound(key);
     }
 
@@ -97,7 +275,8 @@ SparseTensor::getUnfoldIndexFillFactor() const
   auto start_col = m.begin();
   while (start_col != m.end())
     {
-      const IntSequence &key = start_col->first;
+      auto item = *start_col;
+      const IntSequence &key = item.first;
       cnt += key.getSymmetry().noverseq();
       start_col = m.upper_bound(key);
     }
@@ -116,7 +295,8 @@ SparseTensor::print() const
   auto start_col = m.begin();
   while (start_col != m.end())
     {
-      const IntSequence &key = start_col->first;
+      auto item = *start_col;
+      const IntSequence &key = item.first;
       std::cout << "Column: ";
       key.print();
       auto end_col = m.upper_bound(key);
@@ -160,7 +340,45 @@ FSSparseTensor::insert(IntSequence key, int r, double c)
    I have also tried to make the loop through the sparse tensor outer, and
    find index of tensor ‘t’ within the loop. Surprisingly, it is little
    slower (for monomial tests with probability of zeros equal 0.3). But
-   everything depends how filled is the sparse tensor. */
+   everything depends how filled is the sparse tensor.
+
+   This is called for every column of the stacked unfolded tensors, so for
+   the dimensions up to SmallDim::max_dim the key is sorted in an array on
+   the stack, and looked up by SparseTensorMap::find(), without any heap
+   allocation per item. */
+
+namespace
+{
+  struct SparseColumnMult
+  {
+    template<int D>
+    static void
+    run(const FSSparseTensor &s, const Tensor &t, Vector &v)
+    {
+      int key[D];
+      for (Tensor::index it = t.begin(); it != t.end(); ++it)
+        {
+          double a = t.get(*it, 0);
+          if (a != 0.0)
+            {
+              const IntSequence &coor = it.getCoor();
+              for (int i = 0; i < D; i++)
+                key[i] = coor[i];
+              SmallDim::sort<D>(key);
+
+              TL_RAISE_IF(key[0] < 0 || key[D-1] >= s.nvar(),
+                          "Wrong coordinates of index in FSSparseTensor::multColumnAndAdd");
+
+              const int *r;
+              const double *c;
+              int n = s.getMap().find(key, r, c);
+              for (int j = 0; j < n; j++)
+                v[r[j]] += c[j] * a;
+            }
+        }
+    }
+  };
+}
 
 void
 FSSparseTensor::multColumnAndAdd(const Tensor &t, Vector &v) const
@@ -173,6 +391,9 @@ FSSparseTensor::multColumnAndAdd(const Tensor &t, Vector &v) const
   TL_RAISE_IF(t.ncols() != 1,
               "The input tensor is not single-column in FSSparseTensor::multColumnAndAdd");
 
+  if (SmallDim::dispatch<SparseColumnMult>(dimen(), *this, t, v))
+    return;
+
   for (Tensor::index it = t.begin(); it != t.end(); ++it)
     {
       int ind = *it;
@@ -186,14 +407,11 @@ FSSparseTensor::multColumnAndAdd(const Tensor &t, Vector &v) const
           TL_RAISE_IF(key[0] < 0 || key[key.size()-1] >= nv,
                       "Wrong coordinates of index in FSSparseTensor::multColumnAndAdd");
 
-          auto first_pos = m.lower_bound(key);
-          auto last_pos = m.upper_bound(key);
-          for (auto cit = first_pos; cit != last_pos; ++cit)
-            {
-              int r = cit->second.first;
-              double c = cit->second.second;
-              v[r] += c * a;
-            }
+          const int *r;
+          const double *c;
+          int n = m.find(&key[0], r, c);
+          for (int j = 0; j < n; j++)
+            v[r[j]] += c[j] * a;
         }
     }
 }
@@ -21,15 +21,13 @@
 // Sparse tensor.
 
 /* Here we declare a sparse full and general symmetry tensors with the
-   multidimensional index along columns. We implement them as a std::multimap
-   associating to each sequence of coordinates IntSequence a set of pairs (row,
-   number). This is very convenient but not optimal in terms of memory
-   consumption. So the implementation can be changed.
+   multidimensional index along columns. The items are stored in a compressed
+   layout (see SparseTensorMap below) associating to each sequence of
+   coordinates IntSequence a set of pairs (row, number).
 
-   The current std::multimap implementation allows insertions. Another
-   advantage of this approach is that we do not need to calculate column
-   numbers from the IntSequence, since the column is accessed directly via the
-   key which is IntSequence.
+   The storage allows insertions. Another advantage of this approach is that
+   we do not need to calculate column numbers from the IntSequence, since the
+   column is accessed directly via the key which is IntSequence.
 
    The only operation we need to do with the full symmetry sparse tensor
    is a left multiplication of a row oriented single column tensor. The
@@ -47,25 +45,166 @@
 #include "gs_tensor.hh"
 #include "Vector.hh"
 
-#include <map>
+#include <vector>
+#include <utility>
+#include <atomic>
+#include <mutex>
+#include <memory>
 
-struct ltseq
+/* This is the storage of the items of a sparse tensor. It used to be a
+   std::multimap<IntSequence, std::pair<int, double>>, and it keeps the part
+   of the interface of the multimap which we need: begin(), end(),
+   lower_bound(), upper_bound() and size(), dereferencing of an iterator gives
+   an item with members ‘first’ (the key) and ‘second’ (the row and the value).
+
+   However, the items are stored in flat arrays, similarly to the compressed
+   sparse column format. The distinct keys, each having ‘dim’ integers, are
+   packed one after another in ‘keys’ in the lexicographic order. The rows and
+   values of the items are in ‘rows’ and ‘vals’, sorted by the keys and by the
+   rows within the same key. The items of the k-th key are at positions from
+   ‘colptr[k]’ (included) to ‘colptr[k+1]’ (excluded). A lookup of a key is a
+   binary search in a contiguous array, and a traversal of a range of keys
+   (as in slicing) is a sequential scan.
+
+   The insertions are appended (unsorted) to the arrays of pending items, and
+   they are merged to the flat arrays only at the first lookup following them.
+   So a tensor filled item by item is sorted only once. The merge is guarded
+   by a mutex, so that concurrent lookups are safe. Insertions must not be
+   done concurrently with any other operation. */
+
+class SparseTensorMap
 {
-  bool
-  operator()(const IntSequence &s1, const IntSequence &s2) const
+public:
+  struct Item
+  {
+    // A view to the packed key, valid while the map is not modified
+    const IntSequence first;
+    std::pair<int, double> second;
+  };
+
+  class const_iterator
+  {
+    friend class SparseTensorMap;
+    const SparseTensorMap *map;
+    int item; // Position in ‘rows’ and ‘vals’
+    int key; // Position of the key of ‘item’
+    const_iterator(const SparseTensorMap *m, int i, int k)
+      : map{m}, item{i}, key{k}
+    {
+    }
+  public:
+    struct Arrow
+    {
+      Item it;
+      const Item *
+      operator->() const
+      {
+        return &it;
+      }
+    };
+    Item
+    operator*() const
+    {
+      return { map->getKey(key), { map->rows[item], map->vals[item] } };
+    }
+    Arrow
+    operator->() const
+    {
+      return { **this };
+    }
+    const_iterator &
+    operator++()
+    {
+      item++;
+      if (item == map->colptr[key+1])
+        key++;
+      return *this;
+    }
+    bool
+    operator==(const const_iterator &it) const
+    {
+      return item == it.item;
+    }
+    bool
+    operator!=(const const_iterator &it) const
+    {
+      return item != it.item;
+    }
+  };
+
+private:
+  int dim;
+  // Compressed items (‘keys’ is a pointer since IntSequence cannot be resized)
+  mutable std::unique_ptr<IntSequence> keys;
+  mutable std::vector<int> colptr;
+  mutable std::vector<int> rows;
+  mutable std::vector<double> vals;
+  // Pending insertions, ‘pend_keys’ are packed as ‘keys’
+  mutable std::vector<int> pend_keys;
+  mutable std::vector<int> pend_rows;
+  mutable std::vector<double> pend_vals;
+  mutable std::atomic<bool> dirty{false};
+  mutable std::mutex mut;
+public:
+  explicit SparseTensorMap(int d)
+    : dim{d}, keys{std::make_unique<IntSequence>(0)}, colptr{0}
+  {
+  }
+  SparseTensorMap(const SparseTensorMap &m);
+  SparseTensorMap &operator=(const SparseTensorMap &m) = delete;
+
+  void insert(const IntSequence &key, int r, double c);
+
+  const_iterator
+  begin() const
+  {
+    compress();
+    return { this, 0, 0 };
+  }
+  const_iterator
+  end() const
+  {
+    compress();
+    return { this, static_cast<int>(rows.size()), static_cast<int>(colptr.size())-1 };
+  }
+  // Iterator to the first item whose key is not less than ‘key’
+  const_iterator lower_bound(const IntSequence &key) const;
+  // Iterator to the first item whose key is greater than ‘key’
+  const_iterator upper_bound(const IntSequence &key) const;
+  /* Looks up the ‘dim’ integers at ‘key’, points ‘r’ and ‘c’ to the rows
+     and values of its items, and returns their number (zero if the key is
+     not present). This is the same as the range from lower_bound() to
+     upper_bound(), without constructing any IntSequence. */
+  int find(const int *key, const int *&r, const double *&c) const;
+  int
+  size() const
+  {
+    compress();
+    return rows.size();
+  }
+private:
+  int
+  numKeys() const
+  {
+    return colptr.size()-1;
+  }
+  IntSequence
+  getKey(int k) const
   {
-    return s1 < s2;
+    return IntSequence(*keys, k*dim, (k+1)*dim);
   }
+  bool keyLess(const int *k1, const int *k2) const;
+  void compress() const;
 };
 
 /* This is a super class of both full symmetry and general symmetry sparse
-   tensors. It contains a std::multimap and implements insertions. It tracks
+   tensors. It contains a SparseTensorMap and implements insertions. It tracks
    maximum and minimum row, for which there is an item. */
 
 class SparseTensor
 {
 public:
-  using Map = std::multimap<IntSequence, std::pair<int, double>, ltseq>;
+  using Map = SparseTensorMap;
 protected:
   Map m;
   int dim;
@@ -75,7 +214,7 @@ protected:
   int last_nz_row;
 public:
   SparseTensor(int d, int nnr, int nnc)
-    : dim(d), nr(nnr), nc(nnc), first_nz_row(nr), last_nz_row(-1)
+    : m(d), dim(d), nr(nnr), nc(nnc), first_nz_row(nr), last_nz_row(-1)
   {
   }
   void insert(IntSequence s, int r, double c);
@@ -24,6 +24,15 @@
 
 #include <memory>
 
+bool StackOutputBase::thread_local_sums = false;
+
+void
+WorkerAddTo::operator()(std::mutex &mut)
+{
+  GeneralMatrix to_block(to, 0, first_col, to.nrows(), num_cols);
+  to_block.add(1.0, ConstGeneralMatrix(from, 0, first_col, from.nrows(), num_cols));
+}
+
 // FoldedStackContainer::multAndAdd() sparse code
 /* Here we multiply the sparse tensor with the FoldedStackContainer. We have
    four implementations, multAndAddSparse1(), multAndAddSparse2(),
@@ -55,13 +64,15 @@ FoldedStackContainer::multAndAdd(int dim, const FGSContainer &c, FGSTensor &out)
   TL_RAISE_IF(c.num() != numStacks(),
               "Wrong symmetry length of container for FoldedStackContainer::multAndAdd");
 
+  StackOutput<FGSTensor> sums(out);
   sthread::detach_thread_group gr;
 
   for (auto &si : SymmetrySet(dim, c.num()))
     if (c.check(si))
-      gr.insert(std::make_unique<WorkerFoldMAADense>(*this, si, c, out));
+      gr.insert(std::make_unique<WorkerFoldMAADense>(*this, si, c, sums));
 
   gr.run();
+  sums.reduce();
 }
 
 /* This is analogous to WorkerUnfoldMAADense::operator()() code. */
@@ -69,16 +80,18 @@ FoldedStackContainer::multAndAdd(int dim, const FGSContainer &c, FGSTensor &out)
 void
 WorkerFoldMAADense::operator()(std::mutex &mut)
 {
+  MemoryArenaScope arena;
   Permutation iden(dense_cont.num());
   IntSequence coor(iden.getMap().unfold(sym));
   const FGSTensor &g = dense_cont.get(sym);
-  cont.multAndAddStacks(coor, g, out, mut);
+  auto [o, m] = out.target(mut);
+  cont.multAndAddStacks(coor, g, o, m);
 }
 
 WorkerFoldMAADense::WorkerFoldMAADense(const FoldedStackContainer &container,
                                        Symmetry s,
                                        const FGSContainer &dcontainer,
-                                       FGSTensor &outten)
+                                       StackOutput<FGSTensor> &outten)
   : cont(container), sym(std::move(s)), dense_cont(dcontainer), out(outten)
 {
 }
@@ -88,12 +101,14 @@ void
 FoldedStackContainer::multAndAddSparse1(const FSSparseTensor &t,
                                         FGSTensor &out) const
 {
+  StackOutput<FGSTensor> sums(out);
   sthread::detach_thread_group gr;
   UFSTensor dummy(0, numStacks(), t.dimen());
   for (Tensor::index ui = dummy.begin(); ui != dummy.end(); ++ui)
-    gr.insert(std::make_unique<WorkerFoldMAASparse1>(*this, t, out, ui.getCoor()));
+    gr.insert(std::make_unique<WorkerFoldMAASparse1>(*this, t, sums, ui.getCoor()));
 
   gr.run();
+  sums.reduce();
 }
 
 /* This is analogous to WorkerUnfoldMAASparse1::operator()() code.
@@ -108,44 +123,37 @@ FoldedStackContainer::multAndAddSparse1(const FSSparseTensor &t,
 void
 WorkerFoldMAASparse1::operator()(std::mutex &mut)
 {
-  const EquivalenceSet &eset = TLStatic::getEquiv(out.dimen());
-  const PermutationSet &pset = TLStatic::getPerm(t.dimen());
-  Permutation iden(t.dimen());
+  MemoryArenaScope arena;
+  auto [o, m] = out.target(mut);
+  const std::vector<const Equivalence *> &eqs = TLStatic::getEquiv(o.dimen(), t.dimen());
 
   UPSTensor slice(t, cont.getStackSizes(), coor,
                   PerTensorDimens(cont.getStackSizes(), coor));
-  for (int iper = 0; iper < pset.getNum(); iper++)
-    {
-      const Permutation &per = pset.get(iper);
-      IntSequence percoor(coor.size());
-      per.apply(coor, percoor);
-      for (const auto &it : eset)
-        {
-          if (it.numClasses() == t.dimen())
-            {
-              StackProduct<FGSTensor> sp(cont, it, out.getSym());
-              if (!sp.isZero(percoor))
+  IntSequence opercoor(coor.size());
+  for (const auto &percoor : TLStatic::getArrangements(coor))
+    for (auto it : eqs)
+      {
+        StackProduct<FGSTensor> sp(cont, *it, o.getSym());
+        if (!sp.isZero(percoor))
+          {
+            KronProdStack<FGSTensor> kp(sp, percoor);
+            kp.optimizeOrder();
+            kp.getPer().apply(percoor, opercoor);
+            if (opercoor == coor)
+              {
+                FPSTensor fps(o.getDims(), *it, slice, kp);
                 {
-                  KronProdStack<FGSTensor> kp(sp, percoor);
-                  kp.optimizeOrder();
-                  const Permutation &oper = kp.getPer();
-                  if (Permutation(oper, per) == iden)
-                    {
-                      FPSTensor fps(out.getDims(), it, slice, kp);
-                      {
-                        std::unique_lock<std::mutex> lk{mut};
-                        fps.addTo(out);
-                      }
-                    }
+                  std::unique_lock<std::mutex> lk{m};
+                  fps.addTo(o);
                 }
-            }
-        }
-    }
+              }
+          }
+      }
 }
 
 WorkerFoldMAASparse1::WorkerFoldMAASparse1(const FoldedStackContainer &container,
                                            const FSSparseTensor &ten,
-                                           FGSTensor &outten, IntSequence c)
+                                           StackOutput<FGSTensor> &outten, IntSequence c)
   : cont(container), t(ten), out(outten), coor(std::move(c))
 {
 }
@@ -160,12 +168,14 @@ void
 FoldedStackContainer::multAndAddSparse2(const FSSparseTensor &t,
                                         FGSTensor &out) const
 {
+  StackOutput<FGSTensor> sums(out);
   sthread::detach_thread_group gr;
   FFSTensor dummy_f(0, numStacks(), t.dimen());
   for (Tensor::index fi = dummy_f.begin(); fi != dummy_f.end(); ++fi)
-    gr.insert(std::make_unique<WorkerFoldMAASparse2>(*this, t, out, fi.getCoor()));
+    gr.insert(std::make_unique<WorkerFoldMAASparse2>(*this, t, sums, fi.getCoor()));
 
   gr.run();
+  sums.reduce();
 }
 
 /* Here we make a sparse slice first and then call multAndAddStacks()
@@ -182,27 +192,29 @@ FoldedStackContainer::multAndAddSparse2(const FSSparseTensor &t,
 void
 WorkerFoldMAASparse2::operator()(std::mutex &mut)
 {
+  MemoryArenaScope arena;
   GSSparseTensor slice(t, cont.getStackSizes(), coor,
                        TensorDimens(cont.getStackSizes(), coor));
   if (slice.getNumNonZero())
     {
+      auto [o, m] = out.target(mut);
       if (slice.getUnfoldIndexFillFactor() > FoldedStackContainer::fill_threshold)
         {
           FGSTensor dense_slice(slice);
           int r1 = slice.getFirstNonZeroRow();
           int r2 = slice.getLastNonZeroRow();
           FGSTensor dense_slice1(r1, r2-r1+1, dense_slice);
-          FGSTensor out1(r1, r2-r1+1, out);
-          cont.multAndAddStacks(coor, dense_slice1, out1, mut);
+          FGSTensor out1(r1, r2-r1+1, o);
+          cont.multAndAddStacks(coor, dense_slice1, out1, m);
         }
       else
-        cont.multAndAddStacks(coor, slice, out, mut);
+        cont.multAndAddStacks(coor, slice, o, m);
     }
 }
 
 WorkerFoldMAASparse2::WorkerFoldMAASparse2(const FoldedStackContainer &container,
                                            const FSSparseTensor &ten,
-                                           FGSTensor &outten, IntSequence c)
+                                           StackOutput<FGSTensor> &outten, IntSequence c)
   : cont(container), t(ten), out(outten), coor(std::move(c))
 {
 }
@@ -225,20 +237,19 @@ void
 FoldedStackContainer::multAndAddSparse3(const FSSparseTensor &t,
                                         FGSTensor &out) const
 {
-  const EquivalenceSet &eset = TLStatic::getEquiv(out.dimen());
+  const std::vector<const Equivalence *> &eqs = TLStatic::getEquiv(out.dimen(), t.dimen());
   for (Tensor::index run = out.begin(); run != out.end(); ++run)
     {
       Vector outcol{out.getCol(*run)};
       FRSingleTensor sumcol(t.nvar(), t.dimen());
       sumcol.zeros();
-      for (const auto &it : eset)
-        if (it.numClasses() == t.dimen())
-          {
-            StackProduct<FGSTensor> sp(*this, it, out.getSym());
-            IrregTensorHeader header(sp, run.getCoor());
-            IrregTensor irten(header);
-            irten.addTo(sumcol);
-          }
+      for (auto it : eqs)
+        {
+          StackProduct<FGSTensor> sp(*this, *it, out.getSym());
+          IrregTensorHeader header(sp, run.getCoor());
+          IrregTensor irten(header);
+          irten.addTo(sumcol);
+        }
       t.multColumnAndAdd(sumcol, outcol);
     }
 }
@@ -254,12 +265,14 @@ FoldedStackContainer::multAndAddSparse3(const FSSparseTensor &t,
 void
 FoldedStackContainer::multAndAddSparse4(const FSSparseTensor &t, FGSTensor &out) const
 {
+  StackOutput<FGSTensor> sums(out);
   sthread::detach_thread_group gr;
   FFSTensor dummy_f(0, numStacks(), t.dimen());
   for (Tensor::index fi = dummy_f.begin(); fi != dummy_f.end(); ++fi)
-    gr.insert(std::make_unique<WorkerFoldMAASparse4>(*this, t, out, fi.getCoor()));
+    gr.insert(std::make_unique<WorkerFoldMAASparse4>(*this, t, sums, fi.getCoor()));
 
   gr.run();
+  sums.reduce();
 }
 
 /* The WorkerFoldMAASparse4 is the same as WorkerFoldMAASparse2
@@ -269,15 +282,19 @@ FoldedStackContainer::multAndAddSparse4(const FSSparseTensor &t, FGSTensor &out)
 void
 WorkerFoldMAASparse4::operator()(std::mutex &mut)
 {
+  MemoryArenaScope arena;
   GSSparseTensor slice(t, cont.getStackSizes(), coor,
                        TensorDimens(cont.getStackSizes(), coor));
   if (slice.getNumNonZero())
-    cont.multAndAddStacks(coor, slice, out, mut);
+    {
+      auto [o, m] = out.target(mut);
+      cont.multAndAddStacks(coor, slice, o, m);
+    }
 }
 
 WorkerFoldMAASparse4::WorkerFoldMAASparse4(const FoldedStackContainer &container,
                                            const FSSparseTensor &ten,
-                                           FGSTensor &outten, IntSequence c)
+                                           StackOutput<FGSTensor> &outten, IntSequence c)
   : cont(container), t(ten), out(outten), coor(std::move(c))
 {
 }
@@ -294,34 +311,27 @@ FoldedStackContainer::multAndAddStacks(const IntSequence &coor,
                                        const FGSTensor &g,
                                        FGSTensor &out, std::mutex &mut) const
 {
-  const EquivalenceSet &eset = TLStatic::getEquiv(out.dimen());
+  const std::vector<const Equivalence *> &eqs = TLStatic::getEquiv(out.dimen(), g.dimen());
 
   UGSTensor ug(g);
-  UFSTensor dummy_u(0, numStacks(), g.dimen());
-  for (Tensor::index ui = dummy_u.begin(); ui != dummy_u.end(); ++ui)
+  for (const auto &ucoor : TLStatic::getArrangements(coor))
     {
-      IntSequence tmp(ui.getCoor());
-      tmp.sort();
-      if (tmp == coor)
+      Permutation sort_per(ucoor);
+      sort_per.inverse();
+      for (auto it : eqs)
         {
-          Permutation sort_per(ui.getCoor());
-          sort_per.inverse();
-          for (const auto &it : eset)
-            if (it.numClasses() == g.dimen())
+          StackProduct<FGSTensor> sp(*this, *it, sort_per, out.getSym());
+          if (!sp.isZero(coor))
+            {
+              KronProdStack<FGSTensor> kp(sp, coor);
+              if (ug.getSym().isFull())
+                kp.optimizeOrder();
+              FPSTensor fps(out.getDims(), *it, sort_per, ug, kp);
               {
-                StackProduct<FGSTensor> sp(*this, it, sort_per, out.getSym());
-                if (!sp.isZero(coor))
-                  {
-                    KronProdStack<FGSTensor> kp(sp, coor);
-                    if (ug.getSym().isFull())
-                      kp.optimizeOrder();
-                    FPSTensor fps(out.getDims(), it, sort_per, ug, kp);
-                    {
-                      std::unique_lock<std::mutex> lk{mut};
-                      fps.addTo(out);
-                    }
-                  }
+                std::unique_lock<std::mutex> lk{mut};
+                fps.addTo(out);
               }
+            }
         }
     }
 }
@@ -336,30 +346,23 @@ FoldedStackContainer::multAndAddStacks(const IntSequence &coor,
                                        const GSSparseTensor &g,
                                        FGSTensor &out, std::mutex &mut) const
 {
-  const EquivalenceSet &eset = TLStatic::getEquiv(out.dimen());
-  UFSTensor dummy_u(0, numStacks(), g.dimen());
-  for (Tensor::index ui = dummy_u.begin(); ui != dummy_u.end(); ++ui)
+  const std::vector<const Equivalence *> &eqs = TLStatic::getEquiv(out.dimen(), g.dimen());
+  for (const auto &ucoor : TLStatic::getArrangements(coor))
     {
-      IntSequence tmp(ui.getCoor());
-      tmp.sort();
-      if (tmp == coor)
+      Permutation sort_per(ucoor);
+      sort_per.inverse();
+      for (auto it : eqs)
         {
-          Permutation sort_per(ui.getCoor());
-          sort_per.inverse();
-          for (const auto &it : eset)
-            if (it.numClasses() == g.dimen())
+          StackProduct<FGSTensor> sp(*this, *it, sort_per, out.getSym());
+          if (!sp.isZero(coor))
+            {
+              KronProdStack<FGSTensor> kp(sp, coor);
+              FPSTensor fps(out.getDims(), *it, sort_per, g, kp);
               {
-                StackProduct<FGSTensor> sp(*this, it, sort_per, out.getSym());
-                if (!sp.isZero(coor))
-                  {
-                    KronProdStack<FGSTensor> kp(sp, coor);
-                    FPSTensor fps(out.getDims(), it, sort_per, g, kp);
-                    {
-                      std::unique_lock<std::mutex> lk{mut};
-                      fps.addTo(out);
-                    }
-                  }
+                std::unique_lock<std::mutex> lk{mut};
+                fps.addTo(out);
               }
+            }
         }
     }
 }
@@ -397,27 +400,31 @@ UnfoldedStackContainer::multAndAdd(int dim, const UGSContainer &c,
   TL_RAISE_IF(c.num() != numStacks(),
               "Wrong symmetry length of container for UnfoldedStackContainer::multAndAdd");
 
+  StackOutput<UGSTensor> sums(out);
   sthread::detach_thread_group gr;
   for (auto &si : SymmetrySet(dim, c.num()))
     if (c.check(si))
-      gr.insert(std::make_unique<WorkerUnfoldMAADense>(*this, si, c, out));
+      gr.insert(std::make_unique<WorkerUnfoldMAADense>(*this, si, c, sums));
 
   gr.run();
+  sums.reduce();
 }
 
 void
 WorkerUnfoldMAADense::operator()(std::mutex &mut)
 {
+  MemoryArenaScope arena;
   Permutation iden(dense_cont.num());
   IntSequence coor(iden.getMap().unfold(sym));
   const UGSTensor &g = dense_cont.get(sym);
-  cont.multAndAddStacks(coor, g, out, mut);
+  auto [o, m] = out.target(mut);
+  cont.multAndAddStacks(coor, g, o, m);
 }
 
 WorkerUnfoldMAADense::WorkerUnfoldMAADense(const UnfoldedStackContainer &container,
                                            Symmetry s,
                                            const UGSContainer &dcontainer,
-                                           UGSTensor &outten)
+                                           StackOutput<UGSTensor> &outten)
   : cont(container), sym(std::move(s)), dense_cont(dcontainer), out(outten)
 {
 }
@@ -440,12 +447,14 @@ void
 UnfoldedStackContainer::multAndAddSparse1(const FSSparseTensor &t,
                                           UGSTensor &out) const
 {
+  StackOutput<UGSTensor> sums(out);
   sthread::detach_thread_group gr;
   UFSTensor dummy(0, numStacks(), t.dimen());
   for (Tensor::index ui = dummy.begin(); ui != dummy.end(); ++ui)
-    gr.insert(std::make_unique<WorkerUnfoldMAASparse1>(*this, t, out, ui.getCoor()));
+    gr.insert(std::make_unique<WorkerUnfoldMAASparse1>(*this, t, sums, ui.getCoor()));
 
   gr.run();
+  sums.reduce();
 }
 
 /* This does a step of UnfoldedStackContainer::multAndAddSparse1() for
@@ -469,47 +478,51 @@ UnfoldedStackContainer::multAndAddSparse1(const FSSparseTensor &t,
    rule out permutations ‘per’ leading to the same ordering of stacks when
    applied on ‘coor’.
 
+   Since all the permutations giving the same ‘percoor’ give the same
+   optimized KronProdStack, we do not go through the permutations but only
+   through the distinct arrangements ‘percoor’ of ‘coor’, tabulated by
+   TLStatic::getArrangements(). For each of them, the condition oper∘per = id
+   holds for exactly one permutation, namely per = oper⁻¹, and this
+   permutation maps ‘coor’ to ‘percoor’ if and only if percoor∘oper = coor.
+   The equivalences with the right number of classes are also tabulated by
+   TLStatic.
+
    TODO: vertically narrow slice and out according to the fill in t. */
 
 void
 WorkerUnfoldMAASparse1::operator()(std::mutex &mut)
 {
-  const EquivalenceSet &eset = TLStatic::getEquiv(out.dimen());
-  const PermutationSet &pset = TLStatic::getPerm(t.dimen());
-  Permutation iden(t.dimen());
+  MemoryArenaScope arena;
+  auto [o, m] = out.target(mut);
+  const std::vector<const Equivalence *> &eqs = TLStatic::getEquiv(o.dimen(), t.dimen());
 
   UPSTensor slice(t, cont.getStackSizes(), coor,
                   PerTensorDimens(cont.getStackSizes(), coor));
-  for (int iper = 0; iper < pset.getNum(); iper++)
-    {
-      const Permutation &per = pset.get(iper);
-      IntSequence percoor(coor.size());
-      per.apply(coor, percoor);
-      for (const auto &it : eset)
-        if (it.numClasses() == t.dimen())
+  IntSequence opercoor(coor.size());
+  for (const auto &percoor : TLStatic::getArrangements(coor))
+    for (auto it : eqs)
+      {
+        StackProduct<UGSTensor> sp(cont, *it, o.getSym());
+        if (!sp.isZero(percoor))
           {
-            StackProduct<UGSTensor> sp(cont, it, out.getSym());
-            if (!sp.isZero(percoor))
+            KronProdStack<UGSTensor> kp(sp, percoor);
+            kp.optimizeOrder();
+            kp.getPer().apply(percoor, opercoor);
+            if (opercoor == coor)
               {
-                KronProdStack<UGSTensor> kp(sp, percoor);
-                kp.optimizeOrder();
-                const Permutation &oper = kp.getPer();
-                if (Permutation(oper, per) == iden)
-                  {
-                    UPSTensor ups(out.getDims(), it, slice, kp);
-                    {
-                      std::unique_lock<std::mutex> lk{mut};
-                      ups.addTo(out);
-                    }
-                  }
+                UPSTensor ups(o.getDims(), *it, slice, kp);
+                {
+                  std::unique_lock<std::mutex> lk{m};
+                  ups.addTo(o);
+                }
               }
           }
-    }
+      }
 }
 
 WorkerUnfoldMAASparse1::WorkerUnfoldMAASparse1(const UnfoldedStackContainer &container,
                                                const FSSparseTensor &ten,
-                                               UGSTensor &outten, IntSequence c)
+                                               StackOutput<UGSTensor> &outten, IntSequence c)
   : cont(container), t(ten), out(outten), coor(std::move(c))
 {
 }
@@ -539,12 +552,14 @@ void
 UnfoldedStackContainer::multAndAddSparse2(const FSSparseTensor &t,
                                           UGSTensor &out) const
 {
+  StackOutput<UGSTensor> sums(out);
   sthread::detach_thread_group gr;
   FFSTensor dummy_f(0, numStacks(), t.dimen());
   for (Tensor::index fi = dummy_f.begin(); fi != dummy_f.end(); ++fi)
-    gr.insert(std::make_unique<WorkerUnfoldMAASparse2>(*this, t, out, fi.getCoor()));
+    gr.insert(std::make_unique<WorkerUnfoldMAASparse2>(*this, t, sums, fi.getCoor()));
 
   gr.run();
+  sums.reduce();
 }
 
 /* This does a step of UnfoldedStackContainer::multAndAddSparse2() for a given
@@ -557,6 +572,7 @@ UnfoldedStackContainer::multAndAddSparse2(const FSSparseTensor &t,
 void
 WorkerUnfoldMAASparse2::operator()(std::mutex &mut)
 {
+  MemoryArenaScope arena;
   GSSparseTensor slice(t, cont.getStackSizes(), coor,
                        TensorDimens(cont.getStackSizes(), coor));
   if (slice.getNumNonZero())
@@ -566,15 +582,16 @@ WorkerUnfoldMAASparse2::operator()(std::mutex &mut)
       int r1 = slice.getFirstNonZeroRow();
       int r2 = slice.getLastNonZeroRow();
       UGSTensor dense_slice1(r1, r2-r1+1, dense_slice);
-      UGSTensor out1(r1, r2-r1+1, out);
+      auto [o, m] = out.target(mut);
+      UGSTensor out1(r1, r2-r1+1, o);
 
-      cont.multAndAddStacks(coor, dense_slice1, out1, mut);
+      cont.multAndAddStacks(coor, dense_slice1, out1, m);
     }
 }
 
 WorkerUnfoldMAASparse2::WorkerUnfoldMAASparse2(const UnfoldedStackContainer &container,
                                                const FSSparseTensor &ten,
-                                               UGSTensor &outten, IntSequence c)
+                                               StackOutput<UGSTensor> &outten, IntSequence c)
   : cont(container), t(ten), out(outten), coor(std::move(c))
 {
 }
@@ -584,12 +601,13 @@ WorkerUnfoldMAASparse2::WorkerUnfoldMAASparse2(const UnfoldedStackContainer &con
    contributes to ‘out’ all tensors in unfolded stack formula involving
    stacks chosen by ‘fi’.
 
-   We go through all ‘ui’ coordinates which yield ‘fi’ after sorting. We
-   construct a permutation ‘sort_per’ which sorts ‘ui’ to ‘fi’. We go
-   through all appropriate equivalences, and construct StackProduct
-   from equivalence classes permuted by ‘sort_per’, then UPSTensor with
-   implied permutation of columns by the permuted equivalence by
-   ‘sort_per’. The UPSTensor is then added to ‘out’.
+   We go through all ‘ui’ coordinates which yield ‘fi’ after sorting (they
+   are tabulated by TLStatic::getArrangements()). We construct a
+   permutation ‘sort_per’ which sorts ‘ui’ to ‘fi’. We go through all
+   appropriate equivalences, and construct StackProduct from equivalence
+   classes permuted by ‘sort_per’, then UPSTensor with implied permutation
+   of columns by the permuted equivalence by ‘sort_per’. The UPSTensor is
+   then added to ‘out’.
 
    We cannot use here the optimized KronProdStack, since the symmetry
    of ‘UGSTensor& g’ prescribes the ordering of the stacks. However, if
@@ -600,33 +618,26 @@ UnfoldedStackContainer::multAndAddStacks(const IntSequence &fi,
                                          const UGSTensor &g,
                                          UGSTensor &out, std::mutex &mut) const
 {
-  const EquivalenceSet &eset = TLStatic::getEquiv(out.dimen());
+  const std::vector<const Equivalence *> &eqs = TLStatic::getEquiv(out.dimen(), g.dimen());
 
-  UFSTensor dummy_u(0, numStacks(), g.dimen());
-  for (Tensor::index ui = dummy_u.begin(); ui != dummy_u.end(); ++ui)
+  for (const auto &ucoor : TLStatic::getArrangements(fi))
     {
-      IntSequence tmp(ui.getCoor());
-      tmp.sort();
-      if (tmp == fi)
+      Permutation sort_per(ucoor);
+      sort_per.inverse();
+      for (auto it : eqs)
         {
-          Permutation sort_per(ui.getCoor());
-          sort_per.inverse();
-          for (const auto &it : eset)
-            if (it.numClasses() == g.dimen())
+          StackProduct<UGSTensor> sp(*this, *it, sort_per, out.getSym());
+          if (!sp.isZero(fi))
+            {
+              KronProdStack<UGSTensor> kp(sp, fi);
+              if (g.getSym().isFull())
+                kp.optimizeOrder();
+              UPSTensor ups(out.getDims(), *it, sort_per, g, kp);
               {
-                StackProduct<UGSTensor> sp(*this, it, sort_per, out.getSym());
-                if (!sp.isZero(fi))
-                  {
-                    KronProdStack<UGSTensor> kp(sp, fi);
-                    if (g.getSym().isFull())
-                      kp.optimizeOrder();
-                    UPSTensor ups(out.getDims(), it, sort_per, g, kp);
-                    {
-                      std::unique_lock<std::mutex> lk{mut};
-                      ups.addTo(out);
-                    }
-                  }
+                std::unique_lock<std::mutex> lk{mut};
+                ups.addTo(out);
               }
+            }
         }
     }
 }
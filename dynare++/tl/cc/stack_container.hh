@@ -72,8 +72,9 @@
                                   UnfoldedZContainer
 
 
-   We have also two supporting classes StackProduct and KronProdStack
-   and a number of worker classes used as threads. */
+   We have also two supporting classes StackProduct and KronProdStack,
+   the StackOutput class through which the workers add their results to the
+   output tensor, and a number of worker classes used as threads. */
 
 #ifndef STACK_CONTAINER_H
 #define STACK_CONTAINER_H
@@ -85,6 +86,11 @@
 #include "kron_prod.hh"
 #include "permutation.hh"
 #include "sthread.hh"
+#include "MemoryArena.hh"
+
+#include <map>
+#include <thread>
+#include <utility>
 
 /* Here is the general interface to stack container. The subclasses
    maintain IntSequence of stack sizes, i.e. size of G, g, y, and
@@ -641,7 +647,7 @@ public:
     int off = 0;
     for (int i = 0; i < dimen(); i++)
       {
-        IntSequence percoor(perindex, off, syms[i].dimen() + off);
+        IntSequence percoor(std::as_const(perindex), off, syms[i].dimen() + off);
         vs.push_back(stack_cont.createPackedColumn(syms[i], percoor, iu[i]));
         off += syms[i].dimen();
       }
@@ -711,17 +717,127 @@ public:
   }
 };
 
+/* This adds a block of columns of one matrix to the same block of another
+   matrix. It is used in the reduction of StackOutput. */
+
+class WorkerAddTo : public sthread::detach_thread
+{
+  TwoDMatrix &to;
+  const TwoDMatrix &from;
+  int first_col;
+  int num_cols;
+public:
+  WorkerAddTo(TwoDMatrix &t, const TwoDMatrix &f, int fc, int nc)
+    : to(t), from(f), first_col(fc), num_cols(nc)
+  {
+  }
+  void operator()(std::mutex &mut) override;
+};
+
+/* The workers add their contributions to the output tensor through this
+   class. By default, every addition is done directly to the output tensor,
+   under the mutex shared by the workers of the thread group, so all the
+   additions are serialized. If ‘thread_local_sums’ is set, each thread
+   accumulates to its own zero-initialized copy of the output tensor, and the
+   copies are summed into the output by a parallel tree reduction in
+   reduce(), once all the workers are finished. This removes the contention
+   on the mutex at the price of one copy of the output tensor per thread.
+
+   The switch is read when the object is constructed, so it may be changed
+   between two calls of multAndAdd(). */
+
+class StackOutputBase
+{
+public:
+  static bool thread_local_sums;
+};
+
+template<class _Ttype>
+class StackOutput : public StackOutputBase
+{
+  struct Buffer
+  {
+    _Ttype ten;
+    std::mutex mut; // Only locked by the owning thread, hence never contended
+    explicit Buffer(const _Ttype &out)
+      : ten(out.nrows(), out.getDims())
+    {
+      ten.zeros();
+    }
+  };
+  _Ttype &out;
+  const bool local_sums;
+  std::mutex mut_buffers;
+  std::map<std::thread::id, std::unique_ptr<Buffer>> buffers;
+public:
+  explicit StackOutput(_Ttype &o)
+    : out(o), local_sums(thread_local_sums)
+  {
+  }
+
+  /* Returns the tensor to which the calling thread adds its contributions,
+     together with the mutex to be locked during the additions. ‘mut’ is the
+     mutex shared by the thread group. */
+  std::pair<_Ttype &, std::mutex &>
+  target(std::mutex &mut)
+  {
+    if (!local_sums)
+      return { out, mut };
+    std::lock_guard<std::mutex> lk{mut_buffers};
+    auto &b = buffers[std::this_thread::get_id()];
+    if (!b)
+      {
+        // The buffer outlives the worker, so keep it out of its memory arena
+        MemoryArenaScope heap(false);
+        b = std::make_unique<Buffer>(out);
+      }
+    return { b->ten, b->mut };
+  }
+
+  /* Sums the per-thread copies into the output tensor. At each level of the
+     tree, the terms are added pairwise, and each addition is split into
+     blocks of columns so that all the threads are busy also at the last
+     levels. */
+  void
+  reduce()
+  {
+    std::vector<TwoDMatrix *> terms{&out};
+    for (auto &b : buffers)
+      terms.push_back(&b.second->ten);
+    int nterms = terms.size();
+    for (int step = 1; step < nterms; step *= 2)
+      {
+        int npairs = (nterms - step + 2*step - 1)/(2*step);
+        int nblocks = std::max(1, sthread::detach_thread_group::max_parallel_threads/npairs);
+        int ncols = out.ncols();
+        int block = (ncols + nblocks - 1)/nblocks;
+        sthread::detach_thread_group gr;
+        for (int i = 0; i + step < nterms; i += 2*step)
+          for (int c = 0; c < ncols; c += block)
+            gr.insert(std::make_unique<WorkerAddTo>(*terms[i], *terms[i+step],
+                                                    c, std::min(block, ncols-c)));
+        gr.run();
+      }
+    buffers.clear();
+  }
+};
+
+/* The following workers do the multiplications for the parallel multAndAdd()
+   methods. Each of them keeps its temporary tensors (slices, Kronecker
+   products, permuted tensors) in the memory arena of its thread (see
+   MemoryArena.hh), which is reset when the worker finishes. */
+
 class WorkerFoldMAADense : public sthread::detach_thread
 {
   const FoldedStackContainer &cont;
   Symmetry sym;
   const FGSContainer &dense_cont;
-  FGSTensor &out;
+  StackOutput<FGSTensor> &out;
 public:
   WorkerFoldMAADense(const FoldedStackContainer &container,
                      Symmetry s,
                      const FGSContainer &dcontainer,
-                     FGSTensor &outten);
+                     StackOutput<FGSTensor> &outten);
   void operator()(std::mutex &mut) override;
 };
 
@@ -729,12 +845,12 @@ class WorkerFoldMAASparse1 : public sthread::detach_thread
 {
   const FoldedStackContainer &cont;
   const FSSparseTensor &t;
-  FGSTensor &out;
+  StackOutput<FGSTensor> &out;
   IntSequence coor;
 public:
   WorkerFoldMAASparse1(const FoldedStackContainer &container,
                        const FSSparseTensor &ten,
-                       FGSTensor &outten, IntSequence c);
+                       StackOutput<FGSTensor> &outten, IntSequence c);
   void operator()(std::mutex &mut) override;
 };
 
@@ -742,12 +858,12 @@ class WorkerFoldMAASparse2 : public sthread::detach_thread
 {
   const FoldedStackContainer &cont;
   const FSSparseTensor &t;
-  FGSTensor &out;
+  StackOutput<FGSTensor> &out;
   IntSequence coor;
 public:
   WorkerFoldMAASparse2(const FoldedStackContainer &container,
                        const FSSparseTensor &ten,
-                       FGSTensor &outten, IntSequence c);
+                       StackOutput<FGSTensor> &outten, IntSequence c);
   void operator()(std::mutex &mut) override;
 };
 
@@ -755,12 +871,12 @@ class WorkerFoldMAASparse4 : public sthread::detach_thread
 {
   const FoldedStackContainer &cont;
   const FSSparseTensor &t;
-  FGSTensor &out;
+  StackOutput<FGSTensor> &out;
   IntSequence coor;
 public:
   WorkerFoldMAASparse4(const FoldedStackContainer &container,
                        const FSSparseTensor &ten,
-                       FGSTensor &outten, IntSequence c);
+                       StackOutput<FGSTensor> &outten, IntSequence c);
   void operator()(std::mutex &mut) override;
 };
 
@@ -769,12 +885,12 @@ class WorkerUnfoldMAADense : public sthread::detach_thread
   const UnfoldedStackContainer &cont;
   Symmetry sym;
   const UGSContainer &dense_cont;
-  UGSTensor &out;
+  StackOutput<UGSTensor> &out;
 public:
   WorkerUnfoldMAADense(const UnfoldedStackContainer &container,
                        Symmetry s,
                        const UGSContainer &dcontainer,
-                       UGSTensor &outten);
+                       StackOutput<UGSTensor> &outten);
   void operator()(std::mutex &mut) override;
 };
 
@@ -782,12 +898,12 @@ class WorkerUnfoldMAASparse1 : public sthread::detach_thread
 {
   const UnfoldedStackContainer &cont;
   const FSSparseTensor &t;
-  UGSTensor &out;
+  StackOutput<UGSTensor> &out;
   IntSequence coor;
 public:
   WorkerUnfoldMAASparse1(const UnfoldedStackContainer &container,
                          const FSSparseTensor &ten,
-                         UGSTensor &outten, IntSequence c);
+                         StackOutput<UGSTensor> &outten, IntSequence c);
   void operator()(std::mutex &mut) override;
 };
 
@@ -795,12 +911,12 @@ class WorkerUnfoldMAASparse2 : public sthread::detach_thread
 {
   const UnfoldedStackContainer &cont;
   const FSSparseTensor &t;
-  UGSTensor &out;
+  StackOutput<UGSTensor> &out;
   IntSequence coor;
 public:
   WorkerUnfoldMAASparse2(const UnfoldedStackContainer &container,
                          const FSSparseTensor &ten,
-                         UGSTensor &outten, IntSequence c);
+                         StackOutput<UGSTensor> &outten, IntSequence c);
   void operator()(std::mutex &mut) override;
 };
 
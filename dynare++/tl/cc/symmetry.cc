@@ -23,6 +23,7 @@
 #include "tl_exception.hh"
 
 #include <iostream>
+#include <vector>
 
 /* This constructs an implied symmetry from a more general symmetry and
    equivalence class. For example, let the general symmetry be y³u² and the
@@ -74,6 +75,45 @@ Symmetry::isFull() const
   return count <= 1;
 }
 
+/* A symmetry (s₀,…,sₙ₋₁) of dimension d is a placement of n−1 bars among
+   d+n−1 slots, the bars being at positions pₖ = s₀+…+sₖ+k for k=0,…,n−2. The
+   combinatorial number system gives the rank ∑ (pₖ over k+1) of the
+   placement among those of the same dimension, to which we add the number
+   of symmetries of lower dimensions, ∑_{d′<d} (d′+n−1 over n−1) = (d+n−1 over n).
+
+   The binomial coefficients are tabulated once, up to a size for which they
+   fit in a long. */
+
+long
+Symmetry::index() const
+{
+  constexpr int maxn = 64;
+  static const std::vector<std::vector<long>> binom = []()
+    {
+      std::vector<std::vector<long>> b(maxn, std::vector<long>(maxn, 0));
+      for (int i = 0; i < maxn; i++)
+        {
+          b[i][0] = 1;
+          for (int j = 1; j <= i; j++)
+            b[i][j] = b[i-1][j-1] + b[i-1][j];
+        }
+      return b;
+    }();
+
+  int n = num();
+  int d = dimen();
+  if (n == 0 || d+n >= maxn)
+    return -1;
+  long res = binom[d+n-1][n];
+  int p = -1;
+  for (int k = 0; k < n-1; k++)
+    {
+      p += operator[](k) + 1;
+      res += binom[p][k+1];
+    }
+  return res;
+}
+
 /* Construct a symiterator of given dimension, starting from the given
    symmetry. */
 
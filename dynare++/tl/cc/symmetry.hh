@@ -102,6 +102,12 @@ public:
   }
   int findClass(int i) const;
   bool isFull() const;
+  /* Returns the position of the symmetry in the enumeration of all the
+     symmetries of the same length, by increasing dimension. The positions
+     of the symmetries of length n and dimension d range from the number of
+     symmetries of lower dimensions, i.e. (d+n−1 over n), to (d+n over n)
+     excluded. Returns −1 if the position is too large to be computed. */
+  long index() const;
 };
 
 /* This is an iterator that iterates over all symmetries of given length and
@@ -47,19 +47,17 @@ UGSContainer::multAndAdd(const UGSTensor &t, UGSTensor &out) const
 {
   int l = t.dimen();
   int k = out.dimen();
-  const EquivalenceSet &eset = TLStatic::getEquiv(k);
 
-  for (const auto &it : eset)
-    if (it.numClasses() == l)
-      {
-        std::vector<const UGSTensor *> ts = fetchTensors(out.getSym(), it);
-        KronProdAllOptim kp(l);
-        for (int i = 0; i < l; i++)
-          kp.setMat(i, *(ts[i]));
-        kp.optimizeOrder();
-        UPSTensor ups(out.getDims(), it, t, kp);
-        ups.addTo(out);
-      }
+  for (auto it : TLStatic::getEquiv(k, l))
+    {
+      std::vector<const UGSTensor *> ts = fetchTensors(out.getSym(), *it);
+      KronProdAllOptim kp(l);
+      for (int i = 0; i < l; i++)
+        kp.setMat(i, *(ts[i]));
+      kp.optimizeOrder();
+      UPSTensor ups(out.getDims(), *it, t, kp);
+      ups.addTo(out);
+    }
 }
 
 // FGSContainer conversion from UGSContainer
@@ -88,20 +86,18 @@ FGSContainer::multAndAdd(const UGSTensor &t, FGSTensor &out) const
 {
   int l = t.dimen();
   int k = out.dimen();
-  const EquivalenceSet &eset = TLStatic::getEquiv(k);
 
-  for (const auto &it : eset)
-    if (it.numClasses() == l)
-      {
-        std::vector<const FGSTensor *> ts
-          = fetchTensors(out.getSym(), it);
-        KronProdAllOptim kp(l);
-        for (int i = 0; i < l; i++)
-          kp.setMat(i, *(ts[i]));
-        kp.optimizeOrder();
-        FPSTensor fps(out.getDims(), it, t, kp);
-        fps.addTo(out);
-      }
+  for (auto it : TLStatic::getEquiv(k, l))
+    {
+      std::vector<const FGSTensor *> ts
+        = fetchTensors(out.getSym(), *it);
+      KronProdAllOptim kp(l);
+      for (int i = 0; i < l; i++)
+        kp.setMat(i, *(ts[i]));
+      kp.optimizeOrder();
+      FPSTensor fps(out.getDims(), *it, t, kp);
+      fps.addTo(out);
+    }
 }
 
 /* This fills a given vector with integer sequences corresponding to first
@@ -72,6 +72,7 @@
 
 #include <map>
 #include <string>
+#include <vector>
 #include <memory>
 #include <utility>
 
@@ -102,7 +103,13 @@ struct ltsym
    and all equivalence classes, and fetches corresponding tensors in a vector.
 
    Also, each instance of the container has a reference to EquivalenceBundle
-   which allows an access to equivalences. */
+   which allows an access to equivalences.
+
+   Since get() and check() are called in the innermost loops of the Faà Di
+   Bruno formula, the tensors are also indexed in a vector by the position
+   of their symmetry in the enumeration of all symmetries (see
+   Symmetry::index()). Lookups of symmetries whose position is beyond
+   ‘max_table’ fall back to the map. */
 
 template<class _Ttype>
 class TensorContainer
@@ -112,6 +119,18 @@ protected:
 private:
   int n;
   _Map m;
+  std::vector<_Ttype *> table; // tensors by Symmetry::index(), or nullptr
+  static constexpr long max_table = 1 << 16;
+
+  _Ttype *
+  find(const Symmetry &s) const
+  {
+    long i = s.index();
+    if (i >= 0 && i < max_table)
+      return i < static_cast<long>(table.size()) ? table[i] : nullptr;
+    auto it = m.find(s);
+    return it == m.end() ? nullptr : it->second.get();
+  }
 public:
   TensorContainer(int nn)
     : n(nn)
@@ -140,9 +159,10 @@ public:
   operator=(const TensorContainer<_Ttype> &c)
   {
     n = c.n;
-    m.clear();
+    clear();
     for (const auto &it : c.m)
       insert(std::make_unique<_Ttype>(*(it.second)));
+    return *this;
   }
   TensorContainer<_Ttype> &operator=(TensorContainer<_Ttype> &&) = default;
 
@@ -151,9 +171,9 @@ public:
   {
     TL_RAISE_IF(s.num() != num(),
                 "Incompatible symmetry lookup in TensorContainer::get");
-    auto it = m.find(s);
-    TL_RAISE_IF(it == m.end(), "Symmetry not found in TensorContainer::get");
-    return *(it->second);
+    _Ttype *t = find(s);
+    TL_RAISE_IF(!t, "Symmetry not found in TensorContainer::get");
+    return *t;
   }
 
   _Ttype &
@@ -161,9 +181,9 @@ public:
   {
     TL_RAISE_IF(s.num() != num(),
                 "Incompatible symmetry lookup in TensorContainer::get");
-    auto it = m.find(s);
-    TL_RAISE_IF(it == m.end(), "Symmetry not found in TensorContainer::get");
-    return *(it->second);
+    _Ttype *t = find(s);
+    TL_RAISE_IF(!t, "Symmetry not found in TensorContainer::get");
+    return *t;
   }
 
   bool
@@ -171,8 +191,7 @@ public:
   {
     TL_RAISE_IF(s.num() != num(),
                 "Incompatible symmetry lookup in TensorContainer::check");
-    auto it = m.find(s);
-    return it != m.end();
+    return find(s) != nullptr;
   }
 
   virtual void
@@ -184,18 +203,29 @@ public:
                 "Tensor already in container in TensorContainer::insert");
     if (!t->isFinite())
       throw TLException(__FILE__, __LINE__, "NaN or Inf asserted in TensorContainer::insert");
+    long i = t->getSym().index();
+    if (i >= 0 && i < max_table)
+      {
+        if (i >= static_cast<long>(table.size()))
+          table.resize(i+1, nullptr);
+        table[i] = t.get();
+      }
     m.emplace(t->getSym(), std::move(t));
   }
 
   void
   remove(const Symmetry &s)
   {
+    long i = s.index();
+    if (i >= 0 && i < static_cast<long>(table.size()))
+      table[i] = nullptr;
     m.erase(s);
   }
 
   void
   clear()
   {
+    table.clear();
     m.clear();
   }
 
@@ -53,6 +53,86 @@ PowerProvider::getNext(dummy<FRSingleTensor>)
   return *ft;
 }
 
+/* The rows of the d-th power are indexed as the columns of a full symmetry
+   tensor (folded or unfolded) of dimension d. For each of them we find the
+   row of the (d−1)-th power given by the first d−1 coordinates, and the
+   variable of the last coordinate. In the folded case, the coordinates are
+   sorted, and if the last one appears c times, the row stands for c/d times
+   less equivalent items than its parent, whence the factor d/c. */
+
+PowerMatrices::PowerMatrices(int nvar, int maxd, bool fold, int npoints)
+  : nv(nvar), maxdim(maxd), folded(fold), parent(maxd+1), var(maxd+1), factor(maxd+1)
+{
+  TL_RAISE_IF(nv <= 0 || maxdim <= 0,
+              "Wrong number of variables or dimension in PowerMatrices constructor");
+
+  long totrows = 0;
+  for (int d = 1; d <= maxdim; d++)
+    {
+      std::unique_ptr<Tensor> dummy;
+      if (folded)
+        dummy = std::make_unique<FFSTensor>(0, nv, d);
+      else
+        dummy = std::make_unique<UFSTensor>(0, nv, d);
+      totrows += dummy->ncols();
+      if (d == 1)
+        continue;
+      for (Tensor::index run = dummy->begin(); run != dummy->end(); ++run)
+        {
+          const IntSequence &coor = run.getCoor();
+          IntSequence pcoor(coor, 0, d-1);
+          int last = coor[d-1];
+          if (folded)
+            {
+              parent[d].push_back(FTensor::getOffset(pcoor, nv));
+              int c = 1;
+              while (c < d && coor[d-1-c] == last)
+                c++;
+              factor[d].push_back(static_cast<double>(d)/c);
+            }
+          else
+            {
+              parent[d].push_back(UTensor::getOffset(pcoor, nv));
+              factor[d].push_back(1.0);
+            }
+          var[d].push_back(last);
+        }
+    }
+
+  maxcols = std::max(1, std::min(npoints, static_cast<int>(max_size/totrows)));
+  powers.emplace_back(nv, maxcols);
+  for (int d = 2; d <= maxdim; d++)
+    powers.emplace_back(static_cast<int>(parent[d].size()), maxcols);
+}
+
+/* The first power is a copy of the points, the other ones are filled
+   column by column from the previous power. */
+
+void
+PowerMatrices::compute(const ConstGeneralMatrix &xs)
+{
+  TL_RAISE_IF(xs.nrows() != nv || xs.ncols() > maxcols,
+              "Wrong dimensions of points in PowerMatrices::compute");
+
+  ncols = xs.ncols();
+  for (int j = 0; j < ncols; j++)
+    {
+      ConstVector x{xs.getCol(j)};
+      Vector p1{powers[0].getCol(j)};
+      p1 = x;
+      for (int d = 2; d <= maxdim; d++)
+        {
+          const double *prev = powers[d-2].base() + j*powers[d-2].getLD();
+          double *cur = powers[d-1].base() + j*powers[d-1].getLD();
+          const int *par = parent[d].data();
+          const int *v = var[d].data();
+          const double *f = factor[d].data();
+          for (int r = 0; r < static_cast<int>(parent[d].size()); r++)
+            cur[r] = f[r]*prev[par[r]]*x[v[r]];
+        }
+    }
+}
+
 UTensorPolynomial::UTensorPolynomial(const FTensorPolynomial &fp)
   : TensorPolynomial<UFSTensor, UGSTensor, URSingleTensor>(fp.nrows(), fp.nvars())
 {
@@ -58,6 +58,9 @@
 #include "pascal_triangle.hh"
 
 #include <memory>
+#include <vector>
+#include <type_traits>
+#include <algorithm>
 
 /* Just to make the code nicer, we implement a Kronecker power of a
    vector encapsulated in the following class. It has getNext() method
@@ -112,6 +115,67 @@ private:
   const FRSingleTensor &getNext(dummy<FRSingleTensor>);
 };
 
+/* This is a batched counterpart of PowerProvider. It computes the Kronecker
+   powers of several vectors at once: the d-th power of the j-th column of
+   the matrix given to compute() is the j-th column of get(d). The powers are
+   either unfolded, or folded in the sense of FRSingleTensor (the equivalent
+   items of the unfolded power are summed).
+
+   Each row of the d-th power is a row of the (d−1)-th power multiplied
+   elementwise by a row of the points (and, in the folded case, by the ratio
+   of the numbers of equivalent items they stand for). The rows and factors
+   are tabulated by the constructor, which also allocates the matrices, so
+   that compute() allocates nothing.
+
+   The powers of many points would not fit in memory, so the points are
+   processed in blocks of at most maxCols() columns, which is chosen so that
+   the powers of a block take at most ‘max_size’ doubles. */
+
+class PowerMatrices
+{
+  int nv;
+  int maxdim;
+  bool folded;
+  int maxcols;
+  int ncols{0};
+  // Tabulated row of (d−1)-th power, variable and factor of each row of the d-th power
+  std::vector<std::vector<int>> parent;
+  std::vector<std::vector<int>> var;
+  std::vector<std::vector<double>> factor;
+  std::vector<TwoDMatrix> powers;
+public:
+  static constexpr int max_size = 1 << 22;
+  PowerMatrices(int nvar, int maxd, bool fold, int npoints);
+  int
+  nvar() const
+  {
+    return nv;
+  }
+  int
+  getMaxDim() const
+  {
+    return maxdim;
+  }
+  bool
+  isFolded() const
+  {
+    return folded;
+  }
+  int
+  maxCols() const
+  {
+    return maxcols;
+  }
+  // Computes the powers of the columns of ‘xs’, at most maxCols() of them
+  void compute(const ConstGeneralMatrix &xs);
+  // Returns the d-th powers of the last computed columns
+  ConstTwoDMatrix
+  get(int d) const
+  {
+    return ConstTwoDMatrix(powers[d-1], 0, ncols);
+  }
+};
+
 /* The tensor polynomial is basically a tensor container which is more
    strict on insertions. It maintains number of rows and number of
    variables and allows insertions only of those tensors, which yield
@@ -330,6 +394,49 @@ public:
     last->multaVec(out, v);
   }
 
+  /* This evaluates the polynomial at the points given by the columns of
+     ‘xs’, and stores the values in the corresponding columns of ‘out’. It is
+     evalTrad() for a block of points at once: their Kronecker powers are
+     computed by ‘pm’ and each dimension becomes a single matrix
+     multiplication. The workspace ‘pm’ (see batchWorkspace()) can be reused
+     for subsequent calls, which then do not allocate. */
+
+  void
+  evalBatch(GeneralMatrix &out, const ConstGeneralMatrix &xs, PowerMatrices &pm) const
+  {
+    TL_RAISE_IF(xs.nrows() != nvars() || out.nrows() != nrows() || out.ncols() != xs.ncols(),
+                "Wrong dimensions of input or output in TensorPolynomial::evalBatch");
+    constexpr bool folded = std::is_base_of<FTensor, _Ttype>::value;
+    TL_RAISE_IF(pm.nvar() != nvars() || pm.getMaxDim() < maxdim || pm.isFolded() != folded,
+                "Incompatible workspace in TensorPolynomial::evalBatch");
+
+    for (int j = 0; j < xs.ncols(); j += pm.maxCols())
+      {
+        int nc = std::min(pm.maxCols(), xs.ncols()-j);
+        GeneralMatrix outb(out, 0, j, nrows(), nc);
+        if (_Tparent::check(Symmetry{0}))
+          {
+            const _Ttype &g0 = _Tparent::get(Symmetry{0});
+            for (int k = 0; k < nc; k++)
+              outb.getCol(k) = g0.getData();
+          }
+        else
+          outb.zeros();
+
+        pm.compute(ConstGeneralMatrix(xs, 0, j, nvars(), nc));
+        for (int d = 1; d <= maxdim; d++)
+          if (_Tparent::check(Symmetry{d}))
+            outb.multAndAdd(_Tparent::get(Symmetry{d}), pm.get(d));
+      }
+  }
+
+  // Returns a workspace for evalBatch() on (at most) ‘npoints’ points
+  PowerMatrices
+  batchWorkspace(int npoints) const
+  {
+    return PowerMatrices(nv, std::max(maxdim, 1), std::is_base_of<FTensor, _Ttype>::value, npoints);
+  }
+
   /* Before a tensor is inserted, we check for the number of rows, and
      number of variables. Then we insert and update the ‘maxdim’. */
 
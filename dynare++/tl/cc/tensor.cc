@@ -22,6 +22,7 @@
 #include "tl_exception.hh"
 #include "tl_static.hh"
 #include "pascal_triangle.hh"
+#include "small_dim.hh"
 
 /* Here we increment a given sequence within full symmetry given by ‘nv’, which
    is number of variables in each dimension. The underlying tensor is unfolded,
@@ -176,21 +177,44 @@ FTensor::decrement(IntSequence &v, int nv)
     ⎛n+k−1⎞ ⎛n−m+k−1⎞
     ⎝  k  ⎠−⎝   k   ⎠
 
-   The offset of general index (m₁,m₂,…,mₖ) is calculated recursively, since it
-   is the offset of (m₁,…,m₁) for n variables plus the offset of
-   (m₂−m₁,m₃−m₁,…,mₖ−m₁) for n−m₁ variables. */
+   The offset of general index (m₁,m₂,…,mₖ) is the offset of (m₁,…,m₁) for n
+   variables plus the offset of (m₂−m₁,m₃−m₁,…,mₖ−m₁) for n−m₁ variables. We
+   unroll this recursion into a loop over the coordinates, where a coordinate
+   equal to the previous one contributes nothing. For the dimensions up to
+   SmallDim::max_dim, the loop is unrolled at compile time (see small_dim.hh).
+   In any case, this does not allocate anything. */
+
+namespace
+{
+  struct FoldedOffset
+  {
+    template<int D>
+    static void
+    run(const IntSequence &v, int nv, int &res)
+    {
+      res = SmallDim::foldedOffset<D>(v, nv);
+    }
+  };
+}
 
 int
-FTensor::getOffsetRecurse(IntSequence &v, int nv)
+FTensor::getOffset(const IntSequence &v, int nv)
 {
-  if (v.size() == 0)
-    return 0;
-  int prefix = v.getPrefixLength();
-  int m = v[0];
+  int res = 0;
   int k = v.size();
-  int s1 = PascalTriangle::noverk(nv+k-1, k) - PascalTriangle::noverk(nv-m+k-1, k);
-  IntSequence subv(v, prefix, k);
-  subv.add(-m);
-  int s2 = getOffsetRecurse(subv, nv-m);
-  return s1+s2;
+  if (k == 0 || SmallDim::dispatch<FoldedOffset>(k, v, nv, res))
+    return res;
+
+  int prev = 0;
+  for (int i = 0; i < k; i++)
+    {
+      int m = v[i]-prev;
+      if (m > 0)
+        {
+          res += PascalTriangle::noverk(nv+k-i-1, k-i) - PascalTriangle::noverk(nv-m+k-i-1, k-i);
+          nv -= m;
+          prev = v[i];
+        }
+    }
+  return res;
 }
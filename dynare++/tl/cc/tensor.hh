@@ -293,14 +293,7 @@ public:
   FTensor &operator=(FTensor &&) = delete;
 
   static void decrement(IntSequence &v, int nv);
-  static int
-  getOffset(const IntSequence &v, int nv)
-  {
-    IntSequence vtmp(v);
-    return getOffsetRecurse(vtmp, nv);
-  }
-private:
-  static int getOffsetRecurse(IntSequence &v, int nv);
+  static int getOffset(const IntSequence &v, int nv);
 };
 
 #endif
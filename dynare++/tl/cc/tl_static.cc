@@ -19,12 +19,19 @@
  */
 
 #include "tl_static.hh"
+#include "gs_tensor.hh"
 #include "pascal_triangle.hh"
 #include "tl_exception.hh"
 
+#include <map>
+#include <list>
+#include <memory>
+#include <utility>
 #include <mutex>
+#include <atomic>
 #include <limits>
 #include <cmath>
+#include <algorithm>
 
 /* Note that we allow for repeated calls of init(). This is not normal
    and the only purpose of allowing this is the test suite. */
@@ -34,6 +41,51 @@ namespace TLStatic
   EquivalenceBundle ebundle(1);
   PermutationBundle pbundle(1);
   std::mutex mut;
+  /* The equivalences of each set having a given number of classes, indexed
+     by the size of the set and the number of classes; they are computed by
+     init(), and only read afterwards */
+  std::vector<std::vector<std::vector<const Equivalence *>>> eclasses;
+  /* The arrangements and the preserving permutations are computed on
+     demand, and owned by these maps. The maps are modified under the lock,
+     but the tables they contain are never modified nor destroyed until the
+     next init(). */
+  std::map<IntSequence, std::vector<IntSequence>> arrangements;
+  std::map<IntSequence, std::vector<Permutation>> preserving;
+  std::mutex tables_mut;
+  // Incremented by init(), so that the threads drop their lookup caches
+  std::atomic<int> tables_gen{0};
+
+  /* Each thread looks the tables up in its own cache of pointers, keyed by
+     the coordinates as they are passed (without sorting), so that a lookup
+     which has already been done by the thread takes neither the lock nor an
+     allocation. */
+  template<typename T>
+  struct LocalTables
+  {
+    int gen{-1};
+    std::map<IntSequence, const std::vector<T> *> tables;
+    std::map<IntSequence, const std::vector<T> *> &
+    get()
+    {
+      int g = tables_gen.load(std::memory_order_acquire);
+      if (gen != g)
+        {
+          tables.clear();
+          gen = g;
+        }
+      return tables;
+    }
+  };
+
+  using itable_key = std::pair<IntSequence, IntSequence>;
+  /* The cached index tables, with their positions in ‘itables_lru’, which
+     lists the keys from the least to the most recently used */
+  std::map<itable_key, std::pair<std::shared_ptr<const IndexTable>, std::list<itable_key>::iterator>> itables;
+  std::list<itable_key> itables_lru;
+  std::size_t itables_mem{0};
+  std::mutex itables_mut;
+  // Memory budget of the cached index tables in bytes
+  constexpr std::size_t itables_max_mem = std::size_t{256} << 20;
 
   const EquivalenceSet &
   getEquiv(int n)
@@ -41,12 +93,107 @@ namespace TLStatic
     return ebundle.get(n);
   }
 
+  const std::vector<const Equivalence *> &
+  getEquiv(int n, int nclasses)
+  {
+    static const std::vector<const Equivalence *> none;
+    TL_RAISE_IF(n < 1 || n >= static_cast<int>(eclasses.size()),
+                "Equivalence set not tabulated in TLStatic::getEquiv");
+    if (nclasses < 1 || nclasses > n)
+      return none;
+    return eclasses[n][nclasses];
+  }
+
   const PermutationSet &
   getPerm(int n)
   {
     return pbundle.get(n);
   }
 
+  /* The arrangements are keyed by the sorted coordinates, so that all the
+     reorderings of a sequence share the same table. */
+  const std::vector<IntSequence> &
+  getArrangements(const IntSequence &coor)
+  {
+    thread_local LocalTables<IntSequence> local;
+    auto &cache = local.get();
+    auto lit = cache.find(coor);
+    if (lit != cache.end())
+      return *(lit->second);
+
+    IntSequence key(coor);
+    key.sort();
+    std::lock_guard<std::mutex> lk{tables_mut};
+    auto it = arrangements.find(key);
+    if (it == arrangements.end())
+      it = arrangements.emplace(key, pbundle.get(key.size()).getArrangements(key)).first;
+    cache.emplace(coor, &(it->second));
+    return it->second;
+  }
+
+  const std::vector<Permutation> &
+  getPreserving(const IntSequence &coor)
+  {
+    thread_local LocalTables<Permutation> local;
+    auto &cache = local.get();
+    auto lit = cache.find(coor);
+    if (lit != cache.end())
+      return *(lit->second);
+
+    std::lock_guard<std::mutex> lk{tables_mut};
+    auto it = preserving.find(coor);
+    if (it == preserving.end())
+      it = preserving.emplace(coor, pbundle.get(coor.size()).getPreserving(coor)).first;
+    cache.emplace(coor, &(it->second));
+    return it->second;
+  }
+
+  /* The tables are keyed by the symmetry and the numbers of variables,
+     which is what TensorDimens::operator==() compares. A missing table is
+     built without holding the lock, so that building a large table does
+     not block the lookups of the other threads; if another thread has
+     inserted the same table in the meantime, its table is used. Then the
+     least recently used tables are dropped until the cache fits in its
+     budget. A table larger than the whole budget is not cached. */
+  std::shared_ptr<const IndexTable>
+  getIndexTable(const TensorDimens &td)
+  {
+    itable_key key{IntSequence(td.getSym()), td.getNVS()};
+    {
+      std::lock_guard<std::mutex> lk{itables_mut};
+      auto it = itables.find(key);
+      if (it != itables.end())
+        {
+          itables_lru.splice(itables_lru.end(), itables_lru, it->second.second);
+          return it->second.first;
+        }
+    }
+
+    auto table = std::make_shared<const IndexTable>(td);
+    std::size_t mem = table->memory();
+    if (mem > itables_max_mem)
+      return table;
+
+    std::lock_guard<std::mutex> lk{itables_mut};
+    auto it = itables.find(key);
+    if (it != itables.end())
+      {
+        itables_lru.splice(itables_lru.end(), itables_lru, it->second.second);
+        return it->second.first;
+      }
+    while (itables_mem + mem > itables_max_mem)
+      {
+        auto lru = itables.find(itables_lru.front());
+        itables_mem -= lru->second.first->memory();
+        itables.erase(lru);
+        itables_lru.pop_front();
+      }
+    auto pos = itables_lru.insert(itables_lru.end(), key);
+    itables.emplace(std::move(key), std::make_pair(table, pos));
+    itables_mem += mem;
+    return table;
+  }
+
   void
   init(int dim, int nvar)
   {
@@ -54,10 +201,28 @@ namespace TLStatic
     if (std::log2(nvar)*dim > std::numeric_limits<int>::digits)
       throw TLException(__FILE__, __LINE__, "Problem too large, you should decrease the approximation order");
 
-    std::lock_guard<std::mutex>{mut};
+    std::lock_guard<std::mutex> lk{mut};
     ebundle.generateUpTo(dim);
     pbundle.generateUpTo(dim);
 
+    /* The equivalences are pointed to in the equivalence sets of the
+       bundle, in the same order */
+    int nmax = std::max(dim, static_cast<int>(eclasses.size())-1);
+    eclasses.clear();
+    eclasses.resize(nmax+1);
+    for (int n = 1; n <= nmax; n++)
+      {
+        eclasses[n].resize(n+1);
+        for (const auto &e : ebundle.get(n))
+          eclasses[n][e.numClasses()].push_back(&e);
+      }
+    {
+      std::lock_guard<std::mutex> lk{tables_mut};
+      arrangements.clear();
+      preserving.clear();
+      tables_gen++;
+    }
+
     PascalTriangle::ensure(nvar, dim);
   }
 }
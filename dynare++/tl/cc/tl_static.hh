@@ -24,7 +24,26 @@
    would contain all other static variables and be responsible for their
    correct initialization and destruction. The variables include an
    equivalence bundle and a permutation bundle. Both depend on dimension of the
-   problem, and maximum number of variables.
+   problem, and maximum number of variables. It also holds the index tables
+   of tensor dimensions (see index_table.hh), which are created on demand
+   and kept up to a memory budget, the least recently used being dropped
+   first (they are returned as shared pointers, so that a table stays valid
+   while it is used, even if it has been dropped).
+
+   Moreover, some subsets of the bundles are tabulated, since the Faà Di
+   Bruno code would otherwise filter them over and over again in its
+   innermost loops:
+   — the equivalences of an n-element set having a given number of classes
+     (computed by init()),
+   — the distinct arrangements of a sequence of stack coordinates (see
+     PermutationSet::getArrangements()); the table only depends on the
+     sequence up to a reordering,
+   — the permutations preserving a sequence of coordinates (see
+     PermutationSet::getPreserving()).
+   The last two are computed on demand. All the tables can be retrieved
+   concurrently from several threads, and a table already retrieved by a
+   thread is retrieved again without locking. The returned references stay
+   valid until the next call to init().
 
    TLStatic::init() must be called at the beginning of the program, as
    soon as dimension and number of variables is known. */
@@ -34,11 +53,21 @@
 
 #include "equivalence.hh"
 #include "permutation.hh"
+#include "index_table.hh"
+
+#include <vector>
+#include <memory>
+
+class TensorDimens;
 
 namespace TLStatic
 {
   const EquivalenceSet &getEquiv(int n);
+  const std::vector<const Equivalence *> &getEquiv(int n, int nclasses);
   const PermutationSet &getPerm(int n);
+  const std::vector<IntSequence> &getArrangements(const IntSequence &coor);
+  const std::vector<Permutation> &getPreserving(const IntSequence &coor);
+  std::shared_ptr<const IndexTable> getIndexTable(const TensorDimens &td);
   void init(int dim, int nvar);
 };
 
@@ -0,0 +1,57 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+#include "alloc_count.hh"
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+/* The replacement operators are defined in their own translation unit, so
+   that they are not inlined in the callers. The array and nothrow versions
+   of operator new and delete call these ones. */
+
+static std::atomic<long> num_allocs{0};
+
+long
+AllocCount::get()
+{
+  return num_allocs.load(std::memory_order_relaxed);
+}
+
+void *
+operator new(std::size_t sz)
+{
+  num_allocs.fetch_add(1, std::memory_order_relaxed);
+  if (void *p = std::malloc(sz ? sz : 1))
+    return p;
+  throw std::bad_alloc();
+}
+
+void
+operator delete(void *p) noexcept
+{
+  std::free(p);
+}
+
+void
+operator delete(void *p, std::size_t) noexcept
+{
+  std::free(p);
+}
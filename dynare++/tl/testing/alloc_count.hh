@@ -0,0 +1,33 @@
+/*
+ * Copyright © 2019 Dynare Team
+ *
+ * This file is part of Dynare.
+ *
+ * Dynare is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Dynare is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
+ */
+
+/* Counting of the heap allocations, used to report the heap traffic of the
+   tests. The global operator new is replaced (in alloc_count.cc) by a
+   version incrementing a counter. */
+
+#ifndef ALLOC_COUNT_H
+#define ALLOC_COUNT_H
+
+namespace AllocCount
+{
+  // Returns the number of allocations done since the start of the program
+  long get();
+};
+
+#endif
@@ -29,8 +29,12 @@
 #include "rfs_tensor.hh"
 #include "ps_tensor.hh"
 #include "tl_static.hh"
+#include "kron_kernels.hh"
+#include "normal_moments.hh"
+#include "alloc_count.hh"
 
 #include <string>
+#include <algorithm>
 #include <utility>
 #include <memory>
 #include <vector>
@@ -38,6 +42,8 @@
 #include <cstdlib>
 #include <iostream>
 #include <iomanip>
+#include <limits>
+#include <cmath>
 
 class TestRunnable
 {
@@ -62,6 +68,16 @@ protected:
   template<class _Ttype>
   static bool index_offset(const Symmetry &s, const IntSequence &nvs);
 
+  static bool index_table(const Symmetry &s, const IntSequence &nvs);
+
+  static bool static_tables(int n, int nstacks);
+
+  static bool symmetry_index(int maxlen, int maxdim);
+
+  static bool int_sequence_views(int maxlen);
+
+  static bool folded_offset(int nv, int maxdim);
+
   static bool fold_unfold(std::unique_ptr<FTensor> folded);
   static bool
   fs_fold_unfold(int r, int nv, int dim)
@@ -82,6 +98,9 @@ protected:
     return fold_unfold(f.make<FGSTensor>(r, s, nvs));
   }
 
+  static bool kron_prod(int r, const IntSequence &mrows, const IntSequence &mcols,
+                        int unit, int repeats);
+
   static bool dense_prod(const Symmetry &bsym, const IntSequence &bnvs,
                          int hdim, int hnv, int rows);
 
@@ -101,6 +120,11 @@ protected:
 
   static bool poly_eval(int r, int nv, int maxdim);
 
+  static bool poly_eval_batch(int r, int nv, int maxdim, int npoints);
+
+  static bool normal_moments(int nv, int maxdim);
+  static double isserlis(const TwoDMatrix &v, const std::vector<int> &ind);
+
 };
 
 bool
@@ -108,9 +132,11 @@ TestRunnable::test() const
 {
   std::cout << "Running test <" << name << ">" << std::endl;
   clock_t start = clock();
+  long allocs = AllocCount::get();
   bool passed = run();
   clock_t end = clock();
-  std::cout << "CPU time " << static_cast<double>(end-start)/CLOCKS_PER_SEC
+  std::cout << "\tnumber of allocations = " << AllocCount::get() - allocs << '\n'
+            << "CPU time " << static_cast<double>(end-start)/CLOCKS_PER_SEC
             << " (CPU seconds)..................";
   if (passed)
     std::cout << "passed\n\n";
@@ -206,6 +232,204 @@ TestRunnable::index_offset(const Symmetry &s, const IntSequence &nvs)
   return fails == 0;
 }
 
+bool
+TestRunnable::index_table(const Symmetry &s, const IntSequence &nvs)
+{
+  int fails = 0;
+  TensorDimens td(s, nvs);
+  auto itab = TLStatic::getIndexTable(td);
+  FGSTensor fdummy(0, td);
+  UGSTensor udummy(0, td);
+  if (itab->foldSize() != fdummy.ncols() || itab->unfoldSize() != udummy.ncols())
+    fails++;
+  for (auto run = fdummy.begin(); run != fdummy.end(); ++run)
+    {
+      const int *c = itab->foldCoor(*run);
+      for (int i = 0; i < run.getCoor().size(); i++)
+        if (c[i] != run.getCoor()[i])
+          fails++;
+      UGSTensor::index urun(udummy, run.getCoor());
+      if (itab->unfoldOf(*run) != *urun || itab->foldOf(*urun) != *run)
+        fails++;
+    }
+  for (auto run = udummy.begin(); run != udummy.end(); ++run)
+    {
+      IntSequence v(run.getCoor());
+      int last = 0;
+      for (int i = 0; i < s.num(); i++)
+        {
+          IntSequence vtmp(v, last, last+s[i]);
+          vtmp.sort();
+          last += s[i];
+        }
+      if (itab->foldOf(*run) != fdummy.getOffset(v)
+          || itab->firstOf(*run) != udummy.getOffset(v))
+        fails++;
+    }
+
+  std::cout << "\tnumber of folded columns   = " << itab->foldSize() << '\n'
+            << "\tnumber of unfolded columns = " << itab->unfoldSize() << '\n'
+            << "\tnumber of failures         = " << fails << '\n';
+
+  return fails == 0;
+}
+
+bool
+TestRunnable::static_tables(int n, int nstacks)
+{
+  int fails = 0;
+  int nequiv = 0;
+  for (int k = 1; k <= n; k++)
+    for (auto e : TLStatic::getEquiv(n, k))
+      {
+        if (e->numClasses() != k)
+          fails++;
+        nequiv++;
+      }
+  int nequiv_all = 0;
+  for ([[maybe_unused]] const auto &e : TLStatic::getEquiv(n))
+    nequiv_all++;
+  if (nequiv != nequiv_all)
+    fails++;
+
+  int narr = 0;
+  FFSTensor dummy_f(0, nstacks, n);
+  UFSTensor dummy_u(0, nstacks, n);
+  for (Tensor::index fi = dummy_f.begin(); fi != dummy_f.end(); ++fi)
+    {
+      const std::vector<IntSequence> &arr = TLStatic::getArrangements(fi.getCoor());
+      auto it = arr.begin();
+      for (Tensor::index ui = dummy_u.begin(); ui != dummy_u.end(); ++ui)
+        {
+          IntSequence tmp(ui.getCoor());
+          tmp.sort();
+          if (tmp == fi.getCoor())
+            {
+              if (it == arr.end() || *it != ui.getCoor())
+                fails++;
+              else
+                ++it;
+            }
+        }
+      if (it != arr.end())
+        fails++;
+      narr += arr.size();
+
+      std::vector<Permutation> pp = TLStatic::getPerm(n).getPreserving(fi.getCoor());
+      const std::vector<Permutation> &tpp = TLStatic::getPreserving(fi.getCoor());
+      if (pp.size() != tpp.size())
+        fails++;
+    }
+  if (narr != dummy_u.ncols())
+    fails++;
+
+  std::cout << "\tnumber of equivalences = " << nequiv << '\n'
+            << "\tnumber of arrangements = " << narr << '\n'
+            << "\tnumber of failures     = " << fails << '\n';
+
+  return fails == 0;
+}
+
+bool
+TestRunnable::symmetry_index(int maxlen, int maxdim)
+{
+  int fails = 0;
+  int nsym = 0;
+  for (int len = 1; len <= maxlen; len++)
+    {
+      std::vector<bool> seen;
+      for (int dim = 0; dim <= maxdim; dim++)
+        for (auto &si : SymmetrySet(dim, len))
+          {
+            long i = si.index();
+            if (i < 0)
+              {
+                fails++;
+                continue;
+              }
+            if (i >= static_cast<long>(seen.size()))
+              seen.resize(i+1, false);
+            if (seen[i])
+              fails++;
+            seen[i] = true;
+            nsym++;
+          }
+      // The positions of the symmetries up to maxdim must be contiguous
+      if (std::find(seen.begin(), seen.end(), false) != seen.end())
+        fails++;
+    }
+
+  std::cout << "\tnumber of symmetries = " << nsym << '\n'
+            << "\tnumber of failures   = " << fails << '\n';
+
+  return fails == 0;
+}
+
+/* Checks that subsequences sharing the data of their parent stay valid when
+   the parent is moved, both for short parents (whose data is inline) and long
+   ones. The parents are held in a vector which reallocates. */
+
+bool
+TestRunnable::int_sequence_views(int maxlen)
+{
+  int fails = 0;
+  std::vector<IntSequence> parents;
+  std::vector<IntSequence> views;
+  for (int len = 2; len <= maxlen; len++)
+    {
+      parents.emplace_back(len, 0);
+      views.emplace_back(parents.back(), 1, len);
+    }
+  for (int i = 0; i < 100; i++)
+    parents.emplace_back(1, 0);
+  for (int len = 2; len <= maxlen; len++)
+    {
+      IntSequence &p = parents[len-2];
+      IntSequence &v = views[len-2];
+      p[len-1] = len;
+      if (v[len-2] != len)
+        fails++;
+      v[0] = -len;
+      if (p[1] != -len)
+        fails++;
+    }
+
+  Symmetry sym{1, 2, 3};
+  Symmetry sub(sym, 2);
+  Symmetry moved(std::move(sym));
+  moved[2] = 4;
+  if (sub[0] != 2 || sub[1] != 4)
+    fails++;
+
+  std::cout << "\tnumber of failures = " << fails << '\n';
+
+  return fails == 0;
+}
+
+/* Checks FTensor::getOffset() for dimensions below and above
+   SmallDim::max_dim, i.e. both the specialized and the generic code. */
+
+bool
+TestRunnable::folded_offset(int nv, int maxdim)
+{
+  int fails = 0;
+  int ncols = 0;
+  for (int dim = 1; dim <= maxdim; dim++)
+    {
+      FFSTensor dummy(0, nv, dim);
+      int off = 0;
+      for (auto run = dummy.begin(); run != dummy.end(); ++run, off++)
+        if (FTensor::getOffset(run.getCoor(), nv) != off)
+          fails++;
+      ncols += off;
+    }
+
+  std::cout << "\tnumber of columns    = " << ncols << '\n'
+            << "\tnumber of failures   = " << fails << '\n';
+
+  return fails == 0;
+}
+
 bool
 TestRunnable::fold_unfold(std::unique_ptr<FTensor> folded)
 {
@@ -222,6 +446,58 @@ TestRunnable::fold_unfold(std::unique_ptr<FTensor> folded)
   return normInf < 1.0e-15;
 }
 
+/* Here we multiply a matrix by a Kronecker product of the given matrices,
+   once through BLAS on slices and once with the blocked kernels, and compare
+   the results and the timings. The matrix at ‘unit’ (if non-negative) is an
+   identity. The product is also done for a row slice of a bigger matrix,
+   whose leading dimension differs from the number of rows. */
+
+bool
+TestRunnable::kron_prod(int r, const IntSequence &mrows, const IntSequence &mcols,
+                        int unit, int repeats)
+{
+  Factory f;
+  std::vector<std::unique_ptr<TwoDMatrix>> mats;
+  KronProdAll kp(mrows.size());
+  for (int i = 0; i < mrows.size(); i++)
+    if (i == unit)
+      kp.setUnit(i, mrows[i]);
+    else
+      {
+        mats.push_back(std::make_unique<TwoDMatrix>(mrows[i], mcols[i],
+                                                    f.makeVector(mrows[i]*mcols[i])));
+        kp.setMat(i, *mats.back());
+      }
+  TwoDMatrix big(2*r, kp.nrows(), f.makeVector(2*r*kp.nrows()));
+  ConstTwoDMatrix in(0, r, big);
+
+  int saved = KronProd::blocked_max_size;
+  TwoDMatrix out_blas(r, kp.ncols());
+  TwoDMatrix out_blocked(r, kp.ncols());
+  KronProd::blocked_max_size = 0;
+  clock_t s1 = clock();
+  for (int i = 0; i < repeats; i++)
+    kp.mult(in, out_blas);
+  clock_t s2 = clock();
+  KronProd::blocked_max_size = std::numeric_limits<int>::max();
+  for (int i = 0; i < repeats; i++)
+    kp.mult(in, out_blocked);
+  clock_t s3 = clock();
+  KronProd::blocked_max_size = saved;
+
+  out_blocked.add(-1.0, out_blas);
+  double norm = out_blocked.getData().getMax()/std::max(1.0, out_blas.getData().getMax());
+
+  std::cout << "\tproduct size:          (" << r << ", " << kp.nrows() << ")*("
+            << kp.nrows() << ", " << kp.ncols() << ")\n"
+            << "\ttime for BLAS slices:  " << static_cast<double>(s2-s1)/CLOCKS_PER_SEC << '\n'
+            << "\ttime for blocked:      " << static_cast<double>(s3-s2)/CLOCKS_PER_SEC << '\n'
+            << "\tkernel instructions:   " << KronKernels::isa() << '\n'
+            << "\trelative difference:   " << norm << '\n';
+
+  return norm < 1.e-13;
+}
+
 bool
 TestRunnable::dense_prod(const Symmetry &bsym, const IntSequence &bnvs,
                          int hdim, int hnv, int rows)
@@ -554,6 +830,125 @@ TestRunnable::poly_eval(int r, int nv, int maxdim)
   return (max_ft+max_fh+max_uh < 1.0e-10);
 }
 
+/* Compares the batched evaluation of the folded and unfolded polynomials
+   with the evaluation at each point. The workspaces are used twice. */
+
+bool
+TestRunnable::poly_eval_batch(int r, int nv, int maxdim, int npoints)
+{
+  Factory fact;
+  TwoDMatrix xs(nv, npoints);
+  for (int j = 0; j < npoints; j++)
+    xs.getCol(j) = fact.makeVector(nv);
+
+  FTensorPolynomial fp{fact.makePoly<FFSTensor, FTensorPolynomial>(r, nv, maxdim)};
+  UTensorPolynomial up{fp};
+
+  TwoDMatrix out_ref(r, npoints);
+  for (int j = 0; j < npoints; j++)
+    {
+      Vector col{out_ref.getCol(j)};
+      up.evalTrad(col, xs.getCol(j));
+    }
+
+  TwoDMatrix out_fb(r, npoints);
+  TwoDMatrix out_ub(r, npoints);
+  PowerMatrices fws = fp.batchWorkspace(npoints);
+  PowerMatrices uws = up.batchWorkspace(npoints);
+  double max_err = 0.0;
+  for (int rep = 0; rep < 2; rep++)
+    {
+      clock_t fb_cl = clock();
+      fp.evalBatch(out_fb, xs, fws);
+      fb_cl = clock() - fb_cl;
+      std::cout << "\ttime for folded batch eval:    "
+                << static_cast<double>(fb_cl)/CLOCKS_PER_SEC << '\n';
+
+      clock_t ub_cl = clock();
+      up.evalBatch(out_ub, xs, uws);
+      ub_cl = clock() - ub_cl;
+      std::cout << "\ttime for unfolded batch eval:  "
+                << static_cast<double>(ub_cl)/CLOCKS_PER_SEC << '\n';
+
+      out_fb.add(-1.0, out_ref);
+      out_ub.add(-1.0, out_ref);
+      max_err = std::max({max_err, out_fb.getData().getMax(), out_ub.getData().getMax()});
+    }
+
+  std::cout << "\tbatch error norm max:            " << max_err << '\n';
+
+  return max_err < 1.0e-10;
+}
+
+/* Moment E[u_i₁…u_iₖ] of u↝𝒩(0,V) given by the Isserlis formula (the sum
+   over all pairings of the indices of the products of the covariances) */
+
+double
+TestRunnable::isserlis(const TwoDMatrix &v, const std::vector<int> &ind)
+{
+  if (ind.empty())
+    return 1.0;
+  double res = 0.0;
+  for (unsigned int k = 1; k < ind.size(); k++)
+    {
+      std::vector<int> rest;
+      for (unsigned int j = 1; j < ind.size(); j++)
+        if (j != k)
+          rest.push_back(ind[j]);
+      res += v.get(ind[0], ind[k])*isserlis(v, rest);
+    }
+  return res;
+}
+
+/* Checks the generated moments against the Isserlis formula, and checks
+   that the moments obtained from the cache are the same. */
+
+bool
+TestRunnable::normal_moments(int nv, int maxdim)
+{
+  Factory fact;
+  TwoDMatrix a(nv, nv);
+  for (int i = 0; i < nv; i++)
+    for (int j = 0; j < nv; j++)
+      a.get(i, j) = fact.get();
+  TwoDMatrix v(nv, nv);
+  v.zeros();
+  v.multAndAdd(a, a, "trans");
+
+  UNormalMoments::clearCache();
+  UNormalMoments moms(maxdim, v);
+  UNormalMoments moms_cached(maxdim, v);
+  UNormalMoments moms_lower(maxdim-2, v);
+
+  int nitems = 0;
+  int fails = 0;
+  double max_err = 0.0;
+  for (int d = 2; d <= maxdim; d += 2)
+    {
+      const URSingleTensor &t = moms.get(Symmetry{d});
+      for (auto it = t.begin(); it != t.end(); ++it, nitems++)
+        {
+          std::vector<int> ind;
+          for (int j = 0; j < d; j++)
+            ind.push_back(it.getCoor()[j]);
+          double m = isserlis(v, ind);
+          max_err = std::max(max_err, std::abs(t.get(*it, 0) - m)/std::max(std::abs(m), 1.0));
+        }
+      if (ConstVector(moms_cached.get(Symmetry{d}).getData()) != t.getData())
+        fails++;
+      if (d < maxdim && ConstVector(moms_lower.get(Symmetry{d}).getData()) != t.getData())
+        fails++;
+    }
+  if (moms_lower.check(Symmetry{maxdim}))
+    fails++;
+
+  std::cout << "\tnumber of items      = " << nitems << '\n'
+            << "\tmax relative error   = " << max_err << '\n'
+            << "\tcache failures       = " << fails << '\n';
+
+  return fails == 0 && max_err < 1e-12;
+}
+
 /****************************************************/
 /*     definition of TestRunnable subclasses        */
 /****************************************************/
@@ -749,6 +1144,94 @@ public:
   }
 };
 
+class SmallIndexTableGS : public TestRunnable
+{
+public:
+  SmallIndexTableGS()
+    : TestRunnable("small index table (44)(222)", 5, 4)
+  {
+  }
+  bool
+  run() const override
+  {
+    Symmetry s{2, 3};
+    IntSequence nvs{4, 2};
+    return index_table(s, nvs);
+  }
+};
+
+class IndexTableGS : public TestRunnable
+{
+public:
+  IndexTableGS()
+    : TestRunnable("index table (55)(222)(22)", 7, 5)
+  {
+  }
+  bool
+  run() const override
+  {
+    Symmetry s{2, 3, 2};
+    IntSequence nvs{5, 2, 2};
+    return index_table(s, nvs);
+  }
+};
+
+class StaticTables : public TestRunnable
+{
+public:
+  StaticTables()
+    : TestRunnable("static tables of equivalences and arrangements", 5, 4)
+  {
+  }
+  bool
+  run() const override
+  {
+    return static_tables(5, 4);
+  }
+};
+
+class SymmetryIndex : public TestRunnable
+{
+public:
+  SymmetryIndex()
+    : TestRunnable("symmetry index", 8, 5)
+  {
+  }
+  bool
+  run() const override
+  {
+    return symmetry_index(5, 8);
+  }
+};
+
+class IntSequenceViews : public TestRunnable
+{
+public:
+  IntSequenceViews()
+    : TestRunnable("subsequences of moved sequences", 0, 0)
+  {
+  }
+  bool
+  run() const override
+  {
+    return int_sequence_views(2*IntSequence::small_size);
+  }
+};
+
+class FoldedOffset : public TestRunnable
+{
+public:
+  FoldedOffset()
+    : TestRunnable("folded offset", 9, 5)
+  {
+  }
+  bool
+  run() const override
+  {
+    return folded_offset(5, 9);
+  }
+};
+
 class SmallFoldUnfoldFS : public TestRunnable
 {
 public:
@@ -837,6 +1320,36 @@ public:
   }
 };
 
+class SmallKronProd : public TestRunnable
+{
+public:
+  SmallKronProd()
+    : TestRunnable("small kron prod kernels (3x2)(4x3)(2x5)", 3, 5)
+  {
+  }
+  bool
+  run() const override
+  {
+    return kron_prod(7, IntSequence{3, 4, 2}, IntSequence{2, 3, 5}, -1, 1)
+      && kron_prod(7, IntSequence{3, 4, 2}, IntSequence{2, 4, 5}, 1, 1);
+  }
+};
+
+class BigKronProd : public TestRunnable
+{
+public:
+  BigKronProd()
+    : TestRunnable("kron prod kernels (6x6)^4", 4, 6)
+  {
+  }
+  bool
+  run() const override
+  {
+    return kron_prod(20, IntSequence(4, 6), IntSequence(4, 6), -1, 20)
+      && kron_prod(1, IntSequence(4, 6), IntSequence(4, 6), -1, 200);
+  }
+};
+
 class SmallDenseProd : public TestRunnable
 {
 public:
@@ -1022,6 +1535,34 @@ public:
   }
 };
 
+class PolyEvalBatch : public TestRunnable
+{
+public:
+  PolyEvalBatch()
+    : TestRunnable("batched polynomial evaluation (r=30, nv=8, maxdim=4, 500 points)", 4, 8)
+  {
+  }
+  bool
+  run() const override
+  {
+    return poly_eval_batch(30, 8, 4, 500);
+  }
+};
+
+class NormalMoments : public TestRunnable
+{
+public:
+  NormalMoments()
+    : TestRunnable("normal moments (nv=3, maxdim=8)", 8, 3)
+  {
+  }
+  bool
+  run() const override
+  {
+    return normal_moments(3, 8);
+  }
+};
+
 class FoldZContSmall : public TestRunnable
 {
 public:
@@ -1099,12 +1640,20 @@ main()
   all_tests.push_back(std::make_unique<SmallIndexOffsetUnfold>());
   all_tests.push_back(std::make_unique<IndexOffsetFold>());
   all_tests.push_back(std::make_unique<IndexOffsetUnfold>());
+  all_tests.push_back(std::make_unique<SmallIndexTableGS>());
+  all_tests.push_back(std::make_unique<IndexTableGS>());
+  all_tests.push_back(std::make_unique<StaticTables>());
+  all_tests.push_back(std::make_unique<SymmetryIndex>());
+  all_tests.push_back(std::make_unique<IntSequenceViews>());
+  all_tests.push_back(std::make_unique<FoldedOffset>());
   all_tests.push_back(std::make_unique<SmallFoldUnfoldFS>());
   all_tests.push_back(std::make_unique<SmallFoldUnfoldGS>());
   all_tests.push_back(std::make_unique<FoldUnfoldFS>());
   all_tests.push_back(std::make_unique<FoldUnfoldGS>());
   all_tests.push_back(std::make_unique<SmallFoldUnfoldR>());
   all_tests.push_back(std::make_unique<FoldUnfoldR>());
+  all_tests.push_back(std::make_unique<SmallKronProd>());
+  all_tests.push_back(std::make_unique<BigKronProd>());
   all_tests.push_back(std::make_unique<SmallDenseProd>());
   all_tests.push_back(std::make_unique<DenseProd>());
   all_tests.push_back(std::make_unique<BigDenseProd>());
@@ -1118,6 +1667,8 @@ main()
   all_tests.push_back(std::make_unique<UnfoldedContractionBig>());
   all_tests.push_back(std::make_unique<PolyEvalSmall>());
   all_tests.push_back(std::make_unique<PolyEvalBig>());
+  all_tests.push_back(std::make_unique<PolyEvalBatch>());
+  all_tests.push_back(std::make_unique<NormalMoments>());
   all_tests.push_back(std::make_unique<FoldZContSmall>());
   all_tests.push_back(std::make_unique<FoldZCont>());
   all_tests.push_back(std::make_unique<UnfoldZContSmall>());
@@ -1151,7 +1702,8 @@ main()
     }
 
   int nfailed = all_tests.size() - success;
-  std::cout << "There were " << nfailed << " tests that failed out of "
+  std::cout << "Total number of allocations: " << AllocCount::get() << '\n'
+            << "There were " << nfailed << " tests that failed out of "
             << all_tests.size() << " tests run." << std::endl;
 
   if (nfailed)
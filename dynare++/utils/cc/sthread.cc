@@ -19,6 +19,9 @@
  */
 
 #include <algorithm>
+#include <atomic>
+#include <deque>
+#include <shared_mutex>
 
 #include "sthread.hh"
 
@@ -34,39 +37,282 @@ namespace sthread
 
   int detach_thread_group::max_parallel_threads = default_threads_number();
 
-  /* We cycle through all threads in the group, and in each cycle we wait for
-     the change in the ‘counter’. If the counter indicates less than maximum
-     parallel threads running, then a new thread is run, and the iterator in
-     the list is moved.
+  /* This is the process-wide pool of persistent threads executing the
+     workers of all the groups. Every pool thread owns a deque of tasks. A
+     thread takes its own tasks from the back, and when it runs out of them it
+     steals from the front of the deques of the other threads. A thread which
+     is not in the pool (typically the main thread calling
+     detach_thread_group::run()) only steals.
 
-     At the end we have to wait for all thread to finish. */
+     The pool is created on first use and grows to ‘max_parallel_threads’−1
+     threads (the thread calling run() is the remaining one). If
+     ‘max_parallel_threads’ is later decreased, the threads beyond the limit
+     are kept, but they sleep and do not take any tasks.
+
+     Idle threads sleep on a condition variable, which is notified whenever
+     new tasks are pushed. The ‘pending’ counter holds the number of tasks
+     sitting in the deques.
+
+     The pool is never destroyed. Its threads must be joined by an explicit
+     call to shutdown_pool() (see sthread.hh): joining them from the
+     destructor of a static object would happen during the unloading of a
+     MEX file, which on Windows runs under the loader lock and deadlocks, or
+     at the exit of the process, concurrently with the destruction of other
+     static objects that the threads may still use. */
+  class thread_pool
+  {
+    struct task
+    {
+      detach_thread *worker;
+      detach_thread_group *group;
+    };
+    struct task_queue
+    {
+      std::mutex mut;
+      std::deque<task> tasks;
+    };
+
+    std::vector<std::unique_ptr<task_queue>> queues;
+    std::shared_mutex mut_queues; // Protects ‘queues’ against growing
+    std::vector<std::thread> threads;
+    std::mutex mut_pool; // For the condition variable, ‘active’ and ‘stop’
+    std::condition_variable cv;
+    std::atomic<int> pending{0};
+    int active{0}; // Number of pool threads allowed to take tasks
+    bool stop{false};
+    std::atomic<unsigned> next_queue{0}; // For the round-robin distribution of external tasks
+
+    // Index of the pool thread in ‘threads’, −1 for threads out of the pool
+    static thread_local int self;
+
+    thread_pool()
+    {
+      queues.push_back(std::make_unique<task_queue>());
+    }
+  public:
+    thread_pool(const thread_pool &) = delete;
+    thread_pool &operator=(const thread_pool &) = delete;
+
+    static thread_pool &
+    instance()
+    {
+      static auto *pool = new thread_pool;
+      return *pool;
+    }
+
+    void submit(detach_thread_group &group);
+    void help(detach_thread_group &group);
+    void shutdown();
+  private:
+    int adjust();
+    bool acquire(task &t);
+    static void execute(const task &t);
+    void loop(int i);
+  };
+
+  thread_local int thread_pool::self = -1;
+
+  /* Grows the pool to ‘max_parallel_threads’−1 threads if needed, sets
+     and returns the number of active threads. */
+  int
+  thread_pool::adjust()
+  {
+    int want = std::max(0, detach_thread_group::max_parallel_threads - 1);
+    std::lock_guard<std::mutex> lk{mut_pool};
+    if (want > static_cast<int>(threads.size()))
+      {
+        {
+          std::unique_lock<std::shared_mutex> wlk{mut_queues};
+          while (static_cast<int>(queues.size()) < want)
+            queues.push_back(std::make_unique<task_queue>());
+        }
+        for (int i = threads.size(); i < want; i++)
+          threads.emplace_back([this, i] { loop(i); });
+      }
+    active = want;
+    return active;
+  }
+
+  /* The tasks of a group submitted from a pool thread (nested group) are
+     pushed to its own deque, the others steal them. The tasks submitted from
+     outside of the pool are distributed in a round-robin fashion among the
+     deques of the active threads. */
   void
-  detach_thread_group::run()
+  thread_pool::submit(detach_thread_group &group)
+  {
+    int nactive = self < 0 ? adjust() : 0;
+
+    {
+      std::shared_lock<std::shared_mutex> rlk{mut_queues};
+      if (self >= 0)
+        {
+          std::lock_guard<std::mutex> qlk{queues[self]->mut};
+          for (auto &w : group.tlist)
+            queues[self]->tasks.push_back({w.get(), &group});
+        }
+      else
+        {
+          int nq = std::max(1, std::min(nactive, static_cast<int>(queues.size())));
+          for (auto &w : group.tlist)
+            {
+              int i = next_queue++ % nq;
+              std::lock_guard<std::mutex> qlk{queues[i]->mut};
+              queues[i]->tasks.push_back({w.get(), &group});
+            }
+        }
+    }
+
+    pending += static_cast<int>(group.tlist.size());
+    /* Lock and unlock the pool mutex before notifying, so that a thread
+       which has just evaluated the waiting predicate cannot miss the
+       notification. */
+    {
+      std::lock_guard<std::mutex> lk{mut_pool};
+    }
+    cv.notify_all();
+  }
+
+  /* Takes a task, first from the back of the own deque (if any), then from
+     the front of the others. */
+  bool
+  thread_pool::acquire(task &t)
   {
-    std::unique_lock<std::mutex> lk{mut_cv};
-    auto it = tlist.begin();
-    while (it != tlist.end())
+    if (pending.load() == 0)
+      return false;
+    std::shared_lock<std::shared_mutex> rlk{mut_queues};
+    int nq = queues.size();
+    if (self >= 0)
+      {
+        std::lock_guard<std::mutex> qlk{queues[self]->mut};
+        auto &tasks = queues[self]->tasks;
+        if (!tasks.empty())
+          {
+            t = tasks.back();
+            tasks.pop_back();
+            pending--;
+            return true;
+          }
+      }
+    int start = self >= 0 ? self+1 : 0;
+    for (int k = 0; k < nq; k++)
       {
-        counter++;
-        std::thread th{[&, it] {
-                         // The ‘it’ variable is captured by value, because otherwise the iterator may move
-                         (*it)->operator()(mut_threads);
-                         std::unique_lock<std::mutex> lk2{mut_cv};
-                         counter--;
-                         /* First notify the thread waiting on the condition variable, then
-                            unlock the mutex. We must do these two operations in that order,
-                            otherwise there is a possibility of having the main process
-                            destroying the condition variable before the thread tries to
-                            notify it (if all other threads terminate at the same time and
-                            bring the counter down to zero).
-                            For that reason, we cannot use std::notify_all_at_thread_exit() */
-                         cv.notify_one();
-                         lk2.unlock();
-                       }};
-        th.detach();
-        ++it;
-        cv.wait(lk, [&] { return counter < max_parallel_threads; });
+        int i = (start + k) % nq;
+        if (i == self)
+          continue;
+        std::lock_guard<std::mutex> qlk{queues[i]->mut};
+        auto &tasks = queues[i]->tasks;
+        if (!tasks.empty())
+          {
+            t = tasks.front();
+            tasks.pop_front();
+            pending--;
+            return true;
+          }
       }
-    cv.wait(lk, [&] { return counter == 0; });
+    return false;
+  }
+
+  void
+  thread_pool::execute(const task &t)
+  {
+    std::exception_ptr e;
+    try
+      {
+        t.worker->operator()(t.group->mut_threads);
+      }
+    catch (...)
+      {
+        e = std::current_exception();
+      }
+    t.group->finished(e);
+  }
+
+  void
+  thread_pool::loop(int i)
+  {
+    self = i;
+    while (true)
+      {
+        task t;
+        if (acquire(t))
+          {
+            execute(t);
+            continue;
+          }
+        std::unique_lock<std::mutex> lk{mut_pool};
+        cv.wait(lk, [&] { return stop || (pending.load() > 0 && self < active); });
+        if (stop)
+          return;
+      }
+  }
+
+  /* The calling thread executes tasks (of any group) as long as there are
+     some, and then waits for the workers of its group running in the other
+     threads. */
+  void
+  thread_pool::help(detach_thread_group &group)
+  {
+    task t;
+    while (acquire(t))
+      {
+        execute(t);
+        std::lock_guard<std::mutex> lk{group.mut_cv};
+        if (group.counter == 0)
+          return;
+      }
+    std::unique_lock<std::mutex> lk{group.mut_cv};
+    group.cv.wait(lk, [&] { return group.counter == 0; });
+  }
+
+  /* Stops and joins the threads. The queues are empty since no group is
+     running, and the pool grows again at the next submit(). */
+  void
+  thread_pool::shutdown()
+  {
+    {
+      std::lock_guard<std::mutex> lk{mut_pool};
+      stop = true;
+    }
+    cv.notify_all();
+    for (auto &th : threads)
+      th.join();
+    std::lock_guard<std::mutex> lk{mut_pool};
+    threads.clear();
+    active = 0;
+    stop = false;
+  }
+
+  /* Called by the pool once a worker of the group is done. The notification
+     is done before unlocking the mutex, otherwise the thread in run() could
+     return and destroy the condition variable before it is notified. */
+  void
+  detach_thread_group::finished(std::exception_ptr e)
+  {
+    std::lock_guard<std::mutex> lk{mut_cv};
+    if (e && !error)
+      error = e;
+    counter--;
+    if (counter == 0)
+      cv.notify_all();
+  }
+
+  void
+  detach_thread_group::run()
+  {
+    if (tlist.empty())
+      return;
+    counter = tlist.size();
+    error = nullptr;
+    thread_pool &pool = thread_pool::instance();
+    pool.submit(*this);
+    pool.help(*this);
+    if (error)
+      std::rethrow_exception(error);
+  }
+
+  void
+  shutdown_pool()
+  {
+    thread_pool::instance().shutdown();
   }
 }
@@ -28,26 +28,35 @@
      method operator()() be implemented as the running code of the thread.
 
    — detach_thread_group allows insertion of detach_thread’s and running all of
-     them simultaneously. The threads are not joined, they are synchronized by
-     means of a counter counting running threads. A change of the counter is
-     checked by waiting on an associated condition. The number of maximum
-     parallel threads can be controlled. See below. The group also provides a
-     mutex to be shared between the workers for their own synchronization
-     purposes.
+     them simultaneously. The workers are not run in freshly created threads,
+     they are pushed as tasks to a process-wide pool of persistent threads
+     (see thread_pool in sthread.cc). Each pool thread has its own deque of
+     tasks and idle threads steal from the others, so that groups with many
+     small workers are well balanced. The thread calling run() takes part in
+     the execution until all the workers of its group are finished, which
+     makes nested groups (a worker running a group) safe. The group also
+     provides a mutex to be shared between the workers for their own
+     synchronization purposes.
 
    The number of maximum parallel threads is controlled via a static member of
-   the detach_thread_group class. */
+   the detach_thread_group class. It may be changed at any time between two
+   calls to run(), the pool is adjusted accordingly.
+
+   The threads of the pool are not joined automatically. A program declares a
+   pool_shutdown_guard in main(), and a MEX file registers shutdown_pool()
+   with mexAtExit(), so that the threads are joined before the file is
+   unloaded. */
 
 #ifndef STHREAD_H
 #define STHREAD_H
 
 #include <vector>
-#include <map>
 #include <memory>
 #include <utility>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
+#include <exception>
 
 namespace sthread
 {
@@ -60,10 +69,12 @@ namespace sthread
 
   class detach_thread_group
   {
+    friend class thread_pool;
     std::vector<std::unique_ptr<detach_thread>> tlist;
     std::mutex mut_cv; // For the condition variable and the counter
     std::condition_variable cv;
-    int counter{0};
+    int counter{0}; // Number of workers not yet finished
+    std::exception_ptr error; // First exception thrown by a worker
     std::mutex mut_threads; // Passed to the workers and shared between them
   public:
     static int max_parallel_threads;
@@ -76,10 +87,33 @@ namespace sthread
 
     ~detach_thread_group() = default;
 
+    /* Runs all the inserted workers and returns when all of them are
+       finished. If a worker throws, the first exception is rethrown here
+       once the other workers are done. */
     void run();
+  private:
+    void finished(std::exception_ptr e);
   };
 
   int default_threads_number();
+
+  /* Stops and joins the threads of the pool. It must not be called while a
+     group is running. A later run() starts new threads. */
+  void shutdown_pool();
+
+  /* Calls shutdown_pool() at the end of its scope. An instance declared at
+     the beginning of main() joins the threads on every return path. */
+  class pool_shutdown_guard
+  {
+  public:
+    pool_shutdown_guard() = default;
+    pool_shutdown_guard(const pool_shutdown_guard &) = delete;
+    pool_shutdown_guard &operator=(const pool_shutdown_guard &) = delete;
+    ~pool_shutdown_guard()
+    {
+      shutdown_pool();
+    }
+  };
 };
 
 #endif
@@ -336,6 +336,11 @@ options_.simul_replic = 1;
 options_.drop = 100;
 options_.aim_solver = false; % i.e. by default do not use G.Anderson's AIM solver, use mjdgges instead
 options_.k_order_solver = false; % by default do not use k_order_perturbation but mjdgges
+options_.k_order_checkpoint = ''; % file where k_order_perturbation saves the derivatives after each order
+options_.k_order_resume = false; % whether k_order_perturbation resumes from options_.k_order_checkpoint
+options_.k_order_sylv_mixed_precision = false; % whether k_order_perturbation solves the Sylvester equations in single precision with refinement
+options_.k_order_rule_codegen = ''; % file where k_order_perturbation writes the decision rule as C code
+options_.k_order_rule_lib = ''; % shared library compiled from that code, used by the simulations of the rule
 options_.partial_information = false;
 options_.ACES_solver = false;
 options_.conditional_variance_decomposition = [];
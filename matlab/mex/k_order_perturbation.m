@@ -1,10 +1,18 @@
-% [dynpp_derivs, dyn_derivs] = k_order_perturbation(dr,DynareModel,DynareOptions)
+% [dynpp_derivs, dyn_derivs, rule_derivs] = k_order_perturbation(dr,DynareModel,DynareOptions[,prev_rule_derivs])
 % computes a k-th order perturbation solution
 %
 % INPUTS
 % dr:            struct   describing the reduced form solution of the model.
 % DynareModel:   struct   jobs's parameters
 % DynareOptions: struct   job's options
+% prev_rule_derivs: struct (optional) rule_derivs output of a previous call
+%                         for the same model and parameters, typically at a
+%                         lower order. The first order problem is always
+%                         solved; the first order derivatives found in
+%                         prev_rule_derivs must match its solution (otherwise
+%                         an error is raised), and its higher order
+%                         derivatives are reused, so that only the missing
+%                         orders are computed.
 %
 % OUTPUTS
 % dynpp_derivs   struct   Derivatives of the decision rule in Dynare++ format.
@@ -20,6 +28,12 @@
 %                          + gy, gu
 %                          + if order ≥ 2: gyy, gyu, guu, gss
 %                          + if order ≥ 3: gyyy, gyyu, gyuu, guuu, gyss, guss
+% rule_derivs    struct   Derivatives of the decision rule in Dynare++ format,
+%                         separated as in dyn_derivs, for all orders. The tensors
+%                         are folded and the Taylor coefficients aren't included.
+%                         The field g_i_j_k_l contains the derivative w.r.t. i
+%                         state variables, j shocks and l times σ (k is always
+%                         0). It can be passed back as prev_rule_derivs.
 %
 % k_order_perturbation is a compiled MEX function. Its source code is in
 % dynare/mex/sources/k_order_perturbation.cc and it uses code provided by
@@ -40,5 +40,11 @@ for i=1:(kron_prod-1)
     C  = kron(C0,C);
 end
 
-x0 = sylvester3(A,B,C,D);
-E  = sylvester3a(x0,A,B,C,D);
+% D may hold several right hand sides side by side
+nc = size(C,1);
+E = zeros(size(D));
+for j=1:size(D,2)/nc
+    cols = (j-1)*nc+1:j*nc;
+    x0 = sylvester3(A,B,C,D(:,cols));
+    E(:,cols) = sylvester3a(x0,A,B,C,D(:,cols));
+end
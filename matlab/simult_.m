@@ -56,7 +56,7 @@ if options_.k_order_solver && ~options_.pruning % Call dynare++ routines.
     ex_ = [zeros(M_.maximum_lag,M_.exo_nbr); ex_];
     y_ = dynare_simul_(options_.order,M_.nstatic,M_.npred,M_.nboth,M_.nfwrd,exo_nbr, ...
                        y_(dr.order_var,1),ex_',M_.Sigma_e,options_.DynareRandomStreams.seed, ...
-                       dr.ys(dr.order_var),dr);
+                       dr.ys(dr.order_var),dr,options_.k_order_rule_lib);
     y_(dr.order_var,:) = y_;
 else
     if options_.block
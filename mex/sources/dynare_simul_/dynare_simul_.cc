@@ -33,6 +33,9 @@
 //      seed     integer seed
 //      ysteady  full vector of decision rule's steady
 //      dr       structure containing matrices of derivatives (g_0, g_1,…)
+//      rule_lib (optional) shared library compiled from the C code of the
+//               decision rule (see CompiledRule), used instead of the
+//               derivatives if not empty
 
 // output:
 //      res      simulated results
@@ -44,6 +47,7 @@
 #include "fs_tensor.hh"
 #include "SylvException.hh"
 
+#include <memory>
 #include <string>
 
 extern "C" {
@@ -51,8 +55,8 @@ extern "C" {
   mexFunction(int nlhs, mxArray *plhs[],
               int nhrs, const mxArray *prhs[])
   {
-    if (nhrs != 12 || nlhs != 1)
-      mexErrMsgTxt("dynare_simul_ must have at exactly 12 input parameters and 1 output argument.");
+    if (nhrs < 12 || nhrs > 13 || nlhs != 1)
+      mexErrMsgTxt("dynare_simul_ must have 12 or 13 input parameters and 1 output argument.");
 
     int order = static_cast<int>(mxGetScalar(prhs[0]));
     int nstat = static_cast<int>(mxGetScalar(prhs[1]));
@@ -67,6 +71,14 @@ extern "C" {
     int seed = static_cast<int>(mxGetScalar(prhs[9]));
     const mxArray *const ysteady = prhs[10];
     const mxArray *const dr = prhs[11];
+    std::string rule_lib;
+    if (nhrs > 12)
+      {
+        if (!mxIsChar(prhs[12]))
+          mexErrMsgTxt("rule_lib should be a character string.\n");
+        if (mxGetNumberOfElements(prhs[12]) > 0)
+          rule_lib = mxArrayToString(prhs[12]);
+      }
     const mwSize *const ystart_dim = mxGetDimensions(ystart);
     const mwSize *const shocks_dim = mxGetDimensions(shocks);
     const mwSize *const vcov_dim = mxGetDimensions(vcov);
@@ -116,6 +128,8 @@ extern "C" {
         // form the decision rule
         UnfoldDecisionRule dr(pol, PartitionY(nstat, npred, nboth, nforw),
                               nexog, ConstVector{ysteady});
+        if (!rule_lib.empty())
+          dr.setCompiled(std::make_shared<const CompiledRule>(rule_lib));
         // form the shock realization
         ConstTwoDMatrix shocks_mat(nexog, nper, ConstVector{shocks});
         ConstTwoDMatrix vcov_mat(nexog, nexog, ConstVector{vcov});
@@ -25,25 +25,54 @@
 #include "SylvException.hh"
 #include "int_power.hh"
 
+#include <vector>
+
+/* The matrix X holds ‘nrhs’ right hand sides side by side. They are solved
+   with the same decomposition of A, B and C, concurrently. */
+
 void
 gen_sylv_solve(int order, int n, int m, int zero_cols,
                const ConstVector &A, const ConstVector &B,
-               const ConstVector &C, Vector &X)
+               const ConstVector &C, Vector &X, int nrhs)
 {
-  GeneralSylvester s(order, n, m, zero_cols, A, B, C, X, false);
-  s.solve();
+  GeneralSylvesterDecomp decomp(n, m, zero_cols, A, B, C, SylvParams(false));
+  int len = X.length()/nrhs;
+  std::vector<Vector> blocks;
+  blocks.reserve(nrhs);
+  std::vector<Vector *> ptrs;
+  for (int k = 0; k < nrhs; k++)
+    {
+      blocks.emplace_back(X, k*len, len);
+      ptrs.push_back(&blocks.back());
+    }
+  decomp.solve(order, ptrs);
 }
 
+/* Solves and checks each right hand side. Returns the structure of the
+   diagnostics if there is only one right hand side, and a cell array of
+   them otherwise. */
+
 mxArray *
 gen_sylv_solve_and_check(int order, int n, int m, int zero_cols,
                          const ConstVector &A, const ConstVector &B,
                          const ConstVector &C, const ConstVector &D,
-                         Vector &X)
+                         Vector &X, int nrhs)
 {
-  GeneralSylvester s(order, n, m, zero_cols, A, B, C, X, true);
-  s.solve();
-  s.check(D);
-  return s.getParams().createStructArray();
+  GeneralSylvesterDecomp decomp(n, m, zero_cols, A, B, C, SylvParams(true));
+  int len = X.length()/nrhs;
+  mxArray *res = nrhs > 1 ? mxCreateCellMatrix(1, nrhs) : nullptr;
+  for (int k = 0; k < nrhs; k++)
+    {
+      Vector x(X, k*len, len);
+      SylvParams pars(decomp.getParams());
+      decomp.solve(order, x, pars);
+      decomp.check(order, x, ConstVector(D, k*len, len), pars);
+      if (nrhs > 1)
+        mxSetCell(res, k, pars.createStructArray());
+      else
+        res = pars.createStructArray();
+    }
+  return res;
 }
 
 extern "C" {
@@ -74,12 +103,13 @@ extern "C" {
       mexErrMsgTxt("Matrix C must be square.");
     if (Bdims[0] < Bdims[1])
       mexErrMsgTxt("Matrix B must not have more columns than rows.");
-    if (Ddims[1] != static_cast<mwSize>(power(Cdims[0], order)))
+    if (Ddims[1] == 0 || Ddims[1] % static_cast<mwSize>(power(Cdims[0], order)) != 0)
       mexErrMsgTxt("Matrix D has wrong number of columns.");
 
     auto n = static_cast<int>(Adims[0]);
     auto m = static_cast<int>(Cdims[0]);
     auto zero_cols = static_cast<int>(Bdims[0] - Bdims[1]);
+    auto nrhs = static_cast<int>(Ddims[1] / power(Cdims[0], order));
     mxArray *X = mxCreateDoubleMatrix(Ddims[0], Ddims[1], mxREAL);
     // copy D to X
     ConstVector Avec{A}, Bvec{B}, Cvec{C}, Dvec{D};
@@ -89,9 +119,9 @@ extern "C" {
     try
       {
         if (nlhs == 1)
-          gen_sylv_solve(order, n, m, zero_cols, Avec, Bvec, Cvec, Xvec);
+          gen_sylv_solve(order, n, m, zero_cols, Avec, Bvec, Cvec, Xvec, nrhs);
         else if (nlhs == 2)
-          plhs[1] = gen_sylv_solve_and_check(order, n, m, zero_cols, Avec, Bvec, Cvec, Dvec, Xvec);
+          plhs[1] = gen_sylv_solve_and_check(order, n, m, zero_cols, Avec, Bvec, Cvec, Dvec, Xvec, nrhs);
       }
     catch (const SylvException &e)
       {
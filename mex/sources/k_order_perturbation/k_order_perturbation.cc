@@ -36,6 +36,7 @@
 
 #include <algorithm>
 #include <cassert>
+#include <cstdio>
 
 #include "dynmex.h"
 
@@ -76,14 +77,67 @@ copy_derivatives(mxArray *destin, const Symmetry &sym, const FGSContainer &deriv
   mxSetField(destin, 0, fieldname, tmp);
 }
 
+/* Derivatives g_yⁱuʲu′ᵏσˡ of the decision rule about the deterministic steady
+   state, as stored by KOrder, are exchanged with MATLAB in a structure whose
+   fields are named “g_i_j_k_l” and contain the folded tensors. */
+
+std::string
+rule_derivative_fieldname(const Symmetry &sym)
+{
+  std::string name = "g";
+  for (int i = 0; i < sym.num(); i++)
+    name += '_' + std::to_string(sym[i]);
+  return name;
+}
+
+mxArray *
+rule_derivatives_to_struct(const FGSContainer &derivs)
+{
+  mxArray *res = mxCreateStructMatrix(1, 1, 0, nullptr);
+  for (const auto &it : derivs)
+    {
+      std::string name = rule_derivative_fieldname(it.first);
+      const FGSTensor &t = *it.second;
+      mxArray *tmp = mxCreateDoubleMatrix(t.nrows(), t.ncols(), mxREAL);
+      std::copy_n(t.getData().base(), t.getData().length(), mxGetPr(tmp));
+      mxSetFieldByNumber(res, 0, mxAddField(res, name.c_str()), tmp);
+    }
+  return res;
+}
+
+FGSContainer
+struct_to_rule_derivatives(const mxArray *derivs_mx, int ny, const IntSequence &nvs)
+{
+  if (!(mxIsStruct(derivs_mx) && mxGetNumberOfElements(derivs_mx) == 1))
+    mexErrMsgTxt("The previous derivatives should be a scalar structure");
+  FGSContainer res(4);
+  for (int f = 0; f < mxGetNumberOfFields(derivs_mx); f++)
+    {
+      std::string name{mxGetFieldNameByNumber(derivs_mx, f)};
+      Symmetry sym{0, 0, 0, 0};
+      if (std::sscanf(name.c_str(), "g_%d_%d_%d_%d", &sym[0], &sym[1], &sym[2], &sym[3]) != 4
+          || name != rule_derivative_fieldname(sym))
+        mexErrMsgTxt(("Field `" + name + "' of the previous derivatives is not of the form g_i_j_k_l").c_str());
+      auto t = std::make_unique<FGSTensor>(ny, TensorDimens(sym, nvs));
+      const mxArray *field_mx = mxGetFieldByNumber(derivs_mx, 0, f);
+      if (!(mxIsDouble(field_mx) && !mxIsComplex(field_mx)
+            && mxGetM(field_mx) == static_cast<size_t>(t->nrows())
+            && mxGetN(field_mx) == static_cast<size_t>(t->ncols())))
+        mexErrMsgTxt(("Field `" + name + "' of the previous derivatives has wrong dimensions").c_str());
+      std::copy_n(mxGetPr(field_mx), t->getData().length(), t->getData().base());
+      res.insert(std::move(t));
+    }
+  return res;
+}
+
 extern "C" {
 
   void
   mexFunction(int nlhs, mxArray *plhs[],
               int nrhs, const mxArray *prhs[])
   {
-    if (nrhs != 3 || nlhs < 1 || nlhs > 2)
-      mexErrMsgTxt("Must have exactly 3 input parameters and takes 1 or 2 output parameters.");
+    if (nrhs < 3 || nrhs > 4 || nlhs < 1 || nlhs > 3)
+      mexErrMsgTxt("Must have 3 or 4 input parameters and takes 1 to 3 output parameters.");
 
     // Give explicit names to input arguments
     const mxArray *dr_mx = prhs[0];
@@ -113,6 +167,28 @@ extern "C" {
     if (qz_criterium_mx && mxIsScalar(qz_criterium_mx) && mxIsNumeric(qz_criterium_mx))
       qz_criterium = mxGetScalar(qz_criterium_mx);
 
+    // Optional checkpoint file of the derivatives (see Approximation::setCheckpoint())
+    std::string checkpoint;
+    const mxArray *checkpoint_mx = mxGetField(options_mx, 0, "k_order_checkpoint");
+    if (checkpoint_mx && mxIsChar(checkpoint_mx) && mxGetNumberOfElements(checkpoint_mx) > 0)
+      checkpoint = mxArrayToString(checkpoint_mx);
+    bool resume = false;
+    const mxArray *resume_mx = mxGetField(options_mx, 0, "k_order_resume");
+    if (resume_mx && mxIsLogicalScalar(resume_mx))
+      resume = static_cast<bool>(mxGetScalar(resume_mx));
+
+    // Whether the Sylvester equations are solved in mixed precision (see GeneralSylvester.hh)
+    bool sylv_mixed = false;
+    const mxArray *sylv_mixed_mx = mxGetField(options_mx, 0, "k_order_sylv_mixed_precision");
+    if (sylv_mixed_mx && mxIsLogicalScalar(sylv_mixed_mx))
+      sylv_mixed = static_cast<bool>(mxGetScalar(sylv_mixed_mx));
+
+    // Optional file where the C code of the decision rule is written (see CompiledRule)
+    std::string rule_codegen;
+    const mxArray *rule_codegen_mx = mxGetField(options_mx, 0, "k_order_rule_codegen");
+    if (rule_codegen_mx && mxIsChar(rule_codegen_mx) && mxGetNumberOfElements(rule_codegen_mx) > 0)
+      rule_codegen = mxArrayToString(rule_codegen_mx);
+
     const mxArray *threads_mx = mxGetField(options_mx, 0, "threads");
     if (!threads_mx)
       mexErrMsgTxt("Can't find field options_.threads");
@@ -216,8 +292,9 @@ extern "C" {
         // intiate tensor library
         TLStatic::init(kOrder, nStat+2*nPred+3*nBoth+2*nForw+nExog);
 
-        // Set number of parallel threads
+        // Set number of parallel threads, and join them when the MEX is cleared
         sthread::detach_thread_group::max_parallel_threads = num_threads;
+        mexAtExit(sthread::shutdown_pool);
 
         // make KordpDynare object
         KordpDynare dynare(endoNames, exoNames, nExog, nPar,
@@ -227,10 +304,17 @@ extern "C" {
 
         // construct main K-order approximation class
         Approximation app(dynare, journal, nSteps, false, qz_criterium);
+        app.setCheckpoint(checkpoint, resume);
+        app.setSylvMixedPrecision(sylv_mixed);
+        if (nrhs > 3)
+          app.setPreviousDerivatives(struct_to_rule_derivatives(prhs[3], nEndo,
+                                                                IntSequence{nPred+nBoth, nExog, nExog, 1}));
         // run stochastic steady
         app.walkStochSteady();
 
         const FoldDecisionRule &fdr = app.getFoldDecisionRule();
+        if (!rule_codegen.empty())
+          CompiledRule::writeC(fdr, rule_codegen);
 
         // Add possibly missing field names
         for (int i = static_cast<int>(g_fieldnames.size()); i <= kOrder; i++)
@@ -283,6 +367,9 @@ extern "C" {
                 copy_derivatives(plhs[1], Symmetry{0, 1, 0, 2}, derivs, "guss");
               }
           }
+
+        if (nlhs > 2)
+          plhs[2] = rule_derivatives_to_struct(app.get_rule_ders());
       }
     catch (const KordException &e)
       {
@@ -247,8 +247,9 @@ extern "C" {
     // intiate tensor library
     TLStatic::init(kOrder, nStat+2*nPred+3*nBoth+2*nForw+nExog);
 
-    // Set number of parallel threads
+    // Set number of parallel threads, and join them when the MEX is cleared
     sthread::detach_thread_group::max_parallel_threads = num_threads;
+    mexAtExit(sthread::shutdown_pool);
 
     // make KordpDynare object
     KordpDynare dynare(endoNames, exoNames, nExog, nPar,
@@ -17,6 +17,7 @@
  * along with Dynare.  If not, see <https://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
 #include <memory>
 #include <string>
 #include <utility>
@@ -40,41 +41,52 @@ struct ParticleWorker : public sthread::detach_thread
   const std::pair<size_t, size_t> particle_range;
   const ConstGeneralMatrix &yhat, &epsilon;
   const Vector &ys_reordered;
-  const UnfoldDecisionRule &dr;
+  const FoldDecisionRule &dr;
   const ConstVector &restrict_var_list;
   GeneralMatrix &ynext;
 
   ParticleWorker(int npred_both_arg, int exo_nbr_arg, std::pair<size_t, size_t> particle_range_arg,
                  const ConstGeneralMatrix &yhat_arg, const ConstGeneralMatrix &epsilon_arg,
-                 const Vector &ys_reordered_arg, const UnfoldDecisionRule &dr_arg,
+                 const Vector &ys_reordered_arg, const FoldDecisionRule &dr_arg,
                  const ConstVector &restrict_var_list_arg, GeneralMatrix &ynext_arg)
     : npred_both{npred_both_arg}, exo_nbr{exo_nbr_arg}, particle_range{std::move(particle_range_arg)},
       yhat{yhat_arg}, epsilon{epsilon_arg}, ys_reordered{ys_reordered_arg}, dr{dr_arg},
       restrict_var_list{restrict_var_list_arg}, ynext{ynext_arg}
   {
   }
+  /* The particles are processed in blocks, and the decision rule is
+     evaluated on all the particles of a block at once (see
+     TensorPolynomial::evalBatch()). */
   void
   operator()(std::mutex &mut) override
   {
-    Vector dyu(npred_both+exo_nbr);
-    Vector dy(dyu, 0, npred_both);
-    Vector u(dyu, npred_both, exo_nbr);
-    Vector ynext_col_allvars(ys_reordered.length());
+    int nparticles = particle_range.second - particle_range.first;
+    PowerMatrices ws = dr.batchWorkspace(nparticles);
+    int nblock = ws.maxCols();
+    GeneralMatrix dyu(npred_both+exo_nbr, nblock);
+    GeneralMatrix ynext_allvars(ys_reordered.length(), nblock);
 
-    for (size_t i = particle_range.first; i < particle_range.second; i++)
+    for (size_t i = particle_range.first; i < particle_range.second; i += nblock)
       {
-        dy = yhat.getCol(i);
-        u = epsilon.getCol(i);
-
-        dr.eval(DecisionRule::emethod::horner, ynext_col_allvars, dyu);
-
-        ynext_col_allvars.add(1.0, ys_reordered);
-
-        /* Select only the variables in restrict_var_list, and copy back to the
-           result matrix */
-        Vector ynext_col{ynext.getCol(i)};
-        for (int j = 0; j < restrict_var_list.length(); j++)
-          ynext_col[j] = ynext_col_allvars[restrict_var_list[j]-1];
+        int ncols = std::min(static_cast<size_t>(nblock), particle_range.second - i);
+        GeneralMatrix dyu_block(dyu, 0, 0, npred_both+exo_nbr, ncols);
+        dyu_block.place(ConstGeneralMatrix(yhat, 0, i, npred_both, ncols), 0, 0);
+        dyu_block.place(ConstGeneralMatrix(epsilon, 0, i, exo_nbr, ncols), npred_both, 0);
+        GeneralMatrix ynext_block(ynext_allvars, 0, 0, ys_reordered.length(), ncols);
+
+        dr.evalBatch(ynext_block, dyu_block, ws);
+
+        /* Select only the variables in restrict_var_list, add the steady
+           state, and copy back to the result matrix */
+        for (int k = 0; k < ncols; k++)
+          {
+            Vector ynext_col{ynext.getCol(i+k)};
+            for (int j = 0; j < restrict_var_list.length(); j++)
+              {
+                int v = static_cast<int>(restrict_var_list[j])-1;
+                ynext_col[j] = ynext_block.get(v, k) + ys_reordered[v];
+              }
+          }
       }
   }
 };
@@ -146,8 +158,10 @@ mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
       mexErrMsgTxt(("Dynare++ error: " + e.message).c_str());
     }
 
-  // Form the polynomial (copied from dynare_simul_.cc)
-  UTensorPolynomial pol(endo_nbr, npred+nboth+exo_nbr);
+  /* Form the polynomial (adapted from dynare_simul_.cc). It is kept folded,
+     since the Kronecker powers of the particles in the batched evaluation are
+     much smaller in the folded form. */
+  FTensorPolynomial pol(endo_nbr, npred+nboth+exo_nbr);
   for (int dim = 0; dim <= order; dim++)
     {
       const mxArray *gk_m = mxGetField(dr_mx, 0, ("g_" + std::to_string(dim)).c_str());
@@ -161,7 +175,7 @@ mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
         mexErrMsgTxt(("Wrong number of rows for folded tensor: got " + std::to_string(gk.nrows()) + " but i want " + std::to_string(ft.nrows()) + '\n').c_str());
       ft.zeros();
       ft.add(1.0, gk);
-      pol.insert(std::make_unique<UFSTensor>(ft));
+      pol.insert(std::make_unique<FFSTensor>(ft));
     }
 
   // Construct the reordered steady state (dr.ys(dr.order_var))
@@ -170,15 +184,29 @@ mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[])
     ys_reordered[i] = ys[static_cast<int>(order_var[i])-1];
 
   // Form the decision rule
-  UnfoldDecisionRule dr(pol, PartitionY(nstatic, npred, nboth, nfwrd),
-                        exo_nbr, ys_reordered);
+  FoldDecisionRule dr(pol, PartitionY(nstatic, npred, nboth, nfwrd),
+                      exo_nbr, ys_reordered);
+
+  /* Use the rule compiled from its C code if options_.k_order_rule_lib is
+     given (see CompiledRule) */
+  const mxArray *rule_lib_mx = mxGetField(options_mx, 0, "k_order_rule_lib");
+  if (rule_lib_mx && mxIsChar(rule_lib_mx) && mxGetNumberOfElements(rule_lib_mx) > 0)
+    try
+      {
+        dr.setCompiled(std::make_shared<const CompiledRule>(mxArrayToString(rule_lib_mx)));
+      }
+    catch (KordException &e)
+      {
+        mexErrMsgTxt(("Dynare++ error: " + e.get_message()).c_str());
+      }
 
   // Create the result matrix
   plhs[0] = mxCreateDoubleMatrix(restrict_var_list.length(), nparticles, mxREAL);
   GeneralMatrix ynext{plhs[0]};
 
-  // Run the real job in parallel
+  // Run the real job in parallel, and join the threads when the MEX is cleared
   sthread::detach_thread_group::max_parallel_threads = num_threads;
+  mexAtExit(sthread::shutdown_pool);
   sthread::detach_thread_group group;
   // The following is equivalent to ceil(nparticles/num_threads), but with integer arithmetic
   int part_by_thread = nparticles / num_threads + (nparticles % num_threads > 0);